@@ -0,0 +1,67 @@
+AC_ARG_ENABLE([snappy],
+              [AS_HELP_STRING([--enable-snappy=@<:@auto/yes/no@:>@],
+                              [Use libsnappy for wire protocol compression.])],
+              [],
+              [enable_snappy=auto])
+
+AC_ARG_ENABLE([zlib],
+              [AS_HELP_STRING([--enable-zlib=@<:@auto/yes/no@:>@],
+                              [Use zlib for wire protocol compression.])],
+              [],
+              [enable_zlib=auto])
+
+dnl Snappy
+AS_IF([test "$enable_snappy" != "no"],[
+  PKG_CHECK_MODULES(SNAPPY, [snappy], [enable_snappy=yes], [
+    AC_CHECK_LIB([snappy],[snappy_compress],[have_snappy_lib=yes],[have_snappy_lib=no])
+    AC_CHECK_HEADER([snappy-c.h],[have_snappy_headers=yes],[have_snappy_headers=no])
+    if test "$have_snappy_lib" = "yes" -a "$have_snappy_headers" = "yes" ; then
+      enable_snappy=yes
+      SNAPPY_LIBS=-lsnappy
+    elif test "$enable_snappy" = "yes" ; then
+      AC_MSG_ERROR([You must install the snappy library and development headers to enable snappy compression.])
+    else
+      enable_snappy=no
+    fi
+  ])
+])
+
+dnl Zlib
+AS_IF([test "$enable_zlib" != "no"],[
+  PKG_CHECK_MODULES(ZLIB, [zlib], [enable_zlib=yes], [
+    AC_CHECK_LIB([z],[compress2],[have_zlib_lib=yes],[have_zlib_lib=no])
+    AC_CHECK_HEADER([zlib.h],[have_zlib_headers=yes],[have_zlib_headers=no])
+    if test "$have_zlib_lib" = "yes" -a "$have_zlib_headers" = "yes" ; then
+      enable_zlib=yes
+      ZLIB_LIBS=-lz
+    elif test "$enable_zlib" = "yes" ; then
+      AC_MSG_ERROR([You must install zlib and its development headers to enable zlib compression.])
+    else
+      enable_zlib=no
+    fi
+  ])
+])
+
+AC_SUBST(SNAPPY_CFLAGS)
+AC_SUBST(SNAPPY_LIBS)
+AC_SUBST(ZLIB_CFLAGS)
+AC_SUBST(ZLIB_LIBS)
+
+dnl Let mongoc-config.h.in know about compression status.
+if test "$enable_snappy" = "yes" ; then
+  AC_SUBST(MONGOC_ENABLE_COMPRESSION_SNAPPY, 1)
+else
+  AC_SUBST(MONGOC_ENABLE_COMPRESSION_SNAPPY, 0)
+fi
+
+if test "$enable_zlib" = "yes" ; then
+  AC_SUBST(MONGOC_ENABLE_COMPRESSION_ZLIB, 1)
+else
+  AC_SUBST(MONGOC_ENABLE_COMPRESSION_ZLIB, 0)
+fi
+
+if test "$enable_snappy" = "yes" -o "$enable_zlib" = "yes" ; then
+  AC_SUBST(MONGOC_ENABLE_COMPRESSION, 1)
+else
+  AC_SUBST(MONGOC_ENABLE_COMPRESSION, 0)
+fi
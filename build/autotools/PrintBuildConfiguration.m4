@@ -41,6 +41,8 @@ Build configuration:
   Shared memory performance counters               : ${enable_shm_counters}
   SASL                                             : ${sasl_mode}
   SSL                                              : ${enable_ssl}
+  Snappy Compression                               : ${enable_snappy}
+  Zlib Compression                                 : ${enable_zlib}
   Libbson                                          : ${with_libbson}
 
 Documentation:
@@ -0,0 +1,29 @@
+message (STATUS "Searching for snappy-c.h")
+find_path (
+    SNAPPY_INCLUDE_DIRS NAMES snappy-c.h
+    PATHS /include /usr/include /usr/local/include /usr/share/include /opt/include c:/snappy/include
+    DOC "Searching for snappy-c.h")
+
+if (SNAPPY_INCLUDE_DIRS)
+    message (STATUS "  Found in ${SNAPPY_INCLUDE_DIRS}")
+else ()
+    message (STATUS "  Not found (specify -DCMAKE_INCLUDE_PATH=C:/path/to/snappy/include for Snappy support)")
+endif ()
+
+message (STATUS "Searching for libsnappy")
+find_library(
+    SNAPPY_LIBRARIES NAMES snappy
+    PATHS /usr/lib /lib /usr/local/lib /usr/share/lib /opt/lib /opt/share/lib /var/lib c:/snappy/lib
+    DOC "Searching for libsnappy")
+
+if (SNAPPY_LIBRARIES)
+    message (STATUS "  Found ${SNAPPY_LIBRARIES}")
+else ()
+    message (STATUS "  Not found (specify -DCMAKE_LIBRARY_PATH=C:/path/to/snappy/lib for Snappy support)")
+endif ()
+
+if (SNAPPY_INCLUDE_DIRS AND SNAPPY_LIBRARIES)
+    set (SNAPPY_FOUND 1)
+else ()
+    set (SNAPPY_FOUND 0)
+endif ()
@@ -72,8 +72,10 @@ typedef_list = [
     # libmongoc.
     typedef("mongoc_bulk_operation_ptr", "mongoc_bulk_operation_t *"),
     typedef("mongoc_client_ptr", "mongoc_client_t *"),
+    typedef("mongoc_client_ptr_ptr", "mongoc_client_t **"),
     typedef("mongoc_collection_ptr", "mongoc_collection_t *"),
     typedef("mongoc_cursor_ptr", "mongoc_cursor_t *"),
+    typedef("mongoc_cursor_ptr_ptr", "mongoc_cursor_t **"),
     typedef("mongoc_database_ptr", "mongoc_database_t *"),
     typedef("mongoc_gridfs_file_ptr", "mongoc_gridfs_file_t *"),
     typedef("mongoc_gridfs_ptr", "mongoc_gridfs_t *"),
@@ -223,6 +225,15 @@ future_functions = [
                      param("bson_ptr", "stats"),
                      param("bson_error_ptr", "error")]),
 
+    future_function("size_t",
+                    "mongoc_collection_parallel_scan",
+                    [param("mongoc_collection_ptr", "collection"),
+                     param("mongoc_client_ptr_ptr", "clients"),
+                     param("mongoc_cursor_ptr_ptr", "cursors"),
+                     param("size_t", "max_cursors"),
+                     param("const_mongoc_read_prefs_ptr", "read_prefs"),
+                     param("bson_error_ptr", "error")]),
+
     future_function("bool",
                     "mongoc_collection_insert",
                     [param("mongoc_collection_ptr", "collection"),
@@ -286,6 +297,10 @@ future_functions = [
                     [param("mongoc_gridfs_file_ptr", "file"),
                      param("bson_error_ptr", "error")]),
 
+    future_function("bool",
+                    "mongoc_gridfs_file_save",
+                    [param("mongoc_gridfs_file_ptr", "file")]),
+
     future_function("int",
                     "mongoc_gridfs_file_seek",
                     [param("mongoc_gridfs_file_ptr", "file"),
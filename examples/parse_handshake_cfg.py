@@ -19,6 +19,8 @@ MD_FLAGS = [
     "MONGOC_MD_FLAG_HAVE_WEAK_SYMBOLS",
     "MONGOC_MD_FLAG_NO_AUTOMATIC_GLOBALS",
     "MONGOC_MD_FLAG_ENABLE_SSL_LIBRESSL",
+    "MONGOC_MD_FLAG_ENABLE_COMPRESSION_SNAPPY",
+    "MONGOC_MD_FLAG_ENABLE_COMPRESSION_ZLIB",
 ]
 
 def main():
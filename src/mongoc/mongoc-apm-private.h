@@ -47,6 +47,7 @@ struct _mongoc_apm_callbacks_t {
 
 struct _mongoc_apm_command_started_t {
    bson_t *command;
+   bson_t command_local; /* the unwrapped $query, if any */
    bool command_owned;
    const char *database_name;
    const char *command_name;
@@ -55,12 +55,14 @@ mongoc_apm_command_started_init (mongoc_apm_command_started_t *event,
       if (bson_iter_init_find (&iter, command, "$query") &&
           BSON_ITER_HOLDS_DOCUMENT (&iter)) {
          bson_iter_document (&iter, &len, &data);
-         event->command = bson_new_from_data (data, len);
+         /* a view of the subdocument, it lives as long as "command" */
+         bson_init_static (&event->command_local, data, len);
       } else {
          /* $query should exist, but user could provide us a misformatted doc */
-         event->command = bson_new ();
+         bson_init (&event->command_local);
       }
 
+      event->command = &event->command_local;
       event->command_owned = true;
    } else {
       /* discard "const", we promise not to modify "command" */
@@ -82,7 +84,7 @@ void
 mongoc_apm_command_started_cleanup (mongoc_apm_command_started_t *event)
 {
    if (event->command_owned) {
-      bson_destroy (event->command);
+      bson_destroy (&event->command_local);
    }
 }
 
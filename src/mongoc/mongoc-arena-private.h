@@ -0,0 +1,95 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_ARENA_PRIVATE_H
+#define MONGOC_ARENA_PRIVATE_H
+
+#if !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-array-private.h"
+
+
+BSON_BEGIN_DECLS
+
+
+/* chunks are never smaller than this. larger ones, for big write commands,
+ * are freed as soon as they are released. */
+#define MONGOC_ARENA_CHUNK_SIZE 4096
+
+/* the initial buffer size of a document from _mongoc_arena_bson_new */
+#define MONGOC_ARENA_BSON_SIZE 128
+
+
+typedef struct _mongoc_arena_chunk_t mongoc_arena_chunk_t;
+
+
+/* a bump allocator for the temporary documents an operation builds, such as
+ * a command with its options appended. each operation takes a mark, builds
+ * what it needs, and releases everything at once by returning to the mark.
+ * chunks and document structs are kept for the next operation, so steady
+ * state operations do not call malloc at all.
+ *
+ * marks nest: an operation may run another while it holds a mark, so long
+ * as it does not grow memory it allocated before the inner mark until the
+ * inner mark is released. */
+typedef struct {
+   mongoc_arena_chunk_t *first;
+   mongoc_arena_chunk_t *chunk; /* current chunk, or NULL before the first */
+   size_t offset;               /* next free byte in the current chunk */
+   uint8_t *last;               /* latest allocation, it can grow in place */
+   mongoc_array_t docs;         /* mongoc_arena_doc_t pointers */
+   size_t n_docs;               /* docs handed out */
+} mongoc_arena_t;
+
+
+typedef struct {
+   mongoc_arena_chunk_t *chunk;
+   size_t offset;
+   uint8_t *last;
+   size_t n_docs;
+} mongoc_arena_mark_t;
+
+
+void
+_mongoc_arena_init (mongoc_arena_t *arena);
+
+void
+_mongoc_arena_destroy (mongoc_arena_t *arena);
+
+void
+_mongoc_arena_mark (mongoc_arena_t *arena, mongoc_arena_mark_t *mark);
+
+void
+_mongoc_arena_release (mongoc_arena_t *arena, const mongoc_arena_mark_t *mark);
+
+void *
+_mongoc_arena_alloc (mongoc_arena_t *arena, size_t num_bytes);
+
+void *
+_mongoc_arena_realloc (void *mem, size_t num_bytes, void *ctx);
+
+bson_t *
+_mongoc_arena_bson_new (mongoc_arena_t *arena);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_ARENA_PRIVATE_H */
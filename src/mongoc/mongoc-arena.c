@@ -0,0 +1,285 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mongoc-arena-private.h"
+
+
+/* each allocation is preceded by its size, padded to keep the allocation
+ * aligned */
+#define ALIGNMENT 16
+#define ALIGN_UP(_n) (((_n) + (ALIGNMENT - 1)) & ~((size_t) ALIGNMENT - 1))
+#define CHUNK_DATA(_chunk) \
+   ((uint8_t *) (_chunk) + ALIGN_UP (sizeof (mongoc_arena_chunk_t)))
+#define ALLOC_SIZE(_mem) (((size_t *) (_mem))[-1])
+
+
+struct _mongoc_arena_chunk_t {
+   mongoc_arena_chunk_t *next;
+   size_t size; /* bytes of data after the header */
+};
+
+
+/* a document whose buffer is allocated from the arena. libbson keeps
+ * pointers to "buf" and "buf_len", so each is heap-allocated once and
+ * reused for the arena's lifetime. */
+typedef struct {
+   bson_t *bson;
+   uint8_t *buf;
+   size_t buf_len;
+} mongoc_arena_doc_t;
+
+
+void
+_mongoc_arena_init (mongoc_arena_t *arena)
+{
+   BSON_ASSERT (arena);
+
+   memset (arena, 0, sizeof *arena);
+   _mongoc_array_init (&arena->docs, sizeof (mongoc_arena_doc_t *));
+}
+
+
+void
+_mongoc_arena_destroy (mongoc_arena_t *arena)
+{
+   mongoc_arena_chunk_t *chunk;
+   mongoc_arena_chunk_t *next;
+   mongoc_arena_doc_t *doc;
+   size_t i;
+
+   if (!arena) {
+      return;
+   }
+
+   for (i = 0; i < arena->docs.len; i++) {
+      doc = _mongoc_array_index (&arena->docs, mongoc_arena_doc_t *, i);
+      /* frees the struct, the buffer belongs to a chunk */
+      bson_destroy (doc->bson);
+      bson_free (doc);
+   }
+
+   _mongoc_array_destroy (&arena->docs);
+
+   for (chunk = arena->first; chunk; chunk = next) {
+      next = chunk->next;
+      bson_free (chunk);
+   }
+}
+
+
+void
+_mongoc_arena_mark (mongoc_arena_t *arena, mongoc_arena_mark_t *mark)
+{
+   BSON_ASSERT (arena);
+   BSON_ASSERT (mark);
+
+   mark->chunk = arena->chunk;
+   mark->offset = arena->offset;
+   mark->last = arena->last;
+   mark->n_docs = arena->n_docs;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_arena_release --
+ *
+ *       Free everything allocated since @mark was taken, including
+ *       documents from _mongoc_arena_bson_new. Marks taken after @mark
+ *       are invalid afterward.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_arena_release (mongoc_arena_t *arena, const mongoc_arena_mark_t *mark)
+{
+   mongoc_arena_chunk_t **link;
+   mongoc_arena_chunk_t *chunk;
+
+   BSON_ASSERT (arena);
+   BSON_ASSERT (mark);
+   BSON_ASSERT (mark->n_docs <= arena->n_docs);
+
+   arena->chunk = mark->chunk;
+   arena->offset = mark->offset;
+   arena->last = mark->last;
+   arena->n_docs = mark->n_docs;
+
+   /* keep the spare chunks for reuse, except oversized ones */
+   link = arena->chunk ? &arena->chunk->next : &arena->first;
+   while (*link) {
+      chunk = *link;
+      if (chunk->size > MONGOC_ARENA_CHUNK_SIZE) {
+         *link = chunk->next;
+         bson_free (chunk);
+      } else {
+         link = &chunk->next;
+      }
+   }
+}
+
+
+/* move to the next chunk with at least @needed bytes, or insert one */
+static void
+_mongoc_arena_next_chunk (mongoc_arena_t *arena, size_t needed)
+{
+   mongoc_arena_chunk_t **link;
+   mongoc_arena_chunk_t *chunk;
+   size_t size;
+
+   link = arena->chunk ? &arena->chunk->next : &arena->first;
+
+   if (!*link || (*link)->size < needed) {
+      size = BSON_MAX (needed, (size_t) MONGOC_ARENA_CHUNK_SIZE);
+      chunk = (mongoc_arena_chunk_t *) bson_malloc (
+         ALIGN_UP (sizeof (mongoc_arena_chunk_t)) + size);
+      chunk->size = size;
+      chunk->next = *link;
+      *link = chunk;
+   }
+
+   arena->chunk = *link;
+   arena->offset = 0;
+}
+
+
+void *
+_mongoc_arena_alloc (mongoc_arena_t *arena, size_t num_bytes)
+{
+   size_t needed;
+   uint8_t *mem;
+
+   BSON_ASSERT (arena);
+
+   needed = ALIGNMENT + ALIGN_UP (num_bytes);
+
+   if (!arena->chunk || arena->offset + needed > arena->chunk->size) {
+      _mongoc_arena_next_chunk (arena, needed);
+   }
+
+   mem = CHUNK_DATA (arena->chunk) + arena->offset + ALIGNMENT;
+   ALLOC_SIZE (mem) = num_bytes;
+   arena->offset += needed;
+   arena->last = mem;
+
+   return mem;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_arena_realloc --
+ *
+ *       A bson_realloc_func for documents built in the arena @ctx. The
+ *       latest allocation grows in place if its chunk has room; others are
+ *       copied, and their old space is reclaimed when the arena is
+ *       released.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void *
+_mongoc_arena_realloc (void *mem, size_t num_bytes, void *ctx)
+{
+   mongoc_arena_t *arena = (mongoc_arena_t *) ctx;
+   size_t start;
+   size_t needed;
+   void *new_mem;
+
+   BSON_ASSERT (arena);
+
+   if (!mem) {
+      return _mongoc_arena_alloc (arena, num_bytes);
+   }
+
+   if (num_bytes <= ALLOC_SIZE (mem)) {
+      return mem;
+   }
+
+   if (mem == arena->last) {
+      start = (size_t) ((uint8_t *) mem - CHUNK_DATA (arena->chunk)) -
+              ALIGNMENT;
+      needed = ALIGNMENT + ALIGN_UP (num_bytes);
+
+      if (start + needed <= arena->chunk->size) {
+         ALLOC_SIZE (mem) = num_bytes;
+         arena->offset = start + needed;
+         return mem;
+      }
+   }
+
+   new_mem = _mongoc_arena_alloc (arena, num_bytes);
+   memcpy (new_mem, mem, ALLOC_SIZE (mem));
+
+   return new_mem;
+}
+
+
+/* allocate an empty BSON document's bytes */
+static void
+_mongoc_arena_doc_alloc_buf (mongoc_arena_t *arena, mongoc_arena_doc_t *doc)
+{
+   static const uint8_t empty[5] = {5, 0, 0, 0, 0};
+
+   doc->buf_len = MONGOC_ARENA_BSON_SIZE;
+   doc->buf = (uint8_t *) _mongoc_arena_alloc (arena, doc->buf_len);
+   memcpy (doc->buf, empty, sizeof empty);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_arena_bson_new --
+ *
+ *       Get an empty document whose buffer is allocated in @arena.
+ *
+ * Returns:
+ *       A document that is valid until the arena is released to a mark
+ *       taken before this call. Do not call bson_destroy on it.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bson_t *
+_mongoc_arena_bson_new (mongoc_arena_t *arena)
+{
+   mongoc_arena_doc_t *doc;
+
+   BSON_ASSERT (arena);
+
+   if (arena->n_docs < arena->docs.len) {
+      doc = _mongoc_array_index (
+         &arena->docs, mongoc_arena_doc_t *, arena->n_docs);
+      _mongoc_arena_doc_alloc_buf (arena, doc);
+      bson_reinit (doc->bson);
+   } else {
+      doc = (mongoc_arena_doc_t *) bson_malloc0 (sizeof *doc);
+      _mongoc_arena_doc_alloc_buf (arena, doc);
+      doc->bson = bson_new_from_buffer (
+         &doc->buf, &doc->buf_len, _mongoc_arena_realloc, arena);
+      BSON_ASSERT (doc->bson);
+      _mongoc_array_append_val (&arena->docs, doc);
+   }
+
+   arena->n_docs++;
+
+   return doc->bson;
+}
@@ -33,6 +33,7 @@
 BSON_BEGIN_DECLS
 
 typedef enum {
+   MONGOC_ASYNC_CMD_INITIATE,
    MONGOC_ASYNC_CMD_SETUP,
    MONGOC_ASYNC_CMD_SEND,
    MONGOC_ASYNC_CMD_RECV_LEN,
@@ -43,17 +44,22 @@ typedef enum {
 
 typedef struct _mongoc_async_cmd {
    mongoc_stream_t *stream;
+   mongoc_poller_entry_t *poller_entry;
 
    mongoc_async_t *async;
    mongoc_async_cmd_state_t state;
    int events;
    mongoc_async_cmd_setup_t setup;
    void *setup_ctx;
+   mongoc_async_cmd_initiator_t initiator;
+   void *initiator_ctx;
+   int64_t initiate_at; /* when to call initiator, in the INITIATE state */
    mongoc_async_cmd_cb_t cb;
    void *data;
    bson_error_t error;
    int64_t start_time;
    int64_t timeout_msec;
+   int64_t expire_at;
    bson_t cmd;
    mongoc_buffer_t buffer;
    mongoc_array_t array;
@@ -63,6 +69,7 @@ typedef struct _mongoc_async_cmd {
    mongoc_rpc_t rpc;
    bson_t reply;
    bool reply_needs_cleanup;
+   bool destroyed; /* in the async's destroyed list, see _mongoc_async_poll */
    char ns[MONGOC_NAMESPACE_MAX];
 
    struct _mongoc_async_cmd *next;
@@ -76,6 +83,7 @@ mongoc_async_cmd_new (mongoc_async_t *async,
                       void *setup_ctx,
                       const char *dbname,
                       const bson_t *cmd,
+                      mongoc_query_flags_t flags,
                       mongoc_async_cmd_cb_t cb,
                       void *cb_data,
                       int64_t timeout_msec);
@@ -83,9 +91,18 @@ mongoc_async_cmd_new (mongoc_async_t *async,
 void
 mongoc_async_cmd_destroy (mongoc_async_cmd_t *acmd);
 
+void
+_mongoc_async_cmd_free (mongoc_async_cmd_t *acmd);
+
+bool
+mongoc_async_cmd_initiate (mongoc_async_cmd_t *acmd);
+
 bool
 mongoc_async_cmd_run (mongoc_async_cmd_t *acmd);
 
+void
+_mongoc_async_cmd_poller_remove (mongoc_async_cmd_t *acmd);
+
 #ifdef MONGOC_ENABLE_SSL
 int
 mongoc_async_cmd_tls_setup (mongoc_stream_t *stream,
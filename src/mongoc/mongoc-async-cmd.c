@@ -48,6 +48,7 @@ mongoc_async_cmd_result_t
 _mongoc_async_cmd_phase_recv_rpc (mongoc_async_cmd_t *cmd);
 
 static const _mongoc_async_cmd_phase_t gMongocCMDPhases[] = {
+   NULL, /* MONGOC_ASYNC_CMD_INITIATE has no stream to poll yet */
    _mongoc_async_cmd_phase_setup,
    _mongoc_async_cmd_phase_send,
    _mongoc_async_cmd_phase_recv_len,
@@ -85,6 +86,16 @@ mongoc_async_cmd_tls_setup (mongoc_stream_t *stream,
 }
 #endif
 
+/* stop polling @acmd's stream, before a callback that may close it */
+void
+_mongoc_async_cmd_poller_remove (mongoc_async_cmd_t *acmd)
+{
+   if (acmd->poller_entry) {
+      _mongoc_poller_remove (acmd->async->poller, acmd->poller_entry);
+      acmd->poller_entry = NULL;
+   }
+}
+
 bool
 mongoc_async_cmd_run (mongoc_async_cmd_t *acmd)
 {
@@ -100,16 +111,22 @@ mongoc_async_cmd_run (mongoc_async_cmd_t *acmd)
    }
 
    if (result == MONGOC_ASYNC_CMD_IN_PROGRESS) {
+      _mongoc_poller_modify (
+         acmd->async->poller, acmd->poller_entry, acmd->events);
       return true;
    }
 
+   /* the callback may close the stream */
+   _mongoc_async_cmd_poller_remove (acmd);
+
    rtt_msec = (bson_get_monotonic_time () - acmd->start_time) / 1000;
 
    if (result == MONGOC_ASYNC_CMD_SUCCESS) {
-      acmd->cb (result, &acmd->reply, rtt_msec, acmd->data, &acmd->error);
+      acmd->cb (
+         acmd, result, &acmd->reply, rtt_msec, acmd->data, &acmd->error);
    } else {
       /* we're in ERROR, TIMEOUT, or CANCELED */
-      acmd->cb (result, NULL, rtt_msec, acmd->data, &acmd->error);
+      acmd->cb (acmd, result, NULL, rtt_msec, acmd->data, &acmd->error);
    }
 
    mongoc_async_cmd_destroy (acmd);
@@ -117,7 +134,9 @@ mongoc_async_cmd_run (mongoc_async_cmd_t *acmd)
 }
 
 void
-_mongoc_async_cmd_init_send (mongoc_async_cmd_t *acmd, const char *dbname)
+_mongoc_async_cmd_init_send (mongoc_async_cmd_t *acmd,
+                             const char *dbname,
+                             mongoc_query_flags_t flags)
 {
    bson_snprintf (acmd->ns, sizeof acmd->ns, "%s.$cmd", dbname);
 
@@ -125,7 +144,7 @@ _mongoc_async_cmd_init_send (mongoc_async_cmd_t *acmd, const char *dbname)
    acmd->rpc.query.request_id = ++acmd->async->request_id;
    acmd->rpc.query.response_to = 0;
    acmd->rpc.query.opcode = MONGOC_OPCODE_QUERY;
-   acmd->rpc.query.flags = MONGOC_QUERY_SLAVE_OK;
+   acmd->rpc.query.flags = flags;
    acmd->rpc.query.collection = acmd->ns;
    acmd->rpc.query.skip = 0;
    acmd->rpc.query.n_return = -1;
@@ -157,6 +176,7 @@ mongoc_async_cmd_new (mongoc_async_t *async,
                       void *setup_ctx,
                       const char *dbname,
                       const bson_t *cmd,
+                      mongoc_query_flags_t flags,
                       mongoc_async_cmd_cb_t cb,
                       void *cb_data,
                       int64_t timeout_msec)
@@ -165,11 +185,11 @@ mongoc_async_cmd_new (mongoc_async_t *async,
 
    BSON_ASSERT (cmd);
    BSON_ASSERT (dbname);
-   BSON_ASSERT (stream);
 
    acmd = (mongoc_async_cmd_t *) bson_malloc0 (sizeof (*acmd));
    acmd->async = async;
    acmd->timeout_msec = timeout_msec;
+   acmd->expire_at = bson_get_monotonic_time () + timeout_msec * 1000;
    acmd->stream = stream;
    acmd->setup = setup;
    acmd->setup_ctx = setup_ctx;
@@ -180,17 +200,67 @@ mongoc_async_cmd_new (mongoc_async_t *async,
    _mongoc_array_init (&acmd->array, sizeof (mongoc_iovec_t));
    _mongoc_buffer_init (&acmd->buffer, NULL, 0, NULL, NULL);
 
-   _mongoc_async_cmd_init_send (acmd, dbname);
-
-   _mongoc_async_cmd_state_start (acmd);
+   _mongoc_async_cmd_init_send (acmd, dbname, flags);
 
    async->ncmds++;
    DL_APPEND (async->cmds, acmd);
 
+   if (stream) {
+      _mongoc_async_cmd_state_start (acmd);
+      acmd->poller_entry =
+         _mongoc_poller_add (async->poller, stream, acmd->events, acmd);
+   } else {
+      /* the caller sets an initiator, see mongoc_async_cmd_delayed */
+      acmd->state = MONGOC_ASYNC_CMD_INITIATE;
+   }
+
    return acmd;
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_async_cmd_initiate --
+ *
+ *       Create a delayed command's stream with its initiator and begin
+ *       polling it.
+ *
+ * Returns:
+ *       true if the command is in progress. Otherwise its callback has
+ *       been called with an error and the command is destroyed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_async_cmd_initiate (mongoc_async_cmd_t *acmd)
+{
+   int64_t rtt_msec;
+
+   BSON_ASSERT (acmd->state == MONGOC_ASYNC_CMD_INITIATE);
+   BSON_ASSERT (acmd->initiator);
+
+   acmd->stream = acmd->initiator (acmd);
+   if (acmd->stream) {
+      _mongoc_async_cmd_state_start (acmd);
+      acmd->poller_entry = _mongoc_poller_add (
+         acmd->async->poller, acmd->stream, acmd->events, acmd);
+      return true;
+   }
+
+   rtt_msec = (bson_get_monotonic_time () - acmd->start_time) / 1000;
+   acmd->cb (acmd,
+             MONGOC_ASYNC_CMD_ERROR,
+             NULL,
+             rtt_msec,
+             acmd->data,
+             &acmd->error);
+   mongoc_async_cmd_destroy (acmd);
+   return false;
+}
+
+
 void
 mongoc_async_cmd_destroy (mongoc_async_cmd_t *acmd)
 {
@@ -198,7 +268,21 @@ mongoc_async_cmd_destroy (mongoc_async_cmd_t *acmd)
 
    DL_DELETE (acmd->async->cmds, acmd);
    acmd->async->ncmds--;
+   _mongoc_async_cmd_poller_remove (acmd);
+
+   if (acmd->async->in_poll) {
+      /* a later event of the same poll may refer to it; free it after */
+      acmd->destroyed = true;
+      DL_APPEND (acmd->async->destroyed, acmd);
+      return;
+   }
 
+   _mongoc_async_cmd_free (acmd);
+}
+
+void
+_mongoc_async_cmd_free (mongoc_async_cmd_t *acmd)
+{
    bson_destroy (&acmd->cmd);
 
    if (acmd->reply_needs_cleanup) {
@@ -22,6 +22,7 @@
 #endif
 
 #include <bson.h>
+#include "mongoc-poller-private.h"
 #include "mongoc-stream.h"
 
 BSON_BEGIN_DECLS
@@ -32,6 +33,10 @@ typedef struct _mongoc_async {
    struct _mongoc_async_cmd *cmds;
    size_t ncmds;
    uint32_t request_id;
+   mongoc_poller_t *poller; /* the commands' streams */
+   bool in_poll;            /* handling the events of one poller wait */
+   /* destroyed while handling those events, freed once they are done */
+   struct _mongoc_async_cmd *destroyed;
 } mongoc_async_t;
 
 typedef enum {
@@ -41,7 +46,8 @@ typedef enum {
    MONGOC_ASYNC_CMD_TIMEOUT,
 } mongoc_async_cmd_result_t;
 
-typedef void (*mongoc_async_cmd_cb_t) (mongoc_async_cmd_result_t result,
+typedef void (*mongoc_async_cmd_cb_t) (struct _mongoc_async_cmd *acmd,
+                                       mongoc_async_cmd_result_t result,
                                        const bson_t *bson,
                                        int64_t rtt_msec,
                                        void *data,
@@ -53,6 +59,11 @@ typedef int (*mongoc_async_cmd_setup_t) (mongoc_stream_t *stream,
                                          int32_t timeout_msec,
                                          bson_error_t *error);
 
+/* begins connecting a delayed command's stream, see mongoc_async_cmd_delayed.
+ * returns NULL and sets the command's error on failure. */
+typedef mongoc_stream_t *(*mongoc_async_cmd_initiator_t) (
+   struct _mongoc_async_cmd *acmd);
+
 
 mongoc_async_t *
 mongoc_async_new ();
@@ -63,6 +74,9 @@ mongoc_async_destroy (mongoc_async_t *async);
 void
 mongoc_async_run (mongoc_async_t *async, int64_t timeout_msec);
 
+void
+mongoc_async_run_once (mongoc_async_t *async, int32_t timeout_msec);
+
 struct _mongoc_async_cmd *
 mongoc_async_cmd (mongoc_async_t *async,
                   mongoc_stream_t *stream,
@@ -74,6 +88,19 @@ mongoc_async_cmd (mongoc_async_t *async,
                   void *cb_data,
                   int64_t timeout_msec);
 
+struct _mongoc_async_cmd *
+mongoc_async_cmd_delayed (mongoc_async_t *async,
+                          mongoc_async_cmd_initiator_t initiator,
+                          void *initiator_ctx,
+                          int64_t delay_msec,
+                          mongoc_async_cmd_setup_t setup,
+                          void *setup_ctx,
+                          const char *dbname,
+                          const bson_t *cmd,
+                          mongoc_async_cmd_cb_t cb,
+                          void *cb_data,
+                          int64_t timeout_msec);
+
 BSON_END_DECLS
 
 #endif /* MONGOC_ASYNC_PRIVATE_H */
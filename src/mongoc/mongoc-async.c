@@ -19,6 +19,7 @@
 
 #include "mongoc-async-private.h"
 #include "mongoc-async-cmd-private.h"
+#include "mongoc-util-private.h"
 #include "utlist.h"
 #include "mongoc.h"
 
@@ -36,8 +37,63 @@ mongoc_async_cmd (mongoc_async_t *async,
                   void *cb_data,
                   int64_t timeout_msec)
 {
-   return mongoc_async_cmd_new (
-      async, stream, setup, setup_ctx, dbname, cmd, cb, cb_data, timeout_msec);
+   return mongoc_async_cmd_new (async,
+                                stream,
+                                setup,
+                                setup_ctx,
+                                dbname,
+                                cmd,
+                                MONGOC_QUERY_SLAVE_OK,
+                                cb,
+                                cb_data,
+                                timeout_msec);
+}
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_async_cmd_delayed --
+ *
+ *       Like mongoc_async_cmd, but the command's stream is created by
+ *       @initiator after @delay_msec. The command still times out
+ *       @timeout_msec from now.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_async_cmd_t *
+mongoc_async_cmd_delayed (mongoc_async_t *async,
+                          mongoc_async_cmd_initiator_t initiator,
+                          void *initiator_ctx,
+                          int64_t delay_msec,
+                          mongoc_async_cmd_setup_t setup,
+                          void *setup_ctx,
+                          const char *dbname,
+                          const bson_t *cmd,
+                          mongoc_async_cmd_cb_t cb,
+                          void *cb_data,
+                          int64_t timeout_msec)
+{
+   mongoc_async_cmd_t *acmd;
+
+   BSON_ASSERT (initiator);
+
+   acmd = mongoc_async_cmd_new (async,
+                                NULL,
+                                setup,
+                                setup_ctx,
+                                dbname,
+                                cmd,
+                                MONGOC_QUERY_SLAVE_OK,
+                                cb,
+                                cb_data,
+                                timeout_msec);
+
+   acmd->initiator = initiator;
+   acmd->initiator_ctx = initiator_ctx;
+   acmd->initiate_at = bson_get_monotonic_time () + delay_msec * 1000;
+
+   return acmd;
 }
 
 mongoc_async_t *
@@ -45,6 +101,8 @@ mongoc_async_new ()
 {
    mongoc_async_t *async = (mongoc_async_t *) bson_malloc0 (sizeof (*async));
 
+   async->poller = _mongoc_poller_new ();
+
    return async;
 }
 
@@ -58,87 +116,151 @@ mongoc_async_destroy (mongoc_async_t *async)
       mongoc_async_cmd_destroy (acmd);
    }
 
+   _mongoc_poller_destroy (async->poller);
    bson_free (async);
 }
 
+/* start delayed commands that are due, and finish canceled ones. returns
+ * how long until the next delayed command is due, at most @timeout_msec */
+static int32_t
+_mongoc_async_initiate (mongoc_async_t *async, int32_t timeout_msec)
+{
+   mongoc_async_cmd_t *acmd, *tmp;
+   int64_t now;
+
+   now = bson_get_monotonic_time ();
+
+   DL_FOREACH_SAFE (async->cmds, acmd, tmp)
+   {
+      if (acmd->state == MONGOC_ASYNC_CMD_CANCELED_STATE) {
+         /* no need to wait for the stream, if any */
+         mongoc_async_cmd_run (acmd);
+      } else if (acmd->state != MONGOC_ASYNC_CMD_INITIATE) {
+         continue;
+      } else if (acmd->initiate_at <= now) {
+         mongoc_async_cmd_initiate (acmd);
+      } else if ((acmd->initiate_at - now) / 1000 < timeout_msec) {
+         /* round up so as not to spin */
+         timeout_msec = (int32_t) ((acmd->initiate_at - now + 999) / 1000);
+      }
+   }
+
+   return timeout_msec;
+}
+
+/* wait for the commands' streams once and advance those that are ready */
+static void
+_mongoc_async_poll (mongoc_async_t *async, int32_t timeout_msec)
+{
+   const mongoc_poller_event_t *events;
+   mongoc_async_cmd_t *acmd, *tmp;
+   ssize_t nactive;
+   ssize_t i;
+
+   timeout_msec = _mongoc_async_initiate (async, timeout_msec);
+
+   if (!_mongoc_poller_size (async->poller)) {
+      /* only delayed commands, or none */
+      if (async->ncmds && timeout_msec > 0) {
+         _mongoc_usleep ((int64_t) timeout_msec * 1000);
+      }
+
+      return;
+   }
+
+   nactive = _mongoc_poller_wait (async->poller, timeout_msec, &events);
+
+   /* a callback may destroy any command, such as all of a node's when the
+    * scanner disconnects it. commands destroyed meanwhile are kept until
+    * the loop is done, so their events here are skipped, not freed memory */
+   async->in_poll = true;
+
+   for (i = 0; i < nactive; i++) {
+      acmd = (mongoc_async_cmd_t *) events[i].data;
+
+      if (acmd->destroyed) {
+         continue;
+      }
+
+      if (events[i].revents & (POLLERR | POLLHUP)) {
+         int hup = events[i].revents & POLLHUP;
+         if (acmd->state == MONGOC_ASYNC_CMD_SEND) {
+            bson_set_error (&acmd->error,
+                            MONGOC_ERROR_STREAM,
+                            MONGOC_ERROR_STREAM_CONNECT,
+                            hup ? "connection refused"
+                                : "unknown connection error");
+         } else {
+            bson_set_error (&acmd->error,
+                            MONGOC_ERROR_STREAM,
+                            MONGOC_ERROR_STREAM_SOCKET,
+                            hup ? "connection closed"
+                                : "unknown socket error");
+         }
+
+         acmd->state = MONGOC_ASYNC_CMD_ERROR_STATE;
+      }
+
+      if (acmd->state == MONGOC_ASYNC_CMD_ERROR_STATE ||
+          (events[i].revents & acmd->events)) {
+         mongoc_async_cmd_run (acmd);
+      }
+   }
+
+   async->in_poll = false;
+
+   DL_FOREACH_SAFE (async->destroyed, acmd, tmp)
+   {
+      DL_DELETE (async->destroyed, acmd);
+      _mongoc_async_cmd_free (acmd);
+   }
+
+   /* callbacks may have canceled commands, or made delayed ones due */
+   _mongoc_async_initiate (async, 0);
+}
+
+
+static void
+_mongoc_async_cmd_timeout (mongoc_async_cmd_t *acmd, int64_t now)
+{
+   bson_set_error (&acmd->error,
+                   MONGOC_ERROR_STREAM,
+                   MONGOC_ERROR_STREAM_CONNECT,
+                   acmd->state == MONGOC_ASYNC_CMD_SEND ||
+                         acmd->state == MONGOC_ASYNC_CMD_INITIATE
+                      ? "connection timeout"
+                      : "socket timeout");
+
+   /* the callback may close the stream */
+   _mongoc_async_cmd_poller_remove (acmd);
+
+   acmd->cb (acmd,
+             MONGOC_ASYNC_CMD_TIMEOUT,
+             NULL,
+             (now - acmd->start_time) / 1000,
+             acmd->data,
+             &acmd->error);
+   mongoc_async_cmd_destroy (acmd);
+}
+
+
 void
 mongoc_async_run (mongoc_async_t *async, int64_t timeout_msec)
 {
    mongoc_async_cmd_t *acmd, *tmp;
-   mongoc_stream_poll_t *poller = NULL;
-   int i;
-   ssize_t nactive;
    int64_t now;
    int64_t expire_at;
    int64_t poll_timeout_msec;
-   size_t poll_size;
 
    BSON_ASSERT (timeout_msec > 0);
 
    now = bson_get_monotonic_time ();
    expire_at = now + timeout_msec * 1000;
-   poll_size = 0;
 
    while (async->ncmds) {
-      /* ncmds grows if we discover a replica & start calling ismaster on it */
-      if (poll_size < async->ncmds) {
-         poller = (mongoc_stream_poll_t *) bson_realloc (
-            poller, sizeof (*poller) * async->ncmds);
-
-         poll_size = async->ncmds;
-      }
-
-      i = 0;
-      DL_FOREACH (async->cmds, acmd)
-      {
-         poller[i].stream = acmd->stream;
-         poller[i].events = acmd->events;
-         poller[i].revents = 0;
-         i++;
-      }
-
       poll_timeout_msec = (expire_at - now) / 1000;
       BSON_ASSERT (poll_timeout_msec < INT32_MAX);
-      nactive =
-         mongoc_stream_poll (poller, async->ncmds, (int32_t) poll_timeout_msec);
-
-      if (nactive) {
-         i = 0;
-
-         DL_FOREACH_SAFE (async->cmds, acmd, tmp)
-         {
-            if (poller[i].revents & (POLLERR | POLLHUP)) {
-               int hup = poller[i].revents & POLLHUP;
-               if (acmd->state == MONGOC_ASYNC_CMD_SEND) {
-                  bson_set_error (&acmd->error,
-                                  MONGOC_ERROR_STREAM,
-                                  MONGOC_ERROR_STREAM_CONNECT,
-                                  hup ? "connection refused"
-                                      : "unknown connection error");
-               } else {
-                  bson_set_error (&acmd->error,
-                                  MONGOC_ERROR_STREAM,
-                                  MONGOC_ERROR_STREAM_SOCKET,
-                                  hup ? "connection closed"
-                                      : "unknown socket error");
-               }
-
-               acmd->state = MONGOC_ASYNC_CMD_ERROR_STATE;
-            }
-
-            if (acmd->state == MONGOC_ASYNC_CMD_ERROR_STATE ||
-                (poller[i].revents & poller[i].events)) {
-               mongoc_async_cmd_run (acmd);
-               nactive--;
-
-               if (!nactive) {
-                  break;
-               }
-            }
-
-            i++;
-         }
-      }
+      _mongoc_async_poll (async, (int32_t) poll_timeout_msec);
 
       now = bson_get_monotonic_time ();
       if (now > expire_at) {
@@ -146,26 +268,46 @@ mongoc_async_run (mongoc_async_t *async, int64_t timeout_msec)
       }
    }
 
-   if (poll_size) {
-      bson_free (poller);
-   }
-
    /* commands that succeeded or failed already have been removed from the
     * list and freed. therefore, all remaining commands have timed out. */
    DL_FOREACH_SAFE (async->cmds, acmd, tmp)
    {
-      bson_set_error (&acmd->error,
-                      MONGOC_ERROR_STREAM,
-                      MONGOC_ERROR_STREAM_CONNECT,
-                      acmd->state == MONGOC_ASYNC_CMD_SEND
-                         ? "connection timeout"
-                         : "socket timeout");
-
-      acmd->cb (MONGOC_ASYNC_CMD_TIMEOUT,
-                NULL,
-                (now - acmd->start_time) / 1000,
-                acmd->data,
-                &acmd->error);
-      mongoc_async_cmd_destroy (acmd);
+      _mongoc_async_cmd_timeout (acmd, now);
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_async_run_once --
+ *
+ *       Wait up to @timeout_msec for any command's stream to be ready and
+ *       advance the commands that are. Unlike mongoc_async_run, commands
+ *       still in progress afterward are only timed out once their own
+ *       timeout has passed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_async_run_once (mongoc_async_t *async, int32_t timeout_msec)
+{
+   mongoc_async_cmd_t *acmd, *tmp;
+   int64_t now;
+
+   BSON_ASSERT (timeout_msec >= 0);
+
+   if (async->ncmds) {
+      _mongoc_async_poll (async, timeout_msec);
+   }
+
+   now = bson_get_monotonic_time ();
+
+   DL_FOREACH_SAFE (async->cmds, acmd, tmp)
+   {
+      if (acmd->expire_at < now) {
+         _mongoc_async_cmd_timeout (acmd, now);
+      }
    }
 }
@@ -49,6 +49,11 @@ _mongoc_buffer_init (mongoc_buffer_t *buffer,
                      bson_realloc_func realloc_func,
                      void *realloc_data);
 
+bool
+_mongoc_buffer_append (mongoc_buffer_t *buffer,
+                       const uint8_t *data,
+                       size_t data_size);
+
 bool
 _mongoc_buffer_append_from_stream (mongoc_buffer_t *buffer,
                                    mongoc_stream_t *stream,
@@ -23,6 +23,7 @@
 
 #include "mongoc-array-private.h"
 #include "mongoc-client.h"
+#include "mongoc-client-pool.h"
 #include "mongoc-write-command-private.h"
 
 
@@ -39,6 +40,8 @@ struct _mongoc_bulk_operation_t {
    mongoc_write_result_t result;
    bool executed;
    int64_t operation_id;
+   mongoc_client_pool_t *pool; /* for concurrent unordered batches */
+   uint32_t max_concurrency;
 };
 
 
@@ -17,8 +17,10 @@
 
 #include "mongoc-bulk-operation.h"
 #include "mongoc-bulk-operation-private.h"
+#include "mongoc-client-pool-private.h"
 #include "mongoc-client-private.h"
 #include "mongoc-error.h"
+#include "mongoc-thread-private.h"
 #include "mongoc-trace-private.h"
 #include "mongoc-write-concern-private.h"
 
@@ -594,6 +596,256 @@ mongoc_bulk_operation_update_one (mongoc_bulk_operation_t *bulk,
    }
 }
 
+/* batches of an unordered bulk operation shared by the threads sending
+ * them, each on its own client's connection */
+typedef struct {
+   mongoc_array_t batches; /* mongoc_write_batch_t */
+   size_t next;
+   bool must_stop;
+   const char *database;
+   uint32_t server_id;
+   bool select_for_writes;
+   mongoc_mutex_t mutex;
+} mongoc_bulk_dispatch_t;
+
+
+typedef struct {
+   mongoc_bulk_dispatch_t *dispatch;
+   mongoc_client_t *client;
+   mongoc_server_stream_t *server_stream;
+   bool owns_stream;
+   mongoc_thread_t thread;
+} mongoc_bulk_worker_t;
+
+
+static mongoc_write_batch_t *
+_mongoc_bulk_dispatch_next (mongoc_bulk_dispatch_t *dispatch)
+{
+   mongoc_write_batch_t *batch = NULL;
+
+   mongoc_mutex_lock (&dispatch->mutex);
+
+   /* like the serial path, stop after a network error */
+   if (!dispatch->must_stop && dispatch->next < dispatch->batches.len) {
+      batch = &_mongoc_array_index (
+         &dispatch->batches, mongoc_write_batch_t, dispatch->next++);
+   }
+
+   mongoc_mutex_unlock (&dispatch->mutex);
+
+   return batch;
+}
+
+
+static void *
+_mongoc_bulk_worker_run (void *data)
+{
+   mongoc_bulk_worker_t *worker = (mongoc_bulk_worker_t *) data;
+   mongoc_bulk_dispatch_t *dispatch = worker->dispatch;
+   mongoc_cluster_t *cluster = &worker->client->cluster;
+   mongoc_write_batch_t *batch;
+
+   while ((batch = _mongoc_bulk_dispatch_next (dispatch))) {
+      batch->sent = true;
+
+      if (!worker->server_stream) {
+         if (dispatch->select_for_writes) {
+            worker->server_stream =
+               mongoc_cluster_stream_for_writes (cluster, &batch->error);
+         } else {
+            worker->server_stream =
+               mongoc_cluster_stream_for_server (cluster,
+                                                 dispatch->server_id,
+                                                 true /* reconnect_ok */,
+                                                 &batch->error);
+         }
+
+         worker->owns_stream = true;
+      }
+
+      if (worker->server_stream) {
+         batch->ok = mongoc_cluster_run_command_monitored (
+            cluster,
+            worker->server_stream,
+            MONGOC_QUERY_NONE,
+            dispatch->database,
+            batch->cmd,
+            &batch->reply,
+            &batch->error);
+      } else {
+         bson_init (&batch->reply);
+         batch->ok = false;
+      }
+
+      if (!batch->ok && bson_empty (&batch->reply)) {
+         mongoc_mutex_lock (&dispatch->mutex);
+         dispatch->must_stop = true;
+         mongoc_mutex_unlock (&dispatch->mutex);
+      }
+   }
+
+   return NULL;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_bulk_operation_execute_concurrent --
+ *
+ *       If @bulk is unordered and has a client pool, build all of its
+ *       batches up front and send them from up to max_concurrency threads,
+ *       the calling thread with @bulk's client and the others with clients
+ *       from the pool, then merge the replies into @bulk's result in order.
+ *
+ * Returns:
+ *       false, having sent nothing, if @bulk must be executed serially.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_bulk_operation_execute_concurrent (
+   mongoc_bulk_operation_t *bulk, mongoc_server_stream_t *server_stream)
+{
+   const mongoc_write_concern_t *write_concern;
+   mongoc_bulk_dispatch_t dispatch;
+   mongoc_bulk_worker_t *workers;
+   mongoc_write_command_t *command;
+   mongoc_write_batch_t *batch;
+   uint32_t n_workers;
+   uint32_t offset = 0;
+   uint32_t i;
+   bool hinted;
+   bool ret = false;
+
+   ENTRY;
+
+   hinted = bulk->server_id != 0;
+
+   if (bulk->flags.ordered || !bulk->pool || bulk->max_concurrency < 2) {
+      RETURN (false);
+   }
+
+   /* server ids are only valid in the topology they come from */
+   if (_mongoc_client_pool_get_topology_description (bulk->pool) !=
+       &bulk->client->topology->description) {
+      RETURN (false);
+   }
+
+   /* leave legacy opcodes and validation errors to the serial path */
+   if (server_stream->sd->max_wire_version < WIRE_VERSION_WRITE_CMD) {
+      RETURN (false);
+   }
+
+   write_concern = bulk->write_concern;
+   if (!write_concern) {
+      write_concern = bulk->client->write_concern;
+   }
+
+   if (!mongoc_write_concern_is_valid (write_concern) ||
+       !mongoc_write_concern_is_acknowledged (write_concern)) {
+      RETURN (false);
+   }
+
+   _mongoc_array_init (&dispatch.batches, sizeof (mongoc_write_batch_t));
+
+   for (i = 0; i < bulk->commands.len; i++) {
+      command =
+         &_mongoc_array_index (&bulk->commands, mongoc_write_command_t, i);
+
+      if (command->flags.has_collation &&
+          server_stream->sd->max_wire_version < WIRE_VERSION_COLLATION) {
+         GOTO (done);
+      }
+
+      if (!_mongoc_write_command_split (command,
+                                        server_stream,
+                                        bulk->collection,
+                                        write_concern,
+                                        offset,
+                                        &dispatch.batches)) {
+         GOTO (done);
+      }
+
+      offset += command->n_documents;
+   }
+
+   if (dispatch.batches.len < 2) {
+      GOTO (done);
+   }
+
+   dispatch.next = 0;
+   dispatch.must_stop = false;
+   dispatch.database = bulk->database;
+   dispatch.server_id = server_stream->sd->id;
+   /* spread the batches over several mongos */
+   dispatch.select_for_writes =
+      !hinted && server_stream->topology_type == MONGOC_TOPOLOGY_SHARDED;
+   mongoc_mutex_init (&dispatch.mutex);
+
+   n_workers = (uint32_t) BSON_MIN (bulk->max_concurrency,
+                                    (uint32_t) dispatch.batches.len);
+   workers = (mongoc_bulk_worker_t *) bson_malloc0 (
+      n_workers * sizeof (mongoc_bulk_worker_t));
+
+   /* the calling thread is the first worker. don't block waiting for pooled
+    * clients: if the pool is exhausted, use fewer threads */
+   workers[0].dispatch = &dispatch;
+   workers[0].client = bulk->client;
+   workers[0].server_stream = server_stream;
+
+   for (i = 1; i < n_workers; i++) {
+      workers[i].dispatch = &dispatch;
+      workers[i].client = mongoc_client_pool_try_pop (bulk->pool);
+      if (!workers[i].client) {
+         n_workers = i;
+         break;
+      }
+
+      if (mongoc_thread_create (
+             &workers[i].thread, _mongoc_bulk_worker_run, &workers[i])) {
+         mongoc_client_pool_push (bulk->pool, workers[i].client);
+         n_workers = i;
+         break;
+      }
+   }
+
+   _mongoc_bulk_worker_run (&workers[0]);
+
+   for (i = 1; i < n_workers; i++) {
+      mongoc_thread_join (workers[i].thread);
+
+      if (workers[i].owns_stream) {
+         mongoc_server_stream_cleanup (workers[i].server_stream);
+      }
+
+      mongoc_client_pool_push (bulk->pool, workers[i].client);
+   }
+
+   for (i = 0; i < dispatch.batches.len; i++) {
+      batch = &_mongoc_array_index (&dispatch.batches, mongoc_write_batch_t, i);
+      if (batch->sent) {
+         _mongoc_write_result_merge_batch (&bulk->result, batch);
+      }
+   }
+
+   bson_free (workers);
+   mongoc_mutex_destroy (&dispatch.mutex);
+   ret = true;
+
+done:
+   for (i = 0; i < dispatch.batches.len; i++) {
+      _mongoc_write_batch_destroy (
+         &_mongoc_array_index (&dispatch.batches, mongoc_write_batch_t, i));
+   }
+
+   _mongoc_array_destroy (&dispatch.batches);
+
+   RETURN (ret);
+}
+
+
 uint32_t
 mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk, /* IN */
                                bson_t *reply,                 /* OUT */
@@ -666,6 +918,11 @@ mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk, /* IN */
       RETURN (false);
    }
 
+   if (_mongoc_bulk_operation_execute_concurrent (bulk, server_stream)) {
+      bulk->server_id = server_stream->sd->id;
+      GOTO (cleanup);
+   }
+
    for (i = 0; i < bulk->commands.len; i++) {
       command =
          &_mongoc_array_index (&bulk->commands, mongoc_write_command_t, i);
@@ -793,3 +1050,29 @@ mongoc_bulk_operation_set_bypass_document_validation (
       bypass ? MONGOC_BYPASS_DOCUMENT_VALIDATION_TRUE
              : MONGOC_BYPASS_DOCUMENT_VALIDATION_FALSE;
 }
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_bulk_operation_set_concurrency --
+ *
+ *       Let an unordered bulk operation send up to @max_concurrency batches
+ *       at once, each on the connection of a client from @pool. @bulk's
+ *       own client must come from @pool. If @pool is NULL or
+ *       @max_concurrency is less than 2, batches are sent one at a time,
+ *       which is the default.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_bulk_operation_set_concurrency (mongoc_bulk_operation_t *bulk,
+                                       mongoc_client_pool_t *pool,
+                                       uint32_t max_concurrency)
+{
+   BSON_ASSERT (bulk);
+
+   bulk->pool = pool;
+   bulk->max_concurrency = max_concurrency;
+}
@@ -34,6 +34,9 @@ BSON_BEGIN_DECLS
 typedef struct _mongoc_bulk_operation_t mongoc_bulk_operation_t;
 typedef struct _mongoc_bulk_write_flags_t mongoc_bulk_write_flags_t;
 
+/* forward decl */
+struct _mongoc_client_pool_t;
+
 
 BSON_EXPORT (void)
 mongoc_bulk_operation_destroy (mongoc_bulk_operation_t *bulk);
@@ -133,6 +136,10 @@ BSON_EXPORT (uint32_t)
 mongoc_bulk_operation_get_hint (const mongoc_bulk_operation_t *bulk);
 BSON_EXPORT (const mongoc_write_concern_t *)
 mongoc_bulk_operation_get_write_concern (const mongoc_bulk_operation_t *bulk);
+BSON_EXPORT (void)
+mongoc_bulk_operation_set_concurrency (mongoc_bulk_operation_t *bulk,
+                                       struct _mongoc_client_pool_t *pool,
+                                       uint32_t max_concurrency);
 BSON_END_DECLS
 
 
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_CLIENT_ASYNC_PRIVATE_H
+#define MONGOC_CLIENT_ASYNC_PRIVATE_H
+
+#if !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-buffer-private.h"
+#include "mongoc-client-async.h"
+#include "mongoc-cluster-private.h"
+#include "mongoc-poller-private.h"
+#include "mongoc-set-private.h"
+#include "mongoc-write-command-private.h"
+
+
+BSON_BEGIN_DECLS
+
+
+typedef enum {
+   MONGOC_CLIENT_ASYNC_OP_IN_FLIGHT,
+   MONGOC_CLIENT_ASYNC_OP_DONE,
+} mongoc_client_async_op_state_t;
+
+
+/* a connection of the async object's own to one server, not shared with
+ * the client's operations or the topology scanner. any number of commands
+ * are written to it back-to-back, and their replies are matched to them
+ * by request id. */
+typedef struct _mongoc_client_async_conn_t {
+   struct _mongoc_client_async_t *async;
+   uint32_t server_id;
+   mongoc_cluster_node_t *node;
+   mongoc_stream_t *stream; /* node's stream, without a buffering layer */
+   mongoc_poller_entry_t *poller_entry;
+   mongoc_buffer_t out; /* commands not yet written */
+   mongoc_buffer_t in;  /* replies not yet complete */
+   uint32_t n_in_flight;
+   bool failed; /* closed after the poller's events are handled */
+   bson_error_t error;
+} mongoc_client_async_conn_t;
+
+
+typedef struct _mongoc_client_async_op_t {
+   struct _mongoc_client_async_t *async;
+   mongoc_client_async_op_state_t state;
+   mongoc_client_async_conn_t *conn;
+   uint32_t request_id;
+   int64_t expire_at; /* 0 if socketTimeoutMS is 0 */
+   /* set for inserts, whose replies are parsed as write results */
+   mongoc_write_command_t *write_command;
+   mongoc_write_concern_t *write_concern;
+   mongoc_client_async_cb_t cb;
+   void *cb_data;
+   bool succeeded;
+   bson_t reply;
+   bson_error_t error;
+   struct _mongoc_client_async_op_t *next;
+   struct _mongoc_client_async_op_t *prev;
+} mongoc_client_async_op_t;
+
+
+struct _mongoc_client_async_t {
+   mongoc_client_t *client;
+   mongoc_poller_t *poller;
+   mongoc_set_t *conns;     /* by server id */
+   mongoc_set_t *in_flight; /* ops by request id */
+   mongoc_client_async_op_t *ops;  /* in flight, oldest first */
+   mongoc_client_async_op_t *done; /* waiting for their callbacks */
+   uint32_t n_ops;
+};
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_CLIENT_ASYNC_PRIVATE_H */
@@ -0,0 +1,1019 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mongoc-client-async-private.h"
+#include "mongoc-client-private.h"
+#include "mongoc-cluster-private.h"
+#include "mongoc-counters-private.h"
+#include "mongoc-errno-private.h"
+#include "mongoc-error.h"
+#include "mongoc-read-prefs-private.h"
+#include "mongoc-rpc-private.h"
+#include "mongoc-stream-private.h"
+#include "mongoc-topology-private.h"
+#include "mongoc-trace-private.h"
+#include "mongoc-write-concern-private.h"
+#include "utlist.h"
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "client-async"
+
+
+/* how much to read from a connection per poll, unless a longer reply is
+ * known to be waiting */
+#define MONGOC_CLIENT_ASYNC_READ_SIZE (64 * 1024)
+
+
+static void
+_mongoc_client_async_conn_dtor (void *item, void *ctx)
+{
+   mongoc_client_async_conn_t *conn = (mongoc_client_async_conn_t *) item;
+
+   _mongoc_poller_remove (conn->async->poller, conn->poller_entry);
+   _mongoc_cluster_node_destroy (conn->node); /* also destroys stream */
+   _mongoc_buffer_destroy (&conn->out);
+   _mongoc_buffer_destroy (&conn->in);
+   bson_free (conn);
+}
+
+
+static void
+_mongoc_client_async_op_dtor_noop (void *item, void *ctx)
+{
+   /* ops are freed from the ops and done lists */
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_async_new --
+ *
+ *       Create an object to run operations on @client's servers without
+ *       blocking on their replies. Operations are driven by calling
+ *       mongoc_client_async_run().
+ *
+ * Returns:
+ *       A new mongoc_client_async_t that must be freed with
+ *       mongoc_client_async_destroy().
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_client_async_t *
+mongoc_client_async_new (mongoc_client_t *client)
+{
+   mongoc_client_async_t *async;
+
+   BSON_ASSERT (client);
+
+   async = (mongoc_client_async_t *) bson_malloc0 (sizeof *async);
+   async->client = client;
+   async->poller = _mongoc_poller_new ();
+   async->conns = mongoc_set_new (8, _mongoc_client_async_conn_dtor, NULL);
+   async->in_flight =
+      mongoc_set_new (64, _mongoc_client_async_op_dtor_noop, NULL);
+
+   return async;
+}
+
+
+static void
+_mongoc_client_async_op_destroy (mongoc_client_async_op_t *op)
+{
+   if (op->write_command) {
+      _mongoc_write_command_destroy (op->write_command);
+      bson_free (op->write_command);
+   }
+
+   mongoc_write_concern_destroy (op->write_concern);
+   bson_destroy (&op->reply);
+   bson_free (op);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_async_op_finish --
+ *
+ *       Record the outcome of @op: either the server's @reply, or @error
+ *       if the command could not be run. The user's callback is called
+ *       later, from mongoc_client_async_run().
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_client_async_op_finish (mongoc_client_async_op_t *op,
+                                const bson_t *reply,
+                                const bson_error_t *error)
+{
+   mongoc_client_async_t *async;
+   mongoc_client_t *client;
+   mongoc_write_result_t result;
+
+   BSON_ASSERT (op->state == MONGOC_CLIENT_ASYNC_OP_IN_FLIGHT);
+
+   async = op->async;
+   client = async->client;
+
+   /* a late reply to this request id is discarded */
+   mongoc_set_rm (async->in_flight, op->request_id);
+   op->conn->n_in_flight--;
+   op->conn = NULL;
+
+   DL_DELETE (async->ops, op);
+   DL_APPEND (async->done, op);
+   op->state = MONGOC_CLIENT_ASYNC_OP_DONE;
+
+   if (error) {
+      op->succeeded = false;
+      memcpy (&op->error, error, sizeof (bson_error_t));
+      return;
+   }
+
+   BSON_ASSERT (reply);
+
+   if (_mongoc_populate_cmd_error (
+          reply, client->error_api_version, &op->error)) {
+      op->succeeded = false;
+      bson_concat (&op->reply, reply);
+      return;
+   }
+
+   if (!op->write_command) {
+      op->succeeded = true;
+      bson_concat (&op->reply, reply);
+      return;
+   }
+
+   /* like mongoc_collection_insert, report a write result */
+   _mongoc_write_result_init (&result);
+   _mongoc_write_result_merge (&result, op->write_command, reply, 0);
+   op->succeeded = _mongoc_write_result_complete (&result,
+                                                  client->error_api_version,
+                                                  op->write_concern,
+                                                  (mongoc_error_domain_t) 0,
+                                                  &op->reply,
+                                                  &op->error);
+   _mongoc_write_result_destroy (&result);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_async_conn_get --
+ *
+ *       Get the async object's connection to @server_id, connecting,
+ *       running the handshake and authenticating if there is none yet.
+ *
+ *       The connection is never shared with the client's own operations
+ *       or with the topology scanner, so a synchronous command on the
+ *       client can't read the reply to an async one, or vice versa.
+ *
+ * Returns:
+ *       The connection, or NULL and sets @error.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static mongoc_client_async_conn_t *
+_mongoc_client_async_conn_get (mongoc_client_async_t *async,
+                               uint32_t server_id,
+                               bson_error_t *error)
+{
+   mongoc_client_async_conn_t *conn;
+   mongoc_cluster_node_t *node;
+
+   conn = (mongoc_client_async_conn_t *) mongoc_set_get (async->conns,
+                                                         server_id);
+   if (conn) {
+      return conn;
+   }
+
+   node = _mongoc_cluster_node_connect (
+      &async->client->cluster, server_id, error);
+
+   if (!node) {
+      mongoc_topology_invalidate_server (
+         async->client->topology, server_id, error);
+      return NULL;
+   }
+
+   conn = (mongoc_client_async_conn_t *) bson_malloc0 (sizeof *conn);
+   conn->async = async;
+   conn->server_id = server_id;
+   conn->node = node;
+
+   /* read only what the poller says is there; a buffering layer would
+    * block trying to fill itself */
+   conn->stream = node->stream;
+   if (conn->stream->type == MONGOC_STREAM_BUFFERED) {
+      conn->stream = mongoc_stream_get_base_stream (conn->stream);
+   }
+
+   _mongoc_buffer_init (&conn->out, NULL, 0, NULL, NULL);
+   _mongoc_buffer_init (&conn->in, NULL, 0, NULL, NULL);
+
+   /* always poll for reads, to notice the server hanging up */
+   conn->poller_entry =
+      _mongoc_poller_add (async->poller, conn->stream, POLLIN, conn);
+
+   mongoc_set_add (async->conns, server_id, conn);
+
+   return conn;
+}
+
+
+/* mark @conn to be closed once the poller's events are handled */
+static void
+_mongoc_client_async_conn_set_failed (mongoc_client_async_conn_t *conn,
+                                      uint32_t domain,
+                                      uint32_t code,
+                                      const char *message)
+{
+   if (!conn->failed) {
+      conn->failed = true;
+      bson_set_error (&conn->error, domain, code, "%s", message);
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_async_op_new --
+ *
+ *       Serialize @command behind any others waiting to be written to
+ *       @conn. The command is sent from mongoc_client_async_run(), and
+ *       its reply is found by the request id assigned here.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static mongoc_client_async_op_t *
+_mongoc_client_async_op_new (mongoc_client_async_t *async,
+                             mongoc_client_async_conn_t *conn,
+                             const char *db_name,
+                             const bson_t *command,
+                             mongoc_query_flags_t flags,
+                             mongoc_client_async_cb_t cb,
+                             void *cb_data)
+{
+   mongoc_client_async_op_t *op;
+   mongoc_cluster_t *cluster;
+   mongoc_array_t iov;
+   mongoc_iovec_t *iovec;
+   mongoc_rpc_t rpc;
+   char *cmd_ns;
+   size_t i;
+
+   cluster = &async->client->cluster;
+
+   op = (mongoc_client_async_op_t *) bson_malloc0 (sizeof *op);
+   op->async = async;
+   op->state = MONGOC_CLIENT_ASYNC_OP_IN_FLIGHT;
+   op->conn = conn;
+   op->request_id = (uint32_t) ++cluster->request_id;
+   op->cb = cb;
+   op->cb_data = cb_data;
+   bson_init (&op->reply);
+
+   /* socketTimeoutMS=0 means no timeout */
+   if (cluster->sockettimeoutms) {
+      op->expire_at = bson_get_monotonic_time () +
+                      (int64_t) cluster->sockettimeoutms * 1000;
+   }
+
+   cmd_ns = bson_strdup_printf ("%s.$cmd", db_name);
+   _mongoc_rpc_prep_command (&rpc, cmd_ns, command, flags);
+   rpc.query.request_id = (int32_t) op->request_id;
+
+   _mongoc_array_init (&iov, sizeof (mongoc_iovec_t));
+   _mongoc_rpc_gather (&rpc, &iov);
+   _mongoc_rpc_swab_to_le (&rpc);
+
+   iovec = (mongoc_iovec_t *) iov.data;
+   for (i = 0; i < iov.len; i++) {
+      if (iovec[i].iov_len) {
+         _mongoc_buffer_append (&conn->out,
+                                (const uint8_t *) iovec[i].iov_base,
+                                iovec[i].iov_len);
+      }
+   }
+
+   _mongoc_array_destroy (&iov);
+   bson_free (cmd_ns);
+
+   conn->n_in_flight++;
+   _mongoc_poller_modify (async->poller, conn->poller_entry, POLLIN | POLLOUT);
+
+   mongoc_set_add (async->in_flight, op->request_id, op);
+   DL_APPEND (async->ops, op);
+   async->n_ops++;
+
+   return op;
+}
+
+
+/* write as much of @conn's pending commands as the socket takes */
+static void
+_mongoc_client_async_conn_write (mongoc_client_async_conn_t *conn)
+{
+   mongoc_iovec_t iov;
+   ssize_t bytes;
+
+   if (!conn->out.len) {
+      return;
+   }
+
+   iov.iov_base = (void *) (conn->out.data + conn->out.off);
+   iov.iov_len = conn->out.len;
+
+   errno = 0;
+   bytes = mongoc_stream_writev (conn->stream, &iov, 1, 0);
+
+   if (bytes < 0) {
+      if (!MONGOC_ERRNO_IS_AGAIN (errno)) {
+         _mongoc_client_async_conn_set_failed (conn,
+                                               MONGOC_ERROR_STREAM,
+                                               MONGOC_ERROR_STREAM_SOCKET,
+                                               "Failed to write rpc bytes.");
+      }
+
+      return;
+   }
+
+   conn->out.off += bytes;
+   conn->out.len -= bytes;
+
+   if (!conn->out.len) {
+      _mongoc_buffer_clear (&conn->out, false);
+      _mongoc_poller_modify (
+         conn->async->poller, conn->poller_entry, POLLIN);
+   }
+}
+
+
+/* find the op a whole reply message answers, and finish it */
+static void
+_mongoc_client_async_conn_handle_reply (mongoc_client_async_conn_t *conn,
+                                        const uint8_t *data,
+                                        size_t len)
+{
+   mongoc_client_async_op_t *op;
+   mongoc_rpc_t rpc;
+   bson_error_t error;
+   bson_t reply;
+
+   if (!_mongoc_rpc_scatter (&rpc, data, len)) {
+      _mongoc_client_async_conn_set_failed (conn,
+                                            MONGOC_ERROR_PROTOCOL,
+                                            MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                                            "Failed to decode reply.");
+      return;
+   }
+
+   _mongoc_rpc_swab_from_le (&rpc);
+
+   if (rpc.header.opcode != MONGOC_OPCODE_REPLY) {
+      _mongoc_client_async_conn_set_failed (conn,
+                                            MONGOC_ERROR_PROTOCOL,
+                                            MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                                            "Invalid opcode in reply.");
+      return;
+   }
+
+   op = (mongoc_client_async_op_t *) mongoc_set_get (
+      conn->async->in_flight, (uint32_t) rpc.reply.response_to);
+
+   if (!op) {
+      /* the op timed out, its reply is ignored */
+      return;
+   }
+
+   if (!_mongoc_rpc_reply_get_first (&rpc.reply, &reply)) {
+      bson_set_error (&error,
+                      MONGOC_ERROR_BSON,
+                      MONGOC_ERROR_BSON_INVALID,
+                      "Failed to decode reply BSON document.");
+      _mongoc_client_async_op_finish (op, NULL, &error);
+      return;
+   }
+
+   _mongoc_client_async_op_finish (op, &reply, NULL);
+   bson_destroy (&reply);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_async_conn_read --
+ *
+ *       Read once from @conn, which the poller says is readable, and
+ *       finish each op whose reply is now whole. Replies may come in
+ *       any order.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_client_async_conn_read (mongoc_client_async_conn_t *conn)
+{
+   mongoc_buffer_t *in;
+   uint32_t msg_len;
+   size_t want;
+   ssize_t bytes;
+
+   in = &conn->in;
+   want = MONGOC_CLIENT_ASYNC_READ_SIZE;
+
+   if (in->len >= 4) {
+      memcpy (&msg_len, in->data + in->off, 4);
+      msg_len = BSON_UINT32_FROM_LE (msg_len);
+      if (msg_len > in->len && msg_len - in->len > want) {
+         want = msg_len - in->len;
+      }
+   }
+
+   bytes = _mongoc_buffer_try_append_from_stream (in, conn->stream, want, 0,
+                                                  NULL);
+
+   if (bytes <= 0) {
+      _mongoc_client_async_conn_set_failed (
+         conn,
+         MONGOC_ERROR_STREAM,
+         MONGOC_ERROR_STREAM_SOCKET,
+         bytes == 0 ? "Server closed connection."
+                    : "Failed to receive reply from server.");
+      return;
+   }
+
+   while (in->len >= 4) {
+      memcpy (&msg_len, in->data + in->off, 4);
+      msg_len = BSON_UINT32_FROM_LE (msg_len);
+
+      if (msg_len < 16 || msg_len > conn->node->max_msg_size) {
+         _mongoc_client_async_conn_set_failed (
+            conn,
+            MONGOC_ERROR_PROTOCOL,
+            MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+            "Corrupt or malicious reply received.");
+         return;
+      }
+
+      if (in->len < msg_len) {
+         break;
+      }
+
+      _mongoc_client_async_conn_handle_reply (
+         conn, in->data + in->off, msg_len);
+
+      if (conn->failed) {
+         return;
+      }
+
+      in->off += msg_len;
+      in->len -= msg_len;
+   }
+
+   if (!in->len) {
+      _mongoc_buffer_clear (in, false);
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_async_conn_close --
+ *
+ *       Fail every op in flight on @conn with its error, mark its server
+ *       unknown and close it. The next op on the server reconnects.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_client_async_conn_close (mongoc_client_async_t *async,
+                                 mongoc_client_async_conn_t *conn)
+{
+   mongoc_client_async_op_t *op, *tmp;
+
+   DL_FOREACH_SAFE (async->ops, op, tmp)
+   {
+      if (op->conn == conn) {
+         _mongoc_client_async_op_finish (op, NULL, &conn->error);
+      }
+   }
+
+   _mongoc_node_counter_add (
+      conn->node->counters, MONGOC_NODE_COUNTER_ERRORS, 1);
+   mongoc_topology_invalidate_server (
+      async->client->topology, conn->server_id, &conn->error);
+
+   mongoc_set_rm (async->conns, conn->server_id);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_async_poll --
+ *
+ *       Wait up to @timeout_msec for any connection to be ready, then
+ *       write and read what each ready connection allows.
+ *
+ *       Connections that fail are only marked while the poller's events
+ *       are handled, and closed afterwards, so no event refers to a
+ *       connection that is already freed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_client_async_poll (mongoc_client_async_t *async, int32_t timeout_msec)
+{
+   const mongoc_poller_event_t *events;
+   mongoc_client_async_conn_t *conn;
+   ssize_t nactive;
+   ssize_t i;
+   int j;
+
+   nactive = _mongoc_poller_wait (async->poller, timeout_msec, &events);
+
+   for (i = 0; i < nactive; i++) {
+      conn = (mongoc_client_async_conn_t *) events[i].data;
+
+      if (events[i].revents & POLLOUT) {
+         _mongoc_client_async_conn_write (conn);
+      }
+
+      if (!conn->failed && (events[i].revents & POLLIN)) {
+         _mongoc_client_async_conn_read (conn);
+      } else if (events[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+         _mongoc_client_async_conn_set_failed (conn,
+                                               MONGOC_ERROR_STREAM,
+                                               MONGOC_ERROR_STREAM_SOCKET,
+                                               "Server closed connection.");
+      }
+   }
+
+   /* closing removes the conn from the set, items after it move down */
+   for (j = (int) async->conns->items_len - 1; j >= 0; j--) {
+      conn = (mongoc_client_async_conn_t *) mongoc_set_get_item (
+         async->conns, j);
+
+      if (conn->failed) {
+         _mongoc_client_async_conn_close (async, conn);
+      }
+   }
+}
+
+
+/* fail ops that have waited longer than socketTimeoutMS; the connection
+ * stays open, and their replies are discarded if they come */
+static void
+_mongoc_client_async_expire (mongoc_client_async_t *async)
+{
+   mongoc_client_async_op_t *op;
+   bson_error_t error;
+   int64_t now;
+
+   now = bson_get_monotonic_time ();
+
+   /* ops are in start order, and all share the client's socketTimeoutMS */
+   while ((op = async->ops) && op->expire_at && op->expire_at <= now) {
+      bson_set_error (&error,
+                      MONGOC_ERROR_STREAM,
+                      MONGOC_ERROR_STREAM_SOCKET,
+                      "socket timeout");
+      _mongoc_client_async_op_finish (op, NULL, &error);
+   }
+}
+
+
+/* call the callbacks of finished operations and free them */
+static void
+_mongoc_client_async_complete (mongoc_client_async_t *async)
+{
+   mongoc_client_async_op_t *done, *op, *tmp;
+
+   /* callbacks may start more operations */
+   done = async->done;
+   async->done = NULL;
+
+   DL_FOREACH_SAFE (done, op, tmp)
+   {
+      DL_DELETE (done, op);
+      async->n_ops--;
+
+      op->cb (op->succeeded,
+              &op->reply,
+              op->succeeded ? NULL : &op->error,
+              op->cb_data);
+
+      _mongoc_client_async_op_destroy (op);
+   }
+}
+
+
+/* queue a read command on a server selected with @read_prefs */
+static bool
+_mongoc_client_async_read_command (mongoc_client_async_t *async,
+                                   const char *db_name,
+                                   const bson_t *command,
+                                   const mongoc_read_prefs_t *read_prefs,
+                                   int32_t min_wire_version,
+                                   mongoc_client_async_cb_t cb,
+                                   void *cb_data,
+                                   bson_error_t *error)
+{
+   mongoc_client_t *client;
+   mongoc_server_description_t *sd;
+   mongoc_server_stream_t *server_stream;
+   mongoc_client_async_conn_t *conn;
+   mongoc_apply_read_prefs_result_t result = READ_PREFS_RESULT_INIT;
+   bool ret = false;
+
+   ENTRY;
+
+   client = async->client;
+
+   if (!_mongoc_read_prefs_validate (read_prefs, error)) {
+      RETURN (false);
+   }
+
+   _mongoc_client_recv_prefetch (client);
+
+   sd = mongoc_topology_select (
+      client->topology, MONGOC_SS_READ, read_prefs, error);
+
+   if (!sd) {
+      RETURN (false);
+   }
+
+   conn = _mongoc_client_async_conn_get (async, sd->id, error);
+
+   if (!conn) {
+      mongoc_server_description_destroy (sd);
+      RETURN (false);
+   }
+
+   /* takes ownership of sd, used for the wire version and read prefs */
+   server_stream = mongoc_server_stream_new (
+      _mongoc_topology_get_type (client->topology), sd, conn->stream);
+
+   if (server_stream->sd->max_wire_version < min_wire_version) {
+      bson_set_error (error,
+                      MONGOC_ERROR_PROTOCOL,
+                      MONGOC_ERROR_PROTOCOL_BAD_WIRE_VERSION,
+                      "The selected server does not support this operation");
+      GOTO (done);
+   }
+
+   apply_read_preferences (
+      read_prefs, server_stream, command, MONGOC_QUERY_NONE, &result);
+
+   _mongoc_client_async_op_new (async,
+                                conn,
+                                db_name,
+                                result.query_with_read_prefs,
+                                result.flags,
+                                cb,
+                                cb_data);
+
+   ret = true;
+
+done:
+   apply_read_prefs_result_cleanup (&result);
+   mongoc_server_stream_cleanup (server_stream);
+
+   RETURN (ret);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_async_command --
+ *
+ *       Queue @command to run on @db_name, on a server selected with
+ *       @read_prefs. @cb is called from mongoc_client_async_run() once the
+ *       reply arrives or the command fails.
+ *
+ *       Selecting a server, and connecting to it if needed, blocks.
+ *
+ * Returns:
+ *       true if the command was queued; otherwise false, @error is set and
+ *       @cb will not be called.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_client_async_command (mongoc_client_async_t *async,
+                             const char *db_name,
+                             const bson_t *command,
+                             const mongoc_read_prefs_t *read_prefs,
+                             mongoc_client_async_cb_t cb,
+                             void *cb_data,
+                             bson_error_t *error)
+{
+   BSON_ASSERT (async);
+   BSON_ASSERT (db_name);
+   BSON_ASSERT (command);
+   BSON_ASSERT (cb);
+
+   return _mongoc_client_async_read_command (async,
+                                             db_name,
+                                             command,
+                                             read_prefs,
+                                             WIRE_VERSION_MIN,
+                                             cb,
+                                             cb_data,
+                                             error);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_async_find --
+ *
+ *       Queue a "find" command on @collection_name with @filter, on a
+ *       server selected with @read_prefs, or the client's read preference
+ *       if @read_prefs is NULL. @opts are appended to the command. The
+ *       reply passed to @cb contains the first batch of results.
+ *
+ * Returns:
+ *       true if the command was queued; otherwise false, @error is set and
+ *       @cb will not be called.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_client_async_find (mongoc_client_async_t *async,
+                          const char *db_name,
+                          const char *collection_name,
+                          const bson_t *filter,
+                          const bson_t *opts,
+                          const mongoc_read_prefs_t *read_prefs,
+                          mongoc_client_async_cb_t cb,
+                          void *cb_data,
+                          bson_error_t *error)
+{
+   bson_t command = BSON_INITIALIZER;
+   bool ret;
+
+   BSON_ASSERT (async);
+   BSON_ASSERT (db_name);
+   BSON_ASSERT (collection_name);
+   BSON_ASSERT (filter);
+   BSON_ASSERT (cb);
+
+   if (!read_prefs) {
+      read_prefs = mongoc_client_get_read_prefs (async->client);
+   }
+
+   BSON_APPEND_UTF8 (&command, "find", collection_name);
+   BSON_APPEND_DOCUMENT (&command, "filter", filter);
+
+   if (opts) {
+      bson_concat (&command, opts);
+   }
+
+   ret = _mongoc_client_async_read_command (async,
+                                            db_name,
+                                            &command,
+                                            read_prefs,
+                                            WIRE_VERSION_FIND_CMD,
+                                            cb,
+                                            cb_data,
+                                            error);
+
+   bson_destroy (&command);
+
+   return ret;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_async_insert --
+ *
+ *       Queue an "insert" command for @document, generating an "_id" if
+ *       it has none. @write_concern defaults to the client's. The reply
+ *       passed to @cb is a write result, as from mongoc_collection_insert.
+ *
+ * Returns:
+ *       true if the command was queued; otherwise false, @error is set and
+ *       @cb will not be called.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_client_async_insert (mongoc_client_async_t *async,
+                            const char *db_name,
+                            const char *collection_name,
+                            const bson_t *document,
+                            const mongoc_write_concern_t *write_concern,
+                            mongoc_client_async_cb_t cb,
+                            void *cb_data,
+                            bson_error_t *error)
+{
+   mongoc_bulk_write_flags_t write_flags = MONGOC_BULK_WRITE_FLAGS_INIT;
+   mongoc_server_description_t *sd;
+   mongoc_client_async_conn_t *conn;
+   mongoc_write_command_t *write_command;
+   mongoc_client_async_op_t *op;
+   bson_t command = BSON_INITIALIZER;
+
+   ENTRY;
+
+   BSON_ASSERT (async);
+   BSON_ASSERT (db_name);
+   BSON_ASSERT (collection_name);
+   BSON_ASSERT (document);
+   BSON_ASSERT (cb);
+
+   if (!write_concern) {
+      write_concern = mongoc_client_get_write_concern (async->client);
+   }
+
+   if (!mongoc_write_concern_is_valid (write_concern)) {
+      bson_set_error (error,
+                      MONGOC_ERROR_COMMAND,
+                      MONGOC_ERROR_COMMAND_INVALID_ARG,
+                      "The write concern is invalid.");
+      RETURN (false);
+   }
+
+   _mongoc_client_recv_prefetch (async->client);
+
+   sd = mongoc_topology_select (
+      async->client->topology, MONGOC_SS_WRITE, NULL, error);
+
+   if (!sd) {
+      RETURN (false);
+   }
+
+   if (sd->max_wire_version < WIRE_VERSION_WRITE_CMD) {
+      bson_set_error (error,
+                      MONGOC_ERROR_PROTOCOL,
+                      MONGOC_ERROR_PROTOCOL_BAD_WIRE_VERSION,
+                      "The selected server does not support this operation");
+      mongoc_server_description_destroy (sd);
+      RETURN (false);
+   }
+
+   conn = _mongoc_client_async_conn_get (async, sd->id, error);
+   mongoc_server_description_destroy (sd);
+
+   if (!conn) {
+      RETURN (false);
+   }
+
+   write_command =
+      (mongoc_write_command_t *) bson_malloc0 (sizeof *write_command);
+   _mongoc_write_command_init_insert (
+      write_command, document, write_flags, 0, false);
+
+   BSON_APPEND_UTF8 (&command, "insert", collection_name);
+   BSON_APPEND_ARRAY (&command, "documents", write_command->documents);
+   BSON_APPEND_BOOL (&command, "ordered", true);
+
+   if (!_mongoc_write_concern_is_default (write_concern)) {
+      BSON_APPEND_DOCUMENT (
+         &command,
+         "writeConcern",
+         _mongoc_write_concern_get_bson (
+            (mongoc_write_concern_t *) write_concern));
+   }
+
+   op = _mongoc_client_async_op_new (async,
+                                     conn,
+                                     db_name,
+                                     &command,
+                                     MONGOC_QUERY_NONE,
+                                     cb,
+                                     cb_data);
+   op->write_command = write_command;
+   op->write_concern = mongoc_write_concern_copy (write_concern);
+
+   bson_destroy (&command);
+
+   RETURN (true);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_async_run --
+ *
+ *       Wait up to @timeout_msec for I/O on the connections of operations
+ *       in flight, send their commands and read their replies, and call
+ *       the callbacks of operations that completed. Pass 0 to only handle
+ *       connections that are ready.
+ *
+ *       An operation fails with a timeout once socketTimeoutMS has passed
+ *       since it started, unless socketTimeoutMS is 0.
+ *
+ * Returns:
+ *       The number of operations still pending.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+uint32_t
+mongoc_client_async_run (mongoc_client_async_t *async, int32_t timeout_msec)
+{
+   ENTRY;
+
+   BSON_ASSERT (async);
+
+   if (async->ops) {
+      _mongoc_client_async_poll (async, timeout_msec);
+      _mongoc_client_async_expire (async);
+   }
+
+   _mongoc_client_async_complete (async);
+
+   RETURN (async->n_ops);
+}
+
+
+uint32_t
+mongoc_client_async_get_pending (const mongoc_client_async_t *async)
+{
+   BSON_ASSERT (async);
+
+   return async->n_ops;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_async_destroy --
+ *
+ *       Free @async and cancel its pending operations without calling
+ *       their callbacks, and close its connections. The client's own
+ *       connections are not affected.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_client_async_destroy (mongoc_client_async_t *async)
+{
+   mongoc_client_async_op_t *op, *tmp;
+
+   ENTRY;
+
+   if (!async) {
+      EXIT;
+   }
+
+   DL_FOREACH_SAFE (async->ops, op, tmp)
+   {
+      DL_DELETE (async->ops, op);
+      _mongoc_client_async_op_destroy (op);
+   }
+
+   DL_FOREACH_SAFE (async->done, op, tmp)
+   {
+      DL_DELETE (async->done, op);
+      _mongoc_client_async_op_destroy (op);
+   }
+
+   mongoc_set_destroy (async->in_flight);
+   /* remove each connection from the poller before the poller goes */
+   mongoc_set_destroy (async->conns);
+   _mongoc_poller_destroy (async->poller);
+   bson_free (async);
+
+   EXIT;
+}
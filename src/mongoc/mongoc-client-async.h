@@ -0,0 +1,82 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_CLIENT_ASYNC_H
+#define MONGOC_CLIENT_ASYNC_H
+
+#if !defined(MONGOC_INSIDE) && !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-client.h"
+#include "mongoc-read-prefs.h"
+#include "mongoc-write-concern.h"
+
+
+BSON_BEGIN_DECLS
+
+
+typedef struct _mongoc_client_async_t mongoc_client_async_t;
+
+typedef void (*mongoc_client_async_cb_t) (bool succeeded,
+                                          const bson_t *reply,
+                                          const bson_error_t *error,
+                                          void *data);
+
+
+BSON_EXPORT (mongoc_client_async_t *)
+mongoc_client_async_new (mongoc_client_t *client);
+BSON_EXPORT (void)
+mongoc_client_async_destroy (mongoc_client_async_t *async);
+BSON_EXPORT (bool)
+mongoc_client_async_command (mongoc_client_async_t *async,
+                             const char *db_name,
+                             const bson_t *command,
+                             const mongoc_read_prefs_t *read_prefs,
+                             mongoc_client_async_cb_t cb,
+                             void *cb_data,
+                             bson_error_t *error);
+BSON_EXPORT (bool)
+mongoc_client_async_find (mongoc_client_async_t *async,
+                          const char *db_name,
+                          const char *collection_name,
+                          const bson_t *filter,
+                          const bson_t *opts,
+                          const mongoc_read_prefs_t *read_prefs,
+                          mongoc_client_async_cb_t cb,
+                          void *cb_data,
+                          bson_error_t *error);
+BSON_EXPORT (bool)
+mongoc_client_async_insert (mongoc_client_async_t *async,
+                            const char *db_name,
+                            const char *collection_name,
+                            const bson_t *document,
+                            const mongoc_write_concern_t *write_concern,
+                            mongoc_client_async_cb_t cb,
+                            void *cb_data,
+                            bson_error_t *error);
+BSON_EXPORT (uint32_t)
+mongoc_client_async_run (mongoc_client_async_t *async, int32_t timeout_msec);
+BSON_EXPORT (uint32_t)
+mongoc_client_async_get_pending (const mongoc_client_async_t *async);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_CLIENT_ASYNC_H */
@@ -39,6 +39,8 @@ size_t
 mongoc_client_pool_num_pushed (mongoc_client_pool_t *pool);
 mongoc_topology_description_t *
 _mongoc_client_pool_get_topology_description (mongoc_client_pool_t *pool);
+size_t
+_mongoc_client_pool_num_warm (mongoc_client_pool_t *pool);
 
 BSON_END_DECLS
 
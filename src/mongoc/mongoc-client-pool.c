@@ -17,11 +17,13 @@
 
 #include "mongoc.h"
 #include "mongoc-apm-private.h"
+#include "mongoc-array-private.h"
+#include "mongoc-cluster-private.h"
 #include "mongoc-counters-private.h"
 #include "mongoc-client-pool-private.h"
 #include "mongoc-client-pool.h"
 #include "mongoc-client-private.h"
-#include "mongoc-queue-private.h"
+#include "mongoc-server-description-private.h"
 #include "mongoc-thread-private.h"
 #include "mongoc-topology-private.h"
 #include "mongoc-trace-private.h"
@@ -30,10 +32,26 @@
 #include "mongoc-ssl-private.h"
 #endif
 
-struct _mongoc_client_pool_t {
+/* the most shards a pool splits its idle clients into */
+#define MONGOC_CLIENT_POOL_MAX_SHARDS 64
+
+/* a list of idle clients, most recently pushed first. threads hash to a
+ * shard, so at most a few threads contend for each shard's lock */
+typedef struct {
    mongoc_mutex_t mutex;
+   mongoc_client_t *head;
+   mongoc_client_t *tail;
+   /* keep shards' locks on separate cache lines */
+   char padding[64];
+} mongoc_client_pool_shard_t;
+
+struct _mongoc_client_pool_t {
+   mongoc_mutex_t mutex; /* protects size and creating clients */
    mongoc_cond_t cond;
-   mongoc_queue_t queue;
+   mongoc_client_pool_shard_t *shards;
+   uint32_t n_shards;
+   volatile int32_t n_idle;
+   volatile int32_t n_waiters;
    mongoc_topology_t *topology;
    mongoc_uri_t *uri;
    uint32_t min_pool_size;
@@ -48,9 +66,29 @@ struct _mongoc_client_pool_t {
    void *apm_context;
    int32_t error_api_version;
    bool error_api_set;
+   /* keeps min_pool_size clients connected, see mongoc_client_pool_warm */
+   mongoc_thread_t warmer;
+   bool warmer_started; /* protected by mutex */
+   /* protects the flags below. taken with the topology's mutex held, when
+    * a server changes */
+   mongoc_mutex_t warmer_mutex;
+   mongoc_cond_t warmer_cond;
+   bool warmer_signaled;
+   bool warmer_shutdown;
+   bool warmer_connecting;
+   /* destroy returned during a connection attempt, the warmer frees the
+    * pool when the attempt ends */
+   bool warmer_frees_pool;
 };
 
 
+/* a server the warmer connects idle clients to */
+typedef struct {
+   uint32_t id;
+   int64_t timestamp;
+} mongoc_client_pool_server_t;
+
+
 #ifdef MONGOC_ENABLE_SSL
 void
 mongoc_client_pool_set_ssl_opts (mongoc_client_pool_t *pool,
@@ -67,6 +105,10 @@ mongoc_client_pool_set_ssl_opts (mongoc_client_pool_t *pool,
 
    if (opts) {
       _mongoc_ssl_opts_copy_to (opts, &pool->ssl_opts);
+#ifdef MONGOC_ENABLE_SSL_OPENSSL
+      /* the pool's clients and scanner share the topology's SSL_CTX */
+      _mongoc_openssl_shared_reset (&pool->topology->openssl_shared);
+#endif
       pool->ssl_opts_set = true;
    }
 
@@ -78,6 +120,133 @@ mongoc_client_pool_set_ssl_opts (mongoc_client_pool_t *pool,
 #endif
 
 
+/* the shard the calling thread pushes to and pops from first */
+static mongoc_client_pool_shard_t *
+_mongoc_client_pool_home_shard (mongoc_client_pool_t *pool)
+{
+   uint32_t hash;
+#ifdef _WIN32
+   hash = (uint32_t) GetCurrentThreadId ();
+#else
+   pthread_t self;
+   const uint8_t *p;
+   size_t i;
+
+   /* pthread_t is opaque, hash its bytes */
+   self = pthread_self ();
+   p = (const uint8_t *) &self;
+   hash = 2166136261u;
+   for (i = 0; i < sizeof self; i++) {
+      hash = (hash ^ p[i]) * 16777619u;
+   }
+#endif
+
+   return &pool->shards[hash % pool->n_shards];
+}
+
+
+/* the shard's lock must be held */
+static void
+_mongoc_client_pool_shard_push (mongoc_client_pool_shard_t *shard,
+                                mongoc_client_t *client)
+{
+   client->pool_prev = NULL;
+   client->pool_next = shard->head;
+
+   if (shard->head) {
+      shard->head->pool_prev = client;
+   } else {
+      shard->tail = client;
+   }
+
+   shard->head = client;
+}
+
+
+/* remove @client from the shard, whose lock must be held */
+static void
+_mongoc_client_pool_shard_unlink (mongoc_client_pool_shard_t *shard,
+                                  mongoc_client_t *client)
+{
+   if (client->pool_prev) {
+      client->pool_prev->pool_next = client->pool_next;
+   } else {
+      shard->head = client->pool_next;
+   }
+
+   if (client->pool_next) {
+      client->pool_next->pool_prev = client->pool_prev;
+   } else {
+      shard->tail = client->pool_prev;
+   }
+
+   client->pool_prev = client->pool_next = NULL;
+}
+
+
+/* the shard's lock must be held, or the pool being destroyed */
+static mongoc_client_t *
+_mongoc_client_pool_shard_pop (mongoc_client_pool_shard_t *shard)
+{
+   mongoc_client_t *client;
+
+   client = shard->head;
+   if (client) {
+      _mongoc_client_pool_shard_unlink (shard, client);
+   }
+
+   return client;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_pool_pop_idle --
+ *
+ *       Take the most recently pushed client from the calling thread's
+ *       shard, or from another shard if that one is empty. Does not touch
+ *       the pool's mutex.
+ *
+ * Returns:
+ *       An idle client, or NULL if there are none.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static mongoc_client_t *
+_mongoc_client_pool_pop_idle (mongoc_client_pool_t *pool)
+{
+   mongoc_client_pool_shard_t *home;
+   mongoc_client_pool_shard_t *shard;
+   mongoc_client_t *client;
+   uint32_t i;
+
+   home = _mongoc_client_pool_home_shard (pool);
+
+   for (i = 0; i < pool->n_shards; i++) {
+      shard = &pool->shards[((home - pool->shards) + i) % pool->n_shards];
+
+      if (i > 0 && bson_atomic_int_add (&pool->n_idle, 0) <= 0) {
+         /* no need to visit every other shard */
+         break;
+      }
+
+      mongoc_mutex_lock (&shard->mutex);
+      client = _mongoc_client_pool_shard_pop (shard);
+      mongoc_mutex_unlock (&shard->mutex);
+
+      if (client) {
+         bson_atomic_int_add (&pool->n_idle, -1);
+         client->cluster.checkout_counted = false;
+         return client;
+      }
+   }
+
+   return NULL;
+}
+
+
 mongoc_client_pool_t *
 mongoc_client_pool_new (const mongoc_uri_t *uri)
 {
@@ -86,7 +255,7 @@ mongoc_client_pool_new (const mongoc_uri_t *uri)
    const bson_t *b;
    bson_iter_t iter;
    const char *appname;
-
+   uint32_t i;
 
    ENTRY;
 
@@ -102,7 +271,17 @@ mongoc_client_pool_new (const mongoc_uri_t *uri)
 
    pool = (mongoc_client_pool_t *) bson_malloc0 (sizeof *pool);
    mongoc_mutex_init (&pool->mutex);
-   _mongoc_queue_init (&pool->queue);
+   mongoc_cond_init (&pool->cond);
+   mongoc_mutex_init (&pool->warmer_mutex);
+   mongoc_cond_init (&pool->warmer_cond);
+
+   pool->n_shards = BSON_MIN (BSON_MAX (_mongoc_get_cpu_count (), 1),
+                              MONGOC_CLIENT_POOL_MAX_SHARDS);
+   pool->shards = (mongoc_client_pool_shard_t *) bson_malloc0 (
+      pool->n_shards * sizeof (mongoc_client_pool_shard_t));
+   for (i = 0; i < pool->n_shards; i++) {
+      mongoc_mutex_init (&pool->shards[i].mutex);
+   }
    pool->uri = mongoc_uri_copy (uri);
    pool->min_pool_size = 0;
    pool->max_pool_size = 100;
@@ -138,25 +317,30 @@ mongoc_client_pool_new (const mongoc_uri_t *uri)
 }
 
 
-void
-mongoc_client_pool_destroy (mongoc_client_pool_t *pool)
+/* destroy the pool's clients and topology, once its warmer has stopped */
+static void
+_mongoc_client_pool_free (mongoc_client_pool_t *pool)
 {
    mongoc_client_t *client;
+   uint32_t i;
 
-   ENTRY;
-
-   BSON_ASSERT (pool);
+   for (i = 0; i < pool->n_shards; i++) {
+      while ((client = _mongoc_client_pool_shard_pop (&pool->shards[i]))) {
+         mongoc_client_destroy (client);
+      }
 
-   while (
-      (client = (mongoc_client_t *) _mongoc_queue_pop_head (&pool->queue))) {
-      mongoc_client_destroy (client);
+      mongoc_mutex_destroy (&pool->shards[i].mutex);
    }
 
+   bson_free (pool->shards);
+
    mongoc_topology_destroy (pool->topology);
 
    mongoc_uri_destroy (pool->uri);
    mongoc_mutex_destroy (&pool->mutex);
    mongoc_cond_destroy (&pool->cond);
+   mongoc_mutex_destroy (&pool->warmer_mutex);
+   mongoc_cond_destroy (&pool->warmer_cond);
 
 #ifdef MONGOC_ENABLE_SSL
    _mongoc_ssl_opts_cleanup (&pool->ssl_opts);
@@ -166,6 +350,43 @@ mongoc_client_pool_destroy (mongoc_client_pool_t *pool)
 
    mongoc_counter_client_pools_active_dec ();
    mongoc_counter_client_pools_disposed_inc ();
+}
+
+
+void
+mongoc_client_pool_destroy (mongoc_client_pool_t *pool)
+{
+   mongoc_thread_t warmer;
+   bool warmer_started;
+   bool connecting;
+
+   ENTRY;
+
+   BSON_ASSERT (pool);
+
+   mongoc_mutex_lock (&pool->mutex);
+   warmer_started = pool->warmer_started;
+   warmer = pool->warmer;
+   mongoc_mutex_unlock (&pool->mutex);
+
+   mongoc_mutex_lock (&pool->warmer_mutex);
+   pool->warmer_shutdown = true;
+   connecting = pool->warmer_frees_pool = pool->warmer_connecting;
+   mongoc_cond_signal (&pool->warmer_cond);
+   mongoc_mutex_unlock (&pool->warmer_mutex);
+
+   if (connecting) {
+      /* don't wait for the connection attempt, the warmer frees the pool */
+      mongoc_thread_detach (warmer);
+      EXIT;
+   }
+
+   /* the warmer returns the client it is warming before it exits */
+   if (warmer_started) {
+      mongoc_thread_join (warmer);
+   }
+
+   _mongoc_client_pool_free (pool);
 
    EXIT;
 }
@@ -185,36 +406,65 @@ _start_scanner_if_needed (mongoc_client_pool_t *pool)
    }
 }
 
+
+/*
+ * Create a client with the pool's settings.
+ *
+ * This function assumes the pool's mutex is locked
+ */
+static mongoc_client_t *
+_mongoc_client_pool_client_new (mongoc_client_pool_t *pool)
+{
+   mongoc_client_t *client;
+
+   client = _mongoc_client_new_from_uri (pool->uri, pool->topology);
+
+   /* for tests */
+   mongoc_client_set_stream_initiator (
+      client,
+      pool->topology->scanner->initiator,
+      pool->topology->scanner->initiator_context);
+
+   client->error_api_version = pool->error_api_version;
+   _mongoc_client_set_apm_callbacks_private (
+      client, &pool->apm_callbacks, pool->apm_context);
+#ifdef MONGOC_ENABLE_SSL
+   if (pool->ssl_opts_set) {
+      mongoc_client_set_ssl_opts (client, &pool->ssl_opts);
+   }
+#endif
+
+   return client;
+}
+
+
 mongoc_client_t *
 mongoc_client_pool_pop (mongoc_client_pool_t *pool)
 {
    mongoc_client_t *client;
+   int64_t started;
 
    ENTRY;
 
    BSON_ASSERT (pool);
 
+   started = bson_get_monotonic_time ();
+
+   /* fast path: an idle client was popped before, so the scanner runs */
+   client = _mongoc_client_pool_pop_idle (pool);
+   if (client) {
+      mongoc_histogram_client_pool_pop_record (bson_get_monotonic_time () -
+                                               started);
+      RETURN (client);
+   }
+
    mongoc_mutex_lock (&pool->mutex);
+   bson_atomic_int_add (&pool->n_waiters, 1);
 
 again:
-   if (!(client = (mongoc_client_t *) _mongoc_queue_pop_head (&pool->queue))) {
+   if (!(client = _mongoc_client_pool_pop_idle (pool))) {
       if (pool->size < pool->max_pool_size) {
-         client = _mongoc_client_new_from_uri (pool->uri, pool->topology);
-
-         /* for tests */
-         mongoc_client_set_stream_initiator (
-            client,
-            pool->topology->scanner->initiator,
-            pool->topology->scanner->initiator_context);
-
-         client->error_api_version = pool->error_api_version;
-         _mongoc_client_set_apm_callbacks_private (
-            client, &pool->apm_callbacks, pool->apm_context);
-#ifdef MONGOC_ENABLE_SSL
-         if (pool->ssl_opts_set) {
-            mongoc_client_set_ssl_opts (client, &pool->ssl_opts);
-         }
-#endif
+         client = _mongoc_client_pool_client_new (pool);
          pool->size++;
       } else {
          mongoc_cond_wait (&pool->cond, &pool->mutex);
@@ -222,9 +472,13 @@ again:
       }
    }
 
+   bson_atomic_int_add (&pool->n_waiters, -1);
    _start_scanner_if_needed (pool);
    mongoc_mutex_unlock (&pool->mutex);
 
+   mongoc_histogram_client_pool_pop_record (bson_get_monotonic_time () -
+                                            started);
+
    RETURN (client);
 }
 
@@ -238,9 +492,14 @@ mongoc_client_pool_try_pop (mongoc_client_pool_t *pool)
 
    BSON_ASSERT (pool);
 
+   client = _mongoc_client_pool_pop_idle (pool);
+   if (client) {
+      RETURN (client);
+   }
+
    mongoc_mutex_lock (&pool->mutex);
 
-   if (!(client = (mongoc_client_t *) _mongoc_queue_pop_head (&pool->queue))) {
+   if (!(client = _mongoc_client_pool_pop_idle (pool))) {
       if (pool->size < pool->max_pool_size) {
          client = _mongoc_client_new_from_uri (pool->uri, pool->topology);
 #ifdef MONGOC_ENABLE_SSL
@@ -261,33 +520,447 @@ mongoc_client_pool_try_pop (mongoc_client_pool_t *pool)
 }
 
 
+/* take the least recently pushed idle client of the first other shard that
+ * has one, starting after @shard. NULL if there is none */
+static mongoc_client_t *
+_mongoc_client_pool_take_other (mongoc_client_pool_t *pool,
+                                mongoc_client_pool_shard_t *shard)
+{
+   mongoc_client_pool_shard_t *other;
+   mongoc_client_t *client = NULL;
+   uint32_t i;
+
+   for (i = 1; i < pool->n_shards && !client; i++) {
+      other = &pool->shards[((shard - pool->shards) + i) % pool->n_shards];
+      mongoc_mutex_lock (&other->mutex);
+      client = other->tail;
+      if (client) {
+         _mongoc_client_pool_shard_unlink (other, client);
+      }
+      mongoc_mutex_unlock (&other->mutex);
+   }
+
+   return client;
+}
+
+
+/* make @client idle in @shard, and wake a thread waiting for a client */
+static void
+_mongoc_client_pool_push_shard (mongoc_client_pool_t *pool,
+                                mongoc_client_pool_shard_t *shard,
+                                mongoc_client_t *client)
+{
+   mongoc_client_t *old_client = NULL;
+   int32_t min_pool_size;
+   int32_t n_idle;
+
+   min_pool_size = (int32_t) pool->min_pool_size;
+
+   mongoc_mutex_lock (&shard->mutex);
+   _mongoc_client_pool_shard_push (shard, client);
+   n_idle = bson_atomic_int_add (&pool->n_idle, 1);
+
+   /* past minPoolSize, destroy the shard's least recently used client.
+    * the tail is the least recently pushed */
+   if (min_pool_size && n_idle > min_pool_size && shard->tail != client) {
+      old_client = shard->tail;
+      _mongoc_client_pool_shard_unlink (shard, old_client);
+   }
+
+   mongoc_mutex_unlock (&shard->mutex);
+
+   /* this shard held no other client. look in other shards only once the
+    * idle clients pass minPoolSize by more than the number of shards, so
+    * an ordinary push locks one shard */
+   if (min_pool_size && !old_client &&
+       n_idle > min_pool_size + (int32_t) pool->n_shards) {
+      old_client = _mongoc_client_pool_take_other (pool, shard);
+   }
+
+   if (old_client) {
+      bson_atomic_int_add (&pool->n_idle, -1);
+      mongoc_mutex_lock (&pool->mutex);
+      pool->size--;
+      mongoc_mutex_unlock (&pool->mutex);
+   }
+
+   /* the atomic read orders it after the push: either a thread in
+    * mongoc_client_pool_pop's slow path sees the new client, or we see it
+    * waiting and wake it */
+   if (bson_atomic_int_add (&pool->n_waiters, 0) > 0) {
+      mongoc_mutex_lock (&pool->mutex);
+      mongoc_cond_signal (&pool->cond);
+      mongoc_mutex_unlock (&pool->mutex);
+   }
+
+   if (old_client) {
+      mongoc_client_destroy (old_client);
+   }
+}
+
+
+/* wake the warmer, if it is started. called by the topology with its mutex
+ * held when a server changes type */
+static void
+_mongoc_client_pool_signal_warmer (void *data)
+{
+   mongoc_client_pool_t *pool = (mongoc_client_pool_t *) data;
+
+   mongoc_mutex_lock (&pool->warmer_mutex);
+   pool->warmer_signaled = true;
+   mongoc_cond_signal (&pool->warmer_cond);
+   mongoc_mutex_unlock (&pool->warmer_mutex);
+}
+
+
 void
 mongoc_client_pool_push (mongoc_client_pool_t *pool, mongoc_client_t *client)
 {
+   bool node_disconnected;
+
    ENTRY;
 
    BSON_ASSERT (pool);
    BSON_ASSERT (client);
 
+   /* read it before another thread can pop the client */
+   node_disconnected = client->cluster.node_disconnected;
+
+   _mongoc_client_pool_push_shard (
+      pool, _mongoc_client_pool_home_shard (pool), client);
+
+   if (node_disconnected) {
+      /* the warmer replaces the lost connection */
+      _mongoc_client_pool_signal_warmer (pool);
+   }
+
+   EXIT;
+}
+
+
+/* the data-bearing servers an operation could select, each with the time
+ * the topology last replaced its description */
+static void
+_mongoc_client_pool_get_servers (mongoc_client_pool_t *pool,
+                                 mongoc_array_t *servers)
+{
+   mongoc_topology_t *topology;
+   mongoc_set_t *set;
+   mongoc_server_description_t *sd;
+   mongoc_topology_scanner_node_t *node;
+   mongoc_client_pool_server_t server;
+   size_t i;
+
+   topology = pool->topology;
+
+   mongoc_mutex_lock (&topology->mutex);
+   set = topology->description.servers;
+
+   for (i = 0; i < set->items_len; i++) {
+      sd = (mongoc_server_description_t *) mongoc_set_get_item (set, (int) i);
+
+      switch (sd->type) {
+      case MONGOC_SERVER_STANDALONE:
+      case MONGOC_SERVER_MONGOS:
+      case MONGOC_SERVER_RS_PRIMARY:
+      case MONGOC_SERVER_RS_SECONDARY:
+         break;
+      default:
+         continue;
+      }
+
+      node = mongoc_topology_scanner_get_node (topology->scanner, sd->id);
+      if (node) {
+         server.id = sd->id;
+         server.timestamp = node->timestamp;
+         _mongoc_array_append_val (servers, server);
+      }
+   }
+
+   mongoc_mutex_unlock (&topology->mutex);
+}
+
+
+static bool
+_mongoc_client_pool_client_is_warm (mongoc_client_t *client,
+                                    const mongoc_array_t *servers)
+{
+   mongoc_client_pool_server_t *server;
+   size_t i;
+
+   for (i = 0; i < servers->len; i++) {
+      server = &_mongoc_array_index (servers, mongoc_client_pool_server_t, i);
+      if (!mongoc_cluster_node_is_warm (
+             &client->cluster, server->id, server->timestamp)) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+
+/* connect and authenticate an idle client to each server. false if the
+ * pool is being destroyed */
+static bool
+_mongoc_client_pool_warm_client (mongoc_client_pool_t *pool,
+                                 mongoc_client_t *client,
+                                 const mongoc_array_t *servers)
+{
+   mongoc_client_pool_server_t *server;
+   bson_error_t error;
+   bool shutdown;
+   size_t i;
+
+   client->cluster.node_disconnected = false;
+
+   for (i = 0; i < servers->len; i++) {
+      server = &_mongoc_array_index (servers, mongoc_client_pool_server_t, i);
+
+      /* no pool lock is held while connecting, and a destroy meanwhile
+       * does not wait for the attempt */
+      mongoc_mutex_lock (&pool->warmer_mutex);
+      shutdown = pool->warmer_shutdown;
+      pool->warmer_connecting = !shutdown;
+      mongoc_mutex_unlock (&pool->warmer_mutex);
+
+      if (shutdown) {
+         return false;
+      }
+
+      /* the cluster logs a warning and marks the server Unknown */
+      (void) mongoc_cluster_warm_node (&client->cluster, server->id, &error);
+
+      mongoc_mutex_lock (&pool->warmer_mutex);
+      pool->warmer_connecting = false;
+      mongoc_mutex_unlock (&pool->warmer_mutex);
+   }
+
+   return true;
+}
+
+
+/* the least recently used idle client that is not warm, the shard's lock
+ * must be held */
+static mongoc_client_t *
+_mongoc_client_pool_shard_find_cold (mongoc_client_pool_shard_t *shard,
+                                     const mongoc_array_t *servers)
+{
+   mongoc_client_t *client;
+
+   for (client = shard->tail; client; client = client->pool_prev) {
+      if (!_mongoc_client_pool_client_is_warm (client, servers)) {
+         return client;
+      }
+   }
+
+   return NULL;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_pool_warm --
+ *
+ *       Create clients until the pool has min_pool_size of them, and
+ *       connect and authenticate each idle client to every selectable
+ *       server. An idle client is taken from its shard only while it is
+ *       warmed, then returned to the head of the shard so it is popped
+ *       next.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_client_pool_warm (mongoc_client_pool_t *pool)
+{
+   mongoc_array_t servers;
+   mongoc_array_t new_clients;
+   mongoc_client_pool_shard_t *shard;
+   mongoc_client_t *client;
+   uint32_t target;
+   bool stopped = false;
+   size_t n_cold;
+   size_t i;
+
+   _mongoc_array_init (&servers, sizeof (mongoc_client_pool_server_t));
+   _mongoc_array_init (&new_clients, sizeof (mongoc_client_t *));
+
+   _mongoc_client_pool_get_servers (pool, &servers);
+
    mongoc_mutex_lock (&pool->mutex);
-   _mongoc_queue_push_head (&pool->queue, client);
-
-   if (pool->min_pool_size &&
-       _mongoc_queue_get_length (&pool->queue) > pool->min_pool_size) {
-      mongoc_client_t *old_client;
-      old_client = (mongoc_client_t *) _mongoc_queue_pop_tail (&pool->queue);
-      if (old_client) {
-         mongoc_client_destroy (old_client);
-         pool->size--;
+   target = BSON_MIN (pool->min_pool_size, pool->max_pool_size);
+   while (pool->size < target) {
+      client = _mongoc_client_pool_client_new (pool);
+      _mongoc_array_append_val (&new_clients, client);
+      pool->size++;
+   }
+   mongoc_mutex_unlock (&pool->mutex);
+
+   for (i = 0; i < new_clients.len; i++) {
+      client = _mongoc_array_index (&new_clients, mongoc_client_t *, i);
+      if (!stopped) {
+         stopped = !_mongoc_client_pool_warm_client (pool, client, &servers);
       }
+
+      mongoc_client_pool_push (pool, client);
+   }
+
+   for (i = 0; servers.len && !stopped && i < pool->n_shards; i++) {
+      shard = &pool->shards[i];
+
+      /* try each cold client once, a server may be down */
+      n_cold = 0;
+      mongoc_mutex_lock (&shard->mutex);
+      for (client = shard->head; client; client = client->pool_next) {
+         if (!_mongoc_client_pool_client_is_warm (client, &servers)) {
+            n_cold++;
+         }
+      }
+      mongoc_mutex_unlock (&shard->mutex);
+
+      while (n_cold--) {
+         mongoc_mutex_lock (&shard->mutex);
+         client = _mongoc_client_pool_shard_find_cold (shard, &servers);
+         if (client) {
+            _mongoc_client_pool_shard_unlink (shard, client);
+         }
+         mongoc_mutex_unlock (&shard->mutex);
+
+         if (!client) {
+            /* popped by the application */
+            break;
+         }
+
+         bson_atomic_int_add (&pool->n_idle, -1);
+         stopped = !_mongoc_client_pool_warm_client (pool, client, &servers);
+         _mongoc_client_pool_push_shard (pool, shard, client);
+
+         if (stopped) {
+            break;
+         }
+      }
+   }
+
+   _mongoc_array_destroy (&new_clients);
+   _mongoc_array_destroy (&servers);
+}
+
+
+static void *
+_mongoc_client_pool_run_warmer (void *data)
+{
+   mongoc_client_pool_t *pool = (mongoc_client_pool_t *) data;
+   bool frees_pool;
+
+   mongoc_mutex_lock (&pool->warmer_mutex);
+
+   while (!pool->warmer_shutdown) {
+      pool->warmer_signaled = false;
+      mongoc_mutex_unlock (&pool->warmer_mutex);
+
+      _mongoc_client_pool_warm (pool);
+
+      /* sleep until a client loses a connection, a server changes type, or
+       * min_pool_size changes */
+      mongoc_mutex_lock (&pool->warmer_mutex);
+      while (!pool->warmer_shutdown && !pool->warmer_signaled) {
+         mongoc_cond_wait (&pool->warmer_cond, &pool->warmer_mutex);
+      }
+   }
+
+   frees_pool = pool->warmer_frees_pool;
+   mongoc_mutex_unlock (&pool->warmer_mutex);
+
+   if (frees_pool) {
+      _mongoc_client_pool_free (pool);
+   }
+
+   return NULL;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_pool_warm --
+ *
+ *       Start the background topology scanner, and a thread that keeps
+ *       min_pool_size clients connected and authenticated to every
+ *       selectable server, so operations do not wait for TCP, TLS, and
+ *       authentication after the application starts or the topology
+ *       changes. A client returned to the pool after losing a connection
+ *       is reconnected promptly.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_client_pool_warm (mongoc_client_pool_t *pool)
+{
+   int r;
+
+   ENTRY;
+
+   BSON_ASSERT (pool);
+
+   mongoc_mutex_lock (&pool->mutex);
+
+   if (!pool->warmer_started) {
+      mongoc_mutex_lock (&pool->topology->mutex);
+      pool->topology->server_changed_cb = _mongoc_client_pool_signal_warmer;
+      pool->topology->server_changed_context = pool;
+      mongoc_mutex_unlock (&pool->topology->mutex);
+
+      _start_scanner_if_needed (pool);
+
+      r = mongoc_thread_create (
+         &pool->warmer, _mongoc_client_pool_run_warmer, pool);
+
+      if (r != 0) {
+         MONGOC_ERROR ("could not start client pool warmer thread: %s",
+                       strerror (r));
+         abort ();
+      }
+
+      pool->warmer_started = true;
    }
 
-   mongoc_cond_signal (&pool->cond);
    mongoc_mutex_unlock (&pool->mutex);
 
    EXIT;
 }
 
+
+/* for tests: the number of idle clients connected to every selectable
+ * server, or zero if no server is selectable yet */
+size_t
+_mongoc_client_pool_num_warm (mongoc_client_pool_t *pool)
+{
+   mongoc_array_t servers;
+   mongoc_client_t *client;
+   size_t n_warm = 0;
+   uint32_t i;
+
+   _mongoc_array_init (&servers, sizeof (mongoc_client_pool_server_t));
+   _mongoc_client_pool_get_servers (pool, &servers);
+
+   for (i = 0; servers.len && i < pool->n_shards; i++) {
+      mongoc_mutex_lock (&pool->shards[i].mutex);
+      for (client = pool->shards[i].head; client; client = client->pool_next) {
+         if (_mongoc_client_pool_client_is_warm (client, &servers)) {
+            n_warm++;
+         }
+      }
+      mongoc_mutex_unlock (&pool->shards[i].mutex);
+   }
+
+   _mongoc_array_destroy (&servers);
+
+   return n_warm;
+}
+
 /* for tests */
 void
 _mongoc_client_pool_set_stream_initiator (mongoc_client_pool_t *pool,
@@ -321,9 +994,7 @@ mongoc_client_pool_num_pushed (mongoc_client_pool_t *pool)
 
    ENTRY;
 
-   mongoc_mutex_lock (&pool->mutex);
-   num_pushed = pool->queue.length;
-   mongoc_mutex_unlock (&pool->mutex);
+   num_pushed = (size_t) bson_atomic_int_add (&pool->n_idle, 0);
 
    RETURN (num_pushed);
 }
@@ -357,6 +1028,8 @@ mongoc_client_pool_min_size (mongoc_client_pool_t *pool, uint32_t min_pool_size)
    pool->min_pool_size = min_pool_size;
    mongoc_mutex_unlock (&pool->mutex);
 
+   _mongoc_client_pool_signal_warmer (pool);
+
    EXIT;
 }
 
@@ -54,6 +54,8 @@ mongoc_client_pool_max_size (mongoc_client_pool_t *pool,
 BSON_EXPORT (void)
 mongoc_client_pool_min_size (mongoc_client_pool_t *pool,
                              uint32_t min_pool_size);
+BSON_EXPORT (void)
+mongoc_client_pool_warm (mongoc_client_pool_t *pool);
 #ifdef MONGOC_ENABLE_SSL
 BSON_EXPORT (void)
 mongoc_client_pool_set_ssl_opts (mongoc_client_pool_t *pool,
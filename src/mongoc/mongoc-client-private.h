@@ -92,6 +92,13 @@ struct _mongoc_client_t {
 
    int32_t error_api_version;
    bool error_api_set;
+
+   /* links in a mongoc_client_pool_t's list of idle clients */
+   mongoc_client_t *pool_prev;
+   mongoc_client_t *pool_next;
+
+   /* a cursor with the "prefetch" option whose getMore reply is unread */
+   mongoc_cursor_t *prefetching_cursor;
 };
 
 
@@ -135,6 +142,9 @@ _mongoc_client_recv (mongoc_client_t *client,
                      mongoc_server_stream_t *server_stream,
                      bson_error_t *error);
 
+void
+_mongoc_client_recv_prefetch (mongoc_client_t *client);
+
 bool
 _mongoc_client_recv_gle (mongoc_client_t *client,
                          mongoc_server_stream_t *server_stream,
@@ -26,12 +26,16 @@
 #include "mongoc-collection-private.h"
 #include "mongoc-config.h"
 #include "mongoc-counters-private.h"
+#include "mongoc-cursor-cursorid-private.h"
 #include "mongoc-database-private.h"
 #include "mongoc-gridfs-private.h"
 #include "mongoc-error.h"
 #include "mongoc-log.h"
+#include "mongoc-pipeline-private.h"
 #include "mongoc-queue-private.h"
+#include "mongoc-resolver-private.h"
 #include "mongoc-socket.h"
+#include "mongoc-socket-private.h"
 #include "mongoc-stream-buffered.h"
 #include "mongoc-stream-socket.h"
 #include "mongoc-thread-private.h"
@@ -45,6 +49,7 @@
 
 #ifdef MONGOC_ENABLE_SSL
 #include "mongoc-stream-tls.h"
+#include "mongoc-stream-tls-private.h"
 #include "mongoc-ssl-private.h"
 #endif
 
@@ -77,7 +82,9 @@ _mongoc_client_killcursors_command (mongoc_cluster_t *cluster,
  *       Connect to a host using a TCP socket.
  *
  *       This will be performed synchronously and return a mongoc_stream_t
- *       that can be used to connect with the remote host.
+ *       that can be used to connect with the remote host. If the host has
+ *       several addresses, connections to them are raced, see
+ *       _mongoc_socket_connect_race.
  *
  * Returns:
  *       A newly allocated mongoc_stream_t if successful; otherwise
@@ -94,13 +101,10 @@ mongoc_client_connect_tcp (const mongoc_uri_t *uri,
                            const mongoc_host_list_t *host,
                            bson_error_t *error)
 {
-   mongoc_socket_t *sock = NULL;
-   struct addrinfo hints;
-   struct addrinfo *result, *rp;
+   mongoc_socket_t *sock;
+   struct addrinfo *result;
    int32_t connecttimeoutms;
    int64_t expire_at;
-   char portstr[8];
-   int s;
 
    ENTRY;
 
@@ -112,62 +116,14 @@ mongoc_client_connect_tcp (const mongoc_uri_t *uri,
 
    BSON_ASSERT (connecttimeoutms);
 
-   bson_snprintf (portstr, sizeof portstr, "%hu", host->port);
-
-   memset (&hints, 0, sizeof hints);
-   hints.ai_family = host->family;
-   hints.ai_socktype = SOCK_STREAM;
-   hints.ai_flags = 0;
-   hints.ai_protocol = 0;
-
-   s = getaddrinfo (host->host, portstr, &hints, &result);
-
-   if (s != 0) {
-      mongoc_counter_dns_failure_inc ();
-      bson_set_error (error,
-                      MONGOC_ERROR_STREAM,
-                      MONGOC_ERROR_STREAM_NAME_RESOLUTION,
-                      "Failed to resolve %s",
-                      host->host);
+   /* waits for another thread's lookup of the same host, if any */
+   expire_at = bson_get_monotonic_time () + (connecttimeoutms * 1000L);
+   if (!_mongoc_resolver_resolve (host, expire_at, &result, error)) {
       RETURN (NULL);
    }
 
-   mongoc_counter_dns_success_inc ();
-
-   for (rp = result; rp; rp = rp->ai_next) {
-      /*
-       * Create a new non-blocking socket.
-       */
-      if (!(sock = mongoc_socket_new (
-               rp->ai_family, rp->ai_socktype, rp->ai_protocol))) {
-         continue;
-      }
-
-      /*
-       * Try to connect to the peer.
-       */
-      expire_at = bson_get_monotonic_time () + (connecttimeoutms * 1000L);
-      if (0 != mongoc_socket_connect (
-                  sock, rp->ai_addr, (socklen_t) rp->ai_addrlen, expire_at)) {
-         char *errmsg;
-         char errmsg_buf[BSON_ERROR_BUFFER_SIZE];
-         char ip[255];
-
-         mongoc_socket_inet_ntop (rp, ip, sizeof ip);
-         errmsg = bson_strerror_r (
-            mongoc_socket_errno (sock), errmsg_buf, sizeof errmsg_buf);
-         MONGOC_WARNING ("Failed to connect to: %s:%d, error: %d, %s\n",
-                         ip,
-                         host->port,
-                         mongoc_socket_errno (sock),
-                         errmsg);
-         mongoc_socket_destroy (sock);
-         sock = NULL;
-         continue;
-      }
-
-      break;
-   }
+   expire_at = bson_get_monotonic_time () + (connecttimeoutms * 1000L);
+   sock = _mongoc_socket_connect_race (result, expire_at);
 
    if (!sock) {
       bson_set_error (error,
@@ -175,11 +131,11 @@ mongoc_client_connect_tcp (const mongoc_uri_t *uri,
                       MONGOC_ERROR_STREAM_CONNECT,
                       "Failed to connect to target host: %s",
                       host->host_and_port);
-      freeaddrinfo (result);
+      _mongoc_resolver_free_results (result);
       RETURN (NULL);
    }
 
-   freeaddrinfo (result);
+   _mongoc_resolver_free_results (result);
 
    return mongoc_stream_socket_new (sock);
 }
@@ -329,9 +285,20 @@ mongoc_client_default_stream_initiator (const mongoc_uri_t *uri,
       if (client->use_ssl ||
           (mechanism && (0 == strcmp (mechanism, "MONGODB-X509")))) {
          mongoc_stream_t *original = base_stream;
+         struct _mongoc_openssl_shared_t *openssl_shared = NULL;
+
+#ifdef MONGOC_ENABLE_SSL_OPENSSL
+         /* share the SSL_CTX and TLS sessions of the client's topology */
+         openssl_shared = &client->topology->openssl_shared;
+#endif
 
-         base_stream = mongoc_stream_tls_new_with_hostname (
-            base_stream, host->host, &client->ssl_opts, true);
+         base_stream = _mongoc_stream_tls_new_with_hostname_shared (
+            base_stream,
+            host->host,
+            host->host_and_port,
+            &client->ssl_opts,
+            true,
+            openssl_shared);
 
          if (!base_stream) {
             mongoc_stream_destroy (original);
@@ -431,6 +398,33 @@ _mongoc_client_recv (mongoc_client_t *client,
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_recv_prefetch --
+ *
+ *       If a cursor has sent a getMore ahead of time with the "prefetch"
+ *       option, read the reply now so another operation can use the
+ *       connection. The cursor keeps the reply until it needs it.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_client_recv_prefetch (mongoc_client_t *client)
+{
+   mongoc_cursor_t *cursor;
+
+   BSON_ASSERT (client);
+
+   cursor = client->prefetching_cursor;
+   if (cursor) {
+      client->prefetching_cursor = NULL;
+      _mongoc_cursor_cursorid_prefetch_recv (cursor);
+   }
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -657,6 +651,13 @@ mongoc_client_set_ssl_opts (mongoc_client_t *client,
 
    client->use_ssl = true;
    _mongoc_ssl_opts_copy_to (opts, &client->ssl_opts);
+#ifdef MONGOC_ENABLE_SSL_OPENSSL
+   /* new options rebuild the topology's SSL_CTX on the next connection. a
+    * pooled client's topology is its pool's, reset by the pool */
+   if (client->topology->single_threaded) {
+      _mongoc_openssl_shared_reset (&client->topology->openssl_shared);
+   }
+#endif
 
    if (client->topology->single_threaded) {
       mongoc_topology_scanner_set_ssl_opts (client->topology->scanner,
@@ -988,6 +989,38 @@ mongoc_client_get_gridfs (mongoc_client_t *client,
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_create_pipeline --
+ *
+ *       Create a pipeline to send several commands back-to-back on a
+ *       single connection without waiting for each reply.
+ *
+ *       @read_prefs selects the server when the pipeline is first
+ *       flushed. Like mongoc_client_command_simple(), the default is
+ *       primary and the client's read preference is ignored.
+ *
+ * Returns:
+ *       A newly allocated mongoc_pipeline_t that should be freed with
+ *       mongoc_pipeline_destroy().
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_pipeline_t *
+mongoc_client_create_pipeline (mongoc_client_t *client,
+                               const mongoc_read_prefs_t *read_prefs)
+{
+   BSON_ASSERT (client);
+
+   return _mongoc_pipeline_new (client, read_prefs);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -1332,10 +1365,11 @@ _mongoc_client_command_append_iterator_opts_to_command (bson_iter_t *iter,
 }
 
 static void
-_ensure_copied (bson_t **dst, const bson_t *src)
+_ensure_copied (mongoc_arena_t *arena, bson_t **dst, const bson_t *src)
 {
    if (!*dst) {
-      *dst = bson_copy (src);
+      *dst = _mongoc_arena_bson_new (arena);
+      bson_concat (*dst, src);
    }
 }
 
@@ -1380,6 +1414,7 @@ _mongoc_client_command_with_opts (mongoc_client_t *client,
    mongoc_server_stream_t *server_stream = NULL;
    bson_t *command_with_opts = NULL;
    mongoc_cluster_t *cluster;
+   mongoc_arena_mark_t mark;
    bson_t reply_local;
    bson_t *reply_ptr;
    uint32_t server_id;
@@ -1393,6 +1428,10 @@ _mongoc_client_command_with_opts (mongoc_client_t *client,
 
    reply_ptr = reply ? reply : &reply_local;
 
+   /* command_with_opts is released with the mark */
+   cluster = &client->cluster;
+   _mongoc_arena_mark (&cluster->arena, &mark);
+
    if (mode & MONGOC_CMD_READ) {
       /* NULL read pref is ok */
       if (!_mongoc_read_prefs_validate (default_prefs, error)) {
@@ -1403,7 +1442,6 @@ _mongoc_client_command_with_opts (mongoc_client_t *client,
       default_prefs = NULL;
    }
 
-   cluster = &client->cluster;
    if (!_mongoc_get_server_id_from_opts (opts,
                                          MONGOC_ERROR_COMMAND,
                                          MONGOC_ERROR_COMMAND_INVALID_ARG,
@@ -1430,7 +1468,7 @@ _mongoc_client_command_with_opts (mongoc_client_t *client,
 
       if (opts && bson_iter_init (&iter, opts)) {
          bool ok = false;
-         _ensure_copied (&command_with_opts, command);
+         _ensure_copied (&cluster->arena, &command_with_opts, command);
          ok = _mongoc_client_command_append_iterator_opts_to_command (
             &iter,
             server_stream->sd->max_wire_version,
@@ -1448,7 +1486,7 @@ _mongoc_client_command_with_opts (mongoc_client_t *client,
           !_mongoc_write_concern_is_default (default_wc) &&
           (!command_with_opts ||
            !bson_has_field (command_with_opts, "writeConcern"))) {
-         _ensure_copied (&command_with_opts, command);
+         _ensure_copied (&cluster->arena, &command_with_opts, command);
          bson_append_document (command_with_opts,
                                "writeConcern",
                                12,
@@ -1461,7 +1499,7 @@ _mongoc_client_command_with_opts (mongoc_client_t *client,
           !_mongoc_read_concern_is_default (default_rc) &&
           (!command_with_opts ||
            !bson_has_field (command_with_opts, "readConcern"))) {
-         _ensure_copied (&command_with_opts, command);
+         _ensure_copied (&cluster->arena, &command_with_opts, command);
          bson_append_document (command_with_opts,
                                "readConcern",
                                11,
@@ -1494,9 +1532,7 @@ err:
 
 done:
 
-   if (command_with_opts) {
-      bson_destroy (command_with_opts);
-   }
+   _mongoc_arena_release (&cluster->arena, &mark);
 
    if (server_stream) {
       mongoc_server_stream_cleanup (server_stream);
@@ -2165,6 +2201,9 @@ mongoc_client_select_server (mongoc_client_t *client,
       return NULL;
    }
 
+   /* a single-threaded client may check servers on the cursor's stream */
+   _mongoc_client_recv_prefetch (client);
+
    return mongoc_topology_select (client->topology,
                                   for_writes ? MONGOC_SS_WRITE : MONGOC_SS_READ,
                                   prefs,
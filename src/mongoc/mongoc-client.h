@@ -30,6 +30,7 @@
 #include "mongoc-database.h"
 #include "mongoc-gridfs.h"
 #include "mongoc-index.h"
+#include "mongoc-pipeline.h"
 #include "mongoc-read-prefs.h"
 #ifdef MONGOC_ENABLE_SSL
 #include "mongoc-ssl.h"
@@ -175,6 +176,9 @@ BSON_EXPORT (mongoc_collection_t *)
 mongoc_client_get_collection (mongoc_client_t *client,
                               const char *db,
                               const char *collection);
+BSON_EXPORT (mongoc_pipeline_t *)
+mongoc_client_create_pipeline (mongoc_client_t *client,
+                               const mongoc_read_prefs_t *read_prefs);
 BSON_EXPORT (char **)
 mongoc_client_get_database_names (mongoc_client_t *client, bson_error_t *error);
 BSON_EXPORT (mongoc_cursor_t *)
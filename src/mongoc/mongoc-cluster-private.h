@@ -23,10 +23,12 @@
 
 #include <bson.h>
 
+#include "mongoc-arena-private.h"
 #include "mongoc-array-private.h"
 #include "mongoc-buffer-private.h"
 #include "mongoc-config.h"
 #include "mongoc-client.h"
+#include "mongoc-counters-private.h"
 #include "mongoc-list-private.h"
 #include "mongoc-opcode.h"
 #include "mongoc-read-prefs.h"
@@ -45,6 +47,7 @@ BSON_BEGIN_DECLS
 typedef struct _mongoc_cluster_node_t {
    mongoc_stream_t *stream;
    char *connection_address;
+   mongoc_counter_slots_t *counters; /* this server's, in the shm segment */
 
    int32_t max_wire_version;
    int32_t min_wire_version;
@@ -60,13 +63,20 @@ typedef struct _mongoc_cluster_t {
    uint32_t request_id;
    uint32_t sockettimeoutms;
    uint32_t socketcheckintervalms;
+   int32_t zlib_compression_level;
    mongoc_uri_t *uri;
    unsigned requires_auth : 1;
+   /* a pooled node was disconnected, the pool's warmer replaces it */
+   bool node_disconnected;
+   /* the pool's warm or cold checkout counter was incremented since the
+    * client was popped */
+   bool checkout_counted;
 
    mongoc_client_t *client;
 
    mongoc_set_t *nodes;
    mongoc_array_t iov;
+   mongoc_arena_t arena; /* per-operation temporaries */
 } mongoc_cluster_t;
 
 void
@@ -80,6 +90,27 @@ mongoc_cluster_destroy (mongoc_cluster_t *cluster);
 void
 mongoc_cluster_disconnect_node (mongoc_cluster_t *cluster, uint32_t id);
 
+mongoc_cluster_node_t *
+_mongoc_cluster_node_connect (mongoc_cluster_t *cluster,
+                              uint32_t server_id,
+                              bson_error_t *error);
+
+void
+_mongoc_cluster_node_destroy (mongoc_cluster_node_t *node);
+
+bool
+mongoc_cluster_node_is_warm (mongoc_cluster_t *cluster,
+                             uint32_t server_id,
+                             int64_t server_timestamp);
+
+bool
+mongoc_cluster_warm_node (mongoc_cluster_t *cluster,
+                          uint32_t server_id,
+                          bson_error_t *error);
+
+void
+mongoc_cluster_mark_node_used (mongoc_cluster_t *cluster, uint32_t server_id);
+
 int32_t
 mongoc_cluster_get_max_bson_obj_size (mongoc_cluster_t *cluster);
 
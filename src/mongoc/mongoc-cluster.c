@@ -25,6 +25,7 @@
 
 #include "mongoc-cluster-private.h"
 #include "mongoc-client-private.h"
+#include "mongoc-compression-private.h"
 #include "mongoc-counters-private.h"
 #include "mongoc-config.h"
 #include "mongoc-error.h"
@@ -60,6 +61,18 @@
 
 #define CHECK_CLOSED_DURATION_MSEC 1000
 
+/* the first step of a SCRAM conversation, sent in a new connection's
+ * ismaster as "speculativeAuthenticate" so a server that supports it
+ * replies with its first step, saving a round trip */
+typedef struct {
+#ifdef MONGOC_ENABLE_CRYPTO
+   mongoc_scram_t scram;
+#endif
+   bool started; /* scram has taken its first step, cmd is set */
+   bson_t cmd;
+   bson_t reply; /* the server's reply, empty if it didn't support it */
+} mongoc_cluster_speculative_auth_t;
+
 #define DB_AND_CMD_FROM_COLLECTION(outstr, name)              \
    do {                                                       \
       const char *dot = strchr (name, '.');                   \
@@ -115,6 +128,153 @@ _bson_error_message_printf (bson_error_t *error, const char *format, ...)
          error->message);                                          \
    } while (0)
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_read_compressed_reply --
+ *
+ *       Read the rest of an OP_COMPRESSED message whose 16 byte standard
+ *       @header has already been read from @stream, decompress it and
+ *       scatter the original message into @rpc.
+ *
+ * Returns:
+ *       true if successful. Otherwise false, and @error is set: a stream
+ *       error if the message could not be read, a protocol error if it
+ *       could not be decompressed.
+ *
+ * Side effects:
+ *       @decompressed_buf is set to a buffer @rpc points into, which the
+ *       caller must free with bson_free () even on failure.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_cluster_read_compressed_reply (mongoc_cluster_t *cluster,
+                                       mongoc_stream_t *stream,
+                                       const uint8_t *header,
+                                       int32_t msg_len,
+                                       uint8_t **decompressed_buf,
+                                       mongoc_rpc_t *rpc,
+                                       bson_error_t *error)
+{
+   uint8_t *buf;
+   size_t len;
+   int32_t uncompressed_size;
+   bool ret = false;
+
+   ENTRY;
+
+   len = (size_t) msg_len;
+   buf = bson_malloc (len);
+   memcpy (buf, header, 16);
+
+   if (len - 16 != mongoc_stream_read (stream,
+                                       buf + 16,
+                                       len - 16,
+                                       len - 16,
+                                       cluster->sockettimeoutms)) {
+      bson_set_error (error,
+                      MONGOC_ERROR_STREAM,
+                      MONGOC_ERROR_STREAM_SOCKET,
+                      "socket error or timeout");
+      bson_free (buf);
+      RETURN (false);
+   }
+
+   if (!_mongoc_rpc_scatter (rpc, buf, len)) {
+      GOTO (done);
+   }
+
+   mongoc_counter_op_ingress_compressed_inc ();
+
+   uncompressed_size =
+      BSON_UINT32_FROM_LE (rpc->compressed.uncompressed_size);
+   if (uncompressed_size < 0 ||
+       uncompressed_size > MONGOC_DEFAULT_MAX_MSG_SIZE - 16) {
+      GOTO (done);
+   }
+
+   len = (size_t) uncompressed_size + 16;
+   *decompressed_buf = bson_malloc (len);
+
+   if (!_mongoc_rpc_decompress (rpc, *decompressed_buf, len) ||
+       !_mongoc_rpc_scatter (rpc, *decompressed_buf, len)) {
+      GOTO (done);
+   }
+
+   _mongoc_rpc_swab_from_le (rpc);
+   ret = true;
+
+done:
+   if (!ret) {
+      bson_set_error (error,
+                      MONGOC_ERROR_PROTOCOL,
+                      MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                      "Could not decompress server reply");
+   }
+
+   bson_free (buf);
+
+   RETURN (ret);
+}
+
+
+/* record a command's round trip in the histogram for its name */
+static void
+_mongoc_cluster_record_cmd_latency (const char *command_name, int64_t usec)
+{
+   if (!strcmp (command_name, "find")) {
+      mongoc_histogram_cmd_find_record (usec);
+   } else if (!strcmp (command_name, "getMore")) {
+      mongoc_histogram_cmd_getmore_record (usec);
+   } else if (!strcmp (command_name, "insert")) {
+      mongoc_histogram_cmd_insert_record (usec);
+   } else if (!strcmp (command_name, "update")) {
+      mongoc_histogram_cmd_update_record (usec);
+   } else if (!strcmp (command_name, "delete")) {
+      mongoc_histogram_cmd_delete_record (usec);
+   } else {
+      mongoc_histogram_cmd_other_record (usec);
+   }
+}
+
+
+/* the shm counters of @server_id, or NULL if not connected */
+static mongoc_counter_slots_t *
+_mongoc_cluster_node_counters (mongoc_cluster_t *cluster, uint32_t server_id)
+{
+   mongoc_topology_scanner_node_t *scanner_node;
+   mongoc_cluster_node_t *cluster_node;
+
+   if (cluster->client->topology->single_threaded) {
+      scanner_node = mongoc_topology_scanner_get_node (
+         cluster->client->topology->scanner, server_id);
+
+      return scanner_node ? scanner_node->counters : NULL;
+   }
+
+   cluster_node =
+      (mongoc_cluster_node_t *) mongoc_set_get (cluster->nodes, server_id);
+
+   return cluster_node ? cluster_node->counters : NULL;
+}
+
+
+static size_t
+_mongoc_cluster_iov_len (const mongoc_iovec_t *iov, size_t iovcnt)
+{
+   size_t len = 0;
+   size_t i;
+
+   for (i = 0; i < iovcnt; i++) {
+      len += iov[i].iov_len;
+   }
+
+   return len;
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -126,6 +286,9 @@ _bson_error_message_printf (bson_error_t *error, const char *format, ...)
  * Returns:
  *       true if successful; otherwise false and @error is set.
  *
+ *       If @compressor_id is not -1 the command is sent as OP_COMPRESSED,
+ *       unless it is part of the handshake or authentication.
+ *
  * Side effects:
  *       @reply is set and should ALWAYS be released with bson_destroy().
  *       On failure, @error is filled out. If this was a network error
@@ -143,6 +306,7 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t *cluster,
                                      const bson_t *command,
                                      bool monitored,
                                      const mongoc_host_list_t *host,
+                                     int32_t compressor_id,
                                      bson_t *reply,
                                      bson_error_t *error)
 {
@@ -153,6 +317,11 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t *cluster,
    const size_t reply_header_size = sizeof (mongoc_rpc_reply_header_t);
    uint8_t reply_header_buf[sizeof (mongoc_rpc_reply_header_t)];
    uint8_t *reply_buf;     /* reply body */
+   uint8_t *compressed_buf = NULL;   /* OP_COMPRESSED request */
+   uint8_t *decompressed_buf = NULL; /* OP_COMPRESSED reply */
+   size_t compressed_len;
+   mongoc_iovec_t iov;
+   bson_t reply_doc;
    mongoc_rpc_t rpc;       /* sent to server */
    bson_error_t err_local; /* in case the passed-in "error" is NULL */
    bson_t reply_local;
@@ -160,10 +329,12 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t *cluster,
    char cmd_ns[MONGOC_NAMESPACE_MAX];
    uint32_t request_id;
    int32_t msg_len;
+   int32_t opcode;
    size_t doc_len;
    mongoc_apm_command_started_t started_event;
    mongoc_apm_command_succeeded_t succeeded_event;
    mongoc_apm_command_failed_t failed_event;
+   mongoc_counter_slots_t *node_counters;
    bool ret = false;
 
    ENTRY;
@@ -173,6 +344,12 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t *cluster,
 
    started = bson_get_monotonic_time ();
 
+   /* a new node's handshake runs before it is added to the cluster */
+   node_counters = _mongoc_cluster_node_counters (cluster, server_id);
+   if (!node_counters && host) {
+      node_counters = _mongoc_node_counters_get (host->host_and_port);
+   }
+
    /*
     * setup
     */
@@ -206,8 +383,22 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t *cluster,
    request_id = ++cluster->request_id;
    _mongoc_rpc_prep_command (&rpc, cmd_ns, command, flags);
    rpc.query.request_id = request_id;
-   _mongoc_rpc_gather (&rpc, &ar);
-   _mongoc_rpc_swab_to_le (&rpc);
+
+   if (compressor_id != -1 &&
+       _mongoc_compressor_command_is_compressible (command_name)) {
+      compressed_buf = _mongoc_rpc_compress (
+         &rpc, compressor_id, cluster->zlib_compression_level, &compressed_len);
+   }
+
+   if (compressed_buf) {
+      mongoc_counter_op_egress_compressed_inc ();
+      iov.iov_base = (void *) compressed_buf;
+      iov.iov_len = compressed_len;
+      _mongoc_array_append_val (&ar, iov);
+   } else {
+      _mongoc_rpc_gather (&rpc, &ar);
+      _mongoc_rpc_swab_to_le (&rpc);
+   }
 
    if (monitored && callbacks->started) {
       mongoc_apm_command_started_init (&started_event,
@@ -253,11 +444,18 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t *cluster,
       GOTO (done);
    }
 
-   if (reply_header_size != mongoc_stream_read (stream,
-                                                &reply_header_buf,
-                                                reply_header_size,
-                                                reply_header_size,
-                                                cluster->sockettimeoutms)) {
+   _mongoc_node_counter_add (node_counters, MONGOC_NODE_COUNTER_OPS, 1);
+   _mongoc_node_counter_add (
+      node_counters,
+      MONGOC_NODE_COUNTER_BYTES_OUT,
+      (int64_t) _mongoc_cluster_iov_len ((mongoc_iovec_t *) ar.data, ar.len));
+
+   /* read the standard header first, the reply may be OP_COMPRESSED */
+   if (16 != mongoc_stream_read (stream,
+                                 &reply_header_buf,
+                                 16,
+                                 16,
+                                 cluster->sockettimeoutms)) {
       mongoc_cluster_disconnect_node (cluster, server_id);
       RUN_CMD_ERR (MONGOC_ERROR_STREAM,
                    MONGOC_ERROR_STREAM_SOCKET,
@@ -268,8 +466,59 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t *cluster,
 
    memcpy (&msg_len, reply_header_buf, 4);
    msg_len = BSON_UINT32_FROM_LE (msg_len);
-   if ((msg_len < reply_header_size) ||
-       (msg_len > MONGOC_DEFAULT_MAX_MSG_SIZE)) {
+   if ((msg_len < 16) || (msg_len > MONGOC_DEFAULT_MAX_MSG_SIZE)) {
+      GOTO (done);
+   }
+
+   _mongoc_node_counter_add (
+      node_counters, MONGOC_NODE_COUNTER_BYTES_IN, msg_len);
+
+   memcpy (&opcode, reply_header_buf + 12, 4);
+   opcode = BSON_UINT32_FROM_LE (opcode);
+
+   if (opcode == MONGOC_OPCODE_COMPRESSED) {
+      if (!_mongoc_cluster_read_compressed_reply (cluster,
+                                                  stream,
+                                                  reply_header_buf,
+                                                  msg_len,
+                                                  &decompressed_buf,
+                                                  &rpc,
+                                                  error)) {
+         _bson_error_message_printf (
+            error,
+            "Failed to send \"%s\" command with database \"%s\": %s",
+            command_name,
+            db_name,
+            error->message);
+         mongoc_cluster_disconnect_node (cluster, server_id);
+         GOTO (done);
+      }
+
+      if (rpc.header.opcode != MONGOC_OPCODE_REPLY ||
+          rpc.reply.n_returned != 1 ||
+          !_mongoc_rpc_reply_get_first (&rpc.reply, &reply_doc)) {
+         GOTO (done);
+      }
+
+      bson_concat (reply_ptr, &reply_doc);
+      GOTO (check_error);
+   }
+
+   if (msg_len < reply_header_size) {
+      GOTO (done);
+   }
+
+   if (reply_header_size - 16 !=
+       mongoc_stream_read (stream,
+                           reply_header_buf + 16,
+                           reply_header_size - 16,
+                           reply_header_size - 16,
+                           cluster->sockettimeoutms)) {
+      mongoc_cluster_disconnect_node (cluster, server_id);
+      RUN_CMD_ERR (MONGOC_ERROR_STREAM,
+                   MONGOC_ERROR_STREAM_SOCKET,
+                   "socket error or timeout");
+
       GOTO (done);
    }
 
@@ -298,6 +547,7 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t *cluster,
                    "socket error or timeout");
    }
 
+check_error:
    if (_mongoc_populate_cmd_error (
           reply_ptr, cluster->client->error_api_version, error)) {
       GOTO (done);
@@ -321,6 +571,13 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t *cluster,
 
 done:
    _mongoc_array_destroy (&ar);
+   bson_free (compressed_buf);
+   bson_free (decompressed_buf);
+
+   if (command_name) {
+      _mongoc_cluster_record_cmd_latency (
+         command_name, bson_get_monotonic_time () - started);
+   }
 
    if (!ret && error->code == 0) {
       /* generic error */
@@ -386,6 +643,8 @@ mongoc_cluster_run_command_monitored (mongoc_cluster_t *cluster,
                                                command,
                                                true,
                                                &server_stream->sd->host,
+                                               mongoc_server_description_compressor_id (
+                                                  server_stream->sd),
                                                reply,
                                                error);
 }
@@ -429,6 +688,8 @@ mongoc_cluster_run_command (mongoc_cluster_t *cluster,
                                                /* not monitored */
                                                false,
                                                NULL,
+                                               /* not compressed */
+                                               -1,
                                                reply,
                                                error);
 }
@@ -450,10 +711,15 @@ static mongoc_server_description_t *
 _mongoc_stream_run_ismaster (mongoc_cluster_t *cluster,
                              mongoc_stream_t *stream,
                              const char *address,
-                             uint32_t server_id)
+                             uint32_t server_id,
+                             mongoc_cluster_speculative_auth_t *speculative)
 {
    bson_t command = BSON_INITIALIZER;
    bson_t reply;
+   bson_iter_t iter;
+   const uint8_t *data;
+   uint32_t len;
+   bson_t speculative_reply;
    bson_error_t error = {0};
    int64_t start;
    int64_t rtt_msec;
@@ -466,6 +732,13 @@ _mongoc_stream_run_ismaster (mongoc_cluster_t *cluster,
    BSON_ASSERT (stream);
 
    bson_append_int32 (&command, "ismaster", 8, 1);
+   _mongoc_compressor_append_to_ismaster (
+      &command, mongoc_uri_get_compressors (cluster->uri));
+
+   if (speculative && speculative->started) {
+      BSON_APPEND_DOCUMENT (
+         &command, "speculativeAuthenticate", &speculative->cmd);
+   }
 
    start = bson_get_monotonic_time ();
    mongoc_cluster_run_command (cluster,
@@ -486,6 +759,15 @@ _mongoc_stream_run_ismaster (mongoc_cluster_t *cluster,
    /* send the error from run_command IN to handle_ismaster */
    mongoc_server_description_handle_ismaster (sd, &reply, rtt_msec, &error);
 
+   if (speculative && speculative->started &&
+       bson_iter_init_find (&iter, &reply, "speculativeAuthenticate") &&
+       BSON_ITER_HOLDS_DOCUMENT (&iter)) {
+      bson_iter_document (&iter, &len, &data);
+      bson_init_static (&speculative_reply, data, len);
+      bson_destroy (&speculative->reply);
+      bson_copy_to (&speculative_reply, &speculative->reply);
+   }
+
    bson_destroy (&command);
    bson_destroy (&reply);
 
@@ -522,6 +804,7 @@ static bool
 _mongoc_cluster_run_ismaster (mongoc_cluster_t *cluster,
                               mongoc_cluster_node_t *node,
                               uint32_t server_id,
+                              mongoc_cluster_speculative_auth_t *speculative,
                               bson_error_t *error /* OUT */)
 {
    bool r;
@@ -533,8 +816,11 @@ _mongoc_cluster_run_ismaster (mongoc_cluster_t *cluster,
    BSON_ASSERT (node);
    BSON_ASSERT (node->stream);
 
-   sd = _mongoc_stream_run_ismaster (
-      cluster, node->stream, node->connection_address, server_id);
+   sd = _mongoc_stream_run_ismaster (cluster,
+                                     node->stream,
+                                     node->connection_address,
+                                     server_id,
+                                     speculative);
 
    if (sd->type == MONGOC_SERVER_UNKNOWN) {
       r = false;
@@ -1117,45 +1403,112 @@ _mongoc_cluster_auth_node_x509 (mongoc_cluster_t *cluster,
 
 
 #ifdef MONGOC_ENABLE_CRYPTO
+/* read a saslStart, saslContinue, or speculativeAuthenticate reply */
 static bool
-_mongoc_cluster_auth_node_scram (mongoc_cluster_t *cluster,
-                                 mongoc_stream_t *stream,
-                                 bson_error_t *error)
+_mongoc_cluster_scram_parse_reply (const bson_t *reply,
+                                   bool *done,
+                                   int *conv_id,
+                                   uint8_t *buf,
+                                   uint32_t bufmax,
+                                   uint32_t *buflen,
+                                   bson_error_t *error)
 {
-   uint32_t buflen = 0;
-   mongoc_scram_t scram;
    bson_iter_t iter;
-   bool ret = false;
+   bson_subtype_t btype;
    const char *tmpstr;
+
+   if (bson_iter_init_find (&iter, reply, "done") &&
+       bson_iter_as_bool (&iter)) {
+      *done = true;
+      return true;
+   }
+
+   *done = false;
+
+   if (!bson_iter_init_find (&iter, reply, "conversationId") ||
+       !BSON_ITER_HOLDS_INT32 (&iter) ||
+       !(*conv_id = bson_iter_int32 (&iter)) ||
+       !bson_iter_init_find (&iter, reply, "payload") ||
+       !BSON_ITER_HOLDS_BINARY (&iter)) {
+      const char *errmsg = "Received invalid SCRAM reply from MongoDB server.";
+
+      MONGOC_DEBUG ("SCRAM: authentication failed");
+
+      if (bson_iter_init_find (&iter, reply, "errmsg") &&
+          BSON_ITER_HOLDS_UTF8 (&iter)) {
+         errmsg = bson_iter_utf8 (&iter, NULL);
+      }
+
+      bson_set_error (error,
+                      MONGOC_ERROR_CLIENT,
+                      MONGOC_ERROR_CLIENT_AUTHENTICATE,
+                      "%s",
+                      errmsg);
+      return false;
+   }
+
+   bson_iter_binary (&iter, &btype, buflen, (const uint8_t **) &tmpstr);
+
+   if (*buflen > bufmax) {
+      bson_set_error (error,
+                      MONGOC_ERROR_CLIENT,
+                      MONGOC_ERROR_CLIENT_AUTHENTICATE,
+                      "SCRAM reply from MongoDB is too large.");
+      return false;
+   }
+
+   memcpy (buf, tmpstr, *buflen);
+
+   return true;
+}
+
+
+/* run @scram's conversation to the end. if the server already replied to
+ * its first step in ismaster, @speculative_reply is that reply */
+static bool
+_mongoc_cluster_run_scram (mongoc_cluster_t *cluster,
+                           mongoc_stream_t *stream,
+                           mongoc_scram_t *scram,
+                           const bson_t *speculative_reply,
+                           bson_error_t *error)
+{
+   uint32_t buflen = 0;
    const char *auth_source;
    uint8_t buf[4096] = {0};
    bson_t cmd;
    bson_t reply;
    int conv_id = 0;
-   bson_subtype_t btype;
-
-   BSON_ASSERT (cluster);
-   BSON_ASSERT (stream);
+   bool done = false;
+   bool r;
 
    if (!(auth_source = mongoc_uri_get_auth_source (cluster->uri)) ||
        (*auth_source == '\0')) {
       auth_source = "admin";
    }
 
-   _mongoc_scram_init (&scram);
+   if (speculative_reply) {
+      TRACE ("%s", "SCRAM: continuing speculative authentication");
 
-   _mongoc_scram_set_pass (&scram, mongoc_uri_get_password (cluster->uri));
-   _mongoc_scram_set_user (&scram, mongoc_uri_get_username (cluster->uri));
+      if (!_mongoc_cluster_scram_parse_reply (speculative_reply,
+                                              &done,
+                                              &conv_id,
+                                              buf,
+                                              sizeof buf,
+                                              &buflen,
+                                              error)) {
+         return false;
+      }
+   }
 
-   for (;;) {
+   while (!done) {
       if (!_mongoc_scram_step (
-             &scram, buf, buflen, buf, sizeof buf, &buflen, error)) {
-         goto failure;
+             scram, buf, buflen, buf, sizeof buf, &buflen, error)) {
+         return false;
       }
 
       bson_init (&cmd);
 
-      if (scram.step == 1) {
+      if (scram->step == 1) {
          BSON_APPEND_INT32 (&cmd, "saslStart", 1);
          BSON_APPEND_UTF8 (&cmd, "mechanism", "SCRAM-SHA-1");
          bson_append_binary (
@@ -1168,7 +1521,7 @@ _mongoc_cluster_auth_node_scram (mongoc_cluster_t *cluster,
             &cmd, "payload", 7, BSON_SUBTYPE_BINARY, buf, buflen);
       }
 
-      TRACE ("SCRAM: authenticating (step %d)", scram.step);
+      TRACE ("SCRAM: authenticating (step %d)", scram->step);
 
       if (!mongoc_cluster_run_command (cluster,
                                        stream,
@@ -1184,62 +1537,54 @@ _mongoc_cluster_auth_node_scram (mongoc_cluster_t *cluster,
          /* error->message is already set */
          error->domain = MONGOC_ERROR_CLIENT;
          error->code = MONGOC_ERROR_CLIENT_AUTHENTICATE;
-         goto failure;
+         return false;
       }
 
       bson_destroy (&cmd);
 
-      if (bson_iter_init_find (&iter, &reply, "done") &&
-          bson_iter_as_bool (&iter)) {
-         bson_destroy (&reply);
-         break;
-      }
+      r = _mongoc_cluster_scram_parse_reply (
+         &reply, &done, &conv_id, buf, sizeof buf, &buflen, error);
 
-      if (!bson_iter_init_find (&iter, &reply, "conversationId") ||
-          !BSON_ITER_HOLDS_INT32 (&iter) ||
-          !(conv_id = bson_iter_int32 (&iter)) ||
-          !bson_iter_init_find (&iter, &reply, "payload") ||
-          !BSON_ITER_HOLDS_BINARY (&iter)) {
-         const char *errmsg =
-            "Received invalid SCRAM reply from MongoDB server.";
+      bson_destroy (&reply);
 
-         MONGOC_DEBUG ("SCRAM: authentication failed");
+      if (!r) {
+         return false;
+      }
+   }
 
-         if (bson_iter_init_find (&iter, &reply, "errmsg") &&
-             BSON_ITER_HOLDS_UTF8 (&iter)) {
-            errmsg = bson_iter_utf8 (&iter, NULL);
-         }
+   TRACE ("%s", "SCRAM: authenticated");
 
-         bson_set_error (error,
-                         MONGOC_ERROR_CLIENT,
-                         MONGOC_ERROR_CLIENT_AUTHENTICATE,
-                         "%s",
-                         errmsg);
-         bson_destroy (&reply);
-         goto failure;
-      }
+   return true;
+}
 
-      bson_iter_binary (&iter, &btype, &buflen, (const uint8_t **) &tmpstr);
 
-      if (buflen > sizeof buf) {
-         bson_set_error (error,
-                         MONGOC_ERROR_CLIENT,
-                         MONGOC_ERROR_CLIENT_AUTHENTICATE,
-                         "SCRAM reply from MongoDB is too large.");
-         bson_destroy (&reply);
-         goto failure;
-      }
+static bool
+_mongoc_cluster_auth_node_scram (mongoc_cluster_t *cluster,
+                                 mongoc_stream_t *stream,
+                                 mongoc_cluster_speculative_auth_t *speculative,
+                                 bson_error_t *error)
+{
+   mongoc_scram_t scram;
+   bool ret;
 
-      memcpy (buf, tmpstr, buflen);
+   BSON_ASSERT (cluster);
+   BSON_ASSERT (stream);
 
-      bson_destroy (&reply);
+   if (speculative && speculative->started &&
+       !bson_empty (&speculative->reply)) {
+      mongoc_counter_auth_speculative_inc ();
+      return _mongoc_cluster_run_scram (
+         cluster, stream, &speculative->scram, &speculative->reply, error);
    }
 
-   TRACE ("%s", "SCRAM: authenticated");
+   _mongoc_scram_init (&scram);
 
-   ret = true;
+   _mongoc_scram_set_pass (&scram, mongoc_uri_get_password (cluster->uri));
+   _mongoc_scram_set_user (&scram, mongoc_uri_get_username (cluster->uri));
+   _mongoc_scram_set_cache (&scram, &cluster->client->topology->scram_cache);
+
+   ret = _mongoc_cluster_run_scram (cluster, stream, &scram, NULL, error);
 
-failure:
    _mongoc_scram_destroy (&scram);
 
    return ret;
@@ -1247,6 +1592,90 @@ failure:
 #endif
 
 
+static void
+_mongoc_cluster_speculative_auth_init (
+   mongoc_cluster_speculative_auth_t *speculative)
+{
+#ifdef MONGOC_ENABLE_CRYPTO
+   _mongoc_scram_init (&speculative->scram);
+#endif
+   speculative->started = false;
+   bson_init (&speculative->cmd);
+   bson_init (&speculative->reply);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_speculative_auth_start --
+ *
+ *       Take the first step of SCRAM-SHA-1 authentication, to send in a
+ *       new connection's ismaster, if the cluster requires SCRAM-SHA-1 or
+ *       the default mechanism. A server too old to support speculative
+ *       authentication ignores it; the default mechanism is SCRAM-SHA-1
+ *       for any server that supports it.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_cluster_speculative_auth_start (
+   mongoc_cluster_t *cluster, mongoc_cluster_speculative_auth_t *speculative)
+{
+#ifdef MONGOC_ENABLE_CRYPTO
+   const char *mechanism;
+   const char *auth_source;
+   uint8_t buf[4096];
+   uint32_t buflen = 0;
+   bson_error_t error;
+
+   mechanism = mongoc_uri_get_auth_mechanism (cluster->uri);
+   if (!cluster->requires_auth ||
+       (mechanism && strcasecmp (mechanism, "SCRAM-SHA-1"))) {
+      return;
+   }
+
+   if (!(auth_source = mongoc_uri_get_auth_source (cluster->uri)) ||
+       (*auth_source == '\0')) {
+      auth_source = "admin";
+   }
+
+   _mongoc_scram_set_pass (&speculative->scram,
+                           mongoc_uri_get_password (cluster->uri));
+   _mongoc_scram_set_user (&speculative->scram,
+                           mongoc_uri_get_username (cluster->uri));
+   _mongoc_scram_set_cache (&speculative->scram,
+                            &cluster->client->topology->scram_cache);
+
+   if (!_mongoc_scram_step (
+          &speculative->scram, NULL, 0, buf, sizeof buf, &buflen, &error)) {
+      /* authenticating after ismaster fails the same way */
+      return;
+   }
+
+   BSON_APPEND_INT32 (&speculative->cmd, "saslStart", 1);
+   BSON_APPEND_UTF8 (&speculative->cmd, "mechanism", "SCRAM-SHA-1");
+   bson_append_binary (
+      &speculative->cmd, "payload", 7, BSON_SUBTYPE_BINARY, buf, buflen);
+   BSON_APPEND_UTF8 (&speculative->cmd, "db", auth_source);
+   speculative->started = true;
+#endif
+}
+
+
+static void
+_mongoc_cluster_speculative_auth_destroy (
+   mongoc_cluster_speculative_auth_t *speculative)
+{
+#ifdef MONGOC_ENABLE_CRYPTO
+   _mongoc_scram_destroy (&speculative->scram);
+#endif
+   bson_destroy (&speculative->cmd);
+   bson_destroy (&speculative->reply);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -1268,6 +1697,7 @@ _mongoc_cluster_auth_node (mongoc_cluster_t *cluster,
                            mongoc_stream_t *stream,
                            const char *hostname,
                            int32_t max_wire_version,
+                           mongoc_cluster_speculative_auth_t *speculative,
                            bson_error_t *error)
 {
    bool ret = false;
@@ -1303,7 +1733,8 @@ _mongoc_cluster_auth_node (mongoc_cluster_t *cluster,
 #endif
    } else if (0 == strcasecmp (mechanism, "SCRAM-SHA-1")) {
 #ifdef MONGOC_ENABLE_CRYPTO
-      ret = _mongoc_cluster_auth_node_scram (cluster, stream, error);
+      ret = _mongoc_cluster_auth_node_scram (
+         cluster, stream, speculative, error);
 #else
       bson_set_error (error,
                       MONGOC_ERROR_CLIENT,
@@ -1372,6 +1803,10 @@ mongoc_cluster_disconnect_node (mongoc_cluster_t *cluster, uint32_t server_id)
    mongoc_topology_t *topology = cluster->client->topology;
    ENTRY;
 
+   _mongoc_node_counter_add (_mongoc_cluster_node_counters (cluster, server_id),
+                             MONGOC_NODE_COUNTER_ERRORS,
+                             1);
+
    if (topology->single_threaded) {
       mongoc_topology_scanner_node_t *scanner_node;
 
@@ -1386,16 +1821,18 @@ mongoc_cluster_disconnect_node (mongoc_cluster_t *cluster, uint32_t server_id)
       EXIT;
    } else {
       mongoc_set_rm (cluster->nodes, server_id);
+      cluster->node_disconnected = true;
    }
 
    EXIT;
 }
 
-static void
+void
 _mongoc_cluster_node_destroy (mongoc_cluster_node_t *node)
 {
    /* Failure, or Replica Set reconfigure without this node */
    mongoc_stream_failed (node->stream);
+   _mongoc_node_counter_add (node->counters, MONGOC_NODE_COUNTER_STREAMS, -1);
    bson_free (node->connection_address);
 
    bson_free (node);
@@ -1423,8 +1860,11 @@ _mongoc_cluster_node_new (mongoc_stream_t *stream,
 
    node->stream = stream;
    node->connection_address = bson_strdup (connection_address);
+   node->counters = _mongoc_node_counters_get (connection_address);
    node->timestamp = bson_get_monotonic_time ();
 
+   _mongoc_node_counter_add (node->counters, MONGOC_NODE_COUNTER_STREAMS, 1);
+
    node->max_wire_version = MONGOC_DEFAULT_WIRE_VERSION;
    node->min_wire_version = MONGOC_DEFAULT_WIRE_VERSION;
 
@@ -1438,33 +1878,36 @@ _mongoc_cluster_node_new (mongoc_stream_t *stream,
 /*
  *--------------------------------------------------------------------------
  *
- * mongoc_cluster_add_node --
- *
- *       Add a new node to this cluster for the given server description.
+ * _mongoc_cluster_node_connect --
  *
- *       NOTE: does NOT check if this server is already in the cluster.
+ *       Connect to @server_id, run the handshake and authenticate, as for
+ *       a pooled cluster node, but don't add the node to the cluster.
  *
  * Returns:
- *       A stream connected to the server, or NULL on failure.
+ *       A node to free with _mongoc_cluster_node_destroy, or NULL on
+ *       failure.
  *
  * Side effects:
- *       Adds a cluster node, or sets error on failure.
+ *       Updates the topology from the handshake, or sets @error.
  *
  *--------------------------------------------------------------------------
  */
-static mongoc_stream_t *
-_mongoc_cluster_add_node (mongoc_cluster_t *cluster,
-                          uint32_t server_id,
-                          bson_error_t *error /* OUT */)
+mongoc_cluster_node_t *
+_mongoc_cluster_node_connect (mongoc_cluster_t *cluster,
+                              uint32_t server_id,
+                              bson_error_t *error /* OUT */)
 {
    mongoc_host_list_t *host = NULL;
    mongoc_cluster_node_t *cluster_node = NULL;
+   mongoc_cluster_speculative_auth_t speculative;
    mongoc_stream_t *stream;
 
    ENTRY;
 
    BSON_ASSERT (cluster);
-   BSON_ASSERT (!cluster->client->topology->single_threaded);
+
+   _mongoc_cluster_speculative_auth_init (&speculative);
+   _mongoc_cluster_speculative_auth_start (cluster, &speculative);
 
    host =
       _mongoc_topology_host_by_id (cluster->client->topology, server_id, error);
@@ -1473,7 +1916,7 @@ _mongoc_cluster_add_node (mongoc_cluster_t *cluster,
       GOTO (error);
    }
 
-   TRACE ("Adding new server to cluster: %s", host->host_and_port);
+   TRACE ("Connecting to server: %s", host->host_and_port);
 
    stream = _mongoc_client_create_stream (cluster->client, host, error);
 
@@ -1487,7 +1930,7 @@ _mongoc_cluster_add_node (mongoc_cluster_t *cluster,
    cluster_node = _mongoc_cluster_node_new (stream, host->host_and_port);
 
    if (!_mongoc_cluster_run_ismaster (
-          cluster, cluster_node, server_id, error)) {
+          cluster, cluster_node, server_id, &speculative, error)) {
       GOTO (error);
    }
 
@@ -1496,6 +1939,7 @@ _mongoc_cluster_add_node (mongoc_cluster_t *cluster,
                                       cluster_node->stream,
                                       host->host,
                                       cluster_node->max_wire_version,
+                                      &speculative,
                                       error)) {
          MONGOC_WARNING ("Failed authentication to %s (%s)",
                          host->host_and_port,
@@ -1504,13 +1948,14 @@ _mongoc_cluster_add_node (mongoc_cluster_t *cluster,
       }
    }
 
-   mongoc_set_add (cluster->nodes, server_id, cluster_node);
    _mongoc_host_list_destroy_all (host);
+   _mongoc_cluster_speculative_auth_destroy (&speculative);
 
-   RETURN (stream);
+   RETURN (cluster_node);
 
 error:
    _mongoc_host_list_destroy_all (host); /* null ok */
+   _mongoc_cluster_speculative_auth_destroy (&speculative);
 
    if (cluster_node) {
       _mongoc_cluster_node_destroy (cluster_node); /* also destroys stream */
@@ -1519,6 +1964,46 @@ error:
    RETURN (NULL);
 }
 
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_add_node --
+ *
+ *       Add a new node to this cluster for the given server description.
+ *
+ *       NOTE: does NOT check if this server is already in the cluster.
+ *
+ * Returns:
+ *       A stream connected to the server, or NULL on failure.
+ *
+ * Side effects:
+ *       Adds a cluster node, or sets error on failure.
+ *
+ *--------------------------------------------------------------------------
+ */
+static mongoc_stream_t *
+_mongoc_cluster_add_node (mongoc_cluster_t *cluster,
+                          uint32_t server_id,
+                          bson_error_t *error /* OUT */)
+{
+   mongoc_cluster_node_t *cluster_node;
+
+   ENTRY;
+
+   BSON_ASSERT (cluster);
+   BSON_ASSERT (!cluster->client->topology->single_threaded);
+
+   cluster_node = _mongoc_cluster_node_connect (cluster, server_id, error);
+   if (!cluster_node) {
+      RETURN (NULL);
+   }
+
+   mongoc_set_add (cluster->nodes, server_id, cluster_node);
+
+   RETURN (cluster_node->stream);
+}
+
 static void
 node_not_found (mongoc_topology_t *topology,
                 uint32_t server_id,
@@ -1593,6 +2078,9 @@ _mongoc_cluster_stream_for_server (mongoc_cluster_t *cluster,
 
    topology = cluster->client->topology;
 
+   /* don't let anyone read a cursor's prefetched getMore reply */
+   _mongoc_client_recv_prefetch (cluster->client);
+
    /* in the single-threaded use case we share topology's streams */
    if (topology->single_threaded) {
       server_stream = mongoc_cluster_fetch_stream_single (
@@ -1675,6 +2163,8 @@ mongoc_cluster_fetch_stream_single (mongoc_cluster_t *cluster,
    mongoc_server_description_t *sd;
    mongoc_stream_t *stream;
    mongoc_topology_scanner_node_t *scanner_node;
+   mongoc_cluster_speculative_auth_t speculative;
+   mongoc_server_stream_t *server_stream = NULL;
    int64_t expire_at;
 
    topology = cluster->client->topology;
@@ -1683,33 +2173,36 @@ mongoc_cluster_fetch_stream_single (mongoc_cluster_t *cluster,
    BSON_ASSERT (scanner_node && !scanner_node->retired);
    stream = scanner_node->stream;
 
+   _mongoc_cluster_speculative_auth_init (&speculative);
+
    if (stream) {
       sd = mongoc_topology_server_by_id (topology, server_id, error);
 
       if (!sd) {
-         return NULL;
+         goto done;
       }
    } else {
       if (!reconnect_ok) {
          stream_not_found (
             topology, server_id, scanner_node->host.host_and_port, error);
-         return NULL;
+         goto done;
       }
 
-      if (!mongoc_topology_scanner_node_setup (scanner_node, error)) {
-         return NULL;
+      expire_at =
+         bson_get_monotonic_time () + topology->connect_timeout_msec * 1000;
+      if (!mongoc_topology_scanner_node_setup_blocking (
+             scanner_node, expire_at, error)) {
+         goto done;
       }
       stream = scanner_node->stream;
 
-      expire_at =
-         bson_get_monotonic_time () + topology->connect_timeout_msec * 1000;
       if (!mongoc_stream_wait (stream, expire_at)) {
          bson_set_error (error,
                          MONGOC_ERROR_STREAM,
                          MONGOC_ERROR_STREAM_CONNECT,
                          "Failed to connect to target host: '%s'",
                          scanner_node->host.host_and_port);
-         return NULL;
+         goto done;
       }
 
 #ifdef MONGOC_ENABLE_SSL
@@ -1728,20 +2221,27 @@ mongoc_cluster_fetch_stream_single (mongoc_cluster_t *cluster,
             error);
 
          if (!r) {
+            _mongoc_node_counter_add (
+               scanner_node->counters, MONGOC_NODE_COUNTER_ERRORS, 1);
             mongoc_topology_scanner_node_disconnect (scanner_node, true);
-            return NULL;
+            goto done;
          }
       }
 #endif
 
-      sd = _mongoc_stream_run_ismaster (
-         cluster, stream, scanner_node->host.host_and_port, server_id);
+      /* a new connection's ismaster can authenticate speculatively */
+      _mongoc_cluster_speculative_auth_start (cluster, &speculative);
+      sd = _mongoc_stream_run_ismaster (cluster,
+                                        stream,
+                                        scanner_node->host.host_and_port,
+                                        server_id,
+                                        &speculative);
    }
 
    if (sd->type == MONGOC_SERVER_UNKNOWN) {
       memcpy (error, &sd->error, sizeof *error);
       mongoc_server_description_destroy (sd);
-      return NULL;
+      goto done;
    }
 
    /* stream open but not auth'ed: first use since connect or reconnect */
@@ -1750,16 +2250,23 @@ mongoc_cluster_fetch_stream_single (mongoc_cluster_t *cluster,
                                       stream,
                                       sd->host.host,
                                       sd->max_wire_version,
+                                      &speculative,
                                       &sd->error)) {
          memcpy (error, &sd->error, sizeof *error);
          mongoc_server_description_destroy (sd);
-         return NULL;
+         goto done;
       }
 
       scanner_node->has_auth = true;
    }
 
-   return mongoc_server_stream_new (topology->description.type, sd, stream);
+   server_stream =
+      mongoc_server_stream_new (topology->description.type, sd, stream);
+
+done:
+   _mongoc_cluster_speculative_auth_destroy (&speculative);
+
+   return server_stream;
 }
 
 
@@ -1782,6 +2289,25 @@ _mongoc_cluster_create_server_stream (mongoc_topology_t *topology,
 }
 
 
+/* count a pooled client's checkout as warm or cold by its first operation,
+ * whether the operation found its server's stream ready */
+static void
+_mongoc_cluster_count_checkout (mongoc_cluster_t *cluster, bool warm)
+{
+   if (cluster->checkout_counted) {
+      return;
+   }
+
+   cluster->checkout_counted = true;
+
+   if (warm) {
+      mongoc_counter_client_pools_warm_checkouts_inc ();
+   } else {
+      mongoc_counter_client_pools_cold_checkouts_inc ();
+   }
+}
+
+
 static mongoc_server_stream_t *
 mongoc_cluster_fetch_stream_pooled (mongoc_cluster_t *cluster,
                                     uint32_t server_id,
@@ -1807,6 +2333,7 @@ mongoc_cluster_fetch_stream_pooled (mongoc_cluster_t *cluster,
           * or replace server description since node's birth. destroy node. */
          mongoc_cluster_disconnect_node (cluster, server_id);
       } else {
+         _mongoc_cluster_count_checkout (cluster, true);
          return _mongoc_cluster_create_server_stream (
             topology, server_id, cluster_node->stream, error);
       }
@@ -1818,6 +2345,8 @@ mongoc_cluster_fetch_stream_pooled (mongoc_cluster_t *cluster,
       return NULL;
    }
 
+   _mongoc_cluster_count_checkout (cluster, false);
+
    stream = _mongoc_cluster_add_node (cluster, server_id, error);
    if (stream) {
       return _mongoc_cluster_create_server_stream (
@@ -1827,6 +2356,86 @@ mongoc_cluster_fetch_stream_pooled (mongoc_cluster_t *cluster,
    }
 }
 
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_node_is_warm --
+ *
+ *       Whether a pooled @cluster has a connected, authenticated node for
+ *       @server_id that is not older than @server_timestamp, the time the
+ *       topology last replaced the server's description.
+ *
+ *       Does not use the topology's mutex, so a pool can check its idle
+ *       clients while holding its own locks.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_cluster_node_is_warm (mongoc_cluster_t *cluster,
+                             uint32_t server_id,
+                             int64_t server_timestamp)
+{
+   mongoc_cluster_node_t *cluster_node;
+
+   cluster_node =
+      (mongoc_cluster_node_t *) mongoc_set_get (cluster->nodes, server_id);
+
+   return cluster_node && cluster_node->timestamp >= server_timestamp;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_warm_node --
+ *
+ *       Connect and authenticate to @server_id ahead of an operation, so
+ *       the operation finds its stream ready. Called by a client pool's
+ *       warmer thread on an idle client. Like an operation's failure to
+ *       connect, a failure marks the server Unknown.
+ *
+ * Returns:
+ *       True if the node was already warm or has been connected.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_cluster_warm_node (mongoc_cluster_t *cluster,
+                          uint32_t server_id,
+                          bson_error_t *error /* OUT */)
+{
+   mongoc_topology_t *topology;
+   int64_t timestamp;
+
+   ENTRY;
+
+   topology = cluster->client->topology;
+   BSON_ASSERT (!topology->single_threaded);
+
+   timestamp = mongoc_topology_server_timestamp (topology, server_id);
+   if (timestamp == -1) {
+      /* removed from the topology */
+      RETURN (true);
+   }
+
+   if (mongoc_cluster_node_is_warm (cluster, server_id, timestamp)) {
+      RETURN (true);
+   }
+
+   /* out of date, if present */
+   mongoc_set_rm (cluster->nodes, server_id);
+
+   if (!_mongoc_cluster_add_node (cluster, server_id, error)) {
+      mongoc_topology_invalidate_server (topology, server_id, error);
+      RETURN (false);
+   }
+
+   RETURN (true);
+}
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -1869,10 +2478,14 @@ mongoc_cluster_init (mongoc_cluster_t *cluster,
    cluster->socketcheckintervalms = mongoc_uri_get_option_as_int32 (
       uri, "socketcheckintervalms", MONGOC_TOPOLOGY_SOCKET_CHECK_INTERVAL_MS);
 
+   cluster->zlib_compression_level = mongoc_uri_get_option_as_int32 (
+      uri, "zlibcompressionlevel", MONGOC_ZLIB_COMPRESSION_LEVEL_DEFAULT);
+
    /* TODO for single-threaded case we don't need this */
    cluster->nodes = mongoc_set_new (8, _mongoc_cluster_node_dtor, NULL);
 
    _mongoc_array_init (&cluster->iov, sizeof (mongoc_iovec_t));
+   _mongoc_arena_init (&cluster->arena);
 
    cluster->operation_id = rand ();
 
@@ -1908,6 +2521,7 @@ mongoc_cluster_destroy (mongoc_cluster_t *cluster) /* INOUT */
    mongoc_set_destroy (cluster->nodes);
 
    _mongoc_array_destroy (&cluster->iov);
+   _mongoc_arena_destroy (&cluster->arena);
 
    EXIT;
 }
@@ -1945,6 +2559,9 @@ _mongoc_cluster_stream_for_optype (mongoc_cluster_t *cluster,
 
    BSON_ASSERT (cluster);
 
+   /* a single-threaded client may check servers on the cursor's stream */
+   _mongoc_client_recv_prefetch (cluster->client);
+
    server_id =
       mongoc_topology_select_server_id (topology, optype, read_prefs, error);
 
@@ -2060,12 +2677,42 @@ _mongoc_cluster_inc_egress_rpc (const mongoc_rpc_t *rpc)
    case MONGOC_OPCODE_QUERY:
       mongoc_counter_op_egress_query_inc ();
       break;
+   case MONGOC_OPCODE_COMPRESSED:
+      mongoc_counter_op_egress_compressed_inc ();
+      break;
    default:
       BSON_ASSERT (false);
       break;
    }
 }
 
+
+/* record the time to send RPCs in the histogram for their opcode */
+static void
+_mongoc_cluster_record_egress_latency (int32_t opcode, int64_t usec)
+{
+   switch (opcode) {
+   case MONGOC_OPCODE_QUERY:
+      mongoc_histogram_op_egress_query_record (usec);
+      break;
+   case MONGOC_OPCODE_GET_MORE:
+      mongoc_histogram_op_egress_getmore_record (usec);
+      break;
+   case MONGOC_OPCODE_INSERT:
+      mongoc_histogram_op_egress_insert_record (usec);
+      break;
+   case MONGOC_OPCODE_UPDATE:
+      mongoc_histogram_op_egress_update_record (usec);
+      break;
+   case MONGOC_OPCODE_DELETE:
+      mongoc_histogram_op_egress_delete_record (usec);
+      break;
+   default:
+      mongoc_histogram_op_egress_other_record (usec);
+      break;
+   }
+}
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -2113,6 +2760,9 @@ _mongoc_cluster_inc_ingress_rpc (const mongoc_rpc_t *rpc)
    case MONGOC_OPCODE_QUERY:
       mongoc_counter_op_ingress_query_inc ();
       break;
+   case MONGOC_OPCODE_COMPRESSED:
+      mongoc_counter_op_ingress_compressed_inc ();
+      break;
    default:
       BSON_ASSERT (false);
       break;
@@ -2322,6 +2972,79 @@ _mongoc_cluster_check_interval (mongoc_cluster_t *cluster,
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_mark_node_used --
+ *
+ *       Record that the stream to @server_id was just used, so a
+ *       single-threaded client does not check it with "isMaster" before
+ *       socketCheckIntervalMS has passed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_cluster_mark_node_used (mongoc_cluster_t *cluster, uint32_t server_id)
+{
+   mongoc_topology_scanner_node_t *scanner_node;
+
+   if (cluster->client->topology->single_threaded) {
+      scanner_node = mongoc_topology_scanner_get_node (
+         cluster->client->topology->scanner, server_id);
+
+      if (scanner_node) {
+         scanner_node->last_used = bson_get_monotonic_time ();
+      }
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_gather_rpc --
+ *
+ *       Append @rpc to the cluster's iovec array, wrapped in OP_COMPRESSED
+ *       if @compressor_id is not -1. Falls back to sending @rpc as-is if
+ *       it cannot be compressed.
+ *
+ * Side effects:
+ *       Sets @rpc's msg_len. Buffers holding compressed messages are
+ *       appended to @compressed_bufs and must be freed by the caller once
+ *       the iovecs have been written.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_cluster_gather_rpc (mongoc_cluster_t *cluster,
+                            mongoc_rpc_t *rpc,
+                            int32_t compressor_id,
+                            mongoc_array_t *compressed_bufs)
+{
+   mongoc_iovec_t iov;
+   uint8_t *buf;
+   size_t len;
+
+   if (compressor_id != -1) {
+      buf = _mongoc_rpc_compress (
+         rpc, compressor_id, cluster->zlib_compression_level, &len);
+
+      if (buf) {
+         mongoc_counter_op_egress_compressed_inc ();
+         iov.iov_base = (void *) buf;
+         iov.iov_len = len;
+         _mongoc_array_append_val (&cluster->iov, iov);
+         _mongoc_array_append_val (compressed_bufs, buf);
+         return;
+      }
+   }
+
+   _mongoc_rpc_gather (rpc, &cluster->iov);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -2350,8 +3073,9 @@ mongoc_cluster_sendv_to_server (mongoc_cluster_t *cluster,
                                 bson_error_t *error)
 {
    uint32_t server_id;
+   int64_t started;
+   int32_t opcode;
    mongoc_iovec_t *iov;
-   mongoc_topology_scanner_node_t *scanner_node;
    const bson_t *b;
    mongoc_rpc_t gle;
    size_t iovcnt;
@@ -2359,6 +3083,10 @@ mongoc_cluster_sendv_to_server (mongoc_cluster_t *cluster,
    bool need_gle;
    char cmdname[140];
    int32_t max_msg_size;
+   int32_t compressor_id;
+   mongoc_array_t compressed_bufs;
+   mongoc_counter_slots_t *node_counters;
+   bool ret = false;
 
    ENTRY;
 
@@ -2367,7 +3095,10 @@ mongoc_cluster_sendv_to_server (mongoc_cluster_t *cluster,
    BSON_ASSERT (rpcs_len);
    BSON_ASSERT (server_stream);
 
+   started = bson_get_monotonic_time ();
    server_id = server_stream->sd->id;
+   /* before the rpcs are swabbed */
+   opcode = rpcs[0].header.opcode;
 
    if (cluster->client->in_exhaust) {
       bson_set_error (error,
@@ -2387,6 +3118,8 @@ mongoc_cluster_sendv_to_server (mongoc_cluster_t *cluster,
    }
 
    _mongoc_array_clear (&cluster->iov);
+   _mongoc_array_init (&compressed_bufs, sizeof (uint8_t *));
+   compressor_id = mongoc_server_description_compressor_id (server_stream->sd);
 
    /*
     * TODO: We can probably remove the need for sendv and just do send since
@@ -2398,7 +3131,8 @@ mongoc_cluster_sendv_to_server (mongoc_cluster_t *cluster,
    for (i = 0; i < rpcs_len; i++) {
       _mongoc_cluster_inc_egress_rpc (&rpcs[i]);
       need_gle = _mongoc_rpc_needs_gle (&rpcs[i], write_concern);
-      _mongoc_rpc_gather (&rpcs[i], &cluster->iov);
+      _mongoc_cluster_gather_rpc (
+         cluster, &rpcs[i], compressor_id, &compressed_bufs);
 
       max_msg_size = mongoc_server_stream_max_msg_size (server_stream);
 
@@ -2410,7 +3144,7 @@ mongoc_cluster_sendv_to_server (mongoc_cluster_t *cluster,
                          "max allowed message size. Was %u, allowed %u.",
                          rpcs[i].header.msg_len,
                          max_msg_size);
-         RETURN (false);
+         GOTO (done);
       }
 
       if (need_gle) {
@@ -2443,7 +3177,8 @@ mongoc_cluster_sendv_to_server (mongoc_cluster_t *cluster,
             (mongoc_write_concern_t *) write_concern);
          gle.query.query = bson_get_data (b);
          gle.query.fields = NULL;
-         _mongoc_rpc_gather (&gle, &cluster->iov);
+         _mongoc_cluster_gather_rpc (
+            cluster, &gle, compressor_id, &compressed_bufs);
          _mongoc_rpc_swab_to_le (&gle);
       }
 
@@ -2460,19 +3195,76 @@ mongoc_cluster_sendv_to_server (mongoc_cluster_t *cluster,
                                     iovcnt,
                                     cluster->sockettimeoutms,
                                     error)) {
-      RETURN (false);
+      GOTO (done);
    }
 
-   if (cluster->client->topology->single_threaded) {
-      scanner_node = mongoc_topology_scanner_get_node (
-         cluster->client->topology->scanner, server_id);
+   mongoc_cluster_mark_node_used (cluster, server_id);
+   _mongoc_cluster_record_egress_latency (
+      opcode, bson_get_monotonic_time () - started);
 
-      if (scanner_node) {
-         scanner_node->last_used = bson_get_monotonic_time ();
-      }
+   node_counters = _mongoc_cluster_node_counters (cluster, server_id);
+   _mongoc_node_counter_add (node_counters, MONGOC_NODE_COUNTER_OPS, 1);
+   _mongoc_node_counter_add (node_counters,
+                             MONGOC_NODE_COUNTER_BYTES_OUT,
+                             (int64_t) _mongoc_cluster_iov_len (iov, iovcnt));
+
+   ret = true;
+
+done:
+   for (i = 0; i < compressed_bufs.len; i++) {
+      bson_free (_mongoc_array_index (&compressed_bufs, uint8_t *, i));
    }
 
-   RETURN (true);
+   _mongoc_array_destroy (&compressed_bufs);
+
+   RETURN (ret);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_decompress_in_buffer --
+ *
+ *       Replace the OP_COMPRESSED message at offset @pos of @buffer, which
+ *       has been scattered into @rpc, with the message it carries and
+ *       scatter that into @rpc instead. @rpc is left little-endian.
+ *
+ * Returns:
+ *       true if successful.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_cluster_decompress_in_buffer (mongoc_rpc_t *rpc,
+                                      mongoc_buffer_t *buffer,
+                                      off_t pos,
+                                      int32_t max_msg_size)
+{
+   int32_t uncompressed_size;
+   uint8_t *buf;
+   size_t len;
+
+   uncompressed_size =
+      BSON_UINT32_FROM_LE (rpc->compressed.uncompressed_size);
+   if (uncompressed_size < 0 || uncompressed_size > max_msg_size - 16) {
+      return false;
+   }
+
+   len = (size_t) uncompressed_size + 16;
+   buf = bson_malloc (len);
+
+   if (!_mongoc_rpc_decompress (rpc, buf, len)) {
+      bson_free (buf);
+      return false;
+   }
+
+   buffer->len = (size_t) pos;
+   _mongoc_buffer_append (buffer, buf, len);
+   bson_free (buf);
+
+   return _mongoc_rpc_scatter (rpc, &buffer->data[buffer->off + pos], len);
 }
 
 
@@ -2507,6 +3299,7 @@ mongoc_cluster_try_recv (mongoc_cluster_t *cluster,
                          bson_error_t *error)
 {
    uint32_t server_id;
+   int64_t started;
    int32_t msg_len;
    int32_t max_msg_size;
    off_t pos;
@@ -2518,6 +3311,7 @@ mongoc_cluster_try_recv (mongoc_cluster_t *cluster,
    BSON_ASSERT (buffer);
    BSON_ASSERT (server_stream);
 
+   started = bson_get_monotonic_time ();
    server_id = server_stream->sd->id;
 
    TRACE ("Waiting for reply from server_id \"%u\"", server_id);
@@ -2577,9 +3371,29 @@ mongoc_cluster_try_recv (mongoc_cluster_t *cluster,
       RETURN (false);
    }
 
+   if (BSON_UINT32_FROM_LE (rpc->header.opcode) == MONGOC_OPCODE_COMPRESSED) {
+      mongoc_counter_op_ingress_compressed_inc ();
+
+      if (!_mongoc_cluster_decompress_in_buffer (
+             rpc, buffer, pos, max_msg_size)) {
+         bson_set_error (error,
+                         MONGOC_ERROR_PROTOCOL,
+                         MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                         "Could not decompress server reply.");
+         mongoc_cluster_disconnect_node (cluster, server_id);
+         mongoc_counter_protocol_ingress_error_inc ();
+         RETURN (false);
+      }
+   }
+
    _mongoc_rpc_swab_from_le (rpc);
 
    _mongoc_cluster_inc_ingress_rpc (rpc);
+   mongoc_cluster_mark_node_used (cluster, server_id);
+   mongoc_histogram_op_ingress_record (bson_get_monotonic_time () - started);
+   _mongoc_node_counter_add (_mongoc_cluster_node_counters (cluster, server_id),
+                             MONGOC_NODE_COUNTER_BYTES_IN,
+                             msg_len);
 
    RETURN (true);
 }
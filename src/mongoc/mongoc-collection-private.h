@@ -30,6 +30,10 @@
 BSON_BEGIN_DECLS
 
 
+/* the server's limit on parallelCollectionScan's numCursors */
+#define MONGOC_PARALLEL_SCAN_MAX_CURSORS 10000
+
+
 struct _mongoc_collection_t {
    mongoc_client_t *client;
    char ns[128];
@@ -353,6 +353,7 @@ mongoc_collection_aggregate (mongoc_collection_t *collection,       /* IN */
       /* will set slaveok bit if server is not mongos */
       mongoc_cursor_set_hint (cursor, server_id);
    } else {
+      _mongoc_client_recv_prefetch (collection->client);
       server_id =
          mongoc_topology_select_server_id (collection->client->topology,
                                            MONGOC_SS_READ,
@@ -2417,6 +2418,449 @@ mongoc_collection_stats (mongoc_collection_t *collection,
 }
 
 
+/* true if @error is the server rejecting a command, e.g. one it does not
+ * support, rather than a network or server selection error */
+static bool
+_mongoc_collection_is_command_error (const bson_error_t *error)
+{
+   return error->domain == MONGOC_ERROR_QUERY ||
+          error->domain == MONGOC_ERROR_SERVER;
+}
+
+
+static void
+_mongoc_collection_destroy_cursors (mongoc_cursor_t **cursors, size_t n)
+{
+   size_t i;
+
+   for (i = 0; i < n; i++) {
+      mongoc_cursor_destroy (cursors[i]);
+      cursors[i] = NULL;
+   }
+}
+
+
+/* open a cursor for each entry in the reply to parallelCollectionScan.
+ * returns false on a network error or an invalid reply; if the server
+ * rejects the command, returns true and sets @n_cursors to 0. */
+static bool
+_mongoc_collection_parallel_scan_cmd (mongoc_collection_t *collection,
+                                      mongoc_client_t **clients,
+                                      mongoc_cursor_t **cursors,
+                                      size_t max_cursors,
+                                      const mongoc_read_prefs_t *read_prefs,
+                                      uint32_t server_id,
+                                      size_t *n_cursors,
+                                      bson_error_t *error)
+{
+   mongoc_client_t *client;
+   bson_t cmd = BSON_INITIALIZER;
+   bson_t reply;
+   bson_t entry;
+   bson_iter_t iter;
+   bson_iter_t child;
+   const uint8_t *data;
+   uint32_t len;
+   bool ret = false;
+
+   ENTRY;
+
+   *n_cursors = 0;
+
+   BSON_APPEND_UTF8 (&cmd, "parallelCollectionScan", collection->collection);
+   BSON_APPEND_INT32 (&cmd, "numCursors", (int32_t) max_cursors);
+
+   if (!mongoc_client_command_simple_with_server_id (collection->client,
+                                                     collection->db,
+                                                     &cmd,
+                                                     read_prefs,
+                                                     server_id,
+                                                     &reply,
+                                                     error)) {
+      ret = _mongoc_collection_is_command_error (error);
+      GOTO (done);
+   }
+
+   if (!bson_iter_init_find (&iter, &reply, "cursors") ||
+       !BSON_ITER_HOLDS_ARRAY (&iter) || !bson_iter_recurse (&iter, &child)) {
+      GOTO (invalid);
+   }
+
+   while (*n_cursors < max_cursors && bson_iter_next (&child)) {
+      if (!BSON_ITER_HOLDS_DOCUMENT (&child)) {
+         GOTO (invalid);
+      }
+
+      bson_iter_document (&child, &len, &data);
+      if (!bson_init_static (&entry, data, len)) {
+         GOTO (invalid);
+      }
+
+      client = clients ? clients[*n_cursors] : collection->client;
+
+      /* takes ownership of the copy */
+      cursors[*n_cursors] = mongoc_cursor_new_from_command_reply (
+         client, bson_copy (&entry), server_id);
+
+      if (mongoc_cursor_error (cursors[(*n_cursors)++], error)) {
+         GOTO (fail);
+      }
+   }
+
+   ret = true;
+   GOTO (done);
+
+invalid:
+   bson_set_error (error,
+                   MONGOC_ERROR_CURSOR,
+                   MONGOC_ERROR_CURSOR_INVALID_CURSOR,
+                   "Invalid reply to parallelCollectionScan command.");
+
+fail:
+   _mongoc_collection_destroy_cursors (cursors, *n_cursors);
+   *n_cursors = 0;
+
+done:
+   bson_destroy (&reply);
+   bson_destroy (&cmd);
+
+   RETURN (ret);
+}
+
+
+/* find up to @max_cursors - 1 _id values that split the collection into
+ * ranges of similar size, with the splitVector command, and append copies
+ * of them to @split_keys as bson_value_t. returns false on a network error
+ * or an invalid reply; if the collection is empty or the server rejects
+ * the command, returns true and appends nothing. */
+static bool
+_mongoc_collection_split_keys (mongoc_collection_t *collection,
+                               const mongoc_read_prefs_t *read_prefs,
+                               uint32_t server_id,
+                               size_t max_cursors,
+                               mongoc_array_t *split_keys,
+                               bson_error_t *error)
+{
+   bson_t cmd = BSON_INITIALIZER;
+   bson_t reply;
+   bson_t key_pattern;
+   bson_iter_t iter;
+   bson_iter_t child;
+   bson_iter_t id_iter;
+   bson_value_t value;
+   int64_t size = 0;
+   size_t n_keys = 0;
+   size_t n_ranges;
+   size_t next_range;
+   size_t i;
+   bool ret = false;
+
+   ENTRY;
+
+   BSON_APPEND_UTF8 (&cmd, "collStats", collection->collection);
+
+   if (!mongoc_client_command_simple_with_server_id (collection->client,
+                                                     collection->db,
+                                                     &cmd,
+                                                     read_prefs,
+                                                     server_id,
+                                                     &reply,
+                                                     error)) {
+      ret = _mongoc_collection_is_command_error (error);
+      GOTO (done);
+   }
+
+   if (bson_iter_init_find (&iter, &reply, "size")) {
+      size = bson_iter_as_int64 (&iter);
+   }
+
+   if (size <= 0) {
+      ret = true;
+      GOTO (done);
+   }
+
+   bson_destroy (&reply);
+   bson_reinit (&cmd);
+
+   BSON_APPEND_UTF8 (&cmd, "splitVector", collection->ns);
+   BSON_APPEND_DOCUMENT_BEGIN (&cmd, "keyPattern", &key_pattern);
+   BSON_APPEND_INT32 (&key_pattern, "_id", 1);
+   bson_append_document_end (&cmd, &key_pattern);
+   BSON_APPEND_INT64 (
+      &cmd, "maxChunkSizeBytes", BSON_MAX (size / (int64_t) max_cursors, 1));
+
+   if (!mongoc_client_command_simple_with_server_id (collection->client,
+                                                     collection->db,
+                                                     &cmd,
+                                                     read_prefs,
+                                                     server_id,
+                                                     &reply,
+                                                     error)) {
+      ret = _mongoc_collection_is_command_error (error);
+      GOTO (done);
+   }
+
+   if (!bson_iter_init_find (&iter, &reply, "splitKeys") ||
+       !BSON_ITER_HOLDS_ARRAY (&iter) || !bson_iter_recurse (&iter, &child)) {
+      GOTO (invalid);
+   }
+
+   while (bson_iter_next (&child)) {
+      n_keys++;
+   }
+
+   /* splitVector makes chunks smaller than maxChunkSizeBytes, so there may
+    * be more keys than we need: take evenly spaced ones */
+   n_ranges = BSON_MIN (max_cursors, n_keys + 1);
+   next_range = 1;
+
+   BSON_ASSERT (bson_iter_recurse (&iter, &child));
+
+   for (i = 0; next_range < n_ranges && bson_iter_next (&child); i++) {
+      if (i != next_range * (n_keys + 1) / n_ranges - 1) {
+         continue;
+      }
+
+      if (!BSON_ITER_HOLDS_DOCUMENT (&child) ||
+          !bson_iter_recurse (&child, &id_iter) ||
+          !bson_iter_find (&id_iter, "_id")) {
+         GOTO (invalid);
+      }
+
+      bson_value_copy (bson_iter_value (&id_iter), &value);
+      _mongoc_array_append_val (split_keys, value);
+      next_range++;
+   }
+
+   ret = true;
+   GOTO (done);
+
+invalid:
+   bson_set_error (error,
+                   MONGOC_ERROR_COMMAND,
+                   MONGOC_ERROR_COMMAND_INVALID_ARG,
+                   "Invalid reply to splitVector command.");
+
+done:
+   bson_destroy (&reply);
+   bson_destroy (&cmd);
+
+   RETURN (ret);
+}
+
+
+/* open a find cursor on each range of _id values between @split_keys. the
+ * ranges use "min" and "max" on the _id index, not $gte and $lt, so that
+ * documents whose _id types differ from the split keys' are not skipped */
+static size_t
+_mongoc_collection_range_cursors (mongoc_collection_t *collection,
+                                  mongoc_client_t **clients,
+                                  mongoc_cursor_t **cursors,
+                                  const mongoc_read_prefs_t *read_prefs,
+                                  uint32_t server_id,
+                                  mongoc_array_t *split_keys)
+{
+   mongoc_collection_t *coll;
+   bson_t filter = BSON_INITIALIZER;
+   bson_t opts;
+   bson_t child;
+   const bson_value_t *key;
+   size_t n_ranges;
+   size_t i;
+
+   n_ranges = split_keys->len + 1;
+
+   for (i = 0; i < n_ranges; i++) {
+      bson_init (&opts);
+      BSON_APPEND_INT32 (&opts, "serverId", (int32_t) server_id);
+
+      if (n_ranges > 1) {
+         BSON_APPEND_DOCUMENT_BEGIN (&opts, "hint", &child);
+         BSON_APPEND_INT32 (&child, "_id", 1);
+         bson_append_document_end (&opts, &child);
+      }
+
+      if (i > 0) {
+         key = &_mongoc_array_index (split_keys, bson_value_t, i - 1);
+         BSON_APPEND_DOCUMENT_BEGIN (&opts, "min", &child);
+         BSON_APPEND_VALUE (&child, "_id", key);
+         bson_append_document_end (&opts, &child);
+      }
+
+      if (i < n_ranges - 1) {
+         key = &_mongoc_array_index (split_keys, bson_value_t, i);
+         BSON_APPEND_DOCUMENT_BEGIN (&opts, "max", &child);
+         BSON_APPEND_VALUE (&child, "_id", key);
+         bson_append_document_end (&opts, &child);
+      }
+
+      if (clients) {
+         coll = mongoc_client_get_collection (
+            clients[i], collection->db, collection->collection);
+         mongoc_collection_set_read_concern (coll, collection->read_concern);
+      } else {
+         coll = collection;
+      }
+
+      cursors[i] =
+         mongoc_collection_find_with_opts (coll, &filter, &opts, read_prefs);
+
+      if (coll != collection) {
+         mongoc_collection_destroy (coll);
+      }
+
+      bson_destroy (&opts);
+   }
+
+   bson_destroy (&filter);
+
+   return n_ranges;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_collection_parallel_scan --
+ *
+ *       Open up to @max_cursors cursors that together return each document
+ *       in @collection once, so a full collection scan can be spread over
+ *       several threads.
+ *
+ *       The "parallelCollectionScan" command is tried first. If the server
+ *       returns fewer cursors than requested (WiredTiger always returns
+ *       one) or does not support the command, the collection is split
+ *       into _id ranges with "splitVector" and each range is read with a
+ *       find command. If that fails too, one cursor reads the whole
+ *       collection.
+ *
+ *       All cursors read from the same server. Cursor i is created with
+ *       @clients[i], if @clients is not NULL, so that it can be iterated
+ *       on the thread that popped that client from the pool.
+ *
+ * Parameters:
+ *       @collection: A mongoc_collection_t.
+ *       @clients: NULL, or @max_cursors clients from the same
+ *                 mongoc_client_pool_t as @collection's client.
+ *       @cursors: An array of at least @max_cursors cursor pointers.
+ *       @max_cursors: The number of cursors to request, 1 to 10000.
+ *       @read_prefs: A read preference, or NULL for @collection's.
+ *       @error: A location for an error or NULL.
+ *
+ * Returns:
+ *       The number of cursors stored in @cursors. The caller must destroy
+ *       each with mongoc_cursor_destroy. Returns 0 on failure and sets
+ *       @error.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+size_t
+mongoc_collection_parallel_scan (mongoc_collection_t *collection,
+                                 mongoc_client_t **clients,
+                                 mongoc_cursor_t **cursors,
+                                 size_t max_cursors,
+                                 const mongoc_read_prefs_t *read_prefs,
+                                 bson_error_t *error)
+{
+   mongoc_server_description_t *sd;
+   mongoc_array_t split_keys;
+   bson_error_t local_error;
+   uint32_t server_id;
+   size_t n_cursors = 0;
+   size_t i;
+
+   ENTRY;
+
+   BSON_ASSERT (collection);
+   BSON_ASSERT (cursors);
+
+   if (max_cursors < 1 || max_cursors > MONGOC_PARALLEL_SCAN_MAX_CURSORS) {
+      bson_set_error (error,
+                      MONGOC_ERROR_COMMAND,
+                      MONGOC_ERROR_COMMAND_INVALID_ARG,
+                      "max_cursors must be from 1 to %d.",
+                      MONGOC_PARALLEL_SCAN_MAX_CURSORS);
+      RETURN (0);
+   }
+
+   for (i = 0; clients && i < max_cursors; i++) {
+      if (!clients[i] ||
+          clients[i]->topology != collection->client->topology) {
+         bson_set_error (error,
+                         MONGOC_ERROR_COMMAND,
+                         MONGOC_ERROR_COMMAND_INVALID_ARG,
+                         "Each client must be from the same client pool as"
+                         " the collection's client.");
+         RETURN (0);
+      }
+   }
+
+   if (!read_prefs) {
+      read_prefs = collection->read_prefs;
+   }
+
+   sd = mongoc_client_select_server (
+      collection->client, false /* for_writes */, read_prefs, error);
+   if (!sd) {
+      RETURN (0);
+   }
+
+   server_id = mongoc_server_description_id (sd);
+   mongoc_server_description_destroy (sd);
+
+   _mongoc_array_init (&split_keys, sizeof (bson_value_t));
+
+   if (!_mongoc_collection_parallel_scan_cmd (collection,
+                                              clients,
+                                              cursors,
+                                              max_cursors,
+                                              read_prefs,
+                                              server_id,
+                                              &n_cursors,
+                                              &local_error)) {
+      GOTO (fail);
+   }
+
+   if (n_cursors < max_cursors) {
+      if (!_mongoc_collection_split_keys (collection,
+                                          read_prefs,
+                                          server_id,
+                                          max_cursors,
+                                          &split_keys,
+                                          &local_error)) {
+         _mongoc_collection_destroy_cursors (cursors, n_cursors);
+         n_cursors = 0;
+         GOTO (fail);
+      }
+
+      /* prefer the ranges if there are more of them than cursors. if there
+       * are neither, this opens one cursor on the whole collection */
+      if (split_keys.len + 1 > n_cursors) {
+         _mongoc_collection_destroy_cursors (cursors, n_cursors);
+         n_cursors = _mongoc_collection_range_cursors (
+            collection, clients, cursors, read_prefs, server_id, &split_keys);
+      }
+   }
+
+   GOTO (done);
+
+fail:
+   if (error) {
+      memcpy (error, &local_error, sizeof *error);
+   }
+
+done:
+   for (i = 0; i < split_keys.len; i++) {
+      bson_value_destroy (&_mongoc_array_index (&split_keys, bson_value_t, i));
+   }
+
+   _mongoc_array_destroy (&split_keys);
+
+   RETURN (n_cursors);
+}
+
+
 mongoc_bulk_operation_t *
 mongoc_collection_create_bulk_operation (
    mongoc_collection_t *collection,
@@ -231,6 +231,13 @@ mongoc_collection_stats (mongoc_collection_t *collection,
                          const bson_t *options,
                          bson_t *reply,
                          bson_error_t *error);
+BSON_EXPORT (size_t)
+mongoc_collection_parallel_scan (mongoc_collection_t *collection,
+                                 struct _mongoc_client_t **clients,
+                                 mongoc_cursor_t **cursors,
+                                 size_t max_cursors,
+                                 const mongoc_read_prefs_t *read_prefs,
+                                 bson_error_t *error);
 BSON_EXPORT (mongoc_bulk_operation_t *)
 mongoc_collection_create_bulk_operation (
    mongoc_collection_t *collection,
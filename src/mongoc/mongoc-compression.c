@@ -0,0 +1,378 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mongoc-compression-private.h"
+#include "mongoc-trace-private.h"
+#include "mongoc-util-private.h"
+
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+#include <snappy-c.h>
+#endif
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+#include <zlib.h>
+#endif
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "compression"
+
+
+/*
+ * Commands whose bodies must never be compressed, since they either
+ * negotiate compression or carry credentials.
+ */
+static const char *gUncompressibleCommands[] = {
+   "ismaster",
+   "saslstart",
+   "saslcontinue",
+   "getnonce",
+   "authenticate",
+   "createuser",
+   "updateuser",
+   "copydbsaslstart",
+   "copydbgetnonce",
+   "copydb",
+   NULL,
+};
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_compressor_supported --
+ *
+ *       Check whether @compressor names a compressor this build of the
+ *       driver can negotiate with a server.
+ *
+ * Returns:
+ *       true if the compressor is available.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_compressor_supported (const char *compressor)
+{
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+   if (!strcasecmp (compressor, MONGOC_COMPRESSOR_SNAPPY_STR)) {
+      return true;
+   }
+#endif
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   if (!strcasecmp (compressor, MONGOC_COMPRESSOR_ZLIB_STR)) {
+      return true;
+   }
+#endif
+
+   return false;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_compressor_append_to_ismaster --
+ *
+ *       Offer the URI's @compressors, as returned by
+ *       mongoc_uri_get_compressors (), to the server by appending a
+ *       "compression" array to the isMaster command @cmd. Nothing is
+ *       appended if no compressors are configured.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_compressor_append_to_ismaster (bson_t *cmd, const bson_t *compressors)
+{
+   bson_iter_t iter;
+   bson_t array;
+   const char *key;
+   char keybuf[16];
+   uint32_t i = 0;
+
+   BSON_ASSERT (cmd);
+
+   if (!compressors || bson_empty (compressors) ||
+       !bson_iter_init (&iter, compressors)) {
+      return;
+   }
+
+   BSON_APPEND_ARRAY_BEGIN (cmd, "compression", &array);
+   while (bson_iter_next (&iter)) {
+      bson_uint32_to_string (i++, &key, keybuf, sizeof keybuf);
+      BSON_APPEND_UTF8 (&array, key, bson_iter_key (&iter));
+   }
+   bson_append_array_end (cmd, &array);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_compressor_name_to_id --
+ *
+ *       Translate a compressor name to its wire protocol id.
+ *
+ * Returns:
+ *       The compressor id, or -1 if @compressor is unknown.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+int32_t
+_mongoc_compressor_name_to_id (const char *compressor)
+{
+   if (!strcasecmp (compressor, MONGOC_COMPRESSOR_SNAPPY_STR)) {
+      return MONGOC_COMPRESSOR_SNAPPY_ID;
+   } else if (!strcasecmp (compressor, MONGOC_COMPRESSOR_ZLIB_STR)) {
+      return MONGOC_COMPRESSOR_ZLIB_ID;
+   } else if (!strcasecmp (compressor, MONGOC_COMPRESSOR_NOOP_STR)) {
+      return MONGOC_COMPRESSOR_NOOP_ID;
+   }
+
+   return -1;
+}
+
+
+const char *
+_mongoc_compressor_id_to_name (int32_t compressor_id)
+{
+   switch (compressor_id) {
+   case MONGOC_COMPRESSOR_SNAPPY_ID:
+      return MONGOC_COMPRESSOR_SNAPPY_STR;
+   case MONGOC_COMPRESSOR_ZLIB_ID:
+      return MONGOC_COMPRESSOR_ZLIB_STR;
+   case MONGOC_COMPRESSOR_NOOP_ID:
+      return MONGOC_COMPRESSOR_NOOP_STR;
+   default:
+      return "unknown";
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_compressor_max_compressed_length --
+ *
+ *       The size of the buffer the caller must provide to _mongoc_compress
+ *       to compress @len bytes with @compressor_id.
+ *
+ * Returns:
+ *       The worst-case compressed size, or 0 if the compressor is not
+ *       available.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+size_t
+_mongoc_compressor_max_compressed_length (int32_t compressor_id, size_t len)
+{
+   switch (compressor_id) {
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+   case MONGOC_COMPRESSOR_SNAPPY_ID:
+      return snappy_max_compressed_length (len);
+#endif
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   case MONGOC_COMPRESSOR_ZLIB_ID:
+      return compressBound ((uLong) len);
+#endif
+
+   case MONGOC_COMPRESSOR_NOOP_ID:
+      return len;
+   default:
+      return 0;
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_compressor_command_is_compressible --
+ *
+ *       Commands that take part in the handshake or in authentication
+ *       are always sent uncompressed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_compressor_command_is_compressible (const char *command_name)
+{
+   const char **name;
+
+   if (!command_name) {
+      return true;
+   }
+
+   for (name = gUncompressibleCommands; *name; name++) {
+      if (!strcasecmp (command_name, *name)) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_compress --
+ *
+ *       Compress @uncompressed into @compressed, which must be at least
+ *       _mongoc_compressor_max_compressed_length () bytes.
+ *       @compressed_len is the size of @compressed on input and the number
+ *       of bytes written on output.
+ *
+ * Returns:
+ *       true if successful.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_compress (int32_t compressor_id,
+                  int32_t compression_level,
+                  const uint8_t *uncompressed,
+                  size_t uncompressed_len,
+                  uint8_t *compressed,
+                  size_t *compressed_len)
+{
+   BSON_ASSERT (uncompressed);
+   BSON_ASSERT (compressed);
+   BSON_ASSERT (compressed_len);
+
+   TRACE ("compressing %zu bytes with %s",
+          uncompressed_len,
+          _mongoc_compressor_id_to_name (compressor_id));
+
+   switch (compressor_id) {
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+   case MONGOC_COMPRESSOR_SNAPPY_ID:
+      return SNAPPY_OK == snappy_compress ((const char *) uncompressed,
+                                           uncompressed_len,
+                                           (char *) compressed,
+                                           compressed_len);
+#endif
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   case MONGOC_COMPRESSOR_ZLIB_ID: {
+      uLongf len = (uLongf) *compressed_len;
+      bool ok;
+
+      ok = Z_OK == compress2 ((Bytef *) compressed,
+                              &len,
+                              (const Bytef *) uncompressed,
+                              (uLong) uncompressed_len,
+                              compression_level);
+      *compressed_len = (size_t) len;
+      return ok;
+   }
+#endif
+
+   case MONGOC_COMPRESSOR_NOOP_ID:
+      if (*compressed_len < uncompressed_len) {
+         return false;
+      }
+      memcpy (compressed, uncompressed, uncompressed_len);
+      *compressed_len = uncompressed_len;
+      return true;
+   default:
+      return false;
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_uncompress --
+ *
+ *       Decompress @compressed into @uncompressed. @uncompressed_len is the
+ *       size of @uncompressed on input and the number of bytes written on
+ *       output.
+ *
+ * Returns:
+ *       true if successful.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_uncompress (int32_t compressor_id,
+                    const uint8_t *compressed,
+                    size_t compressed_len,
+                    uint8_t *uncompressed,
+                    size_t *uncompressed_len)
+{
+   BSON_ASSERT (compressed);
+   BSON_ASSERT (uncompressed);
+   BSON_ASSERT (uncompressed_len);
+
+   TRACE ("uncompressing %zu bytes with %s",
+          compressed_len,
+          _mongoc_compressor_id_to_name (compressor_id));
+
+   switch (compressor_id) {
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+   case MONGOC_COMPRESSOR_SNAPPY_ID: {
+      size_t len;
+
+      if (SNAPPY_OK != snappy_uncompressed_length (
+                          (const char *) compressed, compressed_len, &len) ||
+          len > *uncompressed_len) {
+         return false;
+      }
+
+      return SNAPPY_OK == snappy_uncompress ((const char *) compressed,
+                                             compressed_len,
+                                             (char *) uncompressed,
+                                             uncompressed_len);
+   }
+#endif
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   case MONGOC_COMPRESSOR_ZLIB_ID: {
+      uLongf len = (uLongf) *uncompressed_len;
+      bool ok;
+
+      ok = Z_OK == uncompress ((Bytef *) uncompressed,
+                               &len,
+                               (const Bytef *) compressed,
+                               (uLong) compressed_len);
+      *uncompressed_len = (size_t) len;
+      return ok;
+   }
+#endif
+
+   case MONGOC_COMPRESSOR_NOOP_ID:
+      if (*uncompressed_len < compressed_len) {
+         return false;
+      }
+      memcpy (uncompressed, compressed, compressed_len);
+      *uncompressed_len = compressed_len;
+      return true;
+   default:
+      MONGOC_WARNING ("Unknown compressor ID: %d", compressor_id);
+      return false;
+   }
+}
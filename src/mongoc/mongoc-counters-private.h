@@ -158,6 +158,118 @@ enum {
 #undef COUNTER
 
 
+/* latencies in microseconds are counted in log-scaled buckets: values below
+ * 4 have their own buckets, and each power of two above is split into 4
+ * buckets. the last bucket also counts anything larger. */
+#define MONGOC_HISTOGRAM_N_BUCKETS 112
+
+
+typedef struct {
+   int64_t buckets[MONGOC_HISTOGRAM_N_BUCKETS];
+} mongoc_histogram_slots_t;
+
+
+BSON_STATIC_ASSERT (sizeof (mongoc_histogram_slots_t) % 64 == 0);
+
+
+typedef struct {
+   mongoc_histogram_slots_t *cpus;
+} mongoc_histogram_t;
+
+
+static BSON_INLINE uint32_t
+_mongoc_histogram_bucket (int64_t usec)
+{
+   uint64_t v;
+   uint32_t log2;
+   uint32_t bucket;
+
+   if (usec < 4) {
+      return usec < 0 ? 0 : (uint32_t) usec;
+   }
+
+   v = (uint64_t) usec;
+#if defined(__GNUC__)
+   log2 = 63 - (uint32_t) __builtin_clzll (v);
+#else
+   for (log2 = 2; (v >> (log2 + 1)) != 0; log2++) {
+   }
+#endif
+
+   /* the two bits after the leading one choose the quarter */
+   bucket = 4 * (log2 - 1) + (uint32_t) ((v >> (log2 - 2)) & 3);
+
+   return BSON_MIN (bucket, MONGOC_HISTOGRAM_N_BUCKETS - 1);
+}
+
+
+#define HISTOGRAM(ident, Category, Name, Description) \
+   extern mongoc_histogram_t __mongoc_histogram_##ident;
+#include "mongoc-histograms.defs"
+#undef HISTOGRAM
+
+
+enum {
+#define HISTOGRAM(ident, Category, Name, Description) HISTOGRAM_##ident,
+#include "mongoc-histograms.defs"
+#undef HISTOGRAM
+   LAST_HISTOGRAM
+};
+
+
+#define HISTOGRAM(ident, Category, Name, Description)                     \
+   static BSON_INLINE void mongoc_histogram_##ident##_record (int64_t usec) \
+   {                                                                      \
+      _mongoc_counter_add (                                               \
+         __mongoc_histogram_##ident.cpus[_mongoc_sched_getcpu ()]         \
+            .buckets[_mongoc_histogram_bucket (usec)],                    \
+         1);                                                              \
+   }
+#include "mongoc-histograms.defs"
+#undef HISTOGRAM
+
+
+/* each server's counters are in one cache line per CPU, like a group of
+ * process-wide counters */
+typedef enum {
+   MONGOC_NODE_COUNTER_STREAMS,
+   MONGOC_NODE_COUNTER_BYTES_IN,
+   MONGOC_NODE_COUNTER_BYTES_OUT,
+   MONGOC_NODE_COUNTER_OPS,
+   MONGOC_NODE_COUNTER_ERRORS,
+   MONGOC_NODE_COUNTER_LAST
+} mongoc_node_counter_t;
+
+
+BSON_STATIC_ASSERT (MONGOC_NODE_COUNTER_LAST <= SLOTS_PER_CACHELINE);
+
+
+/* the default number of servers with counters, override it with the
+ * MONGOC_SHM_NODES environment variable */
+#define MONGOC_DEFAULT_SHM_NODES 64
+
+
+mongoc_counter_slots_t *
+_mongoc_node_counters_get (const char *host_and_port);
+
+/* @node is from _mongoc_node_counters_get, or NULL */
+void
+_mongoc_node_counters_set_rtt (mongoc_counter_slots_t *node, int64_t rtt_msec);
+
+
+/* @node is from _mongoc_node_counters_get, it is NULL if the table is
+ * full */
+static BSON_INLINE void
+_mongoc_node_counter_add (mongoc_counter_slots_t *node,
+                          mongoc_node_counter_t which,
+                          int64_t val)
+{
+   if (node) {
+      _mongoc_counter_add (node[_mongoc_sched_getcpu ()].slots[which], val);
+   }
+}
+
+
 BSON_END_DECLS
 
 
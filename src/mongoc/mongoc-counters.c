@@ -33,6 +33,7 @@
 
 #include "mongoc-counters-private.h"
 #include "mongoc-log.h"
+#include "mongoc-thread-private.h"
 
 
 #pragma pack(1)
@@ -56,14 +57,39 @@ typedef struct {
    uint32_t n_counters;
    uint32_t infos_offset;
    uint32_t values_offset;
-   uint8_t padding[44];
+   uint32_t n_histograms;
+   uint32_t histogram_infos_offset;
+   uint32_t histograms_offset;
+   uint32_t n_nodes;
+   uint32_t max_nodes;
+   uint32_t node_infos_offset;
+   uint32_t node_values_offset;
+   uint8_t padding[16];
 } mongoc_counters_t;
 #pragma pack()
 
 
 BSON_STATIC_ASSERT (sizeof (mongoc_counters_t) == 64);
 
+
+/* a server's counters, claimed the first time the server is seen. "host"
+ * is its truncated "host:port" and "offset" is where its per-CPU counters
+ * are, see mongoc_node_counter_t. */
+#pragma pack(1)
+typedef struct {
+   uint32_t offset;
+   uint32_t padding;
+   int64_t rtt_msec;
+   char host[112];
+} mongoc_node_counter_info_t;
+#pragma pack()
+
+
+BSON_STATIC_ASSERT (sizeof (mongoc_node_counter_info_t) == 128);
+
 static void *gCounterFallback = NULL;
+static mongoc_counters_t *gCounters = NULL;
+static mongoc_mutex_t gNodesMutex;
 
 
 #define COUNTER(ident, Category, Name, Description) \
@@ -72,6 +98,12 @@ static void *gCounterFallback = NULL;
 #undef COUNTER
 
 
+#define HISTOGRAM(ident, Category, Name, Description) \
+   mongoc_histogram_t __mongoc_histogram_##ident;
+#include "mongoc-histograms.defs"
+#undef HISTOGRAM
+
+
 /**
  * mongoc_counters_use_shm:
  *
@@ -88,6 +120,32 @@ mongoc_counters_use_shm (void)
 #endif
 
 
+/**
+ * mongoc_counters_max_nodes:
+ *
+ * Returns: The number of servers that can have counters, from the
+ * MONGOC_SHM_NODES environment variable or the default.
+ */
+static size_t
+mongoc_counters_max_nodes (void)
+{
+   const char *env;
+   long n;
+
+   env = getenv ("MONGOC_SHM_NODES");
+   if (env) {
+      n = strtol (env, NULL, 10);
+      if (n >= 0 && n <= 4096) {
+         return (size_t) n;
+      }
+
+      MONGOC_WARNING ("Invalid MONGOC_SHM_NODES \"%s\"", env);
+   }
+
+   return MONGOC_DEFAULT_SHM_NODES;
+}
+
+
 /**
  * mongoc_counters_calc_size:
  *
@@ -98,7 +156,7 @@ mongoc_counters_use_shm (void)
  * Returns: The number of bytes required.
  */
 static size_t
-mongoc_counters_calc_size (void)
+mongoc_counters_calc_size (size_t max_nodes)
 {
    size_t n_cpu;
    size_t n_groups;
@@ -108,7 +166,11 @@ mongoc_counters_calc_size (void)
    n_groups = (LAST_COUNTER / SLOTS_PER_CACHELINE) + 1;
    size = (sizeof (mongoc_counters_t) +
            (LAST_COUNTER * sizeof (mongoc_counter_info_t)) +
-           (n_cpu * n_groups * sizeof (mongoc_counter_slots_t)));
+           (LAST_HISTOGRAM * sizeof (mongoc_counter_info_t)) +
+           (max_nodes * sizeof (mongoc_node_counter_info_t)) +
+           (n_cpu * n_groups * sizeof (mongoc_counter_slots_t)) +
+           (n_cpu * LAST_HISTOGRAM * sizeof (mongoc_histogram_slots_t)) +
+           (n_cpu * max_nodes * sizeof (mongoc_counter_slots_t)));
 
 #ifdef BSON_OS_UNIX
    return BSON_MAX (getpagesize (), size);
@@ -126,6 +188,9 @@ mongoc_counters_calc_size (void)
 void
 _mongoc_counters_cleanup (void)
 {
+   gCounters = NULL;
+   mongoc_mutex_destroy (&gNodesMutex);
+
    if (gCounterFallback) {
       bson_free (gCounterFallback);
       gCounterFallback = NULL;
@@ -268,6 +333,58 @@ mongoc_counters_register (mongoc_counters_t *counters,
 }
 
 
+/**
+ * mongoc_counters_register_histogram:
+ * @counters: A mongoc_counter_t.
+ * @num: The histogram number.
+ * @category: The histogram category.
+ * @name: The histogram name.
+ * @description The histogram description.
+ *
+ * Like mongoc_counters_register, for a histogram. Its info's "slot" is the
+ * number of buckets, and each CPU's buckets follow the previous CPU's.
+ *
+ * Returns: The offset to the histogram's buckets.
+ */
+static size_t
+mongoc_counters_register_histogram (mongoc_counters_t *counters,
+                                    uint32_t num,
+                                    const char *category,
+                                    const char *name,
+                                    const char *description)
+{
+   mongoc_counter_info_t *infos;
+   char *segment;
+   int n_cpu;
+
+   BSON_ASSERT (counters);
+   BSON_ASSERT (category);
+   BSON_ASSERT (name);
+   BSON_ASSERT (description);
+
+   n_cpu = _mongoc_get_cpu_count ();
+   segment = (char *) counters;
+
+   infos =
+      (mongoc_counter_info_t *) (segment + counters->histogram_infos_offset);
+   infos = &infos[counters->n_histograms];
+   infos->slot = MONGOC_HISTOGRAM_N_BUCKETS;
+   infos->offset = (counters->histograms_offset +
+                    (num * n_cpu * sizeof (mongoc_histogram_slots_t)));
+
+   bson_strncpy (infos->category, category, sizeof infos->category);
+   bson_strncpy (infos->name, name, sizeof infos->name);
+   bson_strncpy (infos->description, description, sizeof infos->description);
+
+   /* as in mongoc_counters_register */
+   bson_memory_barrier ();
+
+   counters->n_histograms++;
+
+   return infos->offset;
+}
+
+
 /**
  * mongoc_counters_init:
  *
@@ -280,21 +397,46 @@ _mongoc_counters_init (void)
    mongoc_counter_info_t *info;
    mongoc_counters_t *counters;
    size_t infos_size;
+   size_t histogram_infos_size;
+   size_t node_infos_size;
+   size_t max_nodes;
+   size_t n_groups;
    size_t off;
    size_t size;
    char *segment;
 
-   size = mongoc_counters_calc_size ();
+   max_nodes = mongoc_counters_max_nodes ();
+   size = mongoc_counters_calc_size (max_nodes);
    segment = (char *) mongoc_counters_alloc (size);
    infos_size = LAST_COUNTER * sizeof *info;
+   histogram_infos_size = LAST_HISTOGRAM * sizeof *info;
+   node_infos_size = max_nodes * sizeof (mongoc_node_counter_info_t);
+   n_groups = (LAST_COUNTER / SLOTS_PER_CACHELINE) + 1;
 
    counters = (mongoc_counters_t *) segment;
    counters->n_cpu = _mongoc_get_cpu_count ();
    counters->n_counters = 0;
+   counters->n_histograms = 0;
+   counters->n_nodes = 0;
+   counters->max_nodes = (uint32_t) max_nodes;
    counters->infos_offset = sizeof *counters;
-   counters->values_offset = (uint32_t) (counters->infos_offset + infos_size);
+   counters->histogram_infos_offset =
+      (uint32_t) (counters->infos_offset + infos_size);
+   counters->node_infos_offset =
+      (uint32_t) (counters->histogram_infos_offset + histogram_infos_size);
+   counters->values_offset =
+      (uint32_t) (counters->node_infos_offset + node_infos_size);
+   counters->histograms_offset =
+      (uint32_t) (counters->values_offset +
+                  counters->n_cpu * n_groups * sizeof (mongoc_counter_slots_t));
+   counters->node_values_offset =
+      (uint32_t) (counters->histograms_offset +
+                  counters->n_cpu * LAST_HISTOGRAM *
+                     sizeof (mongoc_histogram_slots_t));
 
    BSON_ASSERT ((counters->values_offset % 64) == 0);
+   BSON_ASSERT ((counters->histograms_offset % 64) == 0);
+   BSON_ASSERT ((counters->node_values_offset % 64) == 0);
 
 #define COUNTER(ident, Category, Name, Desc)            \
    off = mongoc_counters_register (                     \
@@ -303,6 +445,14 @@ _mongoc_counters_init (void)
 #include "mongoc-counters.defs"
 #undef COUNTER
 
+#define HISTOGRAM(ident, Category, Name, Desc)              \
+   off = mongoc_counters_register_histogram (               \
+      counters, HISTOGRAM_##ident, Category, Name, Desc);   \
+   __mongoc_histogram_##ident.cpus =                        \
+      (mongoc_histogram_slots_t *) (segment + off);
+#include "mongoc-histograms.defs"
+#undef HISTOGRAM
+
    /*
     * NOTE:
     *
@@ -312,4 +462,141 @@ _mongoc_counters_init (void)
     */
    bson_memory_barrier ();
    counters->size = (uint32_t) size;
+
+   mongoc_mutex_init (&gNodesMutex);
+   gCounters = counters;
+}
+
+
+/* the claimed server named @host, or NULL */
+static mongoc_node_counter_info_t *
+mongoc_counters_find_node (const char *host)
+{
+   mongoc_node_counter_info_t *infos;
+   uint32_t n_nodes;
+   uint32_t i;
+
+   infos = (mongoc_node_counter_info_t *) ((char *) gCounters +
+                                           gCounters->node_infos_offset);
+
+   /* a server is visible once its info is complete, see below */
+   n_nodes = gCounters->n_nodes;
+   bson_memory_barrier ();
+
+   for (i = 0; i < n_nodes; i++) {
+      if (!strcmp (infos[i].host, host)) {
+         return &infos[i];
+      }
+   }
+
+   return NULL;
+}
+
+
+/**
+ * mongoc_counters_get_node:
+ * @host_and_port: A server's "host:port".
+ *
+ * Finds the server's counters, or claims the next free ones. Servers keep
+ * their counters until the process exits, so the table shows servers that
+ * have been removed from the topology, and a client that reconnects to a
+ * server uses the same counters.
+ *
+ * Returns: The server's info, or NULL if the table is full.
+ */
+static mongoc_node_counter_info_t *
+mongoc_counters_get_node (const char *host_and_port)
+{
+   mongoc_node_counter_info_t *info;
+   mongoc_node_counter_info_t *infos;
+   char host[sizeof info->host];
+   uint32_t n;
+
+   BSON_ASSERT (host_and_port);
+
+   if (!gCounters) {
+      return NULL;
+   }
+
+   bson_strncpy (host, host_and_port, sizeof host);
+
+   if ((info = mongoc_counters_find_node (host))) {
+      return info;
+   }
+
+   mongoc_mutex_lock (&gNodesMutex);
+
+   /* another thread may have claimed it */
+   info = mongoc_counters_find_node (host);
+
+   if (!info && gCounters->n_nodes < gCounters->max_nodes) {
+      n = gCounters->n_nodes;
+      infos = (mongoc_node_counter_info_t *) ((char *) gCounters +
+                                              gCounters->node_infos_offset);
+      info = &infos[n];
+      info->offset =
+         (uint32_t) (gCounters->node_values_offset +
+                     n * gCounters->n_cpu * sizeof (mongoc_counter_slots_t));
+      info->rtt_msec = -1;
+      bson_strncpy (info->host, host, sizeof info->host);
+
+      /* as in mongoc_counters_register */
+      bson_memory_barrier ();
+
+      gCounters->n_nodes++;
+   }
+
+   mongoc_mutex_unlock (&gNodesMutex);
+
+   return info;
+}
+
+
+/**
+ * _mongoc_node_counters_get:
+ * @host_and_port: A server's "host:port".
+ *
+ * Returns: The server's per-CPU counters for _mongoc_node_counter_add, or
+ * NULL if the table is full. They are valid until the process exits.
+ */
+mongoc_counter_slots_t *
+_mongoc_node_counters_get (const char *host_and_port)
+{
+   mongoc_node_counter_info_t *info;
+
+   info = mongoc_counters_get_node (host_and_port);
+   if (!info) {
+      return NULL;
+   }
+
+   return (mongoc_counter_slots_t *) ((char *) gCounters + info->offset);
+}
+
+
+/**
+ * _mongoc_node_counters_set_rtt:
+ * @node: A server's counters from _mongoc_node_counters_get, or NULL.
+ * @rtt_msec: The server's smoothed round trip time.
+ *
+ * Updates the round trip time shown for the server. The server's info is
+ * found from where its counters are, without searching the table.
+ */
+void
+_mongoc_node_counters_set_rtt (mongoc_counter_slots_t *node, int64_t rtt_msec)
+{
+   mongoc_node_counter_info_t *infos;
+   size_t n;
+
+   if (!node || !gCounters) {
+      return;
+   }
+
+   infos = (mongoc_node_counter_info_t *) ((char *) gCounters +
+                                           gCounters->node_infos_offset);
+   n = ((size_t) ((char *) node - (char *) gCounters) -
+        gCounters->node_values_offset) /
+       (gCounters->n_cpu * sizeof (mongoc_counter_slots_t));
+
+   BSON_ASSERT (n < gCounters->n_nodes);
+   infos[n].rtt_msec = rtt_msec;
 }
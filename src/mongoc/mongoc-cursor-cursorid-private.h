@@ -24,6 +24,7 @@
 #include <bson.h>
 
 #include "mongoc-cursor-private.h"
+#include "mongoc-pipeline.h"
 
 
 BSON_BEGIN_DECLS
@@ -35,6 +36,14 @@ typedef struct {
    bool in_reader;
    bson_iter_t batch_iter;
    bson_t current_doc;
+
+   /* for the "prefetch" option: send the next getMore after reading
+    * prefetch_at of the batch_len documents in this batch */
+   uint32_t batch_len;
+   uint32_t batch_read;
+   uint32_t prefetch_at;
+   mongoc_pipeline_t *prefetch;
+   mongoc_pipeline_request_t *prefetch_request;
 } mongoc_cursor_cursorid_t;
 
 
@@ -44,6 +53,10 @@ bool
 _mongoc_cursor_cursorid_prime (mongoc_cursor_t *cursor);
 bool
 _mongoc_cursor_cursorid_next (mongoc_cursor_t *cursor, const bson_t **bson);
+bool
+_mongoc_cursor_cursorid_batch_has_next (mongoc_cursor_t *cursor);
+void
+_mongoc_cursor_cursorid_prefetch_recv (mongoc_cursor_t *cursor);
 void
 _mongoc_cursor_cursorid_init (mongoc_cursor_t *cursor, const bson_t *command);
 bool
@@ -23,6 +23,7 @@
 #include "mongoc-error.h"
 #include "mongoc-util-private.h"
 #include "mongoc-client-private.h"
+#include "mongoc-pipeline-private.h"
 
 
 #undef MONGOC_LOG_DOMAIN
@@ -45,6 +46,10 @@ _mongoc_cursor_cursorid_new (void)
 }
 
 
+static bool
+_mongoc_cursor_cursorid_take_prefetched (mongoc_cursor_t *cursor);
+
+
 static void
 _mongoc_cursor_cursorid_destroy (mongoc_cursor_t *cursor)
 {
@@ -55,6 +60,11 @@ _mongoc_cursor_cursorid_destroy (mongoc_cursor_t *cursor)
    cid = (mongoc_cursor_cursorid_t *) cursor->iface_data;
    BSON_ASSERT (cid);
 
+   if (cid->prefetch) {
+      /* learn the cursor id from the reply, to kill the cursor if needed */
+      (void) _mongoc_cursor_cursorid_take_prefetched (cursor);
+   }
+
    bson_destroy (&cid->array);
    bson_free (cid);
    _mongoc_cursor_destroy (cursor);
@@ -63,6 +73,32 @@ _mongoc_cursor_cursorid_destroy (mongoc_cursor_t *cursor)
 }
 
 
+/* the fraction of each batch to read before sending the next getMore, or
+ * -1 if the "prefetch" option is not set */
+static double
+_mongoc_cursor_cursorid_prefetch_fraction (const mongoc_cursor_t *cursor)
+{
+   bson_iter_t iter;
+   double fraction = 0.5;
+
+   if (!_mongoc_cursor_get_opt_bool (cursor, MONGOC_CURSOR_PREFETCH)) {
+      return -1;
+   }
+
+   if (bson_iter_init_find (
+          &iter, &cursor->opts, MONGOC_CURSOR_PREFETCH_FRACTION)) {
+      if (BSON_ITER_HOLDS_DOUBLE (&iter)) {
+         fraction = bson_iter_double (&iter);
+      } else if (BSON_ITER_HOLDS_INT32 (&iter) ||
+                 BSON_ITER_HOLDS_INT64 (&iter)) {
+         fraction = (double) bson_iter_as_int64 (&iter);
+      }
+   }
+
+   return BSON_MIN (BSON_MAX (fraction, 0.0), 1.0);
+}
+
+
 /*
  * Start iterating the reply to an "aggregate", "find", "getMore" etc. command:
  *
@@ -76,11 +112,16 @@ _mongoc_cursor_cursorid_start_batch (mongoc_cursor_t *cursor)
    bson_iter_t child;
    const char *ns;
    uint32_t nslen;
+   double fraction;
 
    cid = (mongoc_cursor_cursorid_t *) cursor->iface_data;
 
    BSON_ASSERT (cid);
 
+   cid->batch_len = 0;
+   cid->batch_read = 0;
+   cid->prefetch_at = 0;
+
    if (bson_iter_init_find (&iter, &cid->array, "cursor") &&
        BSON_ITER_HOLDS_DOCUMENT (&iter) && bson_iter_recurse (&iter, &child)) {
       while (bson_iter_next (&child)) {
@@ -99,6 +140,19 @@ _mongoc_cursor_cursorid_start_batch (mongoc_cursor_t *cursor)
       }
    }
 
+   fraction = _mongoc_cursor_cursorid_prefetch_fraction (cursor);
+   if (cid->in_batch && fraction >= 0) {
+      memcpy (&iter, &cid->batch_iter, sizeof iter);
+      while (bson_iter_next (&iter)) {
+         cid->batch_len++;
+      }
+
+      if (cid->batch_len) {
+         cid->prefetch_at =
+            BSON_MAX ((uint32_t) (cid->batch_len * fraction), 1);
+      }
+   }
+
    return cid->in_batch;
 }
 
@@ -219,6 +273,119 @@ _mongoc_cursor_prepare_getmore_command (mongoc_cursor_t *cursor,
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cursor_cursorid_prefetch_send --
+ *
+ *       Send the next getMore without waiting for the reply, so the
+ *       server prepares the next batch while the application reads this
+ *       one. The reply is read when the batch is drained, or earlier by
+ *       _mongoc_client_recv_prefetch if the client needs the connection.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_cursor_cursorid_prefetch_send (mongoc_cursor_t *cursor)
+{
+   mongoc_cursor_cursorid_t *cid;
+   char db[MONGOC_NAMESPACE_MAX];
+   bson_t command;
+   uint32_t count;
+
+   ENTRY;
+
+   cid = (mongoc_cursor_cursorid_t *) cursor->iface_data;
+   BSON_ASSERT (cid);
+   BSON_ASSERT (!cid->prefetch);
+
+   /* request the batchSize we would if we sent the getMore after reading
+    * the rest of this batch, including the document being returned */
+   count = cursor->count;
+   cursor->count += 1 + cid->batch_len - cid->batch_read;
+   _mongoc_cursor_prepare_getmore_command (cursor, &command);
+   cursor->count = count;
+
+   bson_strncpy (db, cursor->ns, cursor->dblen + 1);
+
+   cid->prefetch = _mongoc_pipeline_new (cursor->client, cursor->read_prefs);
+   _mongoc_pipeline_set_server_id (cid->prefetch, cursor->server_id);
+   cid->prefetch_request =
+      mongoc_pipeline_command (cid->prefetch, db, &command);
+
+   /* on failure the request is completed with the error, which is reported
+    * when the cursor reaches the end of this batch */
+   if (mongoc_pipeline_flush (cid->prefetch, NULL)) {
+      cursor->client->prefetching_cursor = cursor;
+   }
+
+   bson_destroy (&command);
+
+   EXIT;
+}
+
+
+/* read the prefetched getMore reply, if it's still on the wire, and store
+ * it in the cursor's pipeline request */
+void
+_mongoc_cursor_cursorid_prefetch_recv (mongoc_cursor_t *cursor)
+{
+   mongoc_cursor_cursorid_t *cid;
+
+   cid = (mongoc_cursor_cursorid_t *) cursor->iface_data;
+   BSON_ASSERT (cid);
+
+   if (cursor->client->prefetching_cursor == cursor) {
+      cursor->client->prefetching_cursor = NULL;
+   }
+
+   if (cid->prefetch_request &&
+       !mongoc_pipeline_request_is_done (cid->prefetch_request)) {
+      /* the reply or error is stored in the request */
+      (void) mongoc_pipeline_request_wait (cid->prefetch_request, NULL, NULL);
+   }
+}
+
+
+/* start iterating the batch from the prefetched getMore */
+static bool
+_mongoc_cursor_cursorid_take_prefetched (mongoc_cursor_t *cursor)
+{
+   mongoc_cursor_cursorid_t *cid;
+   bool ret;
+
+   ENTRY;
+
+   cid = (mongoc_cursor_cursorid_t *) cursor->iface_data;
+   BSON_ASSERT (cid);
+   BSON_ASSERT (cid->prefetch);
+
+   _mongoc_cursor_cursorid_prefetch_recv (cursor);
+
+   bson_destroy (&cid->array);
+   ret = mongoc_pipeline_request_wait (
+      cid->prefetch_request, &cid->array, &cursor->error);
+
+   mongoc_pipeline_destroy (cid->prefetch);
+   cid->prefetch = NULL;
+   cid->prefetch_request = NULL;
+
+   if (ret && _mongoc_cursor_cursorid_start_batch (cursor)) {
+      RETURN (true);
+   }
+
+   if (!cursor->error.domain) {
+      bson_set_error (&cursor->error,
+                      MONGOC_ERROR_PROTOCOL,
+                      MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                      "Invalid reply to getMore command.");
+   }
+
+   RETURN (false);
+}
+
+
 static bool
 _mongoc_cursor_cursorid_get_more (mongoc_cursor_t *cursor)
 {
@@ -232,6 +399,10 @@ _mongoc_cursor_cursorid_get_more (mongoc_cursor_t *cursor)
    cid = (mongoc_cursor_cursorid_t *) cursor->iface_data;
    BSON_ASSERT (cid);
 
+   if (cid->prefetch) {
+      RETURN (_mongoc_cursor_cursorid_take_prefetched (cursor));
+   }
+
    server_stream = _mongoc_cursor_fetch_stream (cursor);
 
    if (!server_stream) {
@@ -286,6 +457,12 @@ again:
       _mongoc_cursor_cursorid_read_from_batch (cursor, bson);
 
       if (*bson) {
+         cid->batch_read++;
+         if (cid->batch_read == cid->prefetch_at && !cid->prefetch &&
+             mongoc_cursor_get_id (cursor)) {
+            _mongoc_cursor_cursorid_prefetch_send (cursor);
+         }
+
          GOTO (done);
       }
 
@@ -318,6 +495,30 @@ done:
 }
 
 
+/* whether a document remains in the current reply, so the next call to
+ * _mongoc_cursor_cursorid_next will not send a getMore */
+bool
+_mongoc_cursor_cursorid_batch_has_next (mongoc_cursor_t *cursor)
+{
+   mongoc_cursor_cursorid_t *cid;
+   bson_iter_t iter;
+
+   cid = (mongoc_cursor_cursorid_t *) cursor->iface_data;
+   BSON_ASSERT (cid);
+
+   if (cid->in_batch) {
+      memcpy (&iter, &cid->batch_iter, sizeof iter);
+      return bson_iter_next (&iter) && BSON_ITER_HOLDS_DOCUMENT (&iter);
+   }
+
+   if (cid->in_reader) {
+      return _mongoc_cursor_reader_has_next (cursor);
+   }
+
+   return false;
+}
+
+
 static mongoc_cursor_t *
 _mongoc_cursor_cursorid_clone (const mongoc_cursor_t *cursor)
 {
@@ -24,6 +24,7 @@
 #include <bson.h>
 
 #include "mongoc-client.h"
+#include "mongoc-array-private.h"
 #include "mongoc-buffer-private.h"
 #include "mongoc-rpc-private.h"
 #include "mongoc-server-stream-private.h"
@@ -77,6 +78,10 @@ struct _mongoc_cursor_interface_t {
 #define MONGOC_CURSOR_NO_CURSOR_TIMEOUT_LEN 15
 #define MONGOC_CURSOR_OPLOG_REPLAY "oplogReplay"
 #define MONGOC_CURSOR_OPLOG_REPLAY_LEN 11
+#define MONGOC_CURSOR_PREFETCH "prefetch"
+#define MONGOC_CURSOR_PREFETCH_LEN 8
+#define MONGOC_CURSOR_PREFETCH_FRACTION "prefetchFraction"
+#define MONGOC_CURSOR_PREFETCH_FRACTION_LEN 16
 #define MONGOC_CURSOR_ORDERBY "orderby"
 #define MONGOC_CURSOR_ORDERBY_LEN 7
 #define MONGOC_CURSOR_PROJECTION "projection"
@@ -138,6 +143,9 @@ struct _mongoc_cursor_t {
    bson_reader_t *reader;
    const bson_t *current;
 
+   /* bson_t views of the documents returned by mongoc_cursor_next_batch */
+   mongoc_array_t batch;
+
    mongoc_cursor_interface_t iface;
    void *iface_data;
 
@@ -151,6 +159,8 @@ void
 _mongoc_set_cursor_ns (mongoc_cursor_t *cursor, const char *ns, uint32_t nslen);
 bool
 _mongoc_cursor_get_opt_bool (const mongoc_cursor_t *cursor, const char *option);
+bool
+_mongoc_cursor_is_driver_opt (const char *option);
 mongoc_cursor_t *
 _mongoc_cursor_new_with_opts (mongoc_client_t *client,
                               const char *db_and_collection,
@@ -178,6 +188,8 @@ _mongoc_cursor_destroy (mongoc_cursor_t *cursor);
 bool
 _mongoc_read_from_buffer (mongoc_cursor_t *cursor, const bson_t **bson);
 bool
+_mongoc_cursor_reader_has_next (const mongoc_cursor_t *cursor);
+bool
 _use_find_command (const mongoc_cursor_t *cursor,
                    const mongoc_server_stream_t *server_stream);
 bool
@@ -121,6 +121,16 @@ _mongoc_cursor_get_opt_bool (const mongoc_cursor_t *cursor, const char *option)
 }
 
 
+/* options the driver handles itself and never sends to the server */
+bool
+_mongoc_cursor_is_driver_opt (const char *option)
+{
+   return !strcmp (option, MONGOC_CURSOR_MAX_AWAIT_TIME_MS) ||
+          !strcmp (option, MONGOC_CURSOR_PREFETCH) ||
+          !strcmp (option, MONGOC_CURSOR_PREFETCH_FRACTION);
+}
+
+
 int32_t
 _mongoc_n_return (mongoc_cursor_t *cursor)
 {
@@ -226,6 +236,7 @@ _mongoc_cursor_new_with_opts (mongoc_client_t *client,
    BSON_ASSERT (client);
 
    cursor = (mongoc_cursor_t *) bson_malloc0 (sizeof *cursor);
+   _mongoc_array_init (&cursor->batch, sizeof (bson_t));
    cursor->client = client;
    cursor->is_command = is_command ? 1 : 0;
 
@@ -518,6 +529,7 @@ _mongoc_cursor_destroy (mongoc_cursor_t *cursor)
    }
 
    _mongoc_buffer_destroy (&cursor->buffer);
+   _mongoc_array_destroy (&cursor->batch);
    mongoc_read_prefs_destroy (cursor->read_prefs);
    mongoc_read_concern_destroy (cursor->read_concern);
    mongoc_write_concern_destroy (cursor->write_concern);
@@ -632,9 +644,10 @@ _mongoc_cursor_monitor_legacy_query (mongoc_cursor_t *cursor,
                                      mongoc_server_stream_t *server_stream,
                                      const char *cmd_name)
 {
-   bson_t doc;
+   bson_t *doc;
    mongoc_client_t *client;
    mongoc_apm_command_started_t event;
+   mongoc_arena_mark_t mark;
    char db[MONGOC_NAMESPACE_MAX];
 
    ENTRY;
@@ -645,20 +658,21 @@ _mongoc_cursor_monitor_legacy_query (mongoc_cursor_t *cursor,
       RETURN (true);
    }
 
-   bson_init (&doc);
+   _mongoc_arena_mark (&client->cluster.arena, &mark);
+   doc = _mongoc_arena_bson_new (&client->cluster.arena);
    bson_strncpy (db, cursor->ns, cursor->dblen + 1);
 
    if (!cursor->is_command) {
       /* simulate a MongoDB 3.2+ "find" command */
-      if (!_mongoc_cursor_prepare_find_command (cursor, &doc, server_stream)) {
+      if (!_mongoc_cursor_prepare_find_command (cursor, doc, server_stream)) {
          /* cursor->error is set */
-         bson_destroy (&doc);
+         _mongoc_arena_release (&client->cluster.arena, &mark);
          RETURN (false);
       }
    }
 
    mongoc_apm_command_started_init (&event,
-                                    cursor->is_command ? &cursor->filter : &doc,
+                                    cursor->is_command ? &cursor->filter : doc,
                                     db,
                                     cmd_name,
                                     client->cluster.request_id,
@@ -669,7 +683,7 @@ _mongoc_cursor_monitor_legacy_query (mongoc_cursor_t *cursor,
 
    client->apm_callbacks.started (&event);
    mongoc_apm_command_started_cleanup (&event);
-   bson_destroy (&doc);
+   _mongoc_arena_release (&client->cluster.arena, &mark);
 
    RETURN (true);
 }
@@ -1040,11 +1054,12 @@ _mongoc_cursor_parse_opts_for_op_query (mongoc_cursor_t *cursor,
       /* singleBatch limit and batchSize are handled in _mongoc_n_return,
        * exhaust noCursorTimeout oplogReplay tailable in _mongoc_cursor_flags
        * maxAwaitTimeMS is handled in _mongoc_cursor_prepare_getmore_command
+       * prefetch only applies to the getMore command
        */
       else if (strcmp (key, MONGOC_CURSOR_SINGLE_BATCH) && strcmp (key, MONGOC_CURSOR_LIMIT) &&
                strcmp (key, MONGOC_CURSOR_BATCH_SIZE) && strcmp (key, MONGOC_CURSOR_EXHAUST) &&
                strcmp (key, MONGOC_CURSOR_NO_CURSOR_TIMEOUT) && strcmp (key, MONGOC_CURSOR_OPLOG_REPLAY) &&
-               strcmp (key, MONGOC_CURSOR_TAILABLE) && strcmp (key, MONGOC_CURSOR_MAX_AWAIT_TIME_MS)) {
+               strcmp (key, MONGOC_CURSOR_TAILABLE) && !_mongoc_cursor_is_driver_opt (key)) {
          /* pass unrecognized options to server, prefixed with $ */
          PUSH_DOLLAR_QUERY ();
          dollar_modifier = bson_strdup_printf ("$%s", key);
@@ -1380,7 +1395,7 @@ _mongoc_cursor_prepare_find_command (mongoc_cursor_t *cursor,
    bson_iter_init (&iter, &cursor->opts);
 
    while (bson_iter_next (&iter)) {
-      /* don't append "maxAwaitTimeMS" */
+      /* don't append "maxAwaitTimeMS" or "prefetch" */
       if (!strcmp (bson_iter_key (&iter), MONGOC_CURSOR_COLLATION) &&
           server_stream->sd->max_wire_version < WIRE_VERSION_COLLATION) {
          bson_set_error (&cursor->error,
@@ -1389,7 +1404,7 @@ _mongoc_cursor_prepare_find_command (mongoc_cursor_t *cursor,
                          "Collation is not supported by this server");
          MARK_FAILED (cursor);
          return false;
-      } else if (strcmp (bson_iter_key (&iter), MONGOC_CURSOR_MAX_AWAIT_TIME_MS)) {
+      } else if (!_mongoc_cursor_is_driver_opt (bson_iter_key (&iter))) {
          if (!bson_append_iter (command, bson_iter_key (&iter), -1, &iter)) {
             bson_set_error (&cursor->error,
                             MONGOC_ERROR_BSON,
@@ -1417,17 +1432,24 @@ static const bson_t *
 _mongoc_cursor_find_command (mongoc_cursor_t *cursor,
                              mongoc_server_stream_t *server_stream)
 {
-   bson_t command = BSON_INITIALIZER;
+   mongoc_arena_t *arena;
+   mongoc_arena_mark_t mark;
+   bson_t *command;
    const bson_t *bson = NULL;
 
    ENTRY;
 
-   if (!_mongoc_cursor_prepare_find_command (cursor, &command, server_stream)) {
+   arena = &cursor->client->cluster.arena;
+   _mongoc_arena_mark (arena, &mark);
+   command = _mongoc_arena_bson_new (arena);
+
+   if (!_mongoc_cursor_prepare_find_command (cursor, command, server_stream)) {
+      _mongoc_arena_release (arena, &mark);
       RETURN (NULL);
    }
 
-   _mongoc_cursor_cursorid_init (cursor, &command);
-   bson_destroy (&command);
+   _mongoc_cursor_cursorid_init (cursor, command);
+   _mongoc_arena_release (arena, &mark);
 
    BSON_ASSERT (cursor->iface.next);
    _mongoc_cursor_cursorid_next (cursor, &bson);
@@ -1733,6 +1755,97 @@ _mongoc_read_from_buffer (mongoc_cursor_t *cursor, const bson_t **bson)
 }
 
 
+/* whether the OP_REPLY in the cursor's buffer has unread documents */
+bool
+_mongoc_cursor_reader_has_next (const mongoc_cursor_t *cursor)
+{
+   return cursor->reader && !cursor->end_of_event &&
+          bson_reader_tell (cursor->reader) <
+             (off_t) cursor->rpc.reply.documents_len;
+}
+
+
+/* whether the next document is already in memory, in the same reply buffer
+ * as the current one */
+static bool
+_mongoc_cursor_batch_has_next (mongoc_cursor_t *cursor)
+{
+   if (cursor->done) {
+      return false;
+   }
+
+   if (cursor->iface.next == _mongoc_cursor_cursorid_next) {
+      return _mongoc_cursor_cursorid_batch_has_next (cursor);
+   }
+
+   if (!cursor->iface.next) {
+      return _mongoc_cursor_reader_has_next (cursor);
+   }
+
+   /* other cursor types may reuse one bson_t for each document */
+   return false;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cursor_next_batch --
+ *
+ *       Like mongoc_cursor_next, but returns all the documents remaining in
+ *       the current batch, fetching the next batch first if none remain.
+ *
+ *       @docs is set to an array of @n_docs bson_t that point into the
+ *       server's reply; no document is copied. They are valid until the
+ *       next call to mongoc_cursor_next, mongoc_cursor_next_batch, or
+ *       mongoc_cursor_destroy.
+ *
+ * Returns:
+ *       true if at least one document was returned. Otherwise false, and
+ *       the cursor is exhausted or mongoc_cursor_error returns the error.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_cursor_next_batch (mongoc_cursor_t *cursor,
+                          const bson_t **docs,
+                          size_t *n_docs)
+{
+   const bson_t *doc;
+   bson_t view;
+   bool r;
+
+   ENTRY;
+
+   BSON_ASSERT (cursor);
+   BSON_ASSERT (docs);
+   BSON_ASSERT (n_docs);
+
+   *docs = NULL;
+   *n_docs = 0;
+   _mongoc_array_clear (&cursor->batch);
+
+   if (!mongoc_cursor_next (cursor, &doc)) {
+      RETURN (false);
+   }
+
+   do {
+      /* mongoc_cursor_next reuses its bson_t, but not the data it points
+       * to while the batch lasts */
+      r = bson_init_static (&view, bson_get_data (doc), doc->len);
+      BSON_ASSERT (r);
+      _mongoc_array_append_val (&cursor->batch, view);
+   } while (_mongoc_cursor_batch_has_next (cursor) &&
+            mongoc_cursor_next (cursor, &doc));
+
+   *docs = (const bson_t *) cursor->batch.data;
+   *n_docs = cursor->batch.len;
+
+   RETURN (true);
+}
+
+
 bool
 _mongoc_cursor_next (mongoc_cursor_t *cursor, const bson_t **bson)
 {
@@ -1897,6 +2010,7 @@ _mongoc_cursor_clone (const mongoc_cursor_t *cursor)
    BSON_ASSERT (cursor);
 
    _clone = (mongoc_cursor_t *) bson_malloc0 (sizeof *_clone);
+   _mongoc_array_init (&_clone->batch, sizeof (bson_t));
 
    _clone->client = cursor->client;
    _clone->is_command = cursor->is_command;
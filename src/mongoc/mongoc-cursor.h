@@ -44,6 +44,10 @@ mongoc_cursor_more (mongoc_cursor_t *cursor);
 BSON_EXPORT (bool)
 mongoc_cursor_next (mongoc_cursor_t *cursor, const bson_t **bson);
 BSON_EXPORT (bool)
+mongoc_cursor_next_batch (mongoc_cursor_t *cursor,
+                          const bson_t **docs,
+                          size_t *n_docs);
+BSON_EXPORT (bool)
 mongoc_cursor_error (mongoc_cursor_t *cursor, bson_error_t *error);
 BSON_EXPORT (void)
 mongoc_cursor_get_host (mongoc_cursor_t *cursor, mongoc_host_list_t *host);
@@ -46,6 +46,12 @@ BSON_BEGIN_DECLS
     (errno == EINPROGRESS))
 #endif
 
+#ifdef _WIN32
+#define MONGOC_ERRNO_TIMEDOUT WSAETIMEDOUT
+#else
+#define MONGOC_ERRNO_TIMEDOUT ETIMEDOUT
+#endif
+
 
 BSON_END_DECLS
 
@@ -51,6 +51,10 @@ int32_t
 _mongoc_gridfs_file_page_read (mongoc_gridfs_file_page_t *page,
                                void *dst,
                                uint32_t len);
+uint32_t
+_mongoc_gridfs_file_page_read_span (mongoc_gridfs_file_page_t *page,
+                                    const uint8_t **data,
+                                    uint32_t len);
 int32_t
 _mongoc_gridfs_file_page_write (mongoc_gridfs_file_page_t *page,
                                 const void *src,
@@ -88,6 +88,43 @@ _mongoc_gridfs_file_page_read (mongoc_gridfs_file_page_t *page,
 }
 
 
+/**
+ * _mongoc_gridfs_file_page_read_span:
+ *
+ * Point @data at up to @len bytes of the page, from its offset on, and
+ * move the offset past them. The bytes are not copied: @data is valid
+ * while the page and the buffer it was created from are.
+ */
+uint32_t
+_mongoc_gridfs_file_page_read_span (mongoc_gridfs_file_page_t *page,
+                                    const uint8_t **data,
+                                    uint32_t len)
+{
+   uint32_t bytes_read;
+   const uint8_t *src;
+
+   ENTRY;
+
+   BSON_ASSERT (page);
+   BSON_ASSERT (data);
+
+   /* the page of a short chunk may be sought past its end */
+   if (page->offset >= page->len) {
+      *data = NULL;
+      RETURN (0);
+   }
+
+   bytes_read = BSON_MIN (len, page->len - page->offset);
+
+   src = page->read_buf ? page->read_buf : page->buf;
+
+   *data = src + page->offset;
+   page->offset += bytes_read;
+
+   RETURN (bytes_read);
+}
+
+
 /**
  * _mongoc_gridfs_file_page_write:
  *
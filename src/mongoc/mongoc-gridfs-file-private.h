@@ -23,9 +23,11 @@
 
 #include <bson.h>
 
+#include "mongoc-bulk-operation.h"
 #include "mongoc-gridfs.h"
 #include "mongoc-gridfs-file.h"
 #include "mongoc-gridfs-file-page.h"
+#include "mongoc-gridfs-read-ahead-private.h"
 #include "mongoc-cursor.h"
 
 
@@ -42,6 +44,12 @@ struct _mongoc_gridfs_file_t {
    mongoc_cursor_t *cursor;
    uint32_t cursor_range[2]; /* current chunk, # of chunks */
    bool is_dirty;
+   uint32_t batch_size;           /* 0 unless new chunks are batched */
+   mongoc_bulk_operation_t *bulk; /* new chunks not yet inserted */
+   uint32_t bulk_len;             /* bytes of chunk data in bulk */
+   bool failed;                   /* a batch of chunks was not inserted */
+   int32_t n_chunks;              /* chunks on the server or in bulk */
+   mongoc_gridfs_read_ahead_t *read_ahead; /* NULL unless concurrent */
 
    bson_value_t files_id;
    int64_t length;
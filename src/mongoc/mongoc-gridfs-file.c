@@ -22,6 +22,7 @@
 #include <time.h>
 #include <errno.h>
 
+#include "mongoc-bulk-operation.h"
 #include "mongoc-cursor.h"
 #include "mongoc-cursor-private.h"
 #include "mongoc-collection.h"
@@ -41,6 +42,9 @@ _mongoc_gridfs_file_refresh_page (mongoc_gridfs_file_t *file);
 static bool
 _mongoc_gridfs_file_flush_page (mongoc_gridfs_file_t *file);
 
+static bool
+_mongoc_gridfs_file_flush_chunks (mongoc_gridfs_file_t *file);
+
 static ssize_t
 _mongoc_gridfs_file_extend (mongoc_gridfs_file_t *file);
 
@@ -133,12 +137,23 @@ mongoc_gridfs_file_save (mongoc_gridfs_file_t *file)
 
    ENTRY;
 
+   /* file->error says why */
+   if (file->failed) {
+      RETURN (false);
+   }
+
    if (!file->is_dirty) {
       return 1;
    }
 
-   if (file->page && _mongoc_gridfs_file_page_is_dirty (file->page)) {
-      _mongoc_gridfs_file_flush_page (file);
+   if (file->page && _mongoc_gridfs_file_page_is_dirty (file->page) &&
+       !_mongoc_gridfs_file_flush_page (file)) {
+      RETURN (false);
+   }
+
+   /* the files document must not refer to chunks that aren't inserted */
+   if (!_mongoc_gridfs_file_flush_chunks (file)) {
+      RETURN (false);
    }
 
    md5 = mongoc_gridfs_file_get_md5 (file);
@@ -283,6 +298,11 @@ _mongoc_gridfs_file_new_from_bson (mongoc_gridfs_t *gridfs, const bson_t *data)
    /* TODO: is there are a minimal object we should be verifying that we
     * actually have here? */
 
+   if (file->chunk_size > 0) {
+      file->n_chunks = (int32_t) (
+         (file->length + file->chunk_size - 1) / file->chunk_size);
+   }
+
    RETURN (file);
 
 failure:
@@ -366,10 +386,22 @@ mongoc_gridfs_file_destroy (mongoc_gridfs_file_t *file)
 
    BSON_ASSERT (file);
 
+   /* without batching, full chunks are written as they are filled. write
+    * the batched ones, and the file with them */
+   if (file->bulk && !mongoc_gridfs_file_save (file)) {
+      MONGOC_WARNING ("Failed to save GridFS file: %s", file->error.message);
+   }
+
    if (file->page) {
       _mongoc_gridfs_file_page_destroy (file->page);
    }
 
+   if (file->bulk) {
+      mongoc_bulk_operation_destroy (file->bulk);
+   }
+
+   _mongoc_gridfs_read_ahead_destroy (file->read_ahead);
+
    if (file->bson.len) {
       bson_destroy (&file->bson);
    }
@@ -480,6 +512,137 @@ mongoc_gridfs_file_readv (mongoc_gridfs_file_t *file,
 }
 
 
+/**
+ * mongoc_gridfs_file_read_span:
+ *
+ *    Read up to @max_len bytes from the file position on, without copying
+ *    them: point @data at the current chunk's data in the server reply, or
+ *    in the file's page if it was modified. A span does not cross the end
+ *    of a chunk.
+ *
+ *    @data is valid until the next call that reads, writes, seeks, saves,
+ *    or destroys @file.
+ *
+ * Returns:
+ *
+ *    The number of bytes at @data, 0 at the end of the file, or -1 on
+ *    error. Use mongoc_gridfs_file_error to get the error.
+ */
+ssize_t
+mongoc_gridfs_file_read_span (mongoc_gridfs_file_t *file,
+                              const uint8_t **data,
+                              size_t max_len)
+{
+   uint32_t r;
+
+   ENTRY;
+
+   BSON_ASSERT (file);
+   BSON_ASSERT (data);
+
+   *data = NULL;
+
+   /* Reading when positioned past the end does nothing */
+   if (file->pos >= file->length || !max_len) {
+      RETURN (0);
+   }
+
+   if (!file->page && !_mongoc_gridfs_file_refresh_page (file)) {
+      RETURN (-1);
+   }
+
+   max_len = BSON_MIN (max_len, (size_t) UINT32_MAX);
+   r = _mongoc_gridfs_file_page_read_span (
+      file->page, data, (uint32_t) max_len);
+
+   if (!r) {
+      /* read to the end of the page, get the next one */
+      if (!_mongoc_gridfs_file_refresh_page (file)) {
+         RETURN (-1);
+      }
+
+      r = _mongoc_gridfs_file_page_read_span (
+         file->page, data, (uint32_t) max_len);
+   }
+
+   if (!r) {
+      /* short of the file's length, but the chunk has no more data */
+      bson_set_error (&file->error,
+                      MONGOC_ERROR_GRIDFS,
+                      MONGOC_ERROR_GRIDFS_CHUNK_MISSING,
+                      "corrupt chunk number %" PRId32,
+                      file->n);
+      RETURN (-1);
+   }
+
+   file->pos += r;
+
+   RETURN ((ssize_t) r);
+}
+
+
+/**
+ * mongoc_gridfs_file_write_to_stream:
+ *
+ *    Write the file from its position to the end to @stream, one chunk's
+ *    span at a time, without copying the data from the server replies.
+ *
+ * Returns:
+ *
+ *    The number of bytes written, or -1 with @error set.
+ */
+int64_t
+mongoc_gridfs_file_write_to_stream (mongoc_gridfs_file_t *file,
+                                    mongoc_stream_t *stream,
+                                    int32_t timeout_msec,
+                                    bson_error_t *error)
+{
+   const uint8_t *data;
+   mongoc_iovec_t iov;
+   int64_t total = 0;
+   ssize_t r;
+
+   ENTRY;
+
+   BSON_ASSERT (file);
+   BSON_ASSERT (stream);
+
+   for (;;) {
+      r = mongoc_gridfs_file_read_span (file, &data, SIZE_MAX);
+      if (r == 0) {
+         break;
+      }
+
+      if (r < 0) {
+         if (!mongoc_gridfs_file_error (file, error)) {
+            bson_set_error (error,
+                            MONGOC_ERROR_GRIDFS,
+                            MONGOC_ERROR_GRIDFS_CHUNK_MISSING,
+                            "missing chunk number %" PRId32,
+                            file->n);
+         }
+
+         RETURN (-1);
+      }
+
+      iov.iov_base = (void *) data;
+      iov.iov_len = (size_t) r;
+
+      if (mongoc_stream_writev (stream, &iov, 1, timeout_msec) != r) {
+         bson_set_error (error,
+                         MONGOC_ERROR_STREAM,
+                         MONGOC_ERROR_STREAM_SOCKET,
+                         "Failed to write GridFS file data to stream");
+         RETURN (-1);
+      }
+
+      total += r;
+   }
+
+   RETURN (total);
+}
+
+
 /** writev against a gridfs file
  *  timeout_msec is unused */
 ssize_t
@@ -499,6 +662,10 @@ mongoc_gridfs_file_writev (mongoc_gridfs_file_t *file,
    BSON_ASSERT (iov);
    BSON_ASSERT (iovcnt);
 
+   if (file->failed) {
+      RETURN (-1);
+   }
+
    /* Pull in the correct page */
    if (!file->page && !_mongoc_gridfs_file_refresh_page (file)) {
       return -1;
@@ -536,7 +703,9 @@ mongoc_gridfs_file_writev (mongoc_gridfs_file_t *file,
          } else {
             /** flush the buffer, the next pass through will bring in a new page
              */
-            _mongoc_gridfs_file_flush_page (file);
+            if (!_mongoc_gridfs_file_flush_page (file)) {
+               RETURN (-1);
+            }
          }
       }
    }
@@ -606,12 +775,61 @@ _mongoc_gridfs_file_extend (mongoc_gridfs_file_t *file)
 }
 
 
+/**
+ * _mongoc_gridfs_file_flush_chunks:
+ *
+ *    Inserts the new chunks batched by _mongoc_gridfs_file_flush_page.
+ *
+ *    A bulk operation can't be executed twice, and an ordered insert stops
+ *    at its first error, so on error the chunks after it are lost: the
+ *    file is marked failed, and further writes and saves fail.
+ *
+ * Side Effects:
+ *
+ *    file->bulk is destroyed and set to NULL. file->error and file->failed
+ *    are set on error.
+ *
+ * Returns:
+ *
+ *    True on success; false otherwise.
+ */
+static bool
+_mongoc_gridfs_file_flush_chunks (mongoc_gridfs_file_t *file)
+{
+   bool r;
+
+   ENTRY;
+   BSON_ASSERT (file);
+
+   if (!file->bulk) {
+      RETURN (true);
+   }
+
+   r = mongoc_bulk_operation_execute (file->bulk, NULL, &file->error) != 0;
+   if (!r) {
+      file->failed = true;
+   }
+
+   mongoc_bulk_operation_destroy (file->bulk);
+   file->bulk = NULL;
+   file->bulk_len = 0;
+
+   RETURN (r);
+}
+
+
 /**
  * _mongoc_gridfs_file_flush_page:
  *
  *    Unconditionally flushes the file's current page to the database.
  *    The page to flush is determined by page->n.
  *
+ *    If file->batch_size is set, a chunk appended to the end of the file is
+ *    added to file->bulk, which is inserted once it holds batch_size bytes,
+ *    or by mongoc_gridfs_file_save. The files document is written by
+ *    mongoc_gridfs_file_save. Any other chunk is upserted right away, and
+ *    the file is saved.
+ *
  * Side Effects:
  *
  *    On success, file->page is properly destroyed and set to NULL.
@@ -624,6 +842,7 @@ static bool
 _mongoc_gridfs_file_flush_page (mongoc_gridfs_file_t *file)
 {
    bson_t *selector, *update;
+   bson_t *chunk;
    bool r;
    const uint8_t *buf;
    uint32_t len;
@@ -632,9 +851,49 @@ _mongoc_gridfs_file_flush_page (mongoc_gridfs_file_t *file)
    BSON_ASSERT (file);
    BSON_ASSERT (file->page);
 
+   /* chunks read ahead may be out of date. the dirty page has its own copy
+    * of its data */
+   if (file->read_ahead) {
+      _mongoc_gridfs_read_ahead_reset (file->read_ahead);
+   }
+
    buf = _mongoc_gridfs_file_page_get_data (file->page);
    len = _mongoc_gridfs_file_page_get_len (file->page);
 
+   if (file->batch_size && file->n >= file->n_chunks) {
+      /* a new chunk, no need to upsert */
+      chunk = bson_sized_new (file->chunk_size + 100);
+
+      bson_append_value (chunk, "files_id", -1, &file->files_id);
+      bson_append_int32 (chunk, "n", -1, file->n);
+      bson_append_binary (chunk, "data", -1, BSON_SUBTYPE_BINARY, buf, len);
+
+      if (!file->bulk) {
+         file->bulk = mongoc_collection_create_bulk_operation (
+            file->gridfs->chunks, true /* ordered */, NULL);
+      }
+
+      mongoc_bulk_operation_insert (file->bulk, chunk);
+      file->bulk_len += len;
+      file->n_chunks = file->n + 1;
+
+      bson_destroy (chunk);
+
+      _mongoc_gridfs_file_page_destroy (file->page);
+      file->page = NULL;
+
+      if (file->bulk_len >= file->batch_size) {
+         RETURN (_mongoc_gridfs_file_flush_chunks (file));
+      }
+
+      RETURN (true);
+   }
+
+   /* the chunk may be in the batch, insert it before overwriting it */
+   if (!_mongoc_gridfs_file_flush_chunks (file)) {
+      RETURN (false);
+   }
+
    selector = bson_new ();
 
    bson_append_value (selector, "files_id", -1, &file->files_id);
@@ -659,6 +918,7 @@ _mongoc_gridfs_file_flush_page (mongoc_gridfs_file_t *file)
    if (r) {
       _mongoc_gridfs_file_page_destroy (file->page);
       file->page = NULL;
+      file->n_chunks = BSON_MAX (file->n_chunks, file->n + 1);
       r = mongoc_gridfs_file_save (file);
    }
 
@@ -711,6 +971,78 @@ divide_round_up (int64_t num, int64_t denom)
 }
 
 
+/**
+ * _mongoc_gridfs_file_cursor_get:
+ *
+ *    Get chunk file->n from the file's cursor, which is replaced by a new
+ *    query for the chunks from file->n on if it can't have the chunk.
+ *
+ * Side Effects:
+ *
+ *    *chunk is valid until the cursor moves. file->error is set on error.
+ */
+static bool
+_mongoc_gridfs_file_cursor_get (mongoc_gridfs_file_t *file,
+                                const bson_t **chunk)
+{
+   bson_t query;
+   bson_t child;
+   bson_t opts;
+
+   /* if we have a cursor, but the cursor doesn't have the chunk we're going
+    * to need, destroy it (we'll grab a new one immediately there after) */
+   if (file->cursor && !_mongoc_gridfs_file_keep_cursor (file)) {
+      mongoc_cursor_destroy (file->cursor);
+      file->cursor = NULL;
+   }
+
+   if (!file->cursor) {
+      bson_init (&query);
+      BSON_APPEND_VALUE (&query, "files_id", &file->files_id);
+      BSON_APPEND_DOCUMENT_BEGIN (&query, "n", &child);
+      BSON_APPEND_INT32 (&child, "$gte", file->n);
+      bson_append_document_end (&query, &child);
+
+      bson_init (&opts);
+      BSON_APPEND_DOCUMENT_BEGIN (&opts, "sort", &child);
+      BSON_APPEND_INT32 (&child, "n", 1);
+      bson_append_document_end (&opts, &child);
+
+      BSON_APPEND_DOCUMENT_BEGIN (&opts, "projection", &child);
+      BSON_APPEND_INT32 (&child, "n", 1);
+      BSON_APPEND_INT32 (&child, "data", 1);
+      BSON_APPEND_INT32 (&child, "_id", 0);
+      bson_append_document_end (&opts, &child);
+
+      /* find all chunks greater than or equal to our current file pos */
+      file->cursor = mongoc_collection_find_with_opts (
+         file->gridfs->chunks, &query, &opts, NULL);
+
+      file->cursor_range[0] = file->n;
+      file->cursor_range[1] = (uint32_t) (file->length / file->chunk_size);
+
+      bson_destroy (&query);
+      bson_destroy (&opts);
+
+      BSON_ASSERT (file->cursor);
+   }
+
+   /* we might have had a cursor before, then seeked ahead past a chunk.
+    * iterate until we're on the right chunk */
+   while (file->cursor_range[0] <= file->n) {
+      if (!mongoc_cursor_next (file->cursor, chunk)) {
+         /* copy cursor error, if any. might just lack a matching chunk. */
+         mongoc_cursor_error (file->cursor, &file->error);
+         return false;
+      }
+
+      file->cursor_range[0]++;
+   }
+
+   return true;
+}
+
+
 /**
  * _mongoc_gridfs_file_refresh_page:
  *
@@ -735,9 +1067,6 @@ divide_round_up (int64_t num, int64_t denom)
 static bool
 _mongoc_gridfs_file_refresh_page (mongoc_gridfs_file_t *file)
 {
-   bson_t query;
-   bson_t child;
-   bson_t opts;
    const bson_t *chunk;
    const char *key;
    bson_iter_t iter;
@@ -766,54 +1095,19 @@ _mongoc_gridfs_file_refresh_page (mongoc_gridfs_file_t *file)
       data = (uint8_t *) "";
       len = 0;
    } else {
-      /* if we have a cursor, but the cursor doesn't have the chunk we're going
-       * to need, destroy it (we'll grab a new one immediately there after) */
-      if (file->cursor && !_mongoc_gridfs_file_keep_cursor (file)) {
-         mongoc_cursor_destroy (file->cursor);
-         file->cursor = NULL;
+      /* the chunk may be batched, not yet inserted */
+      if (!_mongoc_gridfs_file_flush_chunks (file)) {
+         RETURN (0);
       }
 
-      if (!file->cursor) {
-         bson_init (&query);
-         BSON_APPEND_VALUE (&query, "files_id", &file->files_id);
-         BSON_APPEND_DOCUMENT_BEGIN (&query, "n", &child);
-         BSON_APPEND_INT32 (&child, "$gte", file->n);
-         bson_append_document_end (&query, &child);
-
-         bson_init (&opts);
-         BSON_APPEND_DOCUMENT_BEGIN (&opts, "sort", &child);
-         BSON_APPEND_INT32 (&child, "n", 1);
-         bson_append_document_end (&opts, &child);
-
-         BSON_APPEND_DOCUMENT_BEGIN (&opts, "projection", &child);
-         BSON_APPEND_INT32 (&child, "n", 1);
-         BSON_APPEND_INT32 (&child, "data", 1);
-         BSON_APPEND_INT32 (&child, "_id", 0);
-         bson_append_document_end (&opts, &child);
-
-         /* find all chunks greater than or equal to our current file pos */
-         file->cursor = mongoc_collection_find_with_opts (
-            file->gridfs->chunks, &query, &opts, NULL);
-
-         file->cursor_range[0] = file->n;
-         file->cursor_range[1] = (uint32_t) (file->length / file->chunk_size);
-
-         bson_destroy (&query);
-         bson_destroy (&opts);
-
-         BSON_ASSERT (file->cursor);
-      }
-
-      /* we might have had a cursor before, then seeked ahead past a chunk.
-       * iterate until we're on the right chunk */
-      while (file->cursor_range[0] <= file->n) {
-         if (!mongoc_cursor_next (file->cursor, &chunk)) {
-            /* copy cursor error, if any. might just lack a matching chunk. */
-            mongoc_cursor_error (file->cursor, &file->error);
+      if (file->read_ahead) {
+         chunk = _mongoc_gridfs_read_ahead_get (
+            file->read_ahead, file, file->n, &file->error);
+         if (!chunk) {
             RETURN (0);
          }
-
-         file->cursor_range[0]++;
+      } else if (!_mongoc_gridfs_file_cursor_get (file, &chunk)) {
+         RETURN (0);
       }
 
       bson_iter_init (&iter, chunk);
@@ -1003,6 +1297,54 @@ mongoc_gridfs_file_get_upload_date (mongoc_gridfs_file_t *file)
    return file->upload_date;
 }
 
+/**
+ * mongoc_gridfs_file_set_concurrency:
+ *
+ *    Read up to @max_concurrency ranges of chunks at once, from the file
+ *    position on, each with a client from @pool. If @pool is NULL or
+ *    @max_concurrency is less than 2, read the chunks through one cursor,
+ *    which is the default.
+ */
+void
+mongoc_gridfs_file_set_concurrency (mongoc_gridfs_file_t *file,
+                                    mongoc_client_pool_t *pool,
+                                    uint32_t max_concurrency)
+{
+   BSON_ASSERT (file);
+
+   /* a clean page may point into a range read ahead */
+   if (file->page && !_mongoc_gridfs_file_page_is_dirty (file->page)) {
+      _mongoc_gridfs_file_page_destroy (file->page);
+      file->page = NULL;
+   }
+
+   _mongoc_gridfs_read_ahead_destroy (file->read_ahead);
+   file->read_ahead = NULL;
+
+   if (pool && max_concurrency > 1) {
+      file->read_ahead = _mongoc_gridfs_read_ahead_new (
+         pool, max_concurrency, file->chunk_size);
+   }
+}
+
+
+/**
+ * mongoc_gridfs_file_set_batch_size:
+ *
+ *    Insert chunks appended to the file in batches of up to @batch_size
+ *    bytes, and write the files document only from mongoc_gridfs_file_save.
+ *    If @batch_size is 0, each chunk is written and the file saved as soon
+ *    as the chunk is full, which is the default.
+ */
+void
+mongoc_gridfs_file_set_batch_size (mongoc_gridfs_file_t *file,
+                                   uint32_t batch_size)
+{
+   BSON_ASSERT (file);
+
+   file->batch_size = batch_size;
+}
+
 bool
 mongoc_gridfs_file_remove (mongoc_gridfs_file_t *file, bson_error_t *error)
 {
@@ -1011,6 +1353,13 @@ mongoc_gridfs_file_remove (mongoc_gridfs_file_t *file, bson_error_t *error)
 
    BSON_ASSERT (file);
 
+   /* don't insert chunks of a removed file later */
+   if (file->bulk) {
+      mongoc_bulk_operation_destroy (file->bulk);
+      file->bulk = NULL;
+      file->bulk_len = 0;
+   }
+
    BSON_APPEND_VALUE (&sel, "_id", &file->files_id);
 
    if (!mongoc_collection_remove (file->gridfs->files,
@@ -47,6 +47,9 @@ BSON_BEGIN_DECLS
 typedef struct _mongoc_gridfs_file_t mongoc_gridfs_file_t;
 typedef struct _mongoc_gridfs_file_opt_t mongoc_gridfs_file_opt_t;
 
+/* forward decl */
+struct _mongoc_client_pool_t;
+
 
 struct _mongoc_gridfs_file_opt_t {
    const char *md5;
@@ -88,6 +91,15 @@ mongoc_gridfs_file_readv (mongoc_gridfs_file_t *file,
                           size_t iovcnt,
                           size_t min_bytes,
                           uint32_t timeout_msec);
+BSON_EXPORT (ssize_t)
+mongoc_gridfs_file_read_span (mongoc_gridfs_file_t *file,
+                              const uint8_t **data,
+                              size_t max_len);
+BSON_EXPORT (int64_t)
+mongoc_gridfs_file_write_to_stream (mongoc_gridfs_file_t *file,
+                                    mongoc_stream_t *stream,
+                                    int32_t timeout_msec,
+                                    bson_error_t *error);
 BSON_EXPORT (int)
 mongoc_gridfs_file_seek (mongoc_gridfs_file_t *file, int64_t delta, int whence);
 
@@ -111,6 +123,15 @@ mongoc_gridfs_file_error (mongoc_gridfs_file_t *file, bson_error_t *error);
 BSON_EXPORT (bool)
 mongoc_gridfs_file_remove (mongoc_gridfs_file_t *file, bson_error_t *error);
 
+BSON_EXPORT (void)
+mongoc_gridfs_file_set_concurrency (mongoc_gridfs_file_t *file,
+                                    struct _mongoc_client_pool_t *pool,
+                                    uint32_t max_concurrency);
+
+BSON_EXPORT (void)
+mongoc_gridfs_file_set_batch_size (mongoc_gridfs_file_t *file,
+                                   uint32_t batch_size);
+
 BSON_END_DECLS
 
 #endif /* MONGOC_GRIDFS_FILE_H */
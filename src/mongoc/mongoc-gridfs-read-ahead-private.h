@@ -0,0 +1,90 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_GRIDFS_READ_AHEAD_PRIVATE_H
+#define MONGOC_GRIDFS_READ_AHEAD_PRIVATE_H
+
+#if !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-client.h"
+#include "mongoc-client-pool.h"
+#include "mongoc-collection.h"
+#include "mongoc-gridfs-file.h"
+#include "mongoc-thread-private.h"
+
+
+BSON_BEGIN_DECLS
+
+
+/* how many bytes of chunks each read-ahead query fetches */
+#ifndef MONGOC_GRIDFS_READ_AHEAD_SIZE
+#define MONGOC_GRIDFS_READ_AHEAD_SIZE (4 * 1024 * 1024)
+#endif
+
+
+/* one range of chunks, fetched on a background thread with a pooled client,
+ * or by the reader if the pool had no client to spare */
+typedef struct {
+   int64_t range; /* -1 if unused */
+   int32_t first; /* first chunk number in the range */
+   int32_t last;  /* one past the last chunk number */
+   bson_value_t files_id;
+   bson_t **chunks; /* indexed by chunk number - first, NULL if missing */
+   bool started;    /* a thread is fetching the range */
+   bool done;
+   bool ok;
+   bson_error_t error;
+   mongoc_thread_t thread;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+} mongoc_gridfs_read_ahead_slot_t;
+
+
+/* a window of n_slots ranges, starting with the range being read */
+typedef struct {
+   mongoc_client_pool_t *pool;
+   int32_t chunks_per_range;
+   uint32_t n_slots;
+   mongoc_gridfs_read_ahead_slot_t *slots;
+} mongoc_gridfs_read_ahead_t;
+
+
+mongoc_gridfs_read_ahead_t *
+_mongoc_gridfs_read_ahead_new (mongoc_client_pool_t *pool,
+                               uint32_t max_concurrency,
+                               int32_t chunk_size);
+
+const bson_t *
+_mongoc_gridfs_read_ahead_get (mongoc_gridfs_read_ahead_t *read_ahead,
+                               mongoc_gridfs_file_t *file,
+                               int32_t n,
+                               bson_error_t *error);
+
+void
+_mongoc_gridfs_read_ahead_reset (mongoc_gridfs_read_ahead_t *read_ahead);
+
+void
+_mongoc_gridfs_read_ahead_destroy (mongoc_gridfs_read_ahead_t *read_ahead);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_GRIDFS_READ_AHEAD_PRIVATE_H */
@@ -0,0 +1,328 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mongoc-collection-private.h"
+#include "mongoc-cursor.h"
+#include "mongoc-error.h"
+#include "mongoc-gridfs-private.h"
+#include "mongoc-gridfs-file-private.h"
+#include "mongoc-gridfs-read-ahead-private.h"
+#include "mongoc-trace-private.h"
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "gridfs_read_ahead"
+
+
+mongoc_gridfs_read_ahead_t *
+_mongoc_gridfs_read_ahead_new (mongoc_client_pool_t *pool,
+                               uint32_t max_concurrency,
+                               int32_t chunk_size)
+{
+   mongoc_gridfs_read_ahead_t *read_ahead;
+   uint32_t i;
+
+   BSON_ASSERT (pool);
+   BSON_ASSERT (max_concurrency > 0);
+
+   read_ahead =
+      (mongoc_gridfs_read_ahead_t *) bson_malloc0 (sizeof *read_ahead);
+
+   read_ahead->pool = pool;
+   read_ahead->chunks_per_range =
+      chunk_size > 0 ? MONGOC_GRIDFS_READ_AHEAD_SIZE / chunk_size : 1;
+   read_ahead->chunks_per_range = BSON_MAX (read_ahead->chunks_per_range, 1);
+   read_ahead->n_slots = max_concurrency;
+   read_ahead->slots = (mongoc_gridfs_read_ahead_slot_t *) bson_malloc0 (
+      max_concurrency * sizeof (mongoc_gridfs_read_ahead_slot_t));
+
+   for (i = 0; i < max_concurrency; i++) {
+      read_ahead->slots[i].range = -1;
+   }
+
+   return read_ahead;
+}
+
+
+/* query for a range's chunks and keep copies of them in the slot */
+static void
+_mongoc_gridfs_read_ahead_fetch (mongoc_gridfs_read_ahead_slot_t *slot,
+                                 mongoc_collection_t *collection)
+{
+   mongoc_cursor_t *cursor;
+   const bson_t *chunk;
+   bson_iter_t iter;
+   bson_t query;
+   bson_t opts;
+   bson_t child;
+   int32_t n;
+
+   bson_init (&query);
+   BSON_APPEND_VALUE (&query, "files_id", &slot->files_id);
+   BSON_APPEND_DOCUMENT_BEGIN (&query, "n", &child);
+   BSON_APPEND_INT32 (&child, "$gte", slot->first);
+   BSON_APPEND_INT32 (&child, "$lt", slot->last);
+   bson_append_document_end (&query, &child);
+
+   bson_init (&opts);
+   BSON_APPEND_DOCUMENT_BEGIN (&opts, "sort", &child);
+   BSON_APPEND_INT32 (&child, "n", 1);
+   bson_append_document_end (&opts, &child);
+
+   BSON_APPEND_DOCUMENT_BEGIN (&opts, "projection", &child);
+   BSON_APPEND_INT32 (&child, "n", 1);
+   BSON_APPEND_INT32 (&child, "data", 1);
+   BSON_APPEND_INT32 (&child, "_id", 0);
+   bson_append_document_end (&opts, &child);
+
+   cursor = mongoc_collection_find_with_opts (collection, &query, &opts, NULL);
+
+   while (mongoc_cursor_next (cursor, &chunk)) {
+      if (!bson_iter_init_find (&iter, chunk, "n") ||
+          !BSON_ITER_HOLDS_INT32 (&iter)) {
+         continue;
+      }
+
+      n = bson_iter_int32 (&iter);
+      if (n < slot->first || n >= slot->last) {
+         continue;
+      }
+
+      if (!slot->chunks[n - slot->first]) {
+         slot->chunks[n - slot->first] = bson_copy (chunk);
+      }
+   }
+
+   slot->ok = !mongoc_cursor_error (cursor, &slot->error);
+
+   mongoc_cursor_destroy (cursor);
+   bson_destroy (&query);
+   bson_destroy (&opts);
+}
+
+
+static void *
+_mongoc_gridfs_read_ahead_run (void *data)
+{
+   mongoc_gridfs_read_ahead_slot_t *slot;
+
+   slot = (mongoc_gridfs_read_ahead_slot_t *) data;
+   _mongoc_gridfs_read_ahead_fetch (slot, slot->collection);
+
+   return NULL;
+}
+
+
+/* wait for the slot's thread, if any, and return its client to the pool */
+static void
+_mongoc_gridfs_read_ahead_join (mongoc_gridfs_read_ahead_t *read_ahead,
+                                mongoc_gridfs_read_ahead_slot_t *slot)
+{
+   if (slot->started) {
+      mongoc_thread_join (slot->thread);
+      slot->started = false;
+      slot->done = true;
+   }
+
+   if (slot->collection) {
+      mongoc_collection_destroy (slot->collection);
+      slot->collection = NULL;
+   }
+
+   if (slot->client) {
+      mongoc_client_pool_push (read_ahead->pool, slot->client);
+      slot->client = NULL;
+   }
+}
+
+
+static void
+_mongoc_gridfs_read_ahead_clear (mongoc_gridfs_read_ahead_t *read_ahead,
+                                 mongoc_gridfs_read_ahead_slot_t *slot)
+{
+   int32_t i;
+
+   if (slot->range < 0) {
+      return;
+   }
+
+   _mongoc_gridfs_read_ahead_join (read_ahead, slot);
+
+   for (i = 0; i < slot->last - slot->first; i++) {
+      if (slot->chunks[i]) {
+         bson_destroy (slot->chunks[i]);
+      }
+   }
+
+   bson_free (slot->chunks);
+   bson_value_destroy (&slot->files_id);
+   memset (slot, 0, sizeof *slot);
+   slot->range = -1;
+}
+
+
+/* start fetching a range on a background thread, unless it is already
+ * being fetched or the pool has no client to spare. a range that found no
+ * client is tried again on the next call, since the reader returns a client
+ * to the pool each time it finishes waiting for a range */
+static void
+_mongoc_gridfs_read_ahead_start (mongoc_gridfs_read_ahead_t *read_ahead,
+                                 mongoc_gridfs_file_t *file,
+                                 int64_t range,
+                                 int32_t n_chunks)
+{
+   mongoc_gridfs_read_ahead_slot_t *slot;
+   mongoc_collection_t *chunks;
+
+   slot = &read_ahead->slots[range % read_ahead->n_slots];
+   if (slot->range == range) {
+      if (slot->started || slot->done) {
+         return;
+      }
+   } else {
+      /* the slot holds a range behind the reader, or beyond the window */
+      _mongoc_gridfs_read_ahead_clear (read_ahead, slot);
+
+      slot->range = range;
+      slot->first = (int32_t) (range * read_ahead->chunks_per_range);
+      slot->last =
+         BSON_MIN (slot->first + read_ahead->chunks_per_range, n_chunks);
+      slot->chunks = (bson_t **) bson_malloc0 ((slot->last - slot->first) *
+                                               sizeof (bson_t *));
+      bson_value_copy (&file->files_id, &slot->files_id);
+   }
+
+   slot->client = mongoc_client_pool_try_pop (read_ahead->pool);
+   if (!slot->client) {
+      return;
+   }
+
+   chunks = file->gridfs->chunks;
+   slot->collection = mongoc_client_get_collection (
+      slot->client, chunks->db, chunks->collection);
+   mongoc_collection_set_read_prefs (slot->collection,
+                                     mongoc_collection_get_read_prefs (chunks));
+   mongoc_collection_set_read_concern (
+      slot->collection, mongoc_collection_get_read_concern (chunks));
+
+   if (mongoc_thread_create (
+          &slot->thread, _mongoc_gridfs_read_ahead_run, slot)) {
+      _mongoc_gridfs_read_ahead_join (read_ahead, slot);
+      return;
+   }
+
+   slot->started = true;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_gridfs_read_ahead_get --
+ *
+ *       Get chunk @n of @file. Fetch the ranges from @n's through the end
+ *       of the window concurrently, then wait for @n's range. If no pooled
+ *       client was free to fetch @n's range, fetch it with @file's own.
+ *
+ * Returns:
+ *       The chunk, valid until the reader moves to another range or the
+ *       read-ahead is reset, or NULL with @error set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+const bson_t *
+_mongoc_gridfs_read_ahead_get (mongoc_gridfs_read_ahead_t *read_ahead,
+                               mongoc_gridfs_file_t *file,
+                               int32_t n,
+                               bson_error_t *error)
+{
+   mongoc_gridfs_read_ahead_slot_t *slot;
+   const bson_t *chunk;
+   int64_t range;
+   int32_t n_chunks;
+   uint32_t i;
+
+   ENTRY;
+
+   BSON_ASSERT (read_ahead);
+   BSON_ASSERT (file);
+   BSON_ASSERT (n >= 0);
+
+   n_chunks = (int32_t) ((file->length + file->chunk_size - 1) /
+                         file->chunk_size);
+   range = n / read_ahead->chunks_per_range;
+
+   for (i = 0; i < read_ahead->n_slots; i++) {
+      if ((range + i) * read_ahead->chunks_per_range >= n_chunks) {
+         break;
+      }
+
+      _mongoc_gridfs_read_ahead_start (read_ahead, file, range + i, n_chunks);
+   }
+
+   slot = &read_ahead->slots[range % read_ahead->n_slots];
+   BSON_ASSERT (slot->range == range);
+
+   if (slot->started) {
+      _mongoc_gridfs_read_ahead_join (read_ahead, slot);
+   } else if (!slot->done) {
+      _mongoc_gridfs_read_ahead_fetch (slot, file->gridfs->chunks);
+      slot->done = true;
+   }
+
+   if (!slot->ok) {
+      memcpy (error, &slot->error, sizeof *error);
+      RETURN (NULL);
+   }
+
+   chunk = n < slot->last ? slot->chunks[n - slot->first] : NULL;
+   if (!chunk) {
+      bson_set_error (error,
+                      MONGOC_ERROR_GRIDFS,
+                      MONGOC_ERROR_GRIDFS_CHUNK_MISSING,
+                      "missing chunk number %" PRId32,
+                      n);
+      RETURN (NULL);
+   }
+
+   RETURN (chunk);
+}
+
+
+/* discard all ranges, after the file is modified */
+void
+_mongoc_gridfs_read_ahead_reset (mongoc_gridfs_read_ahead_t *read_ahead)
+{
+   uint32_t i;
+
+   BSON_ASSERT (read_ahead);
+
+   for (i = 0; i < read_ahead->n_slots; i++) {
+      _mongoc_gridfs_read_ahead_clear (read_ahead, &read_ahead->slots[i]);
+   }
+}
+
+
+void
+_mongoc_gridfs_read_ahead_destroy (mongoc_gridfs_read_ahead_t *read_ahead)
+{
+   if (read_ahead) {
+      _mongoc_gridfs_read_ahead_reset (read_ahead);
+      bson_free (read_ahead->slots);
+      bson_free (read_ahead);
+   }
+}
@@ -55,7 +55,9 @@ typedef enum {
    MONGOC_MD_FLAG_HAVE_SASL_CLIENT_DONE = 1 << 11,
    MONGOC_MD_FLAG_HAVE_WEAK_SYMBOLS = 1 << 12,
    MONGOC_MD_FLAG_NO_AUTOMATIC_GLOBALS = 1 << 13,
-   MONGOC_MD_FLAG_ENABLE_SSL_LIBRESSL = 1 << 14
+   MONGOC_MD_FLAG_ENABLE_SSL_LIBRESSL = 1 << 14,
+   MONGOC_MD_FLAG_ENABLE_COMPRESSION_SNAPPY = 1 << 15,
+   MONGOC_MD_FLAG_ENABLE_COMPRESSION_ZLIB = 1 << 16
 } mongoc_handshake_config_flags_t;
 
 
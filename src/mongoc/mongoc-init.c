@@ -22,6 +22,8 @@
 #include "mongoc-init.h"
 
 #include "mongoc-handshake-private.h"
+#include "mongoc-matcher-regex-private.h"
+#include "mongoc-resolver-private.h"
 
 #ifdef MONGOC_ENABLE_SSL
 #include "mongoc-scram-private.h"
@@ -111,6 +113,7 @@ static MONGOC_ONCE_FUN (_mongoc_do_init)
 #endif
 
    _mongoc_counters_init ();
+   _mongoc_resolver_init ();
 
 #ifdef _WIN32
    {
@@ -155,11 +158,15 @@ static MONGOC_ONCE_FUN (_mongoc_do_cleanup)
 #endif
 #endif
 
+   /* waits for lookups in flight, which need Winsock */
+   _mongoc_resolver_cleanup ();
+
 #ifdef _WIN32
    WSACleanup ();
 #endif
 
    _mongoc_counters_cleanup ();
+   _mongoc_matcher_regex_cleanup ();
 
    _mongoc_handshake_cleanup ();
 
@@ -23,6 +23,8 @@
 
 #include <bson.h>
 
+#include "mongoc-matcher-regex-private.h"
+
 
 BSON_BEGIN_DECLS
 
@@ -34,6 +36,8 @@ typedef struct _mongoc_matcher_op_compare_t mongoc_matcher_op_compare_t;
 typedef struct _mongoc_matcher_op_exists_t mongoc_matcher_op_exists_t;
 typedef struct _mongoc_matcher_op_type_t mongoc_matcher_op_type_t;
 typedef struct _mongoc_matcher_op_not_t mongoc_matcher_op_not_t;
+typedef struct _mongoc_matcher_op_regex_t mongoc_matcher_op_regex_t;
+typedef struct _mongoc_matcher_op_elem_match_t mongoc_matcher_op_elem_match_t;
 
 
 typedef enum {
@@ -51,6 +55,11 @@ typedef enum {
    MONGOC_MATCHER_OPCODE_NOR,
    MONGOC_MATCHER_OPCODE_EXISTS,
    MONGOC_MATCHER_OPCODE_TYPE,
+   MONGOC_MATCHER_OPCODE_ALL,
+   MONGOC_MATCHER_OPCODE_SIZE,
+   MONGOC_MATCHER_OPCODE_MOD,
+   MONGOC_MATCHER_OPCODE_REGEX,
+   MONGOC_MATCHER_OPCODE_ELEM_MATCH,
 } mongoc_matcher_opcode_t;
 
 
@@ -94,6 +103,23 @@ struct _mongoc_matcher_op_not_t {
 };
 
 
+struct _mongoc_matcher_op_regex_t {
+   mongoc_matcher_op_base_t base;
+   char *path;
+   char *pattern;
+   char *options;
+   mongoc_matcher_regex_t *regex;
+};
+
+
+struct _mongoc_matcher_op_elem_match_t {
+   mongoc_matcher_op_base_t base;
+   char *path;
+   mongoc_matcher_op_t *child;
+   bool values; /* child matches element values, not documents */
+};
+
+
 union _mongoc_matcher_op_t {
    mongoc_matcher_op_base_t base;
    mongoc_matcher_op_logical_t logical;
@@ -101,6 +127,8 @@ union _mongoc_matcher_op_t {
    mongoc_matcher_op_exists_t exists;
    mongoc_matcher_op_type_t type;
    mongoc_matcher_op_not_t not_;
+   mongoc_matcher_op_regex_t regex;
+   mongoc_matcher_op_elem_match_t elem_match;
 };
 
 
@@ -118,8 +146,30 @@ mongoc_matcher_op_t *
 _mongoc_matcher_op_type_new (const char *path, bson_type_t type);
 mongoc_matcher_op_t *
 _mongoc_matcher_op_not_new (const char *path, mongoc_matcher_op_t *child);
+mongoc_matcher_op_t *
+_mongoc_matcher_op_regex_new (const char *path,
+                              const char *pattern,
+                              const char *options,
+                              bson_error_t *error);
+mongoc_matcher_op_t *
+_mongoc_matcher_op_elem_match_new (const char *path,
+                                   mongoc_matcher_op_t *child,
+                                   bool values);
 bool
 _mongoc_matcher_op_match (mongoc_matcher_op_t *op, const bson_t *bson);
+bool
+_mongoc_matcher_op_compare_iter_match (mongoc_matcher_op_compare_t *compare,
+                                       bson_iter_t *iter);
+bool
+_mongoc_matcher_op_value_match (mongoc_matcher_op_t *op, bson_iter_t *iter);
+bool
+_mongoc_matcher_iter_eq_match (bson_iter_t *compare_iter, bson_iter_t *iter);
+bool
+_mongoc_matcher_iter_size_match (bson_iter_t *iter, int64_t size);
+bool
+_mongoc_matcher_iter_mod_match (bson_iter_t *iter,
+                                int64_t divisor,
+                                int64_t remainder);
 void
 _mongoc_matcher_op_destroy (mongoc_matcher_op_t *op);
 void
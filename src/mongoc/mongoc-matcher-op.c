@@ -144,6 +144,9 @@ _mongoc_matcher_op_logical_new (mongoc_matcher_opcode_t opcode, /* IN */
  *          {$ne: {...}
  *          {$in: [...]}
  *          {$nin: [...]}
+ *          {$all: [...]}
+ *          {$size: n}
+ *          {$mod: [divisor, remainder]}
  *
  * Returns:
  *       A newly allocated mongoc_matcher_op_t that should be freed with
@@ -209,6 +212,97 @@ _mongoc_matcher_op_not_new (const char *path,           /* IN */
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_op_regex_new --
+ *
+ *       Create a new op for checking {$regex: pattern, $options: options}.
+ *       The compiled pattern is shared with other matchers through the
+ *       cache in mongoc-matcher-regex.c.
+ *
+ * Returns:
+ *       A newly allocated mongoc_matcher_op_t that should be freed with
+ *       _mongoc_matcher_op_destroy(), or NULL and @error is set if the
+ *       pattern or options are invalid.
+ *
+ * Side effects:
+ *       @error may be set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_matcher_op_t *
+_mongoc_matcher_op_regex_new (const char *path,    /* IN */
+                              const char *pattern, /* IN */
+                              const char *options, /* IN */
+                              bson_error_t *error) /* OUT */
+{
+   mongoc_matcher_regex_t *regex;
+   mongoc_matcher_op_t *op;
+
+   BSON_ASSERT (path);
+   BSON_ASSERT (pattern);
+
+   if (!options) {
+      options = "";
+   }
+
+   if (!(regex = _mongoc_matcher_regex_get (pattern, options, error))) {
+      return NULL;
+   }
+
+   op = (mongoc_matcher_op_t *) bson_malloc0 (sizeof *op);
+   op->regex.base.opcode = MONGOC_MATCHER_OPCODE_REGEX;
+   op->regex.path = bson_strdup (path);
+   op->regex.pattern = bson_strdup (pattern);
+   op->regex.options = bson_strdup (options);
+   op->regex.regex = regex;
+
+   return op;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_op_elem_match_new --
+ *
+ *       Create a new op for checking {$elemMatch: {...}}. If @values is
+ *       true, @child is matched against each element of the array, as in
+ *       {$elemMatch: {$gte: 1, $lt: 5}}. Otherwise @child is a query
+ *       matched against each element that is a document.
+ *
+ * Returns:
+ *       A newly allocated mongoc_matcher_op_t that should be freed with
+ *       _mongoc_matcher_op_destroy().
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_matcher_op_t *
+_mongoc_matcher_op_elem_match_new (const char *path,           /* IN */
+                                   mongoc_matcher_op_t *child, /* IN */
+                                   bool values)                /* IN */
+{
+   mongoc_matcher_op_t *op;
+
+   BSON_ASSERT (path);
+   BSON_ASSERT (child);
+
+   op = (mongoc_matcher_op_t *) bson_malloc0 (sizeof *op);
+   op->elem_match.base.opcode = MONGOC_MATCHER_OPCODE_ELEM_MATCH;
+   op->elem_match.path = bson_strdup (path);
+   op->elem_match.child = child;
+   op->elem_match.values = values;
+
+   return op;
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -238,6 +332,9 @@ _mongoc_matcher_op_destroy (mongoc_matcher_op_t *op) /* IN */
    case MONGOC_MATCHER_OPCODE_LTE:
    case MONGOC_MATCHER_OPCODE_NE:
    case MONGOC_MATCHER_OPCODE_NIN:
+   case MONGOC_MATCHER_OPCODE_ALL:
+   case MONGOC_MATCHER_OPCODE_SIZE:
+   case MONGOC_MATCHER_OPCODE_MOD:
       bson_free (op->compare.path);
       break;
    case MONGOC_MATCHER_OPCODE_OR:
@@ -258,6 +355,16 @@ _mongoc_matcher_op_destroy (mongoc_matcher_op_t *op) /* IN */
    case MONGOC_MATCHER_OPCODE_TYPE:
       bson_free (op->type.path);
       break;
+   case MONGOC_MATCHER_OPCODE_REGEX:
+      _mongoc_matcher_regex_release (op->regex.regex);
+      bson_free (op->regex.path);
+      bson_free (op->regex.pattern);
+      bson_free (op->regex.options);
+      break;
+   case MONGOC_MATCHER_OPCODE_ELEM_MATCH:
+      _mongoc_matcher_op_destroy (op->elem_match.child);
+      bson_free (op->elem_match.path);
+      break;
    default:
       break;
    }
@@ -334,7 +441,7 @@ _mongoc_matcher_op_type_match (mongoc_matcher_op_type_t *type, /* IN */
 
    if (bson_iter_init (&iter, bson) &&
        bson_iter_find_descendant (&iter, type->path, &desc)) {
-      return (bson_iter_type (&iter) == type->type);
+      return (bson_iter_type (&desc) == type->type);
    }
 
    return false;
@@ -410,7 +517,7 @@ _mongoc_matcher_op_not_match (mongoc_matcher_op_not_t *not_, /* IN */
  *--------------------------------------------------------------------------
  */
 
-static bool
+bool
 _mongoc_matcher_iter_eq_match (bson_iter_t *compare_iter, /* IN */
                                bson_iter_t *iter)         /* IN */
 {
@@ -919,10 +1026,184 @@ _mongoc_matcher_op_nin_match (mongoc_matcher_op_compare_t *compare, /* IN */
 /*
  *--------------------------------------------------------------------------
  *
- * _mongoc_matcher_op_compare_match --
+ * _mongoc_matcher_op_all_match --
+ *
+ *       Perform a {"path": {"$all": [value1, value2, ...]}} match.
+ *
+ * Returns:
+ *       true if each value equals an element of the array at "path", or
+ *       the array itself. A value that is not an array must equal each
+ *       value. An empty $all matches nothing.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_matcher_op_all_match (mongoc_matcher_op_compare_t *compare, /* IN */
+                              bson_iter_t *iter)                    /* IN */
+{
+   bson_iter_t operand;
+   bson_iter_t elem;
+   bool found = false;
+
+   if (!BSON_ITER_HOLDS_ARRAY (&compare->iter) ||
+       !bson_iter_recurse (&compare->iter, &operand)) {
+      return false;
+   }
+
+   while (bson_iter_next (&operand)) {
+      found = false;
+
+      if (BSON_ITER_HOLDS_ARRAY (iter) && bson_iter_recurse (iter, &elem)) {
+         while (!found && bson_iter_next (&elem)) {
+            found = _mongoc_matcher_iter_eq_match (&operand, &elem);
+         }
+      }
+
+      if (!found && !_mongoc_matcher_iter_eq_match (&operand, iter)) {
+         return false;
+      }
+
+      found = true;
+   }
+
+   return found;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_iter_size_match --
+ *
+ *       Check if @iter holds an array of @size elements, as for
+ *       {"path": {"$size": size}}.
+ *
+ * Returns:
+ *       true if the array has @size elements, false if it has not or
+ *       @iter does not hold an array.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_matcher_iter_size_match (bson_iter_t *iter, /* IN */
+                                 int64_t size)      /* IN */
+{
+   bson_iter_t child;
+   int64_t n = 0;
+
+   if (!BSON_ITER_HOLDS_ARRAY (iter) || !bson_iter_recurse (iter, &child)) {
+      return false;
+   }
+
+   while (n <= size && bson_iter_next (&child)) {
+      n++;
+   }
+
+   return n == size;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_iter_mod_match --
+ *
+ *       Check if @iter holds a number that leaves @remainder when divided
+ *       by @divisor, as for {"path": {"$mod": [divisor, remainder]}}.
+ *       Doubles are truncated to integers first.
+ *
+ * Returns:
+ *       true if the spec matched. false for non-numbers, NaN, and
+ *       doubles outside the range of int64.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_matcher_iter_mod_match (bson_iter_t *iter, /* IN */
+                                int64_t divisor,   /* IN */
+                                int64_t remainder) /* IN */
+{
+   int64_t value;
+   double d;
+
+   BSON_ASSERT (divisor != 0);
+
+   switch (bson_iter_type (iter)) {
+   case BSON_TYPE_INT32:
+      value = bson_iter_int32 (iter);
+      break;
+   case BSON_TYPE_INT64:
+      value = bson_iter_int64 (iter);
+      break;
+   case BSON_TYPE_DOUBLE:
+      d = bson_iter_double (iter);
+      if (!(d >= -9223372036854775808.0 && d < 9223372036854775808.0)) {
+         return false;
+      }
+
+      value = (int64_t) d;
+      break;
+   default:
+      return false;
+   }
+
+   /* INT64_MIN % -1 overflows */
+   return (divisor == -1 ? 0 : value % divisor) == remainder;
+}
+
+
+static bool
+_mongoc_matcher_op_size_match (mongoc_matcher_op_compare_t *compare, /* IN */
+                               bson_iter_t *iter)                    /* IN */
+{
+   return _mongoc_matcher_iter_size_match (iter,
+                                           bson_iter_as_int64 (&compare->iter));
+}
+
+
+/* the operand was checked to be [divisor, remainder] when it was parsed */
+static bool
+_mongoc_matcher_op_mod_match (mongoc_matcher_op_compare_t *compare, /* IN */
+                              bson_iter_t *iter)                    /* IN */
+{
+   bson_iter_t operand;
+   int64_t divisor;
+
+   if (!bson_iter_recurse (&compare->iter, &operand) ||
+       !bson_iter_next (&operand)) {
+      return false;
+   }
+
+   divisor = bson_iter_as_int64 (&operand);
+   if (!bson_iter_next (&operand)) {
+      return false;
+   }
+
+   return _mongoc_matcher_iter_mod_match (
+      iter, divisor, bson_iter_as_int64 (&operand));
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_op_compare_iter_match --
  *
  *       Dispatch function for mongoc_matcher_op_compare_t operations
- *       to perform a match.
+ *       to perform a match against the value at @iter, which was found
+ *       at the op's path.
  *
  * Returns:
  *       Opcode dependent.
@@ -933,6 +1214,62 @@ _mongoc_matcher_op_nin_match (mongoc_matcher_op_compare_t *compare, /* IN */
  *--------------------------------------------------------------------------
  */
 
+bool
+_mongoc_matcher_op_compare_iter_match (
+   mongoc_matcher_op_compare_t *compare, /* IN */
+   bson_iter_t *iter)                    /* IN */
+{
+   BSON_ASSERT (compare);
+   BSON_ASSERT (iter);
+
+   switch ((int) compare->base.opcode) {
+   case MONGOC_MATCHER_OPCODE_EQ:
+      return _mongoc_matcher_op_eq_match (compare, iter);
+   case MONGOC_MATCHER_OPCODE_GT:
+      return _mongoc_matcher_op_gt_match (compare, iter);
+   case MONGOC_MATCHER_OPCODE_GTE:
+      return _mongoc_matcher_op_gte_match (compare, iter);
+   case MONGOC_MATCHER_OPCODE_IN:
+      return _mongoc_matcher_op_in_match (compare, iter);
+   case MONGOC_MATCHER_OPCODE_LT:
+      return _mongoc_matcher_op_lt_match (compare, iter);
+   case MONGOC_MATCHER_OPCODE_LTE:
+      return _mongoc_matcher_op_lte_match (compare, iter);
+   case MONGOC_MATCHER_OPCODE_NE:
+      return _mongoc_matcher_op_ne_match (compare, iter);
+   case MONGOC_MATCHER_OPCODE_NIN:
+      return _mongoc_matcher_op_nin_match (compare, iter);
+   case MONGOC_MATCHER_OPCODE_ALL:
+      return _mongoc_matcher_op_all_match (compare, iter);
+   case MONGOC_MATCHER_OPCODE_SIZE:
+      return _mongoc_matcher_op_size_match (compare, iter);
+   case MONGOC_MATCHER_OPCODE_MOD:
+      return _mongoc_matcher_op_mod_match (compare, iter);
+   default:
+      BSON_ASSERT (false);
+      break;
+   }
+
+   return false;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_op_compare_match --
+ *
+ *       Find the value at the op's path in @bson and match it.
+ *
+ * Returns:
+ *       false if the path is not found, otherwise opcode dependent.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
 static bool
 _mongoc_matcher_op_compare_match (mongoc_matcher_op_compare_t *compare, /* IN */
                                   const bson_t *bson)                   /* IN */
@@ -952,25 +1289,152 @@ _mongoc_matcher_op_compare_match (mongoc_matcher_op_compare_t *compare, /* IN */
       return false;
    }
 
-   switch ((int) compare->base.opcode) {
+   return _mongoc_matcher_op_compare_iter_match (compare, &iter);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_op_regex_match --
+ *
+ *       Perform a {"path": {"$regex": pattern}} match against the value
+ *       at @iter.
+ *
+ * Returns:
+ *       true if @iter holds a string the pattern matches.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_matcher_op_regex_match (mongoc_matcher_op_regex_t *regex, /* IN */
+                                bson_iter_t *iter)                /* IN */
+{
+   return BSON_ITER_HOLDS_UTF8 (iter) &&
+          _mongoc_matcher_regex_match (regex->regex,
+                                       bson_iter_utf8 (iter, NULL));
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_op_elem_match_match --
+ *
+ *       Perform a {"path": {"$elemMatch": {...}}} match against the value
+ *       at @iter.
+ *
+ * Returns:
+ *       true if @iter holds an array with at least one element that
+ *       matches the op's child.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_matcher_op_elem_match_match (
+   mongoc_matcher_op_elem_match_t *elem_match, /* IN */
+   bson_iter_t *iter)                          /* IN */
+{
+   bson_iter_t child;
+   const uint8_t *data;
+   uint32_t len;
+   bson_t doc;
+
+   if (!BSON_ITER_HOLDS_ARRAY (iter) || !bson_iter_recurse (iter, &child)) {
+      return false;
+   }
+
+   while (bson_iter_next (&child)) {
+      if (elem_match->values) {
+         if (_mongoc_matcher_op_value_match (elem_match->child, &child)) {
+            return true;
+         }
+      } else if (BSON_ITER_HOLDS_DOCUMENT (&child)) {
+         bson_iter_document (&child, &len, &data);
+         if (bson_init_static (&doc, data, len) &&
+             _mongoc_matcher_op_match (elem_match->child, &doc)) {
+            return true;
+         }
+      }
+   }
+
+   return false;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_op_value_match --
+ *
+ *       Match an op that tests a single value against the value at
+ *       @iter, ignoring the op's path. These are comparisons, $exists,
+ *       $type, $regex, $elemMatch, and $not or logical ops of them, as
+ *       in {$elemMatch: {$gte: 1, $lt: 5}}.
+ *
+ *       @iter is NULL if the value is missing.
+ *
+ * Returns:
+ *       Opcode specific. A missing value only matches {$exists: false}
+ *       and the negation of ops it does not match.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_matcher_op_value_match (mongoc_matcher_op_t *op, /* IN */
+                                bson_iter_t *iter)       /* IN */
+{
+   BSON_ASSERT (op);
+
+   switch (op->base.opcode) {
    case MONGOC_MATCHER_OPCODE_EQ:
-      return _mongoc_matcher_op_eq_match (compare, &iter);
    case MONGOC_MATCHER_OPCODE_GT:
-      return _mongoc_matcher_op_gt_match (compare, &iter);
    case MONGOC_MATCHER_OPCODE_GTE:
-      return _mongoc_matcher_op_gte_match (compare, &iter);
    case MONGOC_MATCHER_OPCODE_IN:
-      return _mongoc_matcher_op_in_match (compare, &iter);
    case MONGOC_MATCHER_OPCODE_LT:
-      return _mongoc_matcher_op_lt_match (compare, &iter);
    case MONGOC_MATCHER_OPCODE_LTE:
-      return _mongoc_matcher_op_lte_match (compare, &iter);
    case MONGOC_MATCHER_OPCODE_NE:
-      return _mongoc_matcher_op_ne_match (compare, &iter);
    case MONGOC_MATCHER_OPCODE_NIN:
-      return _mongoc_matcher_op_nin_match (compare, &iter);
+   case MONGOC_MATCHER_OPCODE_ALL:
+   case MONGOC_MATCHER_OPCODE_SIZE:
+   case MONGOC_MATCHER_OPCODE_MOD:
+      return iter && _mongoc_matcher_op_compare_iter_match (&op->compare, iter);
+   case MONGOC_MATCHER_OPCODE_OR:
+      return _mongoc_matcher_op_value_match (op->logical.left, iter) ||
+             (op->logical.right &&
+              _mongoc_matcher_op_value_match (op->logical.right, iter));
+   case MONGOC_MATCHER_OPCODE_AND:
+      return _mongoc_matcher_op_value_match (op->logical.left, iter) &&
+             (!op->logical.right ||
+              _mongoc_matcher_op_value_match (op->logical.right, iter));
+   case MONGOC_MATCHER_OPCODE_NOR:
+      return !(_mongoc_matcher_op_value_match (op->logical.left, iter) ||
+               (op->logical.right &&
+                _mongoc_matcher_op_value_match (op->logical.right, iter)));
+   case MONGOC_MATCHER_OPCODE_NOT:
+      return !_mongoc_matcher_op_value_match (op->not_.child, iter);
+   case MONGOC_MATCHER_OPCODE_EXISTS:
+      return (iter != NULL) == op->exists.exists;
+   case MONGOC_MATCHER_OPCODE_TYPE:
+      return iter && bson_iter_type (iter) == op->type.type;
+   case MONGOC_MATCHER_OPCODE_REGEX:
+      return iter && _mongoc_matcher_op_regex_match (&op->regex, iter);
+   case MONGOC_MATCHER_OPCODE_ELEM_MATCH:
+      return iter &&
+             _mongoc_matcher_op_elem_match_match (&op->elem_match, iter);
    default:
-      BSON_ASSERT (false);
       break;
    }
 
@@ -978,6 +1442,24 @@ _mongoc_matcher_op_compare_match (mongoc_matcher_op_compare_t *compare, /* IN */
 }
 
 
+/* find @path in @bson and match @op against the value there, if any */
+static bool
+_mongoc_matcher_op_path_match (mongoc_matcher_op_t *op, /* IN */
+                               const char *path,        /* IN */
+                               const bson_t *bson)      /* IN */
+{
+   bson_iter_t tmp;
+   bson_iter_t iter;
+
+   if (bson_iter_init (&tmp, bson) &&
+       bson_iter_find_descendant (&tmp, path, &iter)) {
+      return _mongoc_matcher_op_value_match (op, &iter);
+   }
+
+   return _mongoc_matcher_op_value_match (op, NULL);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -1053,6 +1535,9 @@ _mongoc_matcher_op_match (mongoc_matcher_op_t *op, /* IN */
    case MONGOC_MATCHER_OPCODE_LTE:
    case MONGOC_MATCHER_OPCODE_NE:
    case MONGOC_MATCHER_OPCODE_NIN:
+   case MONGOC_MATCHER_OPCODE_ALL:
+   case MONGOC_MATCHER_OPCODE_SIZE:
+   case MONGOC_MATCHER_OPCODE_MOD:
       return _mongoc_matcher_op_compare_match (&op->compare, bson);
    case MONGOC_MATCHER_OPCODE_OR:
    case MONGOC_MATCHER_OPCODE_AND:
@@ -1064,6 +1549,10 @@ _mongoc_matcher_op_match (mongoc_matcher_op_t *op, /* IN */
       return _mongoc_matcher_op_exists_match (&op->exists, bson);
    case MONGOC_MATCHER_OPCODE_TYPE:
       return _mongoc_matcher_op_type_match (&op->type, bson);
+   case MONGOC_MATCHER_OPCODE_REGEX:
+      return _mongoc_matcher_op_path_match (op, op->regex.path, bson);
+   case MONGOC_MATCHER_OPCODE_ELEM_MATCH:
+      return _mongoc_matcher_op_path_match (op, op->elem_match.path, bson);
    default:
       break;
    }
@@ -1114,6 +1603,9 @@ _mongoc_matcher_op_to_bson (mongoc_matcher_op_t *op, /* IN */
    case MONGOC_MATCHER_OPCODE_LTE:
    case MONGOC_MATCHER_OPCODE_NE:
    case MONGOC_MATCHER_OPCODE_NIN:
+   case MONGOC_MATCHER_OPCODE_ALL:
+   case MONGOC_MATCHER_OPCODE_SIZE:
+   case MONGOC_MATCHER_OPCODE_MOD:
       switch ((int) op->base.opcode) {
       case MONGOC_MATCHER_OPCODE_GT:
          str = "$gt";
@@ -1136,6 +1628,15 @@ _mongoc_matcher_op_to_bson (mongoc_matcher_op_t *op, /* IN */
       case MONGOC_MATCHER_OPCODE_NIN:
          str = "$nin";
          break;
+      case MONGOC_MATCHER_OPCODE_ALL:
+         str = "$all";
+         break;
+      case MONGOC_MATCHER_OPCODE_SIZE:
+         str = "$size";
+         break;
+      case MONGOC_MATCHER_OPCODE_MOD:
+         str = "$mod";
+         break;
       default:
          str = "???";
          break;
@@ -1182,6 +1683,21 @@ _mongoc_matcher_op_to_bson (mongoc_matcher_op_t *op, /* IN */
    case MONGOC_MATCHER_OPCODE_TYPE:
       BSON_APPEND_INT32 (bson, "$type", (int) op->type.type);
       break;
+   case MONGOC_MATCHER_OPCODE_REGEX:
+      bson_append_document_begin (bson, op->regex.path, -1, &child);
+      BSON_APPEND_UTF8 (&child, "$regex", op->regex.pattern);
+      if (*op->regex.options) {
+         BSON_APPEND_UTF8 (&child, "$options", op->regex.options);
+      }
+      bson_append_document_end (bson, &child);
+      break;
+   case MONGOC_MATCHER_OPCODE_ELEM_MATCH:
+      bson_append_document_begin (bson, op->elem_match.path, -1, &child);
+      bson_append_document_begin (&child, "$elemMatch", 10, &child2);
+      _mongoc_matcher_op_to_bson (op->elem_match.child, &child2);
+      bson_append_document_end (&child, &child2);
+      bson_append_document_end (bson, &child);
+      break;
    default:
       BSON_ASSERT (false);
       break;
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_MATCHER_PROGRAM_PRIVATE_H
+#define MONGOC_MATCHER_PROGRAM_PRIVATE_H
+
+#if !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-matcher-op-private.h"
+
+
+BSON_BEGIN_DECLS
+
+
+/* the most path segments a program resolves; larger queries are matched by
+ * walking the op tree */
+#define MONGOC_MATCHER_PROGRAM_MAX_NODES 32
+
+
+typedef struct _mongoc_matcher_insn_t mongoc_matcher_insn_t;
+typedef struct _mongoc_matcher_program_t mongoc_matcher_program_t;
+
+
+/* one segment of the dotted paths in a query, such as "b" in "a.b.c" */
+typedef struct {
+   char *key;
+   int32_t first_child; /* -1 if none */
+   int32_t next;        /* next sibling, -1 if none */
+   int32_t n_nodes;     /* number of nodes in this subtree, including this */
+} mongoc_matcher_node_t;
+
+
+/* the values of $in or $nin, hashed by their numeric or string value */
+typedef struct {
+   uint32_t mask; /* number of buckets - 1 */
+   bool *used;
+   uint32_t *hashes;
+   bson_iter_t *iters;
+   bool has_null; /* null matches null and undefined */
+   bson_iter_t *rest; /* arrays and documents, compared one by one */
+   uint32_t n_rest;
+} mongoc_matcher_set_t;
+
+
+typedef enum {
+   MONGOC_MATCHER_INSN_AND,
+   MONGOC_MATCHER_INSN_OR,
+   MONGOC_MATCHER_INSN_NOR,
+   MONGOC_MATCHER_INSN_NOT,
+   MONGOC_MATCHER_INSN_EXISTS,
+   MONGOC_MATCHER_INSN_TYPE,
+   MONGOC_MATCHER_INSN_VALUE,
+} mongoc_matcher_insn_type_t;
+
+
+typedef bool (*mongoc_matcher_value_func_t) (const mongoc_matcher_insn_t *insn,
+                                             bson_iter_t *value);
+
+
+struct _mongoc_matcher_insn_t {
+   mongoc_matcher_insn_type_t type;
+   mongoc_matcher_op_t *op; /* the op this was compiled from */
+   int32_t node;            /* the path's last segment, or -1 */
+   mongoc_matcher_value_func_t match_value; /* for VALUE */
+   union {
+      int32_t v_int32;
+      int64_t v_int64;
+      double v_double;
+      struct {
+         const char *str;
+         uint32_t len;
+      } v_utf8;
+      struct {
+         int64_t divisor;
+         int64_t remainder;
+      } v_mod;
+      mongoc_matcher_set_t *set;
+      mongoc_matcher_program_t *program; /* an $elemMatch query */
+   } operand;
+   mongoc_matcher_insn_t **children; /* for AND, OR, NOR, and NOT */
+   uint32_t n_children;
+};
+
+
+struct _mongoc_matcher_program_t {
+   mongoc_matcher_node_t nodes[MONGOC_MATCHER_PROGRAM_MAX_NODES];
+   int32_t n_nodes;
+   int32_t first_root; /* first top-level segment, -1 if none */
+   mongoc_matcher_insn_t *root;
+};
+
+
+mongoc_matcher_program_t *
+_mongoc_matcher_program_new (mongoc_matcher_op_t *optree);
+bool
+_mongoc_matcher_program_match (const mongoc_matcher_program_t *program,
+                               const bson_t *bson);
+void
+_mongoc_matcher_program_destroy (mongoc_matcher_program_t *program);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_MATCHER_PROGRAM_PRIVATE_H */
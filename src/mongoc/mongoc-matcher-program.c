@@ -0,0 +1,1000 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+
+#include "mongoc-matcher-op-private.h"
+#include "mongoc-matcher-program-private.h"
+
+
+/* the values found at a program's paths in one document */
+typedef struct {
+   bson_iter_t iters[MONGOC_MATCHER_PROGRAM_MAX_NODES];
+   bool found[MONGOC_MATCHER_PROGRAM_MAX_NODES];
+   int32_t n_decided; /* nodes found, or that can no longer be found */
+} mongoc_matcher_values_t;
+
+
+static void
+_mongoc_matcher_insn_destroy (mongoc_matcher_insn_t *insn);
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_set_hash --
+ *
+ *       Hash a string or number for a mongoc_matcher_set_t. Numbers that
+ *       _mongoc_matcher_iter_eq_match finds equal, whatever their types,
+ *       convert to the same double, so they are hashed as doubles.
+ *
+ * Returns:
+ *       true if @iter holds a string, number, or bool and @hash is set.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_matcher_set_hash (const bson_iter_t *iter, /* IN */
+                          uint32_t *hash)          /* OUT */
+{
+   const uint8_t *data;
+   uint32_t len;
+   uint32_t i;
+   double d;
+
+   switch (bson_iter_type (iter)) {
+   case BSON_TYPE_UTF8:
+      data = (const uint8_t *) bson_iter_utf8 (iter, &len);
+      break;
+   case BSON_TYPE_DOUBLE:
+      d = bson_iter_double (iter);
+      break;
+   case BSON_TYPE_BOOL:
+      d = bson_iter_bool (iter) ? 1.0 : 0.0;
+      break;
+   case BSON_TYPE_INT32:
+      d = (double) bson_iter_int32 (iter);
+      break;
+   case BSON_TYPE_INT64:
+      d = (double) bson_iter_int64 (iter);
+      break;
+   default:
+      return false;
+   }
+
+   if (!BSON_ITER_HOLDS_UTF8 (iter)) {
+      /* -0.0 == 0.0 */
+      if (d == 0.0) {
+         d = 0.0;
+      }
+
+      data = (const uint8_t *) &d;
+      len = (uint32_t) sizeof d;
+   }
+
+   /* FNV-1a */
+   *hash = 2166136261u;
+   for (i = 0; i < len; i++) {
+      *hash = (*hash ^ data[i]) * 16777619u;
+   }
+
+   return true;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_set_new --
+ *
+ *       Build a hash set of the values in the {$in: [...]} or
+ *       {$nin: [...]} array at @operand. Values that
+ *       _mongoc_matcher_iter_eq_match never finds equal to anything,
+ *       such as bools, are left out.
+ *
+ * Returns:
+ *       A newly allocated mongoc_matcher_set_t, empty if @operand is not
+ *       an array.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static mongoc_matcher_set_t *
+_mongoc_matcher_set_new (const bson_iter_t *operand) /* IN */
+{
+   mongoc_matcher_set_t *set;
+   bson_iter_t iter;
+   uint32_t n = 0;
+   uint32_t size = 8;
+   uint32_t hash;
+   uint32_t i;
+
+   set = (mongoc_matcher_set_t *) bson_malloc0 (sizeof *set);
+
+   if (BSON_ITER_HOLDS_ARRAY (operand) && bson_iter_recurse (operand, &iter)) {
+      while (bson_iter_next (&iter)) {
+         n++;
+      }
+   }
+
+   /* at most half full */
+   while (size < 2 * n) {
+      size <<= 1;
+   }
+
+   set->mask = size - 1;
+   set->used = (bool *) bson_malloc0 (size * sizeof (bool));
+   set->hashes = (uint32_t *) bson_malloc0 (size * sizeof (uint32_t));
+   set->iters = (bson_iter_t *) bson_malloc0 (size * sizeof (bson_iter_t));
+
+   if (!n) {
+      return set;
+   }
+
+   bson_iter_recurse (operand, &iter);
+
+   while (bson_iter_next (&iter)) {
+      switch (bson_iter_type (&iter)) {
+      case BSON_TYPE_NULL:
+         set->has_null = true;
+         break;
+      case BSON_TYPE_ARRAY:
+      case BSON_TYPE_DOCUMENT:
+         set->rest = (bson_iter_t *) bson_realloc (
+            set->rest, (set->n_rest + 1) * sizeof (bson_iter_t));
+         memcpy (&set->rest[set->n_rest++], &iter, sizeof iter);
+         break;
+      case BSON_TYPE_UTF8:
+      case BSON_TYPE_DOUBLE:
+      case BSON_TYPE_INT32:
+      case BSON_TYPE_INT64:
+         BSON_ASSERT (_mongoc_matcher_set_hash (&iter, &hash));
+         i = hash & set->mask;
+         while (set->used[i]) {
+            i = (i + 1) & set->mask;
+         }
+
+         set->used[i] = true;
+         set->hashes[i] = hash;
+         memcpy (&set->iters[i], &iter, sizeof iter);
+         break;
+      default:
+         break;
+      }
+   }
+
+   return set;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_set_contains --
+ *
+ *       Check if the value at @iter equals any value in @set, as
+ *       _mongoc_matcher_iter_eq_match compares them.
+ *
+ * Returns:
+ *       true if a value in @set equals the value at @iter.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_matcher_set_contains (mongoc_matcher_set_t *set, /* IN */
+                              bson_iter_t *iter)         /* IN */
+{
+   uint32_t hash;
+   uint32_t i;
+
+   switch (bson_iter_type (iter)) {
+   case BSON_TYPE_NULL:
+   case BSON_TYPE_UNDEFINED:
+      return set->has_null;
+   case BSON_TYPE_ARRAY:
+   case BSON_TYPE_DOCUMENT:
+      for (i = 0; i < set->n_rest; i++) {
+         if (_mongoc_matcher_iter_eq_match (&set->rest[i], iter)) {
+            return true;
+         }
+      }
+
+      return false;
+   default:
+      if (!_mongoc_matcher_set_hash (iter, &hash)) {
+         return false;
+      }
+
+      for (i = hash & set->mask; set->used[i]; i = (i + 1) & set->mask) {
+         if (set->hashes[i] == hash &&
+             _mongoc_matcher_iter_eq_match (&set->iters[i], iter)) {
+            return true;
+         }
+      }
+
+      return false;
+   }
+}
+
+
+static void
+_mongoc_matcher_set_destroy (mongoc_matcher_set_t *set)
+{
+   if (set) {
+      bson_free (set->used);
+      bson_free (set->hashes);
+      bson_free (set->iters);
+      bson_free (set->rest);
+      bson_free (set);
+   }
+}
+
+
+/*
+ * Value matchers for VALUE instructions, chosen when the program is built
+ * from the op's opcode and the type of its operand.
+ */
+
+static bool
+_mongoc_matcher_value_compare (const mongoc_matcher_insn_t *insn,
+                               bson_iter_t *value)
+{
+   return _mongoc_matcher_op_compare_iter_match (&insn->op->compare, value);
+}
+
+
+static bool
+_mongoc_matcher_value_eq_utf8 (const mongoc_matcher_insn_t *insn,
+                               bson_iter_t *value)
+{
+   const char *str;
+   uint32_t len;
+
+   if (!BSON_ITER_HOLDS_UTF8 (value)) {
+      return false;
+   }
+
+   str = bson_iter_utf8 (value, &len);
+
+   return len == insn->operand.v_utf8.len &&
+          0 == memcmp (str, insn->operand.v_utf8.str, len);
+}
+
+
+static bool
+_mongoc_matcher_value_ne_utf8 (const mongoc_matcher_insn_t *insn,
+                               bson_iter_t *value)
+{
+   return !_mongoc_matcher_value_eq_utf8 (insn, value);
+}
+
+
+static bool
+_mongoc_matcher_value_op (const mongoc_matcher_insn_t *insn,
+                          bson_iter_t *value)
+{
+   return _mongoc_matcher_op_value_match (insn->op, value);
+}
+
+
+static bool
+_mongoc_matcher_value_size (const mongoc_matcher_insn_t *insn,
+                            bson_iter_t *value)
+{
+   return _mongoc_matcher_iter_size_match (value, insn->operand.v_int64);
+}
+
+
+static bool
+_mongoc_matcher_value_mod (const mongoc_matcher_insn_t *insn,
+                           bson_iter_t *value)
+{
+   return _mongoc_matcher_iter_mod_match (
+      value, insn->operand.v_mod.divisor, insn->operand.v_mod.remainder);
+}
+
+
+static bool
+_mongoc_matcher_value_regex (const mongoc_matcher_insn_t *insn,
+                             bson_iter_t *value)
+{
+   return BSON_ITER_HOLDS_UTF8 (value) &&
+          _mongoc_matcher_regex_match (insn->op->regex.regex,
+                                       bson_iter_utf8 (value, NULL));
+}
+
+
+/* match the documents in the array with the $elemMatch query's program */
+static bool
+_mongoc_matcher_value_elem_match (const mongoc_matcher_insn_t *insn,
+                                  bson_iter_t *value)
+{
+   bson_iter_t child;
+   const uint8_t *data;
+   uint32_t len;
+   bson_t doc;
+
+   if (!BSON_ITER_HOLDS_ARRAY (value) || !bson_iter_recurse (value, &child)) {
+      return false;
+   }
+
+   while (bson_iter_next (&child)) {
+      if (!BSON_ITER_HOLDS_DOCUMENT (&child)) {
+         continue;
+      }
+
+      bson_iter_document (&child, &len, &data);
+      if (bson_init_static (&doc, data, len) &&
+          _mongoc_matcher_program_match (insn->operand.program, &doc)) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+
+static bool
+_mongoc_matcher_value_in (const mongoc_matcher_insn_t *insn,
+                          bson_iter_t *value)
+{
+   return _mongoc_matcher_set_contains (insn->operand.set, value);
+}
+
+
+static bool
+_mongoc_matcher_value_nin (const mongoc_matcher_insn_t *insn,
+                           bson_iter_t *value)
+{
+   return !_mongoc_matcher_set_contains (insn->operand.set, value);
+}
+
+
+/* compare a number in the document with a numeric operand, converting them
+ * as the C compiler does, like the _*_COMPARE macros in mongoc-matcher-op.c.
+ * Other types take the slow path for its warnings and special cases. */
+#define _NUMBER_MATCH(name, op, field)                                     \
+   static bool name (const mongoc_matcher_insn_t *insn, bson_iter_t *value) \
+   {                                                                       \
+      switch (bson_iter_type (value)) {                                    \
+      case BSON_TYPE_DOUBLE:                                               \
+         return bson_iter_double (value) op insn->operand.field;           \
+      case BSON_TYPE_BOOL:                                                 \
+         return bson_iter_bool (value) op insn->operand.field;             \
+      case BSON_TYPE_INT32:                                                \
+         return bson_iter_int32 (value) op insn->operand.field;            \
+      case BSON_TYPE_INT64:                                                \
+         return bson_iter_int64 (value) op insn->operand.field;            \
+      default:                                                             \
+         return _mongoc_matcher_value_compare (insn, value);               \
+      }                                                                    \
+   }
+
+_NUMBER_MATCH (_mongoc_matcher_value_eq_int32, ==, v_int32)
+_NUMBER_MATCH (_mongoc_matcher_value_eq_int64, ==, v_int64)
+_NUMBER_MATCH (_mongoc_matcher_value_eq_double, ==, v_double)
+_NUMBER_MATCH (_mongoc_matcher_value_ne_int32, !=, v_int32)
+_NUMBER_MATCH (_mongoc_matcher_value_ne_int64, !=, v_int64)
+_NUMBER_MATCH (_mongoc_matcher_value_ne_double, !=, v_double)
+_NUMBER_MATCH (_mongoc_matcher_value_gt_int32, >, v_int32)
+_NUMBER_MATCH (_mongoc_matcher_value_gt_int64, >, v_int64)
+_NUMBER_MATCH (_mongoc_matcher_value_gt_double, >, v_double)
+_NUMBER_MATCH (_mongoc_matcher_value_gte_int32, >=, v_int32)
+_NUMBER_MATCH (_mongoc_matcher_value_gte_int64, >=, v_int64)
+_NUMBER_MATCH (_mongoc_matcher_value_gte_double, >=, v_double)
+_NUMBER_MATCH (_mongoc_matcher_value_lt_int32, <, v_int32)
+_NUMBER_MATCH (_mongoc_matcher_value_lt_int64, <, v_int64)
+_NUMBER_MATCH (_mongoc_matcher_value_lt_double, <, v_double)
+_NUMBER_MATCH (_mongoc_matcher_value_lte_int32, <=, v_int32)
+_NUMBER_MATCH (_mongoc_matcher_value_lte_int64, <=, v_int64)
+_NUMBER_MATCH (_mongoc_matcher_value_lte_double, <=, v_double)
+
+#undef _NUMBER_MATCH
+
+
+/* indexed by opcode, then by int32, int64, double operand */
+static const mongoc_matcher_value_func_t gNumberMatchers[][3] = {
+   /* MONGOC_MATCHER_OPCODE_EQ */
+   {_mongoc_matcher_value_eq_int32,
+    _mongoc_matcher_value_eq_int64,
+    _mongoc_matcher_value_eq_double},
+   /* MONGOC_MATCHER_OPCODE_GT */
+   {_mongoc_matcher_value_gt_int32,
+    _mongoc_matcher_value_gt_int64,
+    _mongoc_matcher_value_gt_double},
+   /* MONGOC_MATCHER_OPCODE_GTE */
+   {_mongoc_matcher_value_gte_int32,
+    _mongoc_matcher_value_gte_int64,
+    _mongoc_matcher_value_gte_double},
+   /* MONGOC_MATCHER_OPCODE_IN */
+   {NULL, NULL, NULL},
+   /* MONGOC_MATCHER_OPCODE_LT */
+   {_mongoc_matcher_value_lt_int32,
+    _mongoc_matcher_value_lt_int64,
+    _mongoc_matcher_value_lt_double},
+   /* MONGOC_MATCHER_OPCODE_LTE */
+   {_mongoc_matcher_value_lte_int32,
+    _mongoc_matcher_value_lte_int64,
+    _mongoc_matcher_value_lte_double},
+   /* MONGOC_MATCHER_OPCODE_NE */
+   {_mongoc_matcher_value_ne_int32,
+    _mongoc_matcher_value_ne_int64,
+    _mongoc_matcher_value_ne_double},
+};
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_program_add_path --
+ *
+ *       Add the segments of the dotted @path to @program's tree of path
+ *       segments, sharing any prefix with paths already added.
+ *
+ * Returns:
+ *       The index of the node for the path's last segment, or -1 if
+ *       @program has too many nodes.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static int32_t
+_mongoc_matcher_program_add_path (mongoc_matcher_program_t *program, /* IN */
+                                  const char *path)                  /* IN */
+{
+   mongoc_matcher_node_t *node;
+   int32_t *first;
+   const char *dot;
+   size_t len;
+   int32_t i;
+
+   first = &program->first_root;
+
+   for (;;) {
+      dot = strchr (path, '.');
+      len = dot ? (size_t) (dot - path) : strlen (path);
+
+      for (i = *first; i >= 0; i = program->nodes[i].next) {
+         node = &program->nodes[i];
+         if (strlen (node->key) == len && 0 == strncmp (node->key, path, len)) {
+            break;
+         }
+      }
+
+      if (i < 0) {
+         if (program->n_nodes == MONGOC_MATCHER_PROGRAM_MAX_NODES) {
+            return -1;
+         }
+
+         i = program->n_nodes++;
+         node = &program->nodes[i];
+         node->key = bson_strndup (path, len);
+         node->first_child = -1;
+         node->next = *first;
+         *first = i;
+      }
+
+      if (!dot) {
+         return i;
+      }
+
+      first = &program->nodes[i].first_child;
+      path = dot + 1;
+   }
+}
+
+
+/* count the nodes in each subtree, for _mongoc_matcher_program_scan */
+static int32_t
+_mongoc_matcher_program_count (mongoc_matcher_program_t *program,
+                               int32_t first)
+{
+   int32_t n = 0;
+   int32_t i;
+
+   for (i = first; i >= 0; i = program->nodes[i].next) {
+      program->nodes[i].n_nodes =
+         1 + _mongoc_matcher_program_count (program,
+                                            program->nodes[i].first_child);
+      n += program->nodes[i].n_nodes;
+   }
+
+   return n;
+}
+
+
+static mongoc_matcher_insn_t *
+_mongoc_matcher_program_compile (mongoc_matcher_program_t *program,
+                                 mongoc_matcher_op_t *op);
+
+
+static void
+_mongoc_matcher_insn_append (mongoc_matcher_insn_t *insn,
+                             mongoc_matcher_insn_t *child)
+{
+   insn->children = (mongoc_matcher_insn_t **) bson_realloc (
+      insn->children, (insn->n_children + 1) * sizeof (child));
+   insn->children[insn->n_children++] = child;
+}
+
+
+/* compile the operands of a chain of $and or $or ops as children of one
+ * instruction; $nor chains are not associative and keep their shape */
+static bool
+_mongoc_matcher_program_flatten (mongoc_matcher_program_t *program,
+                                 mongoc_matcher_insn_t *insn,
+                                 mongoc_matcher_op_t *op)
+{
+   mongoc_matcher_insn_t *child;
+
+   if (!op) {
+      return true;
+   }
+
+   if (op->base.opcode == insn->op->base.opcode &&
+       op->base.opcode != MONGOC_MATCHER_OPCODE_NOR) {
+      return _mongoc_matcher_program_flatten (
+                program, insn, op->logical.left) &&
+             _mongoc_matcher_program_flatten (
+                program, insn, op->logical.right);
+   }
+
+   if (!(child = _mongoc_matcher_program_compile (program, op))) {
+      return false;
+   }
+
+   _mongoc_matcher_insn_append (insn, child);
+
+   return true;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_program_compile --
+ *
+ *       Compile @op and its children to instructions that read the
+ *       values at their paths from a mongoc_matcher_values_t, instead of
+ *       each finding its path in the document.
+ *
+ * Returns:
+ *       A newly allocated instruction, or NULL if @op cannot be compiled.
+ *
+ * Side effects:
+ *       Paths are added to @program.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static mongoc_matcher_insn_t *
+_mongoc_matcher_program_compile (mongoc_matcher_program_t *program, /* IN */
+                                 mongoc_matcher_op_t *op)           /* IN */
+{
+   mongoc_matcher_insn_t *insn;
+   mongoc_matcher_insn_t *child;
+   bson_iter_t *operand;
+   const char *path = NULL;
+   int col;
+
+   insn = (mongoc_matcher_insn_t *) bson_malloc0 (sizeof *insn);
+   insn->op = op;
+   insn->node = -1;
+
+   switch (op->base.opcode) {
+   case MONGOC_MATCHER_OPCODE_OR:
+   case MONGOC_MATCHER_OPCODE_AND:
+   case MONGOC_MATCHER_OPCODE_NOR:
+      insn->type = op->base.opcode == MONGOC_MATCHER_OPCODE_OR
+                      ? MONGOC_MATCHER_INSN_OR
+                      : op->base.opcode == MONGOC_MATCHER_OPCODE_AND
+                           ? MONGOC_MATCHER_INSN_AND
+                           : MONGOC_MATCHER_INSN_NOR;
+
+      if (op->base.opcode == MONGOC_MATCHER_OPCODE_NOR) {
+         if (!_mongoc_matcher_program_flatten (
+                program, insn, op->logical.left) ||
+             !_mongoc_matcher_program_flatten (
+                program, insn, op->logical.right)) {
+            goto failure;
+         }
+      } else if (!_mongoc_matcher_program_flatten (program, insn, op)) {
+         goto failure;
+      }
+      break;
+   case MONGOC_MATCHER_OPCODE_NOT:
+      insn->type = MONGOC_MATCHER_INSN_NOT;
+      if (!(child = _mongoc_matcher_program_compile (program,
+                                                     op->not_.child))) {
+         goto failure;
+      }
+
+      _mongoc_matcher_insn_append (insn, child);
+      break;
+   case MONGOC_MATCHER_OPCODE_EXISTS:
+      insn->type = MONGOC_MATCHER_INSN_EXISTS;
+      path = op->exists.path;
+      break;
+   case MONGOC_MATCHER_OPCODE_TYPE:
+      insn->type = MONGOC_MATCHER_INSN_TYPE;
+      path = op->type.path;
+      break;
+   case MONGOC_MATCHER_OPCODE_EQ:
+   case MONGOC_MATCHER_OPCODE_GT:
+   case MONGOC_MATCHER_OPCODE_GTE:
+   case MONGOC_MATCHER_OPCODE_IN:
+   case MONGOC_MATCHER_OPCODE_LT:
+   case MONGOC_MATCHER_OPCODE_LTE:
+   case MONGOC_MATCHER_OPCODE_NE:
+   case MONGOC_MATCHER_OPCODE_NIN:
+      insn->type = MONGOC_MATCHER_INSN_VALUE;
+      insn->match_value = _mongoc_matcher_value_compare;
+      path = op->compare.path;
+      operand = &op->compare.iter;
+
+      switch (bson_iter_type (operand)) {
+      case BSON_TYPE_INT32:
+         insn->operand.v_int32 = bson_iter_int32 (operand);
+         col = 0;
+         break;
+      case BSON_TYPE_INT64:
+         insn->operand.v_int64 = bson_iter_int64 (operand);
+         col = 1;
+         break;
+      case BSON_TYPE_DOUBLE:
+         insn->operand.v_double = bson_iter_double (operand);
+         col = 2;
+         break;
+      case BSON_TYPE_UTF8:
+         insn->operand.v_utf8.str =
+            bson_iter_utf8 (operand, &insn->operand.v_utf8.len);
+         if (op->base.opcode == MONGOC_MATCHER_OPCODE_EQ) {
+            insn->match_value = _mongoc_matcher_value_eq_utf8;
+         } else if (op->base.opcode == MONGOC_MATCHER_OPCODE_NE) {
+            insn->match_value = _mongoc_matcher_value_ne_utf8;
+         }
+         /* fall through */
+      default:
+         col = -1;
+         break;
+      }
+
+      if (op->base.opcode == MONGOC_MATCHER_OPCODE_IN ||
+          op->base.opcode == MONGOC_MATCHER_OPCODE_NIN) {
+         memset (&insn->operand, 0, sizeof insn->operand);
+         insn->operand.set = _mongoc_matcher_set_new (operand);
+         insn->match_value = op->base.opcode == MONGOC_MATCHER_OPCODE_IN
+                                ? _mongoc_matcher_value_in
+                                : _mongoc_matcher_value_nin;
+      } else if (col >= 0) {
+         insn->match_value = gNumberMatchers[op->base.opcode][col];
+      }
+      break;
+   case MONGOC_MATCHER_OPCODE_ALL:
+      insn->type = MONGOC_MATCHER_INSN_VALUE;
+      insn->match_value = _mongoc_matcher_value_compare;
+      path = op->compare.path;
+      break;
+   case MONGOC_MATCHER_OPCODE_SIZE:
+      insn->type = MONGOC_MATCHER_INSN_VALUE;
+      insn->match_value = _mongoc_matcher_value_size;
+      insn->operand.v_int64 = bson_iter_as_int64 (&op->compare.iter);
+      path = op->compare.path;
+      break;
+   case MONGOC_MATCHER_OPCODE_MOD: {
+      bson_iter_t mod;
+
+      /* the parser checked for [divisor, remainder] */
+      if (!bson_iter_recurse (&op->compare.iter, &mod) ||
+          !bson_iter_next (&mod)) {
+         goto failure;
+      }
+
+      insn->operand.v_mod.divisor = bson_iter_as_int64 (&mod);
+      if (!bson_iter_next (&mod)) {
+         goto failure;
+      }
+
+      insn->operand.v_mod.remainder = bson_iter_as_int64 (&mod);
+      insn->type = MONGOC_MATCHER_INSN_VALUE;
+      insn->match_value = _mongoc_matcher_value_mod;
+      path = op->compare.path;
+      break;
+   }
+   case MONGOC_MATCHER_OPCODE_REGEX:
+      insn->type = MONGOC_MATCHER_INSN_VALUE;
+      insn->match_value = _mongoc_matcher_value_regex;
+      path = op->regex.path;
+      break;
+   case MONGOC_MATCHER_OPCODE_ELEM_MATCH:
+      insn->type = MONGOC_MATCHER_INSN_VALUE;
+      insn->match_value = _mongoc_matcher_value_op;
+      path = op->elem_match.path;
+
+      /* a query on the array's documents gets a program of its own */
+      if (!op->elem_match.values &&
+          (insn->operand.program =
+              _mongoc_matcher_program_new (op->elem_match.child))) {
+         insn->match_value = _mongoc_matcher_value_elem_match;
+      }
+      break;
+   default:
+      goto failure;
+   }
+
+   if (path && (insn->node = _mongoc_matcher_program_add_path (
+                   program, path)) < 0) {
+      goto failure;
+   }
+
+   return insn;
+
+failure:
+   _mongoc_matcher_insn_destroy (insn);
+   return NULL;
+}
+
+
+static void
+_mongoc_matcher_insn_destroy (mongoc_matcher_insn_t *insn)
+{
+   uint32_t i;
+
+   for (i = 0; i < insn->n_children; i++) {
+      _mongoc_matcher_insn_destroy (insn->children[i]);
+   }
+
+   if (insn->match_value == _mongoc_matcher_value_in ||
+       insn->match_value == _mongoc_matcher_value_nin) {
+      _mongoc_matcher_set_destroy (insn->operand.set);
+   } else if (insn->match_value == _mongoc_matcher_value_elem_match) {
+      _mongoc_matcher_program_destroy (insn->operand.program);
+   }
+
+   bson_free (insn->children);
+   bson_free (insn);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_program_new --
+ *
+ *       Compile the op tree of a mongoc_matcher_t. The program finds the
+ *       values at all the query's paths in one pass over a document, then
+ *       evaluates the ops against them, with comparisons specialized for
+ *       the type of their operand and $in or $nin arrays in hash sets.
+ *       An $elemMatch query is compiled to a program of its own.
+ *
+ *       The program refers to @optree and the query it was parsed from,
+ *       and must be destroyed first.
+ *
+ * Returns:
+ *       A newly allocated mongoc_matcher_program_t, or NULL if @optree
+ *       has too many paths and should be matched directly.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_matcher_program_t *
+_mongoc_matcher_program_new (mongoc_matcher_op_t *optree) /* IN */
+{
+   mongoc_matcher_program_t *program;
+
+   BSON_ASSERT (optree);
+
+   program = (mongoc_matcher_program_t *) bson_malloc0 (sizeof *program);
+   program->first_root = -1;
+
+   if (!(program->root = _mongoc_matcher_program_compile (program, optree))) {
+      _mongoc_matcher_program_destroy (program);
+      return NULL;
+   }
+
+   _mongoc_matcher_program_count (program, program->first_root);
+
+   return program;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_program_scan --
+ *
+ *       Find the values at @program's paths among the fields at @iter,
+ *       whose keys are the segments in the list starting at @first. The
+ *       list and the subtrees beneath it hold @n_nodes nodes.
+ *
+ *       Like bson_iter_find_descendant, only the first field with a
+ *       given key is used. The scan stops once each of those @n_nodes
+ *       nodes is decided, without reading the rest of @iter's fields.
+ *
+ * Returns:
+ *       None.
+ *
+ * Side effects:
+ *       @values is updated.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_matcher_program_scan (const mongoc_matcher_program_t *program,
+                              int32_t first,
+                              int32_t n_nodes,
+                              bson_iter_t *iter,
+                              mongoc_matcher_values_t *values)
+{
+   const mongoc_matcher_node_t *node;
+   bson_iter_t child;
+   const char *key;
+   int32_t n_decided;
+   int32_t end;
+   int32_t i;
+
+   /* each node found adds its subtree once its own scan is done */
+   end = values->n_decided + n_nodes;
+
+   while (values->n_decided < end && bson_iter_next (iter)) {
+      key = bson_iter_key (iter);
+
+      for (i = first; i >= 0; i = program->nodes[i].next) {
+         node = &program->nodes[i];
+         if (values->found[i] || 0 != strcmp (node->key, key)) {
+            continue;
+         }
+
+         values->found[i] = true;
+         memcpy (&values->iters[i], iter, sizeof *iter);
+         n_decided = values->n_decided;
+
+         if (node->first_child >= 0 &&
+             (BSON_ITER_HOLDS_DOCUMENT (iter) ||
+              BSON_ITER_HOLDS_ARRAY (iter)) &&
+             bson_iter_recurse (iter, &child)) {
+            _mongoc_matcher_program_scan (program,
+                                          node->first_child,
+                                          node->n_nodes - 1,
+                                          &child,
+                                          values);
+         }
+
+         /* paths beneath this node are found by now, or never will be */
+         values->n_decided = n_decided + node->n_nodes;
+         break;
+      }
+   }
+}
+
+
+static bool
+_mongoc_matcher_insn_match (const mongoc_matcher_insn_t *insn,
+                            mongoc_matcher_values_t *values)
+{
+   uint32_t i;
+
+   switch (insn->type) {
+   case MONGOC_MATCHER_INSN_AND:
+      for (i = 0; i < insn->n_children; i++) {
+         if (!_mongoc_matcher_insn_match (insn->children[i], values)) {
+            return false;
+         }
+      }
+
+      return true;
+   case MONGOC_MATCHER_INSN_OR:
+   case MONGOC_MATCHER_INSN_NOR:
+      for (i = 0; i < insn->n_children; i++) {
+         if (_mongoc_matcher_insn_match (insn->children[i], values)) {
+            return insn->type == MONGOC_MATCHER_INSN_OR;
+         }
+      }
+
+      return insn->type == MONGOC_MATCHER_INSN_NOR;
+   case MONGOC_MATCHER_INSN_NOT:
+      return !_mongoc_matcher_insn_match (insn->children[0], values);
+   case MONGOC_MATCHER_INSN_EXISTS:
+      return values->found[insn->node] == insn->op->exists.exists;
+   case MONGOC_MATCHER_INSN_TYPE:
+      return values->found[insn->node] &&
+             bson_iter_type (&values->iters[insn->node]) ==
+                insn->op->type.type;
+   case MONGOC_MATCHER_INSN_VALUE:
+      return values->found[insn->node] &&
+             insn->match_value (insn, &values->iters[insn->node]);
+   default:
+      BSON_ASSERT (false);
+      return false;
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_program_match --
+ *
+ *       Checks to see if @bson matches @program's query, with the same
+ *       result as _mongoc_matcher_op_match on the op tree.
+ *
+ * Returns:
+ *       true if @bson matched the query, otherwise false.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_matcher_program_match (const mongoc_matcher_program_t *program,
+                               const bson_t *bson)
+{
+   mongoc_matcher_values_t values;
+   bson_iter_t iter;
+
+   BSON_ASSERT (program);
+   BSON_ASSERT (bson);
+
+   memset (values.found, 0, sizeof values.found);
+   values.n_decided = 0;
+
+   if (program->n_nodes && bson_iter_init (&iter, bson)) {
+      _mongoc_matcher_program_scan (
+         program, program->first_root, program->n_nodes, &iter, &values);
+   }
+
+   return _mongoc_matcher_insn_match (program->root, &values);
+}
+
+
+void
+_mongoc_matcher_program_destroy (mongoc_matcher_program_t *program)
+{
+   int32_t i;
+
+   if (program) {
+      if (program->root) {
+         _mongoc_matcher_insn_destroy (program->root);
+      }
+
+      for (i = 0; i < program->n_nodes; i++) {
+         bson_free (program->nodes[i].key);
+      }
+
+      bson_free (program);
+   }
+}
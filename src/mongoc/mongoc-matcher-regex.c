@@ -0,0 +1,374 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <ctype.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <regex.h>
+#endif
+
+#include "mongoc-error.h"
+#include "mongoc-matcher-regex-private.h"
+#include "mongoc-thread-private.h"
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "matcher"
+
+
+/* a compiled $regex pattern, shared by every matcher in the process that
+ * uses the same pattern and options. "refcount" and "next" are protected
+ * by gMatcherRegexMutex, the rest is immutable once the entry is listed.
+ * an entry is freed only once no matcher refers to it. */
+struct _mongoc_matcher_regex_t {
+   char *pattern;
+   int cflags;
+#ifndef _WIN32
+   regex_t re;
+#endif
+   int refcount;
+   struct _mongoc_matcher_regex_t *next;
+};
+
+
+/* the cache needs no mongoc_init, like the rest of the matcher */
+static mongoc_once_t gMatcherRegexOnce = MONGOC_ONCE_INIT;
+static mongoc_mutex_t gMatcherRegexMutex;
+static mongoc_matcher_regex_t *gMatcherRegexEntries; /* most recent first */
+
+
+static MONGOC_ONCE_FUN (_mongoc_matcher_regex_init_once)
+{
+   mongoc_mutex_init (&gMatcherRegexMutex);
+
+   MONGOC_ONCE_RETURN;
+}
+
+
+static void
+_mongoc_matcher_regex_destroy (mongoc_matcher_regex_t *regex)
+{
+#ifndef _WIN32
+   regfree (&regex->re);
+#endif
+   bson_free (regex->pattern);
+   bson_free (regex);
+}
+
+
+#ifndef _WIN32
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_regex_check_syntax --
+ *
+ *       Reject PCRE syntax the server understands that POSIX regcomp
+ *       would silently read another way: a backslash in a bracket
+ *       expression, as in "[\d]", which POSIX reads as a backslash; an
+ *       escaped letter or digit, such as "\d", "\w", "\b" or "\1"; and
+ *       "(?" groups.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_matcher_regex_check_syntax (const char *pattern, /* IN */
+                                    bson_error_t *error) /* OUT */
+{
+   const char *p;
+   const char *end;
+   char close[3] = {0};
+
+   for (p = pattern; *p; p++) {
+      if (*p == '\\') {
+         if (isalnum ((unsigned char) p[1])) {
+            bson_set_error (error,
+                            MONGOC_ERROR_MATCHER,
+                            MONGOC_ERROR_MATCHER_INVALID,
+                            "Unsupported escape \"\\%c\" in $regex \"%s\"",
+                            p[1],
+                            pattern);
+            return false;
+         }
+
+         if (p[1]) {
+            p++;
+         }
+      } else if (p[0] == '(' && p[1] == '?') {
+         bson_set_error (error,
+                         MONGOC_ERROR_MATCHER,
+                         MONGOC_ERROR_MATCHER_INVALID,
+                         "Unsupported \"(?\" group in $regex \"%s\"",
+                         pattern);
+         return false;
+      } else if (*p == '[') {
+         /* a "]" first in the list is a member, not its end */
+         p++;
+         if (*p == '^') {
+            p++;
+         }
+         if (*p == ']') {
+            p++;
+         }
+
+         for (; *p && *p != ']'; p++) {
+            if (*p == '\\') {
+               bson_set_error (error,
+                               MONGOC_ERROR_MATCHER,
+                               MONGOC_ERROR_MATCHER_INVALID,
+                               "Unsupported backslash in a bracket expression "
+                               "in $regex \"%s\"",
+                               pattern);
+               return false;
+            }
+
+            /* skip "[:alpha:]", "[.x.]" and "[=x=]", which may hold "]" */
+            if (*p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '=')) {
+               close[0] = p[1];
+               close[1] = ']';
+               end = strstr (p + 2, close);
+               if (end) {
+                  p = end + 1;
+               }
+            }
+         }
+
+         if (!*p) {
+            /* regcomp reports the unmatched "[" */
+            break;
+         }
+      }
+   }
+
+   return true;
+}
+#endif
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_regex_cleanup --
+ *
+ *       Free the cached patterns no matcher uses. Patterns in use stay
+ *       valid, and are cached as usual when their matchers release them.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_matcher_regex_cleanup (void)
+{
+   mongoc_matcher_regex_t *unused = NULL;
+   mongoc_matcher_regex_t *regex;
+   mongoc_matcher_regex_t **prev;
+
+   mongoc_once (&gMatcherRegexOnce, _mongoc_matcher_regex_init_once);
+
+   mongoc_mutex_lock (&gMatcherRegexMutex);
+
+   prev = &gMatcherRegexEntries;
+   while ((regex = *prev)) {
+      if (regex->refcount == 0) {
+         *prev = regex->next;
+         regex->next = unused;
+         unused = regex;
+      } else {
+         prev = &regex->next;
+      }
+   }
+
+   mongoc_mutex_unlock (&gMatcherRegexMutex);
+
+   while ((regex = unused)) {
+      unused = regex->next;
+      _mongoc_matcher_regex_destroy (regex);
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_regex_get --
+ *
+ *       Get @pattern compiled as a POSIX extended regular expression,
+ *       from the cache if any matcher compiled it with the same @options
+ *       before. The options "i" and "m" are supported, as in $options.
+ *       PCRE syntax that POSIX would read differently is rejected.
+ *
+ * Returns:
+ *       A compiled pattern to release with _mongoc_matcher_regex_release,
+ *       or NULL and @error is set if @pattern or @options is invalid.
+ *
+ * Side effects:
+ *       The pattern is moved to the front of the cache.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_matcher_regex_t *
+_mongoc_matcher_regex_get (const char *pattern, /* IN */
+                           const char *options, /* IN */
+                           bson_error_t *error) /* OUT */
+{
+#ifdef _WIN32
+   bson_set_error (error,
+                   MONGOC_ERROR_MATCHER,
+                   MONGOC_ERROR_MATCHER_INVALID,
+                   "$regex is not supported on this platform");
+   return NULL;
+#else
+   mongoc_matcher_regex_t *regex;
+   mongoc_matcher_regex_t **prev;
+   char msg[128];
+   int cflags = REG_EXTENDED | REG_NOSUB;
+   int r;
+
+   BSON_ASSERT (pattern);
+
+   mongoc_once (&gMatcherRegexOnce, _mongoc_matcher_regex_init_once);
+
+   for (; options && *options; options++) {
+      switch (*options) {
+      case 'i':
+         cflags |= REG_ICASE;
+         break;
+      case 'm':
+         cflags |= REG_NEWLINE;
+         break;
+      default:
+         bson_set_error (error,
+                         MONGOC_ERROR_MATCHER,
+                         MONGOC_ERROR_MATCHER_INVALID,
+                         "Invalid $regex option '%c'",
+                         *options);
+         return NULL;
+      }
+   }
+
+   mongoc_mutex_lock (&gMatcherRegexMutex);
+
+   for (prev = &gMatcherRegexEntries; (regex = *prev); prev = &regex->next) {
+      if (regex->cflags == cflags && 0 == strcmp (regex->pattern, pattern)) {
+         *prev = regex->next;
+         regex->next = gMatcherRegexEntries;
+         gMatcherRegexEntries = regex;
+         regex->refcount++;
+         mongoc_mutex_unlock (&gMatcherRegexMutex);
+         return regex;
+      }
+   }
+
+   mongoc_mutex_unlock (&gMatcherRegexMutex);
+
+   if (!_mongoc_matcher_regex_check_syntax (pattern, error)) {
+      return NULL;
+   }
+
+   /* compile without the lock; if another thread compiles the same pattern
+    * meanwhile, both copies are listed until the older one is trimmed */
+   regex = (mongoc_matcher_regex_t *) bson_malloc0 (sizeof *regex);
+   regex->pattern = bson_strdup (pattern);
+   regex->cflags = cflags;
+   regex->refcount = 1;
+
+   if ((r = regcomp (&regex->re, pattern, cflags))) {
+      regerror (r, &regex->re, msg, sizeof msg);
+      bson_set_error (error,
+                      MONGOC_ERROR_MATCHER,
+                      MONGOC_ERROR_MATCHER_INVALID,
+                      "Invalid $regex \"%s\": %s",
+                      pattern,
+                      msg);
+      bson_free (regex->pattern);
+      bson_free (regex);
+      return NULL;
+   }
+
+   mongoc_mutex_lock (&gMatcherRegexMutex);
+   regex->next = gMatcherRegexEntries;
+   gMatcherRegexEntries = regex;
+   mongoc_mutex_unlock (&gMatcherRegexMutex);
+
+   return regex;
+#endif
+}
+
+
+bool
+_mongoc_matcher_regex_match (const mongoc_matcher_regex_t *regex, /* IN */
+                             const char *str)                     /* IN */
+{
+   BSON_ASSERT (regex);
+   BSON_ASSERT (str);
+
+#ifdef _WIN32
+   return false;
+#else
+   return 0 == regexec (&regex->re, str, 0, NULL, 0);
+#endif
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_regex_release --
+ *
+ *       Release a pattern from _mongoc_matcher_regex_get. It stays in the
+ *       cache until more than MONGOC_MATCHER_REGEX_CACHE_SIZE patterns
+ *       that are more recently used are unreferenced.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_matcher_regex_release (mongoc_matcher_regex_t *regex) /* IN */
+{
+   mongoc_matcher_regex_t *unused = NULL;
+   mongoc_matcher_regex_t **prev;
+   int n_unused = 0;
+
+   if (!regex) {
+      return;
+   }
+
+   mongoc_mutex_lock (&gMatcherRegexMutex);
+
+   BSON_ASSERT (regex->refcount > 0);
+   regex->refcount--;
+
+   prev = &gMatcherRegexEntries;
+   while ((regex = *prev)) {
+      if (regex->refcount == 0 &&
+          ++n_unused > MONGOC_MATCHER_REGEX_CACHE_SIZE) {
+         *prev = regex->next;
+         regex->next = unused;
+         unused = regex;
+      } else {
+         prev = &regex->next;
+      }
+   }
+
+   mongoc_mutex_unlock (&gMatcherRegexMutex);
+
+   while ((regex = unused)) {
+      unused = regex->next;
+      _mongoc_matcher_regex_destroy (regex);
+   }
+}
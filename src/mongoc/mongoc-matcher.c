@@ -21,6 +21,7 @@
 #include "mongoc-matcher.h"
 #include "mongoc-matcher-private.h"
 #include "mongoc-matcher-op-private.h"
+#include "mongoc-matcher-program-private.h"
 
 
 static mongoc_matcher_op_t *
@@ -30,12 +31,159 @@ _mongoc_matcher_parse_logical (mongoc_matcher_opcode_t opcode,
                                bson_error_t *error);
 
 
+static mongoc_matcher_op_t *
+_mongoc_matcher_parse_compare (bson_iter_t *iter,
+                               const char *path,
+                               bson_error_t *error);
+
+
+/* an operand of $size or $mod; doubles must be integral */
+static bool
+_mongoc_matcher_is_integer (const bson_iter_t *iter)
+{
+   double d;
+
+   if (BSON_ITER_HOLDS_INT32 (iter) || BSON_ITER_HOLDS_INT64 (iter)) {
+      return true;
+   }
+
+   if (!BSON_ITER_HOLDS_DOUBLE (iter)) {
+      return false;
+   }
+
+   d = bson_iter_double (iter);
+
+   return d >= -9223372036854775808.0 && d < 9223372036854775808.0 &&
+          d == (double) (int64_t) d;
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
- * _mongoc_matcher_parse_compare --
+ * _mongoc_matcher_parse_regex --
+ *
+ *       Parse {$regex: pattern} in the operator document at @parent,
+ *       with the options in its $options field, if any, or else in the
+ *       pattern if it is a BSON regular expression.
  *
- *       Parse a compare spec such as $gt or $in.
+ * Returns:
+ *       A newly allocated mongoc_matcher_op_t if successful; otherwise
+ *       NULL and @error is set.
+ *
+ * Side effects:
+ *       @error may be set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static mongoc_matcher_op_t *
+_mongoc_matcher_parse_regex (bson_iter_t *child,        /* IN */
+                             const bson_iter_t *parent, /* IN */
+                             const char *path,          /* IN */
+                             bson_error_t *error)       /* OUT */
+{
+   bson_iter_t iter;
+   const char *pattern;
+   const char *options = NULL;
+
+   if (BSON_ITER_HOLDS_UTF8 (child)) {
+      pattern = bson_iter_utf8 (child, NULL);
+   } else if (BSON_ITER_HOLDS_REGEX (child)) {
+      pattern = bson_iter_regex (child, &options);
+   } else {
+      bson_set_error (error,
+                      MONGOC_ERROR_MATCHER,
+                      MONGOC_ERROR_MATCHER_INVALID,
+                      "$regex requires a string");
+      return NULL;
+   }
+
+   if (bson_iter_recurse (parent, &iter) &&
+       bson_iter_find (&iter, "$options")) {
+      if (!BSON_ITER_HOLDS_UTF8 (&iter)) {
+         bson_set_error (error,
+                         MONGOC_ERROR_MATCHER,
+                         MONGOC_ERROR_MATCHER_INVALID,
+                         "$options requires a string");
+         return NULL;
+      }
+
+      options = bson_iter_utf8 (&iter, NULL);
+   }
+
+   return _mongoc_matcher_op_regex_new (path, pattern, options, error);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_parse_elem_match --
+ *
+ *       Parse {$elemMatch: {...}}. If the document's first key is an
+ *       operator other than $and, $or, or $nor, such as in
+ *       {$elemMatch: {$gte: 1, $lt: 5}}, its operators are matched
+ *       against each array element. Otherwise it is a query matched
+ *       against each element that is a document.
+ *
+ * Returns:
+ *       A newly allocated mongoc_matcher_op_t if successful; otherwise
+ *       NULL and @error is set.
+ *
+ * Side effects:
+ *       @error may be set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static mongoc_matcher_op_t *
+_mongoc_matcher_parse_elem_match (bson_iter_t *child,  /* IN */
+                                  const char *path,    /* IN */
+                                  bson_error_t *error) /* OUT */
+{
+   mongoc_matcher_op_t *op;
+   bson_iter_t iter;
+   const char *key;
+
+   if (!BSON_ITER_HOLDS_DOCUMENT (child) ||
+       !bson_iter_recurse (child, &iter) || !bson_iter_next (&iter)) {
+      bson_set_error (error,
+                      MONGOC_ERROR_MATCHER,
+                      MONGOC_ERROR_MATCHER_INVALID,
+                      "$elemMatch requires a non-empty document");
+      return NULL;
+   }
+
+   key = bson_iter_key (&iter);
+
+   if (key[0] == '$' && strcmp (key, "$and") != 0 &&
+       strcmp (key, "$or") != 0 && strcmp (key, "$nor") != 0) {
+      if (!(op = _mongoc_matcher_parse_compare (child, "", error))) {
+         return NULL;
+      }
+
+      return _mongoc_matcher_op_elem_match_new (path, op, true);
+   }
+
+   bson_iter_recurse (child, &iter);
+
+   if (!(op = _mongoc_matcher_parse_logical (
+            MONGOC_MATCHER_OPCODE_AND, &iter, true, error))) {
+      return NULL;
+   }
+
+   return _mongoc_matcher_op_elem_match_new (path, op, false);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_parse_operator --
+ *
+ *       Parse the operator at @child, one field of the operator document
+ *       at @parent such as {$gt: 1, $lt: 5}, for the value at @path.
  *
  *       See the following link for more information.
  *
@@ -52,73 +200,182 @@ _mongoc_matcher_parse_logical (mongoc_matcher_opcode_t opcode,
  */
 
 static mongoc_matcher_op_t *
-_mongoc_matcher_parse_compare (bson_iter_t *iter,   /* IN */
-                               const char *path,    /* IN */
-                               bson_error_t *error) /* OUT */
+_mongoc_matcher_parse_operator (bson_iter_t *child,        /* IN */
+                                const bson_iter_t *parent, /* IN */
+                                const char *path,          /* IN */
+                                bson_error_t *error)       /* OUT */
 {
+   mongoc_matcher_op_t *op_child;
+   bson_iter_t operand;
    const char *key;
-   mongoc_matcher_op_t *op = NULL, *op_child;
-   bson_iter_t child;
 
-   BSON_ASSERT (iter);
-   BSON_ASSERT (path);
+   key = bson_iter_key (child);
 
-   if (bson_iter_type (iter) == BSON_TYPE_DOCUMENT) {
-      if (!bson_iter_recurse (iter, &child) || !bson_iter_next (&child)) {
+   if (strcmp (key, "$not") == 0) {
+      if (!(op_child = _mongoc_matcher_parse_compare (child, path, error))) {
+         return NULL;
+      }
+      return _mongoc_matcher_op_not_new (path, op_child);
+   } else if (strcmp (key, "$gt") == 0) {
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_GT, path, child);
+   } else if (strcmp (key, "$gte") == 0) {
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_GTE, path, child);
+   } else if (strcmp (key, "$in") == 0) {
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_IN, path, child);
+   } else if (strcmp (key, "$lt") == 0) {
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_LT, path, child);
+   } else if (strcmp (key, "$lte") == 0) {
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_LTE, path, child);
+   } else if (strcmp (key, "$ne") == 0) {
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_NE, path, child);
+   } else if (strcmp (key, "$nin") == 0) {
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_NIN, path, child);
+   } else if (strcmp (key, "$exists") == 0) {
+      return _mongoc_matcher_op_exists_new (path, bson_iter_bool (child));
+   } else if (strcmp (key, "$type") == 0) {
+      return _mongoc_matcher_op_type_new (path, bson_iter_type (child));
+   } else if (strcmp (key, "$all") == 0) {
+      if (!BSON_ITER_HOLDS_ARRAY (child)) {
          bson_set_error (error,
                          MONGOC_ERROR_MATCHER,
                          MONGOC_ERROR_MATCHER_INVALID,
-                         "Document contains no operations.");
+                         "$all requires an array");
          return NULL;
       }
-
-      key = bson_iter_key (&child);
-
-      if (key[0] != '$') {
-         op = _mongoc_matcher_op_compare_new (
-            MONGOC_MATCHER_OPCODE_EQ, path, iter);
-      } else if (strcmp (key, "$not") == 0) {
-         if (!(op_child =
-                  _mongoc_matcher_parse_compare (&child, path, error))) {
-            return NULL;
-         }
-         op = _mongoc_matcher_op_not_new (path, op_child);
-      } else if (strcmp (key, "$gt") == 0) {
-         op = _mongoc_matcher_op_compare_new (
-            MONGOC_MATCHER_OPCODE_GT, path, &child);
-      } else if (strcmp (key, "$gte") == 0) {
-         op = _mongoc_matcher_op_compare_new (
-            MONGOC_MATCHER_OPCODE_GTE, path, &child);
-      } else if (strcmp (key, "$in") == 0) {
-         op = _mongoc_matcher_op_compare_new (
-            MONGOC_MATCHER_OPCODE_IN, path, &child);
-      } else if (strcmp (key, "$lt") == 0) {
-         op = _mongoc_matcher_op_compare_new (
-            MONGOC_MATCHER_OPCODE_LT, path, &child);
-      } else if (strcmp (key, "$lte") == 0) {
-         op = _mongoc_matcher_op_compare_new (
-            MONGOC_MATCHER_OPCODE_LTE, path, &child);
-      } else if (strcmp (key, "$ne") == 0) {
-         op = _mongoc_matcher_op_compare_new (
-            MONGOC_MATCHER_OPCODE_NE, path, &child);
-      } else if (strcmp (key, "$nin") == 0) {
-         op = _mongoc_matcher_op_compare_new (
-            MONGOC_MATCHER_OPCODE_NIN, path, &child);
-      } else if (strcmp (key, "$exists") == 0) {
-         op = _mongoc_matcher_op_exists_new (path, bson_iter_bool (&child));
-      } else if (strcmp (key, "$type") == 0) {
-         op = _mongoc_matcher_op_type_new (path, bson_iter_type (&child));
-      } else {
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_ALL, path, child);
+   } else if (strcmp (key, "$size") == 0) {
+      if (!_mongoc_matcher_is_integer (child) ||
+          bson_iter_as_int64 (child) < 0) {
          bson_set_error (error,
                          MONGOC_ERROR_MATCHER,
                          MONGOC_ERROR_MATCHER_INVALID,
-                         "Invalid operator \"%s\"",
-                         key);
+                         "$size requires a non-negative integer");
          return NULL;
       }
-   } else {
-      op =
-         _mongoc_matcher_op_compare_new (MONGOC_MATCHER_OPCODE_EQ, path, iter);
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_SIZE, path, child);
+   } else if (strcmp (key, "$mod") == 0) {
+      if (!BSON_ITER_HOLDS_ARRAY (child) ||
+          !bson_iter_recurse (child, &operand) ||
+          !bson_iter_next (&operand) ||
+          !_mongoc_matcher_is_integer (&operand) ||
+          bson_iter_as_int64 (&operand) == 0 ||
+          !bson_iter_next (&operand) ||
+          !_mongoc_matcher_is_integer (&operand) ||
+          bson_iter_next (&operand)) {
+         bson_set_error (error,
+                         MONGOC_ERROR_MATCHER,
+                         MONGOC_ERROR_MATCHER_INVALID,
+                         "$mod requires [divisor, remainder] with a "
+                         "non-zero integer divisor");
+         return NULL;
+      }
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_MOD, path, child);
+   } else if (strcmp (key, "$regex") == 0) {
+      return _mongoc_matcher_parse_regex (child, parent, path, error);
+   } else if (strcmp (key, "$elemMatch") == 0) {
+      return _mongoc_matcher_parse_elem_match (child, path, error);
+   }
+
+   bson_set_error (error,
+                   MONGOC_ERROR_MATCHER,
+                   MONGOC_ERROR_MATCHER_INVALID,
+                   "Invalid operator \"%s\"",
+                   key);
+
+   return NULL;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_matcher_parse_compare --
+ *
+ *       Parse a compare spec such as $gt or $in, a document of operators
+ *       that must all match such as {$gt: 1, $lt: 5}, or a value to
+ *       match exactly. A BSON regular expression is matched like $regex.
+ *
+ * Returns:
+ *       A newly allocated mongoc_matcher_op_t if successful; otherwise
+ *       NULL and @error is set.
+ *
+ * Side effects:
+ *       @error may be set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static mongoc_matcher_op_t *
+_mongoc_matcher_parse_compare (bson_iter_t *iter,   /* IN */
+                               const char *path,    /* IN */
+                               bson_error_t *error) /* OUT */
+{
+   mongoc_matcher_op_t *op = NULL;
+   mongoc_matcher_op_t *next;
+   bson_iter_t child;
+   const char *pattern;
+   const char *options;
+   bool has_regex;
+
+   BSON_ASSERT (iter);
+   BSON_ASSERT (path);
+
+   if (BSON_ITER_HOLDS_REGEX (iter)) {
+      pattern = bson_iter_regex (iter, &options);
+      return _mongoc_matcher_op_regex_new (path, pattern, options, error);
+   }
+
+   if (bson_iter_type (iter) != BSON_TYPE_DOCUMENT) {
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_EQ, path, iter);
+   }
+
+   if (!bson_iter_recurse (iter, &child) || !bson_iter_next (&child)) {
+      bson_set_error (error,
+                      MONGOC_ERROR_MATCHER,
+                      MONGOC_ERROR_MATCHER_INVALID,
+                      "Document contains no operations.");
+      return NULL;
+   }
+
+   if (bson_iter_key (&child)[0] != '$') {
+      return _mongoc_matcher_op_compare_new (
+         MONGOC_MATCHER_OPCODE_EQ, path, iter);
+   }
+
+   has_regex = bson_iter_recurse (iter, &child) &&
+               bson_iter_find (&child, "$regex");
+
+   bson_iter_recurse (iter, &child);
+
+   while (bson_iter_next (&child)) {
+      /* consumed by $regex */
+      if (has_regex && strcmp (bson_iter_key (&child), "$options") == 0) {
+         continue;
+      }
+
+      next = _mongoc_matcher_parse_operator (&child, iter, path, error);
+      if (!next) {
+         if (op) {
+            _mongoc_matcher_op_destroy (op);
+         }
+
+         return NULL;
+      }
+
+      op = op ? _mongoc_matcher_op_logical_new (
+                   MONGOC_MATCHER_OPCODE_AND, op, next)
+              : next;
    }
 
    BSON_ASSERT (op);
@@ -303,7 +560,8 @@ _mongoc_matcher_parse_logical (mongoc_matcher_opcode_t opcode, /* IN */
  *       provided in @query.
  *
  *       This will build an operation tree that can be applied to arbitrary
- *       bson documents using mongoc_matcher_match().
+ *       bson documents using mongoc_matcher_match(), and compile it to a
+ *       mongoc_matcher_program_t unless it has too many paths.
  *
  * Returns:
  *       A newly allocated mongoc_matcher_t if successful; otherwise NULL
@@ -341,6 +599,7 @@ mongoc_matcher_new (const bson_t *query, /* IN */
    }
 
    matcher->optree = op;
+   matcher->program = _mongoc_matcher_program_new (op);
 
    return matcher;
 
@@ -376,6 +635,10 @@ mongoc_matcher_match (const mongoc_matcher_t *matcher, /* IN */
    BSON_ASSERT (matcher->optree);
    BSON_ASSERT (document);
 
+   if (matcher->program) {
+      return _mongoc_matcher_program_match (matcher->program, document);
+   }
+
    return _mongoc_matcher_op_match (matcher->optree, document);
 }
 
@@ -401,6 +664,7 @@ mongoc_matcher_destroy (mongoc_matcher_t *matcher) /* IN */
 {
    BSON_ASSERT (matcher);
 
+   _mongoc_matcher_program_destroy (matcher->program);
    _mongoc_matcher_op_destroy (matcher->optree);
    bson_destroy (&matcher->query);
    bson_free (matcher);
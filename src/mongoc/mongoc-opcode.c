@@ -43,6 +43,7 @@ _mongoc_opcode_needs_primary (mongoc_opcode_t opcode)
    case MONGOC_OPCODE_GET_MORE:
    case MONGOC_OPCODE_MSG:
    case MONGOC_OPCODE_REPLY:
+   case MONGOC_OPCODE_COMPRESSED:
       needs_primary = false;
       break;
    case MONGOC_OPCODE_QUERY:
@@ -36,6 +36,7 @@ typedef enum {
    MONGOC_OPCODE_GET_MORE = 2005,
    MONGOC_OPCODE_DELETE = 2006,
    MONGOC_OPCODE_KILL_CURSORS = 2007,
+   MONGOC_OPCODE_COMPRESSED = 2012,
 } mongoc_opcode_t;
 
 
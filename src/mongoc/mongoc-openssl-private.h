@@ -26,12 +26,25 @@
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
+#include "mongoc-array-private.h"
 #include "mongoc-ssl.h"
+#include "mongoc-thread-private.h"
 
 
 BSON_BEGIN_DECLS
 
 
+/* a client's or pool's OpenSSL state, shared by its TLS streams: one
+ * SSL_CTX, built on first use, and TLS sessions by host and port to resume
+ * when it reconnects. It is owned by the topology and passed to
+ * _mongoc_stream_tls_new_with_hostname_shared. */
+typedef struct _mongoc_openssl_shared_t {
+   mongoc_mutex_t mutex;
+   SSL_CTX *ctx;
+   mongoc_array_t sessions;
+} mongoc_openssl_shared_t;
+
+
 bool
 _mongoc_openssl_check_cert (SSL *ssl,
                             const char *host,
@@ -44,6 +57,23 @@ void
 _mongoc_openssl_init (void);
 void
 _mongoc_openssl_cleanup (void);
+void
+_mongoc_openssl_shared_init (mongoc_openssl_shared_t *shared);
+void
+_mongoc_openssl_shared_reset (mongoc_openssl_shared_t *shared);
+void
+_mongoc_openssl_shared_destroy (mongoc_openssl_shared_t *shared);
+SSL_CTX *
+_mongoc_openssl_shared_get_ctx (mongoc_openssl_shared_t *shared,
+                                mongoc_ssl_opt_t *opt);
+bool
+_mongoc_openssl_shared_resume (mongoc_openssl_shared_t *shared,
+                               const char *host_and_port,
+                               SSL *ssl);
+void
+_mongoc_openssl_shared_save (mongoc_openssl_shared_t *shared,
+                             const char *host_and_port,
+                             SSL *ssl);
 
 
 BSON_END_DECLS
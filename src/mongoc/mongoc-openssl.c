@@ -540,10 +540,195 @@ _mongoc_openssl_ctx_new (mongoc_ssl_opt_t *opt)
       return NULL;
    }
 
+   if (opt->weak_cert_validation) {
+      SSL_CTX_set_verify (ctx, SSL_VERIFY_NONE, NULL);
+   } else {
+      SSL_CTX_set_verify (ctx, SSL_VERIFY_PEER, NULL);
+   }
+
+   return ctx;
+}
+
+
+typedef struct {
+   char *host_and_port;
+   SSL_SESSION *session;
+} mongoc_openssl_session_t;
+
+
+void
+_mongoc_openssl_shared_init (mongoc_openssl_shared_t *shared)
+{
+   mongoc_mutex_init (&shared->mutex);
+   shared->ctx = NULL;
+   _mongoc_array_init (&shared->sessions, sizeof (mongoc_openssl_session_t));
+}
+
+
+/**
+ * _mongoc_openssl_shared_reset:
+ *
+ * Forget the SSL_CTX and sessions, when the owner's options change.
+ * Streams keep their own references to the old SSL_CTX.
+ */
+void
+_mongoc_openssl_shared_reset (mongoc_openssl_shared_t *shared)
+{
+   mongoc_openssl_session_t *entry;
+   size_t i;
+
+   mongoc_mutex_lock (&shared->mutex);
+
+   for (i = 0; i < shared->sessions.len; i++) {
+      entry = &_mongoc_array_index (
+         &shared->sessions, mongoc_openssl_session_t, i);
+      bson_free (entry->host_and_port);
+      SSL_SESSION_free (entry->session);
+   }
+
+   _mongoc_array_clear (&shared->sessions);
+
+   if (shared->ctx) {
+      SSL_CTX_free (shared->ctx);
+      shared->ctx = NULL;
+   }
+
+   mongoc_mutex_unlock (&shared->mutex);
+}
+
+
+void
+_mongoc_openssl_shared_destroy (mongoc_openssl_shared_t *shared)
+{
+   _mongoc_openssl_shared_reset (shared);
+   _mongoc_array_destroy (&shared->sessions);
+   mongoc_mutex_destroy (&shared->mutex);
+}
+
+
+/**
+ * _mongoc_openssl_shared_get_ctx:
+ *
+ * Return the SSL_CTX for @opt, loading its certificates and CA files the
+ * first time. The caller must SSL_CTX_free the returned reference.
+ */
+SSL_CTX *
+_mongoc_openssl_shared_get_ctx (mongoc_openssl_shared_t *shared,
+                                mongoc_ssl_opt_t *opt)
+{
+   SSL_CTX *ctx;
+
+   mongoc_mutex_lock (&shared->mutex);
+
+   if (!shared->ctx) {
+      shared->ctx = _mongoc_openssl_ctx_new (opt);
+   }
+
+   ctx = shared->ctx;
+   if (ctx) {
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L && !defined(LIBRESSL_VERSION_NUMBER)
+      SSL_CTX_up_ref (ctx);
+#else
+      CRYPTO_add (&ctx->references, 1, CRYPTO_LOCK_SSL_CTX);
+#endif
+   }
+
+   mongoc_mutex_unlock (&shared->mutex);
+
    return ctx;
 }
 
 
+static mongoc_openssl_session_t *
+_mongoc_openssl_shared_find (mongoc_openssl_shared_t *shared,
+                             const char *host_and_port)
+{
+   mongoc_openssl_session_t *entry;
+   size_t i;
+
+   for (i = 0; i < shared->sessions.len; i++) {
+      entry = &_mongoc_array_index (
+         &shared->sessions, mongoc_openssl_session_t, i);
+      /* servers on one host, on different ports, have separate sessions */
+      if (!strcasecmp (entry->host_and_port, host_and_port)) {
+         return entry;
+      }
+   }
+
+   return NULL;
+}
+
+
+/**
+ * _mongoc_openssl_shared_resume:
+ *
+ * Offer the last session of the server at @host_and_port, if any, when
+ * @ssl connects. Returns true if
+ * there was a session to offer; the server may still refuse it.
+ */
+bool
+_mongoc_openssl_shared_resume (mongoc_openssl_shared_t *shared,
+                               const char *host_and_port,
+                               SSL *ssl)
+{
+   mongoc_openssl_session_t *entry;
+   bool ret = false;
+
+   mongoc_mutex_lock (&shared->mutex);
+   entry = _mongoc_openssl_shared_find (shared, host_and_port);
+   if (entry) {
+      /* SSL_set_session takes its own reference */
+      ret = SSL_set_session (ssl, entry->session) == 1;
+   }
+   mongoc_mutex_unlock (&shared->mutex);
+
+   return ret;
+}
+
+
+/**
+ * _mongoc_openssl_shared_save:
+ *
+ * Remember @ssl's session as that of the server at @host_and_port, after
+ * a handshake. Called again when
+ * the stream is destroyed, since a TLS 1.3 server sends its session ticket
+ * after the handshake.
+ */
+void
+_mongoc_openssl_shared_save (mongoc_openssl_shared_t *shared,
+                             const char *host_and_port,
+                             SSL *ssl)
+{
+   mongoc_openssl_session_t *entry;
+   mongoc_openssl_session_t new_entry;
+   SSL_SESSION *session;
+
+   session = SSL_get1_session (ssl);
+   if (!session) {
+      return;
+   }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+   if (!SSL_SESSION_is_resumable (session)) {
+      SSL_SESSION_free (session);
+      return;
+   }
+#endif
+
+   mongoc_mutex_lock (&shared->mutex);
+   entry = _mongoc_openssl_shared_find (shared, host_and_port);
+   if (entry) {
+      SSL_SESSION_free (entry->session);
+      entry->session = session;
+   } else {
+      new_entry.host_and_port = bson_strdup (host_and_port);
+      new_entry.session = session;
+      _mongoc_array_append_val (&shared->sessions, new_entry);
+   }
+   mongoc_mutex_unlock (&shared->mutex);
+}
+
+
 char *
 _mongoc_openssl_extract_subject (const char *filename, const char *passphrase)
 {
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_PIPELINE_PRIVATE_H
+#define MONGOC_PIPELINE_PRIVATE_H
+
+#if !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-array-private.h"
+#include "mongoc-buffer-private.h"
+#include "mongoc-client.h"
+#include "mongoc-host-list.h"
+#include "mongoc-pipeline.h"
+#include "mongoc-read-prefs.h"
+
+
+BSON_BEGIN_DECLS
+
+
+typedef enum {
+   MONGOC_PIPELINE_REQUEST_QUEUED,
+   MONGOC_PIPELINE_REQUEST_SENT,
+   MONGOC_PIPELINE_REQUEST_DONE,
+} mongoc_pipeline_request_state_t;
+
+
+struct _mongoc_pipeline_request_t {
+   mongoc_pipeline_t *pipeline;
+   mongoc_pipeline_request_state_t state;
+   char *db_name;
+   char *cmd_ns;
+   bson_t command;
+   uint32_t request_id;
+   int64_t started;
+   bool succeeded;
+   bson_t reply;
+   bson_error_t error;
+};
+
+
+struct _mongoc_pipeline_t {
+   mongoc_client_t *client;
+   mongoc_read_prefs_t *read_prefs;
+   uint32_t server_id;
+   mongoc_host_list_t host;
+   mongoc_array_t requests; /* mongoc_pipeline_request_t pointers */
+   uint32_t n_in_flight;
+   mongoc_buffer_t buffer;
+};
+
+
+mongoc_pipeline_t *
+_mongoc_pipeline_new (mongoc_client_t *client,
+                      const mongoc_read_prefs_t *read_prefs);
+
+void
+_mongoc_pipeline_set_server_id (mongoc_pipeline_t *pipeline,
+                                uint32_t server_id);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_PIPELINE_PRIVATE_H */
@@ -0,0 +1,680 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mongoc-apm-private.h"
+#include "mongoc-client-private.h"
+#include "mongoc-cluster-private.h"
+#include "mongoc-error.h"
+#include "mongoc-pipeline-private.h"
+#include "mongoc-read-prefs-private.h"
+#include "mongoc-rpc-private.h"
+#include "mongoc-trace-private.h"
+#include "mongoc-util-private.h"
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "pipeline"
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_pipeline_new --
+ *
+ *       Create a pipeline of commands to be sent to one server, selected
+ *       with @read_prefs when the pipeline is first flushed.
+ *
+ * Returns:
+ *       A new pipeline that must be freed with mongoc_pipeline_destroy().
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_pipeline_t *
+_mongoc_pipeline_new (mongoc_client_t *client,
+                      const mongoc_read_prefs_t *read_prefs)
+{
+   mongoc_pipeline_t *pipeline;
+
+   BSON_ASSERT (client);
+
+   pipeline = (mongoc_pipeline_t *) bson_malloc0 (sizeof *pipeline);
+   pipeline->client = client;
+   pipeline->read_prefs = mongoc_read_prefs_copy (read_prefs);
+   _mongoc_array_init (&pipeline->requests,
+                       sizeof (mongoc_pipeline_request_t *));
+   _mongoc_buffer_init (&pipeline->buffer, NULL, 0, NULL, NULL);
+
+   return pipeline;
+}
+
+
+/* send to @server_id instead of selecting a server on the first flush */
+void
+_mongoc_pipeline_set_server_id (mongoc_pipeline_t *pipeline,
+                                uint32_t server_id)
+{
+   BSON_ASSERT (pipeline);
+   BSON_ASSERT (!pipeline->n_in_flight);
+
+   pipeline->server_id = server_id;
+}
+
+
+static void
+_mongoc_pipeline_request_destroy (mongoc_pipeline_request_t *request)
+{
+   bson_free (request->db_name);
+   bson_free (request->cmd_ns);
+   bson_destroy (&request->command);
+   bson_destroy (&request->reply);
+   bson_free (request);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_pipeline_request_finish --
+ *
+ *       Complete @request with the server's @reply, or with @error if
+ *       @error is not NULL. @reply may be NULL if no reply was received.
+ *
+ * Side effects:
+ *       If the command had been sent, the client's APM callbacks are
+ *       executed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_pipeline_request_finish (mongoc_pipeline_request_t *request,
+                                 const bson_t *reply,
+                                 const bson_error_t *error)
+{
+   mongoc_pipeline_t *pipeline;
+   mongoc_client_t *client;
+   mongoc_apm_callbacks_t *callbacks;
+   mongoc_apm_command_succeeded_t succeeded_event;
+   mongoc_apm_command_failed_t failed_event;
+   int64_t duration;
+
+   pipeline = request->pipeline;
+   client = pipeline->client;
+   callbacks = &client->apm_callbacks;
+
+   BSON_ASSERT (request->state != MONGOC_PIPELINE_REQUEST_DONE);
+
+   if (reply) {
+      bson_concat (&request->reply, reply);
+   }
+
+   request->succeeded = (error == NULL);
+   if (error) {
+      memcpy (&request->error, error, sizeof (bson_error_t));
+   }
+
+   if (request->state == MONGOC_PIPELINE_REQUEST_SENT) {
+      BSON_ASSERT (pipeline->n_in_flight > 0);
+      pipeline->n_in_flight--;
+
+      duration = bson_get_monotonic_time () - request->started;
+
+      if (request->succeeded && callbacks->succeeded) {
+         mongoc_apm_command_succeeded_init (
+            &succeeded_event,
+            duration,
+            &request->reply,
+            _mongoc_get_command_name (&request->command),
+            request->request_id,
+            client->cluster.operation_id,
+            &pipeline->host,
+            pipeline->server_id,
+            client->apm_context);
+
+         callbacks->succeeded (&succeeded_event);
+         mongoc_apm_command_succeeded_cleanup (&succeeded_event);
+      } else if (!request->succeeded && callbacks->failed) {
+         mongoc_apm_command_failed_init (
+            &failed_event,
+            duration,
+            _mongoc_get_command_name (&request->command),
+            &request->error,
+            request->request_id,
+            client->cluster.operation_id,
+            &pipeline->host,
+            pipeline->server_id,
+            client->apm_context);
+
+         callbacks->failed (&failed_event);
+         mongoc_apm_command_failed_cleanup (&failed_event);
+      }
+   }
+
+   request->state = MONGOC_PIPELINE_REQUEST_DONE;
+}
+
+
+/* complete every request in @state with @error */
+static void
+_mongoc_pipeline_fail_requests (mongoc_pipeline_t *pipeline,
+                                mongoc_pipeline_request_state_t state,
+                                const bson_error_t *error)
+{
+   mongoc_pipeline_request_t *request;
+   size_t i;
+
+   for (i = 0; i < pipeline->requests.len; i++) {
+      request =
+         _mongoc_array_index (&pipeline->requests, mongoc_pipeline_request_t *, i);
+
+      if (request->state == state) {
+         _mongoc_pipeline_request_finish (request, NULL, error);
+      }
+   }
+}
+
+
+static mongoc_pipeline_request_t *
+_mongoc_pipeline_find_sent (mongoc_pipeline_t *pipeline, int32_t request_id)
+{
+   mongoc_pipeline_request_t *request;
+   size_t i;
+
+   for (i = 0; i < pipeline->requests.len; i++) {
+      request =
+         _mongoc_array_index (&pipeline->requests, mongoc_pipeline_request_t *, i);
+
+      if (request->state == MONGOC_PIPELINE_REQUEST_SENT &&
+          request->request_id == (uint32_t) request_id) {
+         return request;
+      }
+   }
+
+   return NULL;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_pipeline_recv --
+ *
+ *       Read the next reply from the pipeline's stream and complete the
+ *       request whose request_id matches the reply's response_to.
+ *
+ * Returns:
+ *       true if a reply was read and matched to a request.
+ *
+ * Side effects:
+ *       On a network or protocol error the node is disconnected, all
+ *       in-flight requests are failed, and @error is set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_pipeline_recv (mongoc_pipeline_t *pipeline, bson_error_t *error)
+{
+   mongoc_client_t *client;
+   mongoc_cluster_t *cluster;
+   mongoc_server_stream_t *server_stream;
+   mongoc_pipeline_request_t *request;
+   mongoc_rpc_t rpc;
+   bson_error_t request_error;
+   bson_error_t err_local;
+   bson_t reply;
+   bool has_reply;
+   bool ret = false;
+
+   ENTRY;
+
+   BSON_ASSERT (pipeline->n_in_flight > 0);
+
+   if (!error) {
+      error = &err_local;
+   }
+
+   client = pipeline->client;
+   cluster = &client->cluster;
+
+   /* the stream must not be replaced while we await its replies */
+   server_stream = mongoc_cluster_stream_for_server (
+      cluster, pipeline->server_id, false /* reconnect ok */, error);
+
+   if (!server_stream) {
+      _mongoc_pipeline_fail_requests (
+         pipeline, MONGOC_PIPELINE_REQUEST_SENT, error);
+      RETURN (false);
+   }
+
+   _mongoc_buffer_clear (&pipeline->buffer, false);
+
+   if (!_mongoc_client_recv (
+          client, &rpc, &pipeline->buffer, server_stream, error)) {
+      _mongoc_pipeline_fail_requests (
+         pipeline, MONGOC_PIPELINE_REQUEST_SENT, error);
+      GOTO (done);
+   }
+
+   if (rpc.header.opcode != MONGOC_OPCODE_REPLY) {
+      bson_set_error (error,
+                      MONGOC_ERROR_PROTOCOL,
+                      MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                      "Received rpc other than OP_REPLY.");
+      GOTO (fail);
+   }
+
+   request = _mongoc_pipeline_find_sent (pipeline, rpc.reply.response_to);
+   if (!request) {
+      bson_set_error (error,
+                      MONGOC_ERROR_PROTOCOL,
+                      MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                      "Received reply to unknown request %d.",
+                      rpc.reply.response_to);
+      GOTO (fail);
+   }
+
+   has_reply = _mongoc_rpc_reply_get_first (&rpc.reply, &reply);
+
+   if (_mongoc_rpc_parse_command_error (
+          &rpc, client->error_api_version, &request_error)) {
+      _mongoc_pipeline_request_finish (
+         request, has_reply ? &reply : NULL, &request_error);
+   } else {
+      _mongoc_pipeline_request_finish (request, &reply, NULL);
+   }
+
+   if (has_reply) {
+      bson_destroy (&reply);
+   }
+
+   ret = true;
+   GOTO (done);
+
+fail:
+   /* replies can no longer be matched to requests */
+   mongoc_cluster_disconnect_node (cluster, pipeline->server_id);
+   _mongoc_pipeline_fail_requests (
+      pipeline, MONGOC_PIPELINE_REQUEST_SENT, error);
+
+done:
+   mongoc_server_stream_cleanup (server_stream);
+
+   RETURN (ret);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_pipeline_destroy --
+ *
+ *       Free a pipeline and all its requests. Replies to requests still in
+ *       flight are read and discarded first, so the connection can be
+ *       reused.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_pipeline_destroy (mongoc_pipeline_t *pipeline)
+{
+   size_t i;
+
+   ENTRY;
+
+   if (!pipeline) {
+      EXIT;
+   }
+
+   while (pipeline->n_in_flight > 0) {
+      if (!_mongoc_pipeline_recv (pipeline, NULL)) {
+         break;
+      }
+   }
+
+   for (i = 0; i < pipeline->requests.len; i++) {
+      _mongoc_pipeline_request_destroy (_mongoc_array_index (
+         &pipeline->requests, mongoc_pipeline_request_t *, i));
+   }
+
+   _mongoc_array_destroy (&pipeline->requests);
+   _mongoc_buffer_destroy (&pipeline->buffer);
+   mongoc_read_prefs_destroy (pipeline->read_prefs);
+   bson_free (pipeline);
+
+   EXIT;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_pipeline_command --
+ *
+ *       Queue @command to be run on @db_name. Nothing is sent until the
+ *       pipeline is flushed, or a request is waited on.
+ *
+ * Returns:
+ *       A request handle owned by @pipeline, valid until the pipeline is
+ *       destroyed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_pipeline_request_t *
+mongoc_pipeline_command (mongoc_pipeline_t *pipeline,
+                         const char *db_name,
+                         const bson_t *command)
+{
+   mongoc_pipeline_request_t *request;
+   bson_error_t error;
+
+   BSON_ASSERT (pipeline);
+   BSON_ASSERT (db_name);
+   BSON_ASSERT (command);
+
+   request = (mongoc_pipeline_request_t *) bson_malloc0 (sizeof *request);
+   request->pipeline = pipeline;
+   request->state = MONGOC_PIPELINE_REQUEST_QUEUED;
+   request->db_name = bson_strdup (db_name);
+   request->cmd_ns = bson_strdup_printf ("%s.$cmd", db_name);
+   bson_copy_to (command, &request->command);
+   bson_init (&request->reply);
+
+   _mongoc_array_append_val (&pipeline->requests, request);
+
+   if (!_mongoc_get_command_name (command)) {
+      bson_set_error (&error,
+                      MONGOC_ERROR_COMMAND,
+                      MONGOC_ERROR_COMMAND_INVALID_ARG,
+                      "Empty command document");
+      _mongoc_pipeline_request_finish (request, NULL, &error);
+   }
+
+   return request;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_pipeline_flush --
+ *
+ *       Send all queued commands to the server back-to-back, without
+ *       waiting for replies to commands already in flight. The server is
+ *       selected on the first flush; later flushes use the same
+ *       connection.
+ *
+ * Returns:
+ *       true if all queued commands were sent; otherwise false, @error is
+ *       set and the queued commands are failed with the same error.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_pipeline_flush (mongoc_pipeline_t *pipeline, bson_error_t *error)
+{
+   mongoc_cluster_t *cluster;
+   mongoc_server_stream_t *server_stream = NULL;
+   mongoc_pipeline_request_t *request;
+   mongoc_pipeline_request_t **queued;
+   mongoc_apply_read_prefs_result_t *results;
+   mongoc_apm_callbacks_t *callbacks;
+   mongoc_apm_command_started_t started_event;
+   mongoc_rpc_t *rpcs;
+   bson_error_t err_local;
+   size_t n_queued = 0;
+   size_t i;
+   bool ret = false;
+
+   ENTRY;
+
+   BSON_ASSERT (pipeline);
+
+   if (!error) {
+      error = &err_local;
+   }
+
+   cluster = &pipeline->client->cluster;
+   callbacks = &pipeline->client->apm_callbacks;
+
+   for (i = 0; i < pipeline->requests.len; i++) {
+      request =
+         _mongoc_array_index (&pipeline->requests, mongoc_pipeline_request_t *, i);
+
+      if (request->state == MONGOC_PIPELINE_REQUEST_QUEUED) {
+         n_queued++;
+      }
+   }
+
+   if (!n_queued) {
+      RETURN (true);
+   }
+
+   queued = (mongoc_pipeline_request_t **) bson_malloc0 (
+      n_queued * sizeof (mongoc_pipeline_request_t *));
+   n_queued = 0;
+
+   for (i = 0; i < pipeline->requests.len; i++) {
+      request =
+         _mongoc_array_index (&pipeline->requests, mongoc_pipeline_request_t *, i);
+
+      if (request->state == MONGOC_PIPELINE_REQUEST_QUEUED) {
+         queued[n_queued++] = request;
+      }
+   }
+
+   if (pipeline->client->in_exhaust) {
+      bson_set_error (error,
+                      MONGOC_ERROR_CLIENT,
+                      MONGOC_ERROR_CLIENT_IN_EXHAUST,
+                      "A cursor derived from this client is in exhaust.");
+      _mongoc_pipeline_fail_requests (
+         pipeline, MONGOC_PIPELINE_REQUEST_QUEUED, error);
+      bson_free (queued);
+      RETURN (false);
+   }
+
+   if (!pipeline->server_id) {
+      if (_mongoc_read_prefs_validate (pipeline->read_prefs, error)) {
+         server_stream = mongoc_cluster_stream_for_reads (
+            cluster, pipeline->read_prefs, error);
+      }
+
+   } else {
+      /* only reconnect if no replies are owed on the current stream */
+      server_stream =
+         mongoc_cluster_stream_for_server (cluster,
+                                           pipeline->server_id,
+                                           pipeline->n_in_flight == 0,
+                                           error);
+   }
+
+   if (server_stream) {
+      pipeline->server_id = server_stream->sd->id;
+      memcpy (&pipeline->host,
+              &server_stream->sd->host,
+              sizeof (mongoc_host_list_t));
+      pipeline->host.next = NULL;
+   }
+
+   if (!server_stream) {
+      _mongoc_pipeline_fail_requests (
+         pipeline, MONGOC_PIPELINE_REQUEST_QUEUED, error);
+      bson_free (queued);
+      RETURN (false);
+   }
+
+   if (pipeline->n_in_flight > 0) {
+      /* don't let a single-threaded client check the stream with an
+       * "isMaster" while it owes us replies */
+      mongoc_cluster_mark_node_used (cluster, pipeline->server_id);
+   }
+
+   rpcs = (mongoc_rpc_t *) bson_malloc0 (n_queued * sizeof (mongoc_rpc_t));
+   results = (mongoc_apply_read_prefs_result_t *) bson_malloc0 (
+      n_queued * sizeof (mongoc_apply_read_prefs_result_t));
+
+   for (i = 0; i < n_queued; i++) {
+      request = queued[i];
+
+      apply_read_preferences (pipeline->read_prefs,
+                              server_stream,
+                              &request->command,
+                              MONGOC_QUERY_NONE,
+                              &results[i]);
+
+      _mongoc_rpc_prep_command (&rpcs[i],
+                                request->cmd_ns,
+                                results[i].query_with_read_prefs,
+                                results[i].flags);
+
+      request->request_id = ++cluster->request_id;
+      rpcs[i].query.request_id = request->request_id;
+      request->started = bson_get_monotonic_time ();
+      request->state = MONGOC_PIPELINE_REQUEST_SENT;
+      pipeline->n_in_flight++;
+
+      if (callbacks->started) {
+         mongoc_apm_command_started_init (
+            &started_event,
+            &request->command,
+            request->db_name,
+            _mongoc_get_command_name (&request->command),
+            request->request_id,
+            cluster->operation_id,
+            &pipeline->host,
+            pipeline->server_id,
+            pipeline->client->apm_context);
+
+         callbacks->started (&started_event);
+         mongoc_apm_command_started_cleanup (&started_event);
+      }
+   }
+
+   if (!mongoc_cluster_sendv_to_server (
+          cluster, rpcs, n_queued, server_stream, NULL, error)) {
+      /* a partial write leaves the stream unusable for earlier requests */
+      mongoc_cluster_disconnect_node (cluster, pipeline->server_id);
+      _mongoc_pipeline_fail_requests (
+         pipeline, MONGOC_PIPELINE_REQUEST_SENT, error);
+      GOTO (done);
+   }
+
+   ret = true;
+
+done:
+   for (i = 0; i < n_queued; i++) {
+      apply_read_prefs_result_cleanup (&results[i]);
+   }
+
+   bson_free (results);
+   bson_free (rpcs);
+   bson_free (queued);
+   mongoc_server_stream_cleanup (server_stream);
+
+   RETURN (ret);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_pipeline_get_hint --
+ *
+ *       Get the id of the server the pipeline sends commands to, or 0 if
+ *       it has not been flushed yet.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+uint32_t
+mongoc_pipeline_get_hint (const mongoc_pipeline_t *pipeline)
+{
+   BSON_ASSERT (pipeline);
+
+   return pipeline->server_id;
+}
+
+
+bool
+mongoc_pipeline_request_is_done (const mongoc_pipeline_request_t *request)
+{
+   BSON_ASSERT (request);
+
+   return request->state == MONGOC_PIPELINE_REQUEST_DONE;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_pipeline_request_wait --
+ *
+ *       Block until the reply to @request is received. Flushes the
+ *       pipeline first if @request has not been sent. Replies to other
+ *       requests that arrive first are stored in their requests.
+ *
+ * Returns:
+ *       true if the command succeeded; otherwise false and @error is set.
+ *
+ * Side effects:
+ *       @reply is always initialized and must be freed with
+ *       bson_destroy().
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_pipeline_request_wait (mongoc_pipeline_request_t *request,
+                              bson_t *reply,
+                              bson_error_t *error)
+{
+   mongoc_pipeline_t *pipeline;
+
+   ENTRY;
+
+   BSON_ASSERT (request);
+
+   pipeline = request->pipeline;
+
+   if (request->state == MONGOC_PIPELINE_REQUEST_QUEUED) {
+      /* on failure, the request is completed with the error */
+      mongoc_pipeline_flush (pipeline, NULL);
+   }
+
+   while (request->state == MONGOC_PIPELINE_REQUEST_SENT) {
+      if (!_mongoc_pipeline_recv (pipeline, NULL)) {
+         break;
+      }
+   }
+
+   BSON_ASSERT (request->state == MONGOC_PIPELINE_REQUEST_DONE);
+
+   if (reply) {
+      bson_copy_to (&request->reply, reply);
+   }
+
+   if (!request->succeeded && error) {
+      memcpy (error, &request->error, sizeof (bson_error_t));
+   }
+
+   RETURN (request->succeeded);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_PIPELINE_H
+#define MONGOC_PIPELINE_H
+
+#if !defined(MONGOC_INSIDE) && !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+
+BSON_BEGIN_DECLS
+
+
+typedef struct _mongoc_pipeline_t mongoc_pipeline_t;
+typedef struct _mongoc_pipeline_request_t mongoc_pipeline_request_t;
+
+
+BSON_EXPORT (void)
+mongoc_pipeline_destroy (mongoc_pipeline_t *pipeline);
+BSON_EXPORT (mongoc_pipeline_request_t *)
+mongoc_pipeline_command (mongoc_pipeline_t *pipeline,
+                         const char *db_name,
+                         const bson_t *command);
+BSON_EXPORT (bool)
+mongoc_pipeline_flush (mongoc_pipeline_t *pipeline, bson_error_t *error);
+BSON_EXPORT (uint32_t)
+mongoc_pipeline_get_hint (const mongoc_pipeline_t *pipeline);
+BSON_EXPORT (bool)
+mongoc_pipeline_request_is_done (const mongoc_pipeline_request_t *request);
+BSON_EXPORT (bool)
+mongoc_pipeline_request_wait (mongoc_pipeline_request_t *request,
+                              bson_t *reply,
+                              bson_error_t *error);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_PIPELINE_H */
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_POLLER_PRIVATE_H
+#define MONGOC_POLLER_PRIVATE_H
+
+#if !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-array-private.h"
+#include "mongoc-stream.h"
+
+#if defined(__linux__)
+#define MONGOC_HAVE_EPOLL 1
+#include <sys/epoll.h>
+#endif
+
+
+BSON_BEGIN_DECLS
+
+
+/* a stream registered with a poller, with the events to wait for */
+typedef struct {
+   mongoc_stream_t *stream;
+#ifdef MONGOC_HAVE_EPOLL
+   int fd;
+#endif
+   int events;
+   void *data;
+   size_t index;
+} mongoc_poller_entry_t;
+
+
+typedef struct {
+   void *data;
+   int revents;
+} mongoc_poller_event_t;
+
+
+/* a set of streams to wait on repeatedly. on Linux, registrations are kept
+ * in an epoll instance so each wait costs O(ready streams), not O(streams);
+ * elsewhere, or if a stream has no socket, it falls back to
+ * mongoc_stream_poll. */
+typedef struct {
+   mongoc_array_t entries; /* mongoc_poller_entry_t pointers */
+   mongoc_poller_event_t *events;
+   size_t events_size;
+   mongoc_stream_poll_t *poll_streams;
+   size_t poll_streams_size;
+#ifdef MONGOC_HAVE_EPOLL
+   int epfd;
+   struct epoll_event *epoll_events;
+#endif
+} mongoc_poller_t;
+
+
+mongoc_poller_t *
+_mongoc_poller_new (void);
+
+void
+_mongoc_poller_destroy (mongoc_poller_t *poller);
+
+mongoc_poller_entry_t *
+_mongoc_poller_add (mongoc_poller_t *poller,
+                    mongoc_stream_t *stream,
+                    int events,
+                    void *data);
+
+void
+_mongoc_poller_modify (mongoc_poller_t *poller,
+                       mongoc_poller_entry_t *entry,
+                       int events);
+
+void
+_mongoc_poller_remove (mongoc_poller_t *poller, mongoc_poller_entry_t *entry);
+
+size_t
+_mongoc_poller_size (const mongoc_poller_t *poller);
+
+bool
+_mongoc_poller_uses_epoll (const mongoc_poller_t *poller);
+
+ssize_t
+_mongoc_poller_wait (mongoc_poller_t *poller,
+                     int32_t timeout_msec,
+                     const mongoc_poller_event_t **events);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_POLLER_PRIVATE_H */
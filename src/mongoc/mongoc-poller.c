@@ -0,0 +1,426 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <errno.h>
+
+#include "mongoc-poller-private.h"
+#include "mongoc-socket-private.h"
+#include "mongoc-stream-private.h"
+#include "mongoc-stream-socket.h"
+#include "mongoc-trace-private.h"
+
+#ifdef MONGOC_HAVE_EPOLL
+#include <unistd.h>
+#endif
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "poller"
+
+
+#define ENTRY_AT(_poller, _i) \
+   (_mongoc_array_index (&(_poller)->entries, mongoc_poller_entry_t *, (_i)))
+
+
+#ifdef MONGOC_HAVE_EPOLL
+static uint32_t
+_mongoc_poller_to_epoll (int events)
+{
+   uint32_t epoll_events = 0;
+
+   if (events & POLLIN) {
+      epoll_events |= EPOLLIN;
+   }
+
+   if (events & POLLOUT) {
+      epoll_events |= EPOLLOUT;
+   }
+
+   /* EPOLLERR and EPOLLHUP are always reported, as with poll */
+   return epoll_events;
+}
+
+
+static int
+_mongoc_poller_from_epoll (uint32_t epoll_events)
+{
+   int revents = 0;
+
+   if (epoll_events & EPOLLIN) {
+      revents |= POLLIN;
+   }
+
+   if (epoll_events & EPOLLOUT) {
+      revents |= POLLOUT;
+   }
+
+   if (epoll_events & EPOLLERR) {
+      revents |= POLLERR;
+   }
+
+   if (epoll_events & EPOLLHUP) {
+      revents |= POLLHUP;
+   }
+
+   return revents;
+}
+
+
+/* the socket descriptor under @stream, or -1 if it has none */
+static int
+_mongoc_poller_stream_fd (mongoc_stream_t *stream)
+{
+   mongoc_stream_t *root;
+   mongoc_socket_t *sock;
+
+   root = mongoc_stream_get_root_stream (stream);
+   if (!root || root->type != MONGOC_STREAM_SOCKET) {
+      return -1;
+   }
+
+   sock = mongoc_stream_socket_get_socket ((mongoc_stream_socket_t *) root);
+
+   return sock ? sock->sd : -1;
+}
+
+
+/* stop using epoll, e.g. for a stream that is not a socket. the entries are
+ * polled with mongoc_stream_poll from now on. */
+static void
+_mongoc_poller_fall_back (mongoc_poller_t *poller)
+{
+   if (poller->epfd >= 0) {
+      TRACE ("%s", "falling back to poll");
+      close (poller->epfd);
+      poller->epfd = -1;
+   }
+}
+
+
+static bool
+_mongoc_poller_epoll_ctl (mongoc_poller_t *poller,
+                          int op,
+                          mongoc_poller_entry_t *entry)
+{
+   struct epoll_event event = {0};
+
+   event.events = _mongoc_poller_to_epoll (entry->events);
+   event.data.ptr = entry;
+
+   return epoll_ctl (poller->epfd, op, entry->fd, &event) == 0;
+}
+#endif
+
+
+mongoc_poller_t *
+_mongoc_poller_new (void)
+{
+   mongoc_poller_t *poller;
+
+   poller = (mongoc_poller_t *) bson_malloc0 (sizeof *poller);
+   _mongoc_array_init (&poller->entries, sizeof (mongoc_poller_entry_t *));
+
+#ifdef MONGOC_HAVE_EPOLL
+   poller->epfd = epoll_create1 (EPOLL_CLOEXEC);
+   if (poller->epfd < 0) {
+      MONGOC_WARNING ("epoll_create1 failed, errno %d, falling back to poll",
+                      errno);
+   }
+#endif
+
+   return poller;
+}
+
+
+void
+_mongoc_poller_destroy (mongoc_poller_t *poller)
+{
+   size_t i;
+
+   if (!poller) {
+      return;
+   }
+
+   for (i = 0; i < poller->entries.len; i++) {
+      bson_free (ENTRY_AT (poller, i));
+   }
+
+#ifdef MONGOC_HAVE_EPOLL
+   _mongoc_poller_fall_back (poller);
+#endif
+
+   _mongoc_array_destroy (&poller->entries);
+   bson_free (poller->events);
+#ifdef MONGOC_HAVE_EPOLL
+   bson_free (poller->epoll_events);
+#endif
+   bson_free (poller->poll_streams);
+   bson_free (poller);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_poller_add --
+ *
+ *       Start waiting for @events (POLLIN and/or POLLOUT) on @stream.
+ *       @data is reported with the stream's events by _mongoc_poller_wait.
+ *       Each stream may be added to a poller only once.
+ *
+ * Returns:
+ *       A handle to modify or remove the registration with. It is valid
+ *       until it is removed or the poller is destroyed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_poller_entry_t *
+_mongoc_poller_add (mongoc_poller_t *poller,
+                    mongoc_stream_t *stream,
+                    int events,
+                    void *data)
+{
+   mongoc_poller_entry_t *entry;
+
+   BSON_ASSERT (poller);
+   BSON_ASSERT (stream);
+
+   entry = (mongoc_poller_entry_t *) bson_malloc0 (sizeof *entry);
+   entry->stream = stream;
+   entry->events = events;
+   entry->data = data;
+   entry->index = poller->entries.len;
+
+   _mongoc_array_append_val (&poller->entries, entry);
+
+#ifdef MONGOC_HAVE_EPOLL
+   entry->fd = _mongoc_poller_stream_fd (stream);
+
+   if (poller->epfd >= 0) {
+      if (entry->fd < 0 ||
+          !_mongoc_poller_epoll_ctl (poller, EPOLL_CTL_ADD, entry)) {
+         _mongoc_poller_fall_back (poller);
+      }
+   }
+#endif
+
+   return entry;
+}
+
+
+void
+_mongoc_poller_modify (mongoc_poller_t *poller,
+                       mongoc_poller_entry_t *entry,
+                       int events)
+{
+   BSON_ASSERT (poller);
+   BSON_ASSERT (entry);
+
+   if (entry->events == events) {
+      return;
+   }
+
+   entry->events = events;
+
+#ifdef MONGOC_HAVE_EPOLL
+   if (poller->epfd >= 0 &&
+       !_mongoc_poller_epoll_ctl (poller, EPOLL_CTL_MOD, entry)) {
+      _mongoc_poller_fall_back (poller);
+   }
+#endif
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_poller_remove --
+ *
+ *       Stop waiting on @entry's stream and free @entry. Call this before
+ *       the stream is closed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_poller_remove (mongoc_poller_t *poller, mongoc_poller_entry_t *entry)
+{
+   mongoc_poller_entry_t *last;
+
+   BSON_ASSERT (poller);
+   BSON_ASSERT (entry);
+   BSON_ASSERT (entry->index < poller->entries.len);
+   BSON_ASSERT (ENTRY_AT (poller, entry->index) == entry);
+
+#ifdef MONGOC_HAVE_EPOLL
+   if (poller->epfd >= 0) {
+      /* failure means the socket was already closed; nothing to do */
+      (void) _mongoc_poller_epoll_ctl (poller, EPOLL_CTL_DEL, entry);
+   }
+#endif
+
+   /* move the last entry into the hole */
+   last = ENTRY_AT (poller, poller->entries.len - 1);
+   last->index = entry->index;
+   ENTRY_AT (poller, entry->index) = last;
+   poller->entries.len--;
+
+   bson_free (entry);
+}
+
+
+size_t
+_mongoc_poller_size (const mongoc_poller_t *poller)
+{
+   return poller->entries.len;
+}
+
+
+bool
+_mongoc_poller_uses_epoll (const mongoc_poller_t *poller)
+{
+#ifdef MONGOC_HAVE_EPOLL
+   return poller->epfd >= 0;
+#else
+   return false;
+#endif
+}
+
+
+static ssize_t
+_mongoc_poller_wait_poll (mongoc_poller_t *poller, int32_t timeout_msec)
+{
+   mongoc_poller_entry_t *entry;
+   size_t n_entries;
+   ssize_t nactive;
+   ssize_t n_events;
+   size_t i;
+
+   n_entries = poller->entries.len;
+
+   if (poller->poll_streams_size < n_entries) {
+      poller->poll_streams = (mongoc_stream_poll_t *) bson_realloc (
+         poller->poll_streams, n_entries * sizeof (mongoc_stream_poll_t));
+      poller->poll_streams_size = n_entries;
+   }
+
+   for (i = 0; i < n_entries; i++) {
+      entry = ENTRY_AT (poller, i);
+      poller->poll_streams[i].stream = entry->stream;
+      poller->poll_streams[i].events = entry->events;
+      poller->poll_streams[i].revents = 0;
+   }
+
+   nactive = mongoc_stream_poll (poller->poll_streams, n_entries, timeout_msec);
+   if (nactive <= 0) {
+      return nactive;
+   }
+
+   n_events = 0;
+   for (i = 0; i < n_entries && n_events < nactive; i++) {
+      if (poller->poll_streams[i].revents) {
+         poller->events[n_events].data = ENTRY_AT (poller, i)->data;
+         poller->events[n_events].revents = poller->poll_streams[i].revents;
+         n_events++;
+      }
+   }
+
+   return n_events;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_poller_wait --
+ *
+ *       Wait up to @timeout_msec for events on the registered streams.
+ *
+ *       The returned events are valid until the next call. Streams may be
+ *       added or removed while the caller handles them, but the caller
+ *       must not use the data of a removed entry.
+ *
+ * Returns:
+ *       The number of events stored in @events, 0 on timeout, or -1 on
+ *       error with errno set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+ssize_t
+_mongoc_poller_wait (mongoc_poller_t *poller,
+                     int32_t timeout_msec,
+                     const mongoc_poller_event_t **events)
+{
+   size_t n_entries;
+   ssize_t n_events;
+#ifdef MONGOC_HAVE_EPOLL
+   struct epoll_event *epoll_events;
+   ssize_t i;
+#endif
+
+   BSON_ASSERT (poller);
+   BSON_ASSERT (events);
+
+   *events = NULL;
+   n_entries = poller->entries.len;
+
+   if (!n_entries) {
+      return 0;
+   }
+
+   /* grown only here, so the caller's events stay valid while it handles
+    * them, even if that adds streams */
+   if (poller->events_size < n_entries) {
+      poller->events = (mongoc_poller_event_t *) bson_realloc (
+         poller->events, n_entries * sizeof (mongoc_poller_event_t));
+#ifdef MONGOC_HAVE_EPOLL
+      poller->epoll_events = (struct epoll_event *) bson_realloc (
+         poller->epoll_events, n_entries * sizeof (struct epoll_event));
+#endif
+      poller->events_size = n_entries;
+   }
+
+   *events = poller->events;
+
+#ifdef MONGOC_HAVE_EPOLL
+   if (poller->epfd >= 0) {
+      epoll_events = poller->epoll_events;
+
+      do {
+         n_events = epoll_wait (
+            poller->epfd, epoll_events, (int) n_entries, timeout_msec);
+      } while (n_events < 0 && errno == EINTR);
+
+      for (i = 0; i < n_events; i++) {
+         mongoc_poller_entry_t *entry =
+            (mongoc_poller_entry_t *) epoll_events[i].data.ptr;
+
+         poller->events[i].data = entry->data;
+         poller->events[i].revents =
+            _mongoc_poller_from_epoll (epoll_events[i].events);
+      }
+
+      return n_events;
+   }
+#endif
+
+   n_events = _mongoc_poller_wait_poll (poller, timeout_msec);
+
+   return n_events;
+}
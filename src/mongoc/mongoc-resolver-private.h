@@ -0,0 +1,89 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_RESOLVER_PRIVATE_H
+#define MONGOC_RESOLVER_PRIVATE_H
+
+#if !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-host-list.h"
+#include "mongoc-socket.h"
+
+
+BSON_BEGIN_DECLS
+
+
+/* how long a host's addresses are used before they are resolved again.
+ * getaddrinfo does not report the records' TTLs. */
+#ifndef MONGOC_RESOLVER_TTL_MS
+#define MONGOC_RESOLVER_TTL_MS (60 * 1000)
+#endif
+
+/* how long a failure is remembered before the host is resolved again */
+#ifndef MONGOC_RESOLVER_NEGATIVE_TTL_MS
+#define MONGOC_RESOLVER_NEGATIVE_TTL_MS 1000
+#endif
+
+/* how often a loop waiting for sockets checks for finished lookups */
+#define MONGOC_RESOLVER_POLL_MS 10
+
+
+typedef enum {
+   MONGOC_RESOLVER_DONE,
+   MONGOC_RESOLVER_PENDING,
+   MONGOC_RESOLVER_FAILED,
+} mongoc_resolver_status_t;
+
+
+void
+_mongoc_resolver_init (void);
+
+void
+_mongoc_resolver_cleanup (void);
+
+mongoc_resolver_status_t
+_mongoc_resolver_start (const mongoc_host_list_t *host,
+                        bool waited,
+                        struct addrinfo **result,
+                        bson_error_t *error);
+
+bool
+_mongoc_resolver_resolve (const mongoc_host_list_t *host,
+                          int64_t expire_at,
+                          struct addrinfo **result,
+                          bson_error_t *error);
+
+uint32_t
+_mongoc_resolver_generation (void);
+
+void
+_mongoc_resolver_wait (uint32_t generation, int64_t timeout_msec);
+
+void
+_mongoc_resolver_free_results (struct addrinfo *result);
+
+void
+_mongoc_resolver_clear (void);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_RESOLVER_PRIVATE_H */
@@ -0,0 +1,439 @@
+/*
+ * Copyright 2017 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+
+#include "mongoc-counters-private.h"
+#include "mongoc-error.h"
+#include "mongoc-resolver-private.h"
+#include "mongoc-thread-private.h"
+#include "mongoc-trace-private.h"
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "resolver"
+
+
+/* one host's addresses, shared by every client in the process. while a
+ * lookup is in flight its thread owns "host", "port", and "family"; the
+ * other fields are protected by gResolverMutex. */
+typedef struct _mongoc_resolver_entry_t {
+   char host[BSON_HOST_NAME_MAX + 1];
+   char port[8];
+   int family;
+   struct addrinfo *results; /* our copy, or NULL */
+   bson_error_t error;       /* set if the last lookup failed */
+   int64_t expire_at;        /* when to look up the host again */
+   bool in_flight;
+   bool has_thread; /* must be joined */
+   mongoc_thread_t thread;
+   struct _mongoc_resolver_entry_t *next;
+} mongoc_resolver_entry_t;
+
+
+static mongoc_mutex_t gResolverMutex;
+static mongoc_cond_t gResolverCond;
+static mongoc_resolver_entry_t *gResolverEntries;
+static uint32_t gResolverGeneration; /* incremented as lookups finish */
+
+
+void
+_mongoc_resolver_init (void)
+{
+   mongoc_mutex_init (&gResolverMutex);
+   mongoc_cond_init (&gResolverCond);
+   gResolverEntries = NULL;
+}
+
+
+/* wait for an entry's lookup thread to finish and free the entry */
+static void
+_mongoc_resolver_entry_destroy (mongoc_resolver_entry_t *entry)
+{
+   if (entry->has_thread) {
+      mongoc_thread_join (entry->thread);
+   }
+
+   _mongoc_resolver_free_results (entry->results);
+   bson_free (entry);
+}
+
+
+void
+_mongoc_resolver_cleanup (void)
+{
+   _mongoc_resolver_clear ();
+   mongoc_cond_destroy (&gResolverCond);
+   mongoc_mutex_destroy (&gResolverMutex);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_resolver_clear --
+ *
+ *       Forget all cached addresses. Waits for lookups in flight.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_resolver_clear (void)
+{
+   mongoc_resolver_entry_t *entry;
+   mongoc_resolver_entry_t *next;
+
+   mongoc_mutex_lock (&gResolverMutex);
+   entry = gResolverEntries;
+   gResolverEntries = NULL;
+   mongoc_mutex_unlock (&gResolverMutex);
+
+   for (; entry; entry = next) {
+      next = entry->next;
+      _mongoc_resolver_entry_destroy (entry);
+   }
+}
+
+
+/* copy getaddrinfo's results so they outlive freeaddrinfo. the copies are
+ * freed with _mongoc_resolver_free_results. */
+static struct addrinfo *
+_mongoc_resolver_copy_results (const struct addrinfo *src)
+{
+   struct addrinfo *head = NULL;
+   struct addrinfo **tail = &head;
+   struct addrinfo *ai;
+
+   for (; src; src = src->ai_next) {
+      ai = (struct addrinfo *) bson_malloc0 (sizeof *ai + src->ai_addrlen);
+      ai->ai_flags = src->ai_flags;
+      ai->ai_family = src->ai_family;
+      ai->ai_socktype = src->ai_socktype;
+      ai->ai_protocol = src->ai_protocol;
+      ai->ai_addrlen = src->ai_addrlen;
+      ai->ai_addr = (struct sockaddr *) (ai + 1);
+      memcpy (ai->ai_addr, src->ai_addr, src->ai_addrlen);
+
+      *tail = ai;
+      tail = &ai->ai_next;
+   }
+
+   return head;
+}
+
+
+void
+_mongoc_resolver_free_results (struct addrinfo *result)
+{
+   struct addrinfo *next;
+
+   for (; result; result = next) {
+      next = result->ai_next;
+      bson_free (result);
+   }
+}
+
+
+static void *
+_mongoc_resolver_run (void *data)
+{
+   mongoc_resolver_entry_t *entry = (mongoc_resolver_entry_t *) data;
+   struct addrinfo hints;
+   struct addrinfo *result = NULL;
+   int64_t now;
+   int s;
+
+   memset (&hints, 0, sizeof hints);
+   hints.ai_family = entry->family;
+   hints.ai_socktype = SOCK_STREAM;
+   hints.ai_flags = 0;
+   hints.ai_protocol = 0;
+
+   s = getaddrinfo (entry->host, entry->port, &hints, &result);
+
+   mongoc_mutex_lock (&gResolverMutex);
+   now = bson_get_monotonic_time ();
+
+   if (s == 0) {
+      mongoc_counter_dns_success_inc ();
+      _mongoc_resolver_free_results (entry->results);
+      entry->results = _mongoc_resolver_copy_results (result);
+      memset (&entry->error, 0, sizeof entry->error);
+      entry->expire_at = now + MONGOC_RESOLVER_TTL_MS * 1000;
+      freeaddrinfo (result);
+   } else {
+      mongoc_counter_dns_failure_inc ();
+      bson_set_error (&entry->error,
+                      MONGOC_ERROR_STREAM,
+                      MONGOC_ERROR_STREAM_NAME_RESOLUTION,
+                      "Failed to resolve '%s'",
+                      entry->host);
+
+      /* if the host was resolved before, keep using its old addresses */
+      entry->expire_at = now + MONGOC_RESOLVER_NEGATIVE_TTL_MS * 1000;
+   }
+
+   entry->in_flight = false;
+   gResolverGeneration++;
+   mongoc_cond_broadcast (&gResolverCond);
+   mongoc_mutex_unlock (&gResolverMutex);
+
+   return NULL;
+}
+
+
+static mongoc_resolver_entry_t *
+_mongoc_resolver_find (const mongoc_host_list_t *host, const char *port)
+{
+   mongoc_resolver_entry_t *entry;
+
+   for (entry = gResolverEntries; entry; entry = entry->next) {
+      if (entry->family == host->family && !strcmp (entry->port, port) &&
+          !strcasecmp (entry->host, host->host)) {
+         return entry;
+      }
+   }
+
+   return NULL;
+}
+
+
+/* begin looking up @entry's host on a new thread, or on this one if a
+ * thread cannot be started. call with gResolverMutex held. */
+static void
+_mongoc_resolver_begin (mongoc_resolver_entry_t *entry)
+{
+   if (entry->has_thread) {
+      mongoc_thread_join (entry->thread);
+      entry->has_thread = false;
+   }
+
+   entry->in_flight = true;
+
+   if (mongoc_thread_create (
+          &entry->thread, _mongoc_resolver_run, (void *) entry) == 0) {
+      entry->has_thread = true;
+      return;
+   }
+
+   MONGOC_WARNING ("Could not start a thread to resolve '%s'", entry->host);
+
+   mongoc_mutex_unlock (&gResolverMutex);
+   _mongoc_resolver_run (entry);
+   mongoc_mutex_lock (&gResolverMutex);
+}
+
+
+/* like _mongoc_resolver_start, call with gResolverMutex held */
+static mongoc_resolver_status_t
+_mongoc_resolver_start_locked (const mongoc_host_list_t *host,
+                               bool waited,
+                               struct addrinfo **result,
+                               bson_error_t *error)
+{
+   mongoc_resolver_entry_t *entry;
+   char port[8];
+   int64_t now;
+
+   bson_snprintf (port, sizeof port, "%hu", host->port);
+   now = bson_get_monotonic_time ();
+
+   entry = _mongoc_resolver_find (host, port);
+
+   if (!entry) {
+      entry = (mongoc_resolver_entry_t *) bson_malloc0 (sizeof (*entry));
+      bson_strncpy (entry->host, host->host, sizeof entry->host);
+      bson_strncpy (entry->port, port, sizeof entry->port);
+      entry->family = host->family;
+      entry->next = gResolverEntries;
+      gResolverEntries = entry;
+
+      _mongoc_resolver_begin (entry);
+   } else if (!entry->in_flight && now >= entry->expire_at) {
+      _mongoc_resolver_begin (entry);
+   } else if (!entry->in_flight && !waited && entry->results) {
+      /* a remembered failure is neither a hit nor stale */
+      if (entry->error.code) {
+         /* the last refresh failed */
+         mongoc_counter_dns_cache_stale_inc ();
+      } else {
+         mongoc_counter_dns_cache_hit_inc ();
+      }
+   }
+
+   if (entry->in_flight) {
+      if (entry->results) {
+         /* don't wait for the refresh */
+         if (!waited) {
+            mongoc_counter_dns_cache_stale_inc ();
+         }
+         *result = _mongoc_resolver_copy_results (entry->results);
+         return MONGOC_RESOLVER_DONE;
+      }
+
+      return MONGOC_RESOLVER_PENDING;
+   }
+
+   if (entry->results) {
+      *result = _mongoc_resolver_copy_results (entry->results);
+      return MONGOC_RESOLVER_DONE;
+   }
+
+   if (error) {
+      memcpy (error, &entry->error, sizeof *error);
+   }
+
+   return MONGOC_RESOLVER_FAILED;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_resolver_start --
+ *
+ *       Get @host's addresses from the cache, or begin looking them up
+ *       without blocking. Concurrent lookups of the same host share one
+ *       getaddrinfo call. Expired addresses are used while they are
+ *       refreshed, and if the refresh fails.
+ *
+ *       Pass @waited true when calling again after MONGOC_RESOLVER_PENDING,
+ *       so the lookup's outcome isn't counted as a cache hit.
+ *
+ * Returns:
+ *       MONGOC_RESOLVER_DONE and sets @result, which must be freed with
+ *       _mongoc_resolver_free_results. MONGOC_RESOLVER_PENDING if the
+ *       caller must try again later, see _mongoc_resolver_wait. Or
+ *       MONGOC_RESOLVER_FAILED and sets @error.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_resolver_status_t
+_mongoc_resolver_start (const mongoc_host_list_t *host,
+                        bool waited,
+                        struct addrinfo **result,
+                        bson_error_t *error)
+{
+   mongoc_resolver_status_t status;
+
+   BSON_ASSERT (host);
+   BSON_ASSERT (result);
+
+   *result = NULL;
+
+   mongoc_mutex_lock (&gResolverMutex);
+   status = _mongoc_resolver_start_locked (host, waited, result, error);
+   mongoc_mutex_unlock (&gResolverMutex);
+
+   return status;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_resolver_resolve --
+ *
+ *       Like _mongoc_resolver_start, but block until the lookup is
+ *       complete or @expire_at passes.
+ *
+ * Returns:
+ *       true and sets @result, or false and sets @error.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_resolver_resolve (const mongoc_host_list_t *host,
+                          int64_t expire_at,
+                          struct addrinfo **result,
+                          bson_error_t *error)
+{
+   mongoc_resolver_status_t status;
+   int64_t timeout_msec;
+   bool waited = false;
+
+   BSON_ASSERT (host);
+   BSON_ASSERT (result);
+
+   *result = NULL;
+
+   mongoc_mutex_lock (&gResolverMutex);
+
+   for (;;) {
+      status = _mongoc_resolver_start_locked (host, waited, result, error);
+      if (status != MONGOC_RESOLVER_PENDING) {
+         break;
+      }
+
+      timeout_msec = (expire_at - bson_get_monotonic_time ()) / 1000;
+      if (timeout_msec <= 0) {
+         bson_set_error (error,
+                         MONGOC_ERROR_STREAM,
+                         MONGOC_ERROR_STREAM_NAME_RESOLUTION,
+                         "Timed out resolving '%s'",
+                         host->host);
+         break;
+      }
+
+      mongoc_cond_timedwait (&gResolverCond, &gResolverMutex, timeout_msec);
+      waited = true;
+   }
+
+   mongoc_mutex_unlock (&gResolverMutex);
+
+   return status == MONGOC_RESOLVER_DONE;
+}
+
+
+uint32_t
+_mongoc_resolver_generation (void)
+{
+   uint32_t generation;
+
+   mongoc_mutex_lock (&gResolverMutex);
+   generation = gResolverGeneration;
+   mongoc_mutex_unlock (&gResolverMutex);
+
+   return generation;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_resolver_wait --
+ *
+ *       Wait up to @timeout_msec for any lookup to finish after
+ *       @generation was read from _mongoc_resolver_generation. Returns at
+ *       once if one already has.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_resolver_wait (uint32_t generation, int64_t timeout_msec)
+{
+   mongoc_mutex_lock (&gResolverMutex);
+
+   if (generation == gResolverGeneration && timeout_msec > 0) {
+      mongoc_cond_timedwait (&gResolverCond, &gResolverMutex, timeout_msec);
+   }
+
+   mongoc_mutex_unlock (&gResolverMutex);
+}
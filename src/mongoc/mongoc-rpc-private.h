@@ -38,6 +38,7 @@ BSON_BEGIN_DECLS
       _code               \
    } mongoc_rpc_##_name##_t;
 #define ENUM_FIELD(_name) uint32_t _name;
+#define UINT8_FIELD(_name) uint8_t _name;
 #define INT32_FIELD(_name) int32_t _name;
 #define INT64_FIELD(_name) int64_t _name;
 #define INT64_ARRAY_FIELD(_len, _name) \
@@ -59,6 +60,7 @@ BSON_BEGIN_DECLS
 
 
 #pragma pack(1)
+#include "op-compressed.def"
 #include "op-delete.def"
 #include "op-get-more.def"
 #include "op-header.def"
@@ -74,6 +76,7 @@ BSON_BEGIN_DECLS
 
 
 typedef union {
+   mongoc_rpc_compressed_t compressed;
    mongoc_rpc_delete_t delete_;
    mongoc_rpc_get_more_t get_more;
    mongoc_rpc_header_t header;
@@ -95,6 +98,7 @@ BSON_STATIC_ASSERT (sizeof (mongoc_rpc_reply_header_t) == 36);
 
 #undef RPC
 #undef ENUM_FIELD
+#undef UINT8_FIELD
 #undef INT32_FIELD
 #undef INT64_FIELD
 #undef INT64_ARRAY_FIELD
@@ -138,6 +142,13 @@ bool
 _mongoc_rpc_parse_query_error (mongoc_rpc_t *rpc,
                                int32_t error_api_version,
                                bson_error_t *error);
+uint8_t *
+_mongoc_rpc_compress (mongoc_rpc_t *rpc,
+                      int32_t compressor_id,
+                      int32_t compression_level,
+                      size_t *len);
+bool
+_mongoc_rpc_decompress (mongoc_rpc_t *rpc_le, uint8_t *buf, size_t buflen);
 bool
 _mongoc_populate_cmd_error (const bson_t *doc,
                             int32_t error_api_version,
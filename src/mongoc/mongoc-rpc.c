@@ -20,6 +20,7 @@
 #include "mongoc.h"
 #include "mongoc-rpc-private.h"
 #include "mongoc-trace-private.h"
+#include "mongoc-compression-private.h"
 
 
 #define RPC(_name, _code)                                               \
@@ -39,6 +40,12 @@
    rpc->msg_len += (int32_t) iov.iov_len; \
    _mongoc_array_append_val (array, iov);
 #define ENUM_FIELD INT32_FIELD
+#define UINT8_FIELD(_name)                \
+   iov.iov_base = (void *) &rpc->_name;   \
+   iov.iov_len = 1;                       \
+   assert (iov.iov_len);                  \
+   rpc->msg_len += (int32_t) iov.iov_len; \
+   _mongoc_array_append_val (array, iov);
 #define INT64_FIELD(_name)                \
    iov.iov_base = (void *) &rpc->_name;   \
    iov.iov_len = 8;                       \
@@ -104,6 +111,7 @@
    _mongoc_array_append_val (array, iov);
 
 
+#include "op-compressed.def"
 #include "op-delete.def"
 #include "op-get-more.def"
 #include "op-insert.def"
@@ -116,6 +124,7 @@
 
 #undef RPC
 #undef ENUM_FIELD
+#undef UINT8_FIELD
 #undef INT32_FIELD
 #undef INT64_FIELD
 #undef INT64_ARRAY_FIELD
@@ -137,6 +146,7 @@
    }
 #define INT32_FIELD(_name) rpc->_name = BSON_UINT32_FROM_LE (rpc->_name);
 #define ENUM_FIELD INT32_FIELD
+#define UINT8_FIELD(_name)
 #define INT64_FIELD(_name) rpc->_name = BSON_UINT64_FROM_LE (rpc->_name);
 #define CSTRING_FIELD(_name)
 #define BSON_FIELD(_name)
@@ -157,6 +167,7 @@
    } while (0);
 
 
+#include "op-compressed.def"
 #include "op-delete.def"
 #include "op-get-more.def"
 #include "op-insert.def"
@@ -187,6 +198,7 @@
    } while (0);
 
 
+#include "op-compressed.def"
 #include "op-delete.def"
 #include "op-get-more.def"
 #include "op-insert.def"
@@ -200,6 +212,7 @@
 
 #undef RPC
 #undef ENUM_FIELD
+#undef UINT8_FIELD
 #undef INT32_FIELD
 #undef INT64_FIELD
 #undef INT64_ARRAY_FIELD
@@ -221,6 +234,7 @@
    }
 #define INT32_FIELD(_name) printf ("  " #_name " : %d\n", rpc->_name);
 #define ENUM_FIELD(_name) printf ("  " #_name " : %u\n", rpc->_name);
+#define UINT8_FIELD(_name) printf ("  " #_name " : %u\n", rpc->_name);
 #define INT64_FIELD(_name) \
    printf ("  " #_name " : %" PRIi64 "\n", (int64_t) rpc->_name);
 #define CSTRING_FIELD(_name) printf ("  " #_name " : %s\n", rpc->_name);
@@ -289,6 +303,7 @@
    } while (0);
 
 
+#include "op-compressed.def"
 #include "op-delete.def"
 #include "op-get-more.def"
 #include "op-insert.def"
@@ -301,6 +316,7 @@
 
 #undef RPC
 #undef ENUM_FIELD
+#undef UINT8_FIELD
 #undef INT32_FIELD
 #undef INT64_FIELD
 #undef INT64_ARRAY_FIELD
@@ -329,6 +345,13 @@
    buflen -= 4;                  \
    buf += 4;
 #define ENUM_FIELD INT32_FIELD
+#define UINT8_FIELD(_name)       \
+   if (buflen < 1) {             \
+      return false;              \
+   }                             \
+   memcpy (&rpc->_name, buf, 1); \
+   buflen -= 1;                  \
+   buf += 1;
 #define INT64_FIELD(_name)       \
    if (buflen < 8) {             \
       return false;              \
@@ -408,6 +431,7 @@
    buflen = 0;
 
 
+#include "op-compressed.def"
 #include "op-delete.def"
 #include "op-get-more.def"
 #include "op-header.def"
@@ -422,6 +446,7 @@
 
 #undef RPC
 #undef ENUM_FIELD
+#undef UINT8_FIELD
 #undef INT32_FIELD
 #undef INT64_FIELD
 #undef INT64_ARRAY_FIELD
@@ -461,6 +486,9 @@ _mongoc_rpc_gather (mongoc_rpc_t *rpc, mongoc_array_t *array)
    case MONGOC_OPCODE_KILL_CURSORS:
       _mongoc_rpc_gather_kill_cursors (&rpc->kill_cursors, array);
       return;
+   case MONGOC_OPCODE_COMPRESSED:
+      _mongoc_rpc_gather_compressed (&rpc->compressed, array);
+      return;
    default:
       MONGOC_WARNING ("Unknown rpc type: 0x%08x", rpc->header.opcode);
       break;
@@ -501,6 +529,9 @@ _mongoc_rpc_swab_to_le (mongoc_rpc_t *rpc)
    case MONGOC_OPCODE_KILL_CURSORS:
       _mongoc_rpc_swab_to_le_kill_cursors (&rpc->kill_cursors);
       break;
+   case MONGOC_OPCODE_COMPRESSED:
+      _mongoc_rpc_swab_to_le_compressed (&rpc->compressed);
+      break;
    default:
       MONGOC_WARNING ("Unknown rpc type: 0x%08x", opcode);
       break;
@@ -542,6 +573,9 @@ _mongoc_rpc_swab_from_le (mongoc_rpc_t *rpc)
    case MONGOC_OPCODE_KILL_CURSORS:
       _mongoc_rpc_swab_from_le_kill_cursors (&rpc->kill_cursors);
       break;
+   case MONGOC_OPCODE_COMPRESSED:
+      _mongoc_rpc_swab_from_le_compressed (&rpc->compressed);
+      break;
    default:
       MONGOC_WARNING ("Unknown rpc type: 0x%08x", rpc->header.opcode);
       break;
@@ -578,6 +612,9 @@ _mongoc_rpc_printf (mongoc_rpc_t *rpc)
    case MONGOC_OPCODE_KILL_CURSORS:
       _mongoc_rpc_printf_kill_cursors (&rpc->kill_cursors);
       break;
+   case MONGOC_OPCODE_COMPRESSED:
+      _mongoc_rpc_printf_compressed (&rpc->compressed);
+      break;
    default:
       MONGOC_WARNING ("Unknown rpc type: 0x%08x", rpc->header.opcode);
       break;
@@ -619,6 +656,8 @@ _mongoc_rpc_scatter (mongoc_rpc_t *rpc, const uint8_t *buf, size_t buflen)
       return _mongoc_rpc_scatter_delete (&rpc->delete_, buf, buflen);
    case MONGOC_OPCODE_KILL_CURSORS:
       return _mongoc_rpc_scatter_kill_cursors (&rpc->kill_cursors, buf, buflen);
+   case MONGOC_OPCODE_COMPRESSED:
+      return _mongoc_rpc_scatter_compressed (&rpc->compressed, buf, buflen);
    default:
       MONGOC_WARNING ("Unknown rpc type: 0x%08x", opcode);
       return false;
@@ -688,6 +727,7 @@ _mongoc_rpc_needs_gle (mongoc_rpc_t *rpc,
    case MONGOC_OPCODE_MSG:
    case MONGOC_OPCODE_GET_MORE:
    case MONGOC_OPCODE_KILL_CURSORS:
+   case MONGOC_OPCODE_COMPRESSED:
       return false;
    case MONGOC_OPCODE_INSERT:
    case MONGOC_OPCODE_UPDATE:
@@ -933,3 +973,163 @@ _mongoc_rpc_parse_query_error (mongoc_rpc_t *rpc,
 {
    return _mongoc_rpc_parse_error (rpc, false, error_api_version, error);
 }
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_rpc_compress --
+ *
+ *       Serialize @rpc and wrap it in an OP_COMPRESSED message using
+ *       @compressor_id. @rpc must be in host byte order; its msg_len is
+ *       updated as by _mongoc_rpc_gather.
+ *
+ * Returns:
+ *       A newly allocated buffer holding the complete little-endian
+ *       OP_COMPRESSED message, to be freed with bson_free (). @len is set
+ *       to its length. NULL if compression failed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+uint8_t *
+_mongoc_rpc_compress (mongoc_rpc_t *rpc,
+                      int32_t compressor_id,
+                      int32_t compression_level,
+                      size_t *len)
+{
+   mongoc_array_t ar;
+   mongoc_iovec_t *iov;
+   uint8_t *uncompressed;
+   uint8_t *out = NULL;
+   size_t uncompressed_len;
+   size_t compressed_len;
+   size_t skip;
+   size_t off;
+   size_t i;
+   int32_t i32;
+
+   ENTRY;
+
+   BSON_ASSERT (rpc);
+   BSON_ASSERT (len);
+
+   _mongoc_array_init (&ar, sizeof (mongoc_iovec_t));
+   _mongoc_rpc_gather (rpc, &ar);
+
+   BSON_ASSERT (rpc->header.msg_len >= 16);
+   uncompressed_len = (size_t) rpc->header.msg_len - 16;
+   uncompressed = bson_malloc (uncompressed_len);
+
+   /* flatten everything after the standard header */
+   _mongoc_rpc_swab_to_le (rpc);
+   for (i = 0, skip = 16, off = 0; i < ar.len; i++) {
+      iov = &_mongoc_array_index (&ar, mongoc_iovec_t, i);
+
+      if (iov->iov_len <= skip) {
+         skip -= iov->iov_len;
+         continue;
+      }
+
+      memcpy (uncompressed + off,
+              (uint8_t *) iov->iov_base + skip,
+              iov->iov_len - skip);
+      off += iov->iov_len - skip;
+      skip = 0;
+   }
+   _mongoc_rpc_swab_from_le (rpc);
+
+   BSON_ASSERT (off == uncompressed_len);
+
+   compressed_len =
+      _mongoc_compressor_max_compressed_length (compressor_id, off);
+   if (!compressed_len) {
+      GOTO (done);
+   }
+
+   out = bson_malloc (MONGOC_COMPRESSED_HEADER_LEN + compressed_len);
+
+   if (!_mongoc_compress (compressor_id,
+                          compression_level,
+                          uncompressed,
+                          uncompressed_len,
+                          out + MONGOC_COMPRESSED_HEADER_LEN,
+                          &compressed_len)) {
+      bson_free (out);
+      out = NULL;
+      GOTO (done);
+   }
+
+   *len = MONGOC_COMPRESSED_HEADER_LEN + compressed_len;
+
+   i32 = BSON_UINT32_TO_LE ((int32_t) *len);
+   memcpy (out, &i32, 4);
+   i32 = BSON_UINT32_TO_LE (rpc->header.request_id);
+   memcpy (out + 4, &i32, 4);
+   i32 = BSON_UINT32_TO_LE (rpc->header.response_to);
+   memcpy (out + 8, &i32, 4);
+   i32 = BSON_UINT32_TO_LE (MONGOC_OPCODE_COMPRESSED);
+   memcpy (out + 12, &i32, 4);
+   i32 = BSON_UINT32_TO_LE (rpc->header.opcode);
+   memcpy (out + 16, &i32, 4);
+   i32 = BSON_UINT32_TO_LE ((int32_t) uncompressed_len);
+   memcpy (out + 20, &i32, 4);
+   out[24] = (uint8_t) compressor_id;
+
+done:
+   bson_free (uncompressed);
+   _mongoc_array_destroy (&ar);
+
+   RETURN (out);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_rpc_decompress --
+ *
+ *       Rebuild the original message carried by a scattered, still
+ *       little-endian OP_COMPRESSED @rpc_le into @buf. @buflen must be
+ *       16 plus the message's uncompressed_size.
+ *
+ * Returns:
+ *       true if @buf now holds a complete little-endian message that can
+ *       be passed to _mongoc_rpc_scatter.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_rpc_decompress (mongoc_rpc_t *rpc_le, uint8_t *buf, size_t buflen)
+{
+   size_t uncompressed_len;
+   int32_t i32;
+
+   BSON_ASSERT (rpc_le);
+   BSON_ASSERT (buf);
+
+   uncompressed_len = (size_t) BSON_UINT32_FROM_LE (
+      rpc_le->compressed.uncompressed_size);
+
+   if (buflen != uncompressed_len + 16) {
+      return false;
+   }
+
+   if (!_mongoc_uncompress (rpc_le->compressed.compressor_id,
+                            rpc_le->compressed.compressed_message,
+                            (size_t) rpc_le->compressed.compressed_message_len,
+                            buf + 16,
+                            &uncompressed_len) ||
+       uncompressed_len != buflen - 16) {
+      return false;
+   }
+
+   i32 = BSON_UINT32_TO_LE ((int32_t) buflen);
+   memcpy (buf, &i32, 4);
+   memcpy (buf + 4, &rpc_le->header.request_id, 4);
+   memcpy (buf + 8, &rpc_le->header.response_to, 4);
+   memcpy (buf + 12, &rpc_le->compressed.original_opcode, 4);
+
+   return true;
+}
@@ -26,18 +26,40 @@
 
 #include <bson.h>
 #include "mongoc-crypto-private.h"
+#include "mongoc-thread-private.h"
 
 
 BSON_BEGIN_DECLS
 
 #define MONGOC_SCRAM_HASH_SIZE 20
 
+/* the hex MD5 of "user:mongo:password", and its terminator */
+#define MONGOC_SCRAM_HASHED_PASSWORD_SIZE 33
+
+/* the keys derived from one user's password by the slow Hi() function. a
+ * topology's connections share them, so that only the first to
+ * authenticate pays for the iterations */
+typedef struct _mongoc_scram_cache_t {
+   mongoc_mutex_t mutex;
+   bool set;
+   char hashed_password[MONGOC_SCRAM_HASHED_PASSWORD_SIZE];
+   uint8_t salt[MONGOC_SCRAM_HASH_SIZE];
+   uint32_t salt_len;
+   uint32_t iterations;
+   uint8_t salted_password[MONGOC_SCRAM_HASH_SIZE];
+   uint8_t client_key[MONGOC_SCRAM_HASH_SIZE];
+   uint8_t server_key[MONGOC_SCRAM_HASH_SIZE];
+} mongoc_scram_cache_t;
+
 typedef struct _mongoc_scram_t {
    bool done;
    int step;
    char *user;
    char *pass;
    uint8_t salted_password[MONGOC_SCRAM_HASH_SIZE];
+   uint8_t client_key[MONGOC_SCRAM_HASH_SIZE];
+   uint8_t server_key[MONGOC_SCRAM_HASH_SIZE];
+   mongoc_scram_cache_t *cache;
    char encoded_nonce[48];
    int32_t encoded_nonce_len;
    uint8_t *auth_message;
@@ -59,9 +81,19 @@ _mongoc_scram_set_pass (mongoc_scram_t *scram, const char *pass);
 
 void
 _mongoc_scram_set_user (mongoc_scram_t *scram, const char *user);
+
+void
+_mongoc_scram_set_cache (mongoc_scram_t *scram, mongoc_scram_cache_t *cache);
+
 void
 _mongoc_scram_destroy (mongoc_scram_t *scram);
 
+void
+_mongoc_scram_cache_init (mongoc_scram_cache_t *cache);
+
+void
+_mongoc_scram_cache_destroy (mongoc_scram_cache_t *cache);
+
 bool
 _mongoc_scram_step (mongoc_scram_t *scram,
                     const uint8_t *inbuf,
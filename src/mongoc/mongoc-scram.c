@@ -19,6 +19,7 @@
 
 #include <string.h>
 
+#include "mongoc-counters-private.h"
 #include "mongoc-error.h"
 #include "mongoc-scram-private.h"
 #include "mongoc-rand-private.h"
@@ -68,6 +69,47 @@ _mongoc_scram_set_user (mongoc_scram_t *scram, const char *user)
 }
 
 
+/* a memset the compiler can't drop because the memory is freed next */
+static void
+_mongoc_scram_zero (void *mem, size_t len)
+{
+   volatile uint8_t *p = (volatile uint8_t *) mem;
+
+   while (len--) {
+      *p++ = 0;
+   }
+}
+
+
+void
+_mongoc_scram_set_cache (mongoc_scram_t *scram, mongoc_scram_cache_t *cache)
+{
+   BSON_ASSERT (scram);
+
+   scram->cache = cache;
+}
+
+
+void
+_mongoc_scram_cache_init (mongoc_scram_cache_t *cache)
+{
+   BSON_ASSERT (cache);
+
+   memset (cache, 0, sizeof *cache);
+   mongoc_mutex_init (&cache->mutex);
+}
+
+
+void
+_mongoc_scram_cache_destroy (mongoc_scram_cache_t *cache)
+{
+   BSON_ASSERT (cache);
+
+   mongoc_mutex_destroy (&cache->mutex);
+   _mongoc_scram_zero (cache, sizeof *cache);
+}
+
+
 void
 _mongoc_scram_init (mongoc_scram_t *scram)
 {
@@ -91,6 +133,10 @@ _mongoc_scram_destroy (mongoc_scram_t *scram)
    }
 
    bson_free (scram->auth_message);
+
+   _mongoc_scram_zero (scram->salted_password, MONGOC_SCRAM_HASH_SIZE);
+   _mongoc_scram_zero (scram->client_key, MONGOC_SCRAM_HASH_SIZE);
+   _mongoc_scram_zero (scram->server_key, MONGOC_SCRAM_HASH_SIZE);
 }
 
 
@@ -307,30 +353,102 @@ _mongoc_scram_salt_password (mongoc_scram_t *scram,
 }
 
 
+/* compute SaltedPassword, ClientKey, and ServerKey, or copy them from the
+ * cache if they were computed for the same password, salt, and iterations */
+static void
+_mongoc_scram_derive_keys (mongoc_scram_t *scram,
+                           const char *hashed_password,
+                           const uint8_t *salt,
+                           uint32_t salt_len,
+                           uint32_t iterations)
+{
+   mongoc_scram_cache_t *cache = scram->cache;
+   size_t hashed_password_len = strlen (hashed_password);
+
+   BSON_ASSERT (hashed_password_len < MONGOC_SCRAM_HASHED_PASSWORD_SIZE);
+
+   if (cache) {
+      /* hold the lock while salting, so connections that authenticate at
+       * once, e.g. after a failover, wait for the first one's result */
+      mongoc_mutex_lock (&cache->mutex);
+
+      if (cache->set && cache->iterations == iterations &&
+          cache->salt_len == salt_len &&
+          mongoc_memcmp (cache->salt, salt, salt_len) == 0 &&
+          mongoc_memcmp (cache->hashed_password,
+                         hashed_password,
+                         hashed_password_len + 1) == 0) {
+         memcpy (scram->salted_password,
+                 cache->salted_password,
+                 MONGOC_SCRAM_HASH_SIZE);
+         memcpy (scram->client_key, cache->client_key, MONGOC_SCRAM_HASH_SIZE);
+         memcpy (scram->server_key, cache->server_key, MONGOC_SCRAM_HASH_SIZE);
+         mongoc_mutex_unlock (&cache->mutex);
+
+         mongoc_counter_auth_scram_cache_hit_inc ();
+         return;
+      }
+   }
+
+   _mongoc_scram_salt_password (scram,
+                                hashed_password,
+                                (uint32_t) hashed_password_len,
+                                salt,
+                                salt_len,
+                                iterations);
+
+   /* ClientKey := HMAC(saltedPassword, "Client Key") */
+   mongoc_crypto_hmac_sha1 (&scram->crypto,
+                            scram->salted_password,
+                            MONGOC_SCRAM_HASH_SIZE,
+                            (uint8_t *) MONGOC_SCRAM_CLIENT_KEY,
+                            strlen (MONGOC_SCRAM_CLIENT_KEY),
+                            scram->client_key);
+
+   /* ServerKey := HMAC(SaltedPassword, "Server Key") */
+   mongoc_crypto_hmac_sha1 (&scram->crypto,
+                            scram->salted_password,
+                            MONGOC_SCRAM_HASH_SIZE,
+                            (uint8_t *) MONGOC_SCRAM_SERVER_KEY,
+                            strlen (MONGOC_SCRAM_SERVER_KEY),
+                            scram->server_key);
+
+   if (cache) {
+      if (salt_len <= sizeof cache->salt) {
+         memcpy (cache->hashed_password,
+                 hashed_password,
+                 hashed_password_len + 1);
+         memcpy (cache->salt, salt, salt_len);
+         cache->salt_len = salt_len;
+         cache->iterations = iterations;
+         memcpy (cache->salted_password,
+                 scram->salted_password,
+                 MONGOC_SCRAM_HASH_SIZE);
+         memcpy (cache->client_key, scram->client_key, MONGOC_SCRAM_HASH_SIZE);
+         memcpy (cache->server_key, scram->server_key, MONGOC_SCRAM_HASH_SIZE);
+         cache->set = true;
+      }
+
+      mongoc_mutex_unlock (&cache->mutex);
+   }
+}
+
+
 static bool
 _mongoc_scram_generate_client_proof (mongoc_scram_t *scram,
                                      uint8_t *outbuf,
                                      uint32_t outbufmax,
                                      uint32_t *outbuflen)
 {
-   uint8_t client_key[MONGOC_SCRAM_HASH_SIZE];
    uint8_t stored_key[MONGOC_SCRAM_HASH_SIZE];
    uint8_t client_signature[MONGOC_SCRAM_HASH_SIZE];
    unsigned char client_proof[MONGOC_SCRAM_HASH_SIZE];
    int i;
    int r = 0;
 
-   /* ClientKey := HMAC(saltedPassword, "Client Key") */
-   mongoc_crypto_hmac_sha1 (&scram->crypto,
-                            scram->salted_password,
-                            MONGOC_SCRAM_HASH_SIZE,
-                            (uint8_t *) MONGOC_SCRAM_CLIENT_KEY,
-                            strlen (MONGOC_SCRAM_CLIENT_KEY),
-                            client_key);
-
    /* StoredKey := H(client_key) */
    mongoc_crypto_sha1 (
-      &scram->crypto, client_key, MONGOC_SCRAM_HASH_SIZE, stored_key);
+      &scram->crypto, scram->client_key, MONGOC_SCRAM_HASH_SIZE, stored_key);
 
    /* ClientSignature := HMAC(StoredKey, AuthMessage) */
    mongoc_crypto_hmac_sha1 (&scram->crypto,
@@ -343,7 +461,7 @@ _mongoc_scram_generate_client_proof (mongoc_scram_t *scram,
    /* ClientProof := ClientKey XOR ClientSignature */
 
    for (i = 0; i < MONGOC_SCRAM_HASH_SIZE; i++) {
-      client_proof[i] = client_key[i] ^ client_signature[i];
+      client_proof[i] = scram->client_key[i] ^ client_signature[i];
    }
 
    r = mongoc_b64_ntop (client_proof,
@@ -576,12 +694,11 @@ _mongoc_scram_step2 (mongoc_scram_t *scram,
       goto FAIL;
    }
 
-   _mongoc_scram_salt_password (scram,
-                                hashed_password,
-                                (uint32_t) strlen (hashed_password),
-                                decoded_salt,
-                                decoded_salt_len,
-                                iterations);
+   _mongoc_scram_derive_keys (scram,
+                              hashed_password,
+                              decoded_salt,
+                              (uint32_t) decoded_salt_len,
+                              (uint32_t) iterations);
 
    _mongoc_scram_generate_client_proof (scram, outbuf, outbufmax, outbuflen);
 
@@ -625,22 +742,13 @@ _mongoc_scram_verify_server_signature (mongoc_scram_t *scram,
                                        uint8_t *verification,
                                        uint32_t len)
 {
-   uint8_t server_key[MONGOC_SCRAM_HASH_SIZE];
    char encoded_server_signature[MONGOC_SCRAM_B64_HASH_SIZE];
    int32_t encoded_server_signature_len;
    uint8_t server_signature[MONGOC_SCRAM_HASH_SIZE];
 
-   /* ServerKey := HMAC(SaltedPassword, "Server Key") */
-   mongoc_crypto_hmac_sha1 (&scram->crypto,
-                            scram->salted_password,
-                            MONGOC_SCRAM_HASH_SIZE,
-                            (uint8_t *) MONGOC_SCRAM_SERVER_KEY,
-                            strlen (MONGOC_SCRAM_SERVER_KEY),
-                            server_key);
-
    /* ServerSignature := HMAC(ServerKey, AuthMessage) */
    mongoc_crypto_hmac_sha1 (&scram->crypto,
-                            server_key,
+                            scram->server_key,
                             MONGOC_SCRAM_HASH_SIZE,
                             scram->auth_message,
                             scram->auth_messagelen,
@@ -17,6 +17,7 @@
 #ifndef MONGOC_SERVER_DESCRIPTION_PRIVATE_H
 #define MONGOC_SERVER_DESCRIPTION_PRIVATE_H
 
+#include "mongoc-counters-private.h"
 #include "mongoc-server-description.h"
 
 
@@ -51,6 +52,9 @@ struct _mongoc_server_description_t {
    bool has_is_master;
    const char *connection_address;
    const char *me;
+   /* this server's, in the shm segment. NULL in copies, which would only
+    * publish the original's round trip time again */
+   mongoc_counter_slots_t *counters;
 
    /* The following fields are filled from the last_is_master and are zeroed on
     * parse.  So order matters here.  DON'T move set_name */
@@ -69,6 +73,7 @@ struct _mongoc_server_description_t {
    bson_t arbiters;
 
    bson_t tags;
+   bson_t compressors;
    const char *current_primary;
    int64_t set_version;
    bson_oid_t election_id;
@@ -95,6 +100,10 @@ mongoc_server_description_has_election_id (
 void
 mongoc_server_description_cleanup (mongoc_server_description_t *sd);
 
+int32_t
+mongoc_server_description_compressor_id (
+   const mongoc_server_description_t *description);
+
 void
 mongoc_server_description_reset (mongoc_server_description_t *sd);
 
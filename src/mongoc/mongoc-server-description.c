@@ -23,6 +23,8 @@
 #include "mongoc-trace-private.h"
 #include "mongoc-uri.h"
 #include "mongoc-util-private.h"
+#include "mongoc-compression-private.h"
+#include "mongoc-counters-private.h"
 
 #include <stdio.h>
 
@@ -65,6 +67,8 @@ mongoc_server_description_reset (mongoc_server_description_t *sd)
    sd->max_bson_obj_size = MONGOC_DEFAULT_BSON_OBJ_SIZE;
    sd->max_write_batch_size = MONGOC_DEFAULT_WRITE_BATCH_SIZE;
    sd->last_write_date_ms = -1;
+   bson_init_static (
+      &sd->compressors, kMongocEmptyBson, sizeof (kMongocEmptyBson));
 
    /* always leave last ismaster in an init-ed state until we destroy sd */
    bson_destroy (&sd->last_is_master);
@@ -114,6 +118,7 @@ mongoc_server_description_init (mongoc_server_description_t *sd,
    }
 
    sd->connection_address = sd->host.host_and_port;
+   sd->counters = _mongoc_node_counters_get (sd->host.host_and_port);
 
    sd->me = NULL;
    sd->min_wire_version = MONGOC_DEFAULT_WIRE_VERSION;
@@ -129,6 +134,8 @@ mongoc_server_description_init (mongoc_server_description_t *sd,
    bson_init_static (
       &sd->arbiters, kMongocEmptyBson, sizeof (kMongocEmptyBson));
    bson_init_static (&sd->tags, kMongocEmptyBson, sizeof (kMongocEmptyBson));
+   bson_init_static (
+      &sd->compressors, kMongocEmptyBson, sizeof (kMongocEmptyBson));
 
    bson_init (&sd->last_is_master);
 
@@ -438,7 +445,7 @@ mongoc_server_description_set_election_id (
  *       weighted moving average formula.
  *
  * Side effects:
- *       None.
+ *       Updates the server's round trip time in the shm counters.
  *
  *-------------------------------------------------------------------------
  */
@@ -452,6 +459,9 @@ mongoc_server_description_update_rtt (mongoc_server_description_t *server,
       server->round_trip_time_msec = (int64_t) (
          ALPHA * rtt_msec + (1 - ALPHA) * server->round_trip_time_msec);
    }
+
+   _mongoc_node_counters_set_rtt (server->counters,
+                                  server->round_trip_time_msec);
 }
 
 
@@ -603,6 +613,11 @@ mongoc_server_description_handle_ismaster (mongoc_server_description_t *sd,
             goto failure;
          bson_iter_document (&iter, &len, &bytes);
          bson_init_static (&sd->tags, bytes, len);
+      } else if (strcmp ("compression", bson_iter_key (&iter)) == 0) {
+         if (!BSON_ITER_HOLDS_ARRAY (&iter))
+            goto failure;
+         bson_iter_array (&iter, &len, &bytes);
+         bson_init_static (&sd->compressors, bytes, len);
       } else if (strcmp ("hidden", bson_iter_key (&iter)) == 0) {
          is_hidden = bson_iter_bool (&iter);
       } else if (strcmp ("lastWrite", bson_iter_key (&iter)) == 0) {
@@ -693,6 +708,8 @@ mongoc_server_description_new_copy (
    bson_init_static (
       &copy->arbiters, kMongocEmptyBson, sizeof (kMongocEmptyBson));
    bson_init_static (&copy->tags, kMongocEmptyBson, sizeof (kMongocEmptyBson));
+   bson_init_static (
+      &copy->compressors, kMongocEmptyBson, sizeof (kMongocEmptyBson));
 
    bson_init (&copy->last_is_master);
 
@@ -933,3 +950,41 @@ _match_tag_set (const mongoc_server_description_t *sd,
 
    return true;
 }
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_server_description_compressor_id --
+ *
+ *       Choose the compressor for messages to this server: the first
+ *       entry of the "compression" list from its ismaster response that
+ *       this build supports. The server only echoes compressors the
+ *       driver offered, in the driver's order of preference.
+ *
+ * Returns:
+ *       A compressor id, or -1 to send messages uncompressed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+int32_t
+mongoc_server_description_compressor_id (
+   const mongoc_server_description_t *description)
+{
+   bson_iter_t iter;
+
+   BSON_ASSERT (description);
+
+   if (bson_iter_init (&iter, &description->compressors)) {
+      while (bson_iter_next (&iter)) {
+         if (BSON_ITER_HOLDS_UTF8 (&iter) &&
+             _mongoc_compressor_supported (bson_iter_utf8 (&iter, NULL))) {
+            return _mongoc_compressor_name_to_id (
+               bson_iter_utf8 (&iter, NULL));
+         }
+      }
+   }
+
+   return -1;
+}
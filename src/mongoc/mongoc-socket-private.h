@@ -25,6 +25,12 @@
 
 BSON_BEGIN_DECLS
 
+/* how long to wait for a connection before trying the next address, as
+ * RFC 8305 "Happy Eyeballs" recommends */
+#ifndef MONGOC_HAPPY_EYEBALLS_DELAY_MS
+#define MONGOC_HAPPY_EYEBALLS_DELAY_MS 250
+#endif
+
 struct _mongoc_socket_t {
 #ifdef _WIN32
    SOCKET sd;
@@ -40,6 +46,13 @@ mongoc_socket_accept_ex (mongoc_socket_t *sock,
                          int64_t expire_at,
                          uint16_t *port);
 
+size_t
+_mongoc_socket_sort_addrinfo (struct addrinfo *addrs,
+                              struct addrinfo ***sorted);
+
+mongoc_socket_t *
+_mongoc_socket_connect_race (struct addrinfo *addrs, int64_t expire_at);
+
 BSON_END_DECLS
 
 #endif /* MONGOC_SOCKET_PRIVATE_H */
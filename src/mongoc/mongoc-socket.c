@@ -337,6 +337,19 @@ _mongoc_socket_capture_errno (mongoc_socket_t *sock) /* IN */
 }
 
 
+/* the last socket error in this thread, for when there's no socket to
+ * capture it in */
+static int
+_mongoc_socket_last_errno (void)
+{
+#ifdef _WIN32
+   return WSAGetLastError ();
+#else
+   return errno;
+#endif
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -1281,3 +1294,245 @@ mongoc_socket_inet_ntop (struct addrinfo *rp, /* IN */
       break;
    }
 }
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_socket_sort_addrinfo --
+ *
+ *       List @addrs in the order to try them: alternating between address
+ *       families, beginning with the resolver's first choice (RFC 8305
+ *       section 4).
+ *
+ * Returns:
+ *       The number of addresses. @sorted is set to an array of pointers
+ *       into @addrs, which the caller must free with bson_free().
+ *
+ *--------------------------------------------------------------------------
+ */
+
+size_t
+_mongoc_socket_sort_addrinfo (struct addrinfo *addrs,     /* IN */
+                              struct addrinfo ***sorted) /* OUT */
+{
+   struct addrinfo *first_family;
+   struct addrinfo *other_family;
+   struct addrinfo *rp;
+   size_t n_addrs = 0;
+   size_t i = 0;
+
+   for (rp = addrs; rp; rp = rp->ai_next) {
+      n_addrs++;
+   }
+
+   *sorted = (struct addrinfo **) bson_malloc0 (
+      BSON_MAX (n_addrs, 1) * sizeof (struct addrinfo *));
+
+   first_family = addrs;
+   other_family = addrs;
+
+   while (i < n_addrs) {
+      /* the next address of the first address's family, then the next of
+       * any other family */
+      while (first_family && first_family->ai_family != addrs->ai_family) {
+         first_family = first_family->ai_next;
+      }
+
+      if (first_family) {
+         (*sorted)[i++] = first_family;
+         first_family = first_family->ai_next;
+      }
+
+      while (other_family && other_family->ai_family == addrs->ai_family) {
+         other_family = other_family->ai_next;
+      }
+
+      if (other_family) {
+         (*sorted)[i++] = other_family;
+         other_family = other_family->ai_next;
+      }
+   }
+
+   return n_addrs;
+}
+
+
+/* the result of a non-blocking connect on @sock, once it's writable */
+static int
+_mongoc_socket_connect_error (mongoc_socket_t *sock)
+{
+   int optval = -1;
+   socklen_t optlen = sizeof optval;
+
+   if (getsockopt (
+          sock->sd, SOL_SOCKET, SO_ERROR, (char *) &optval, &optlen) != 0) {
+      _mongoc_socket_capture_errno (sock);
+      return sock->errno_;
+   }
+
+   return optval;
+}
+
+
+static void
+_mongoc_socket_connect_failed (mongoc_socket_t *sock,
+                               struct addrinfo *rp,
+                               int err)
+{
+   char errmsg_buf[BSON_ERROR_BUFFER_SIZE];
+   char ip[255];
+   uint16_t port;
+
+   if (rp->ai_family == AF_INET6) {
+      port = ntohs (((struct sockaddr_in6 *) rp->ai_addr)->sin6_port);
+   } else {
+      port = ntohs (((struct sockaddr_in *) rp->ai_addr)->sin_port);
+   }
+
+   mongoc_socket_inet_ntop (rp, ip, sizeof ip);
+   MONGOC_WARNING ("Failed to connect to: %s:%d, error: %d, %s\n",
+                   ip,
+                   (int) port,
+                   err,
+                   bson_strerror_r (err, errmsg_buf, sizeof errmsg_buf));
+
+   mongoc_socket_destroy (sock);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_socket_connect_race --
+ *
+ *       Connect to whichever of @addrs accepts first, "Happy Eyeballs"
+ *       style: begin connecting to each address in the order of
+ *       _mongoc_socket_sort_addrinfo, MONGOC_HAPPY_EYEBALLS_DELAY_MS
+ *       after the previous one or as soon as it fails, without waiting
+ *       for the previous ones to finish.
+ *
+ *       An unreachable address only delays the next one by the stagger
+ *       delay, rather than by the whole connect timeout.
+ *
+ * Returns:
+ *       A connected socket, or NULL if none connected before @expire_at.
+ *       The other attempts are closed.
+ *
+ * Side effects:
+ *       errno is set on failure.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_socket_t *
+_mongoc_socket_connect_race (struct addrinfo *addrs, /* IN */
+                             int64_t expire_at)      /* IN */
+{
+   struct addrinfo **sorted;
+   struct addrinfo **pending_addrs;
+   mongoc_socket_poll_t *pending;
+   mongoc_socket_t *winner = NULL;
+   mongoc_socket_t *sock;
+   struct addrinfo *rp;
+   size_t n_addrs;
+   size_t n_pending = 0;
+   size_t next = 0;
+   size_t i;
+   int64_t now;
+   int64_t next_at;
+   int64_t wait_until;
+   int err = MONGOC_ERRNO_TIMEDOUT;
+
+   ENTRY;
+
+   n_addrs = _mongoc_socket_sort_addrinfo (addrs, &sorted);
+   pending = (mongoc_socket_poll_t *) bson_malloc0 (
+      BSON_MAX (n_addrs, 1) * sizeof (mongoc_socket_poll_t));
+   pending_addrs = (struct addrinfo **) bson_malloc0 (
+      BSON_MAX (n_addrs, 1) * sizeof (struct addrinfo *));
+
+   now = bson_get_monotonic_time ();
+   next_at = now;
+
+   while (!winner && (next < n_addrs || n_pending)) {
+      if (next < n_addrs && (now >= next_at || !n_pending)) {
+         rp = sorted[next++];
+         next_at = now + MONGOC_HAPPY_EYEBALLS_DELAY_MS * 1000;
+
+         sock = mongoc_socket_new (
+            rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+         if (!sock) {
+            err = _mongoc_socket_last_errno ();
+            next_at = now;
+            continue;
+         }
+
+         if (0 == mongoc_socket_connect (
+                     sock, rp->ai_addr, (socklen_t) rp->ai_addrlen, 0)) {
+            winner = sock;
+         } else if (_mongoc_socket_errno_is_again (sock)) {
+            pending[n_pending].socket = sock;
+            pending[n_pending].events = POLLOUT;
+            pending_addrs[n_pending] = rp;
+            n_pending++;
+         } else {
+            err = mongoc_socket_errno (sock);
+            _mongoc_socket_connect_failed (sock, rp, err);
+            next_at = now;
+         }
+
+         continue;
+      }
+
+      if (now >= expire_at) {
+         break;
+      }
+
+      wait_until = next < n_addrs ? BSON_MIN (next_at, expire_at) : expire_at;
+      mongoc_socket_poll (
+         pending, n_pending, (int32_t) ((wait_until - now + 999) / 1000));
+      now = bson_get_monotonic_time ();
+
+      for (i = 0; i < n_pending && !winner;) {
+         if (!pending[i].revents) {
+            i++;
+            continue;
+         }
+
+         sock = pending[i].socket;
+         err = _mongoc_socket_connect_error (sock);
+         if (!err) {
+            winner = sock;
+         } else {
+            _mongoc_socket_connect_failed (sock, pending_addrs[i], err);
+            next_at = now;
+         }
+
+         /* remove attempt i */
+         n_pending--;
+         pending[i] = pending[n_pending];
+         pending_addrs[i] = pending_addrs[n_pending];
+      }
+   }
+
+   for (i = 0; i < n_pending; i++) {
+      if (winner) {
+         mongoc_socket_destroy (pending[i].socket);
+      } else {
+         err = MONGOC_ERRNO_TIMEDOUT;
+         _mongoc_socket_connect_failed (
+            pending[i].socket, pending_addrs[i], err);
+      }
+   }
+
+   bson_free (pending_addrs);
+   bson_free (pending);
+   bson_free (sorted);
+
+   if (!winner) {
+      errno = err;
+   }
+
+   RETURN (winner);
+}
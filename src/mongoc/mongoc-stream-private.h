@@ -37,6 +37,9 @@ BSON_BEGIN_DECLS
 bool
 mongoc_stream_wait (mongoc_stream_t *stream, int64_t expire_at);
 
+mongoc_stream_t *
+mongoc_stream_get_root_stream (mongoc_stream_t *stream);
+
 bool
 _mongoc_stream_writev_full (mongoc_stream_t *stream,
                             mongoc_iovec_t *iov,
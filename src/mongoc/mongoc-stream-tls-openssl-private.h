@@ -24,9 +24,15 @@
 #ifdef MONGOC_ENABLE_SSL_OPENSSL
 #include <bson.h>
 
+#include "mongoc-openssl-private.h"
+
 BSON_BEGIN_DECLS
 
 
+/* writes are packed into records of up to the most plaintext TLS allows */
+#define MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE SSL3_RT_MAX_PLAIN_LENGTH
+
+
 /**
  * mongoc_stream_tls_openssl_t:
  *
@@ -36,9 +42,21 @@ typedef struct {
    BIO *bio;
    BIO_METHOD *meth;
    SSL_CTX *ctx;
+   mongoc_openssl_shared_t *shared; /* the client's or pool's, or NULL */
+   char *host_and_port; /* the key of its session in shared */
+   char write_buf[MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE];
 } mongoc_stream_tls_openssl_t;
 
 
+mongoc_stream_t *
+_mongoc_stream_tls_openssl_new_shared (mongoc_stream_t *base_stream,
+                                       const char *host,
+                                       const char *host_and_port,
+                                       mongoc_ssl_opt_t *opt,
+                                       int client,
+                                       mongoc_openssl_shared_t *shared);
+
+
 BSON_END_DECLS
 
 #endif /* MONGOC_ENABLE_SSL_OPENSSL */
@@ -43,8 +43,6 @@
 #undef MONGOC_LOG_DOMAIN
 #define MONGOC_LOG_DOMAIN "stream-tls-openssl"
 
-#define MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE 4096
-
 #if OPENSSL_VERSION_NUMBER < 0x10100000L || defined(LIBRESSL_VERSION_NUMBER)
 static void
 BIO_meth_free (BIO_METHOD *meth)
@@ -54,6 +52,44 @@ BIO_meth_free (BIO_METHOD *meth)
 #endif
 
 
+#ifdef SSL3_RT_HEADER
+/* count the application data records OpenSSL writes, as it writes them.
+ * in TLS 1.3 every encrypted record's header says application data, the
+ * real type follows in a separate callback */
+static void
+_mongoc_stream_tls_openssl_msg_callback (int write_p,
+                                         int version,
+                                         int content_type,
+                                         const void *buf,
+                                         size_t len,
+                                         SSL *ssl,
+                                         void *arg)
+{
+   const uint8_t *bytes = (const uint8_t *) buf;
+
+   if (!write_p || len < 1) {
+      return;
+   }
+
+#if defined(SSL3_RT_INNER_CONTENT_TYPE) && defined(TLS1_3_VERSION)
+   if (SSL_version (ssl) == TLS1_3_VERSION) {
+      if (content_type == SSL3_RT_INNER_CONTENT_TYPE &&
+          bytes[0] == SSL3_RT_APPLICATION_DATA) {
+         mongoc_counter_tls_records_out_inc ();
+      }
+
+      return;
+   }
+#endif
+
+   if (content_type == SSL3_RT_HEADER &&
+       bytes[0] == SSL3_RT_APPLICATION_DATA) {
+      mongoc_counter_tls_records_out_inc ();
+   }
+}
+#endif
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -78,9 +114,21 @@ _mongoc_stream_tls_openssl_destroy (mongoc_stream_t *stream)
    mongoc_stream_tls_t *tls = (mongoc_stream_tls_t *) stream;
    mongoc_stream_tls_openssl_t *openssl =
       (mongoc_stream_tls_openssl_t *) tls->ctx;
+   SSL *ssl;
 
    BSON_ASSERT (tls);
 
+   if (openssl->shared) {
+      BIO_get_ssl (openssl->bio, &ssl);
+      if (SSL_is_init_finished (ssl)) {
+         /* pick up a session ticket received after the handshake */
+         _mongoc_openssl_shared_save (
+            openssl->shared, openssl->host_and_port, ssl);
+      }
+   }
+
+   bson_free (openssl->host_and_port);
+
    BIO_free_all (openssl->bio);
    openssl->bio = NULL;
 
@@ -240,13 +288,16 @@ _mongoc_stream_tls_openssl_write (mongoc_stream_tls_t *tls,
  *       all of the bytes or fail. If the number of bytes is not equal
  *       to the number requested, a failure or EOF has occurred.
  *
+ *       Small iovecs, like a message's header fields and documents, are
+ *       packed into full TLS records in the stream's write buffer, so a
+ *       message costs as few records and syscalls as its size allows.
+ *
  * Returns:
  *       -1 on failure, otherwise the number of bytes written.
  *
  * Side effects:
  *       None.
  *
- * This function is copied as _mongoc_stream_tls_secure_transport_writev
  *--------------------------------------------------------------------------
  */
 
@@ -257,28 +308,18 @@ _mongoc_stream_tls_openssl_writev (mongoc_stream_t *stream,
                                    int32_t timeout_msec)
 {
    mongoc_stream_tls_t *tls = (mongoc_stream_tls_t *) stream;
-   char buf[MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE];
+   mongoc_stream_tls_openssl_t *openssl =
+      (mongoc_stream_tls_openssl_t *) tls->ctx;
+   char *buf = openssl->write_buf;
+   const size_t buf_size = sizeof openssl->write_buf;
+   size_t buf_len = 0;
    ssize_t ret = 0;
    ssize_t child_ret;
    size_t i;
-   size_t iov_pos = 0;
-
-   /* There's a bit of a dance to coalesce vectorized writes into
-    * MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE'd writes to avoid lots of small tls
-    * packets.
-    *
-    * The basic idea is that we want to combine writes in the buffer if they're
-    * smaller than the buffer, flushing as it gets full.  For larger writes, or
-    * the last write in the iovec array, we want to ignore the buffer and just
-    * write immediately.  We take care of doing buffer writes by re-invoking
-    * ourself with a single iovec_t, pointing at our stack buffer.
-    */
-   char *buf_head = buf;
-   char *buf_tail = buf;
-   char *buf_end = buf + MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE;
+   size_t iov_pos;
+   size_t remaining;
    size_t bytes;
-
-   char *to_write = NULL;
+   char *to_write;
    size_t to_write_len;
 
    BSON_ASSERT (tls);
@@ -292,78 +333,66 @@ _mongoc_stream_tls_openssl_writev (mongoc_stream_t *stream,
       iov_pos = 0;
 
       while (iov_pos < iov[i].iov_len) {
-         if (buf_head != buf_tail ||
-             ((i + 1 < iovcnt) &&
-              ((buf_end - buf_tail) > (iov[i].iov_len - iov_pos)))) {
-            /* If we have either of:
-             *   - buffered bytes already
-             *   - another iovec to send after this one and we don't have more
-             *     bytes to send than the size of the buffer.
-             *
-             * copy into the buffer */
-
-            bytes = BSON_MIN (iov[i].iov_len - iov_pos, buf_end - buf_tail);
-
-            memcpy (buf_tail, (char *) iov[i].iov_base + iov_pos, bytes);
-            buf_tail += bytes;
-            iov_pos += bytes;
-
-            if (buf_tail == buf_end) {
-               /* If we're full, request send */
+         remaining = iov[i].iov_len - iov_pos;
 
-               to_write = buf_head;
-               to_write_len = buf_tail - buf_head;
-
-               buf_tail = buf_head = buf;
+         if (buf_len == 0 && (i + 1 == iovcnt || remaining >= buf_size)) {
+            /* nothing buffered: write the last iovec through, or as many
+             * full records as this one holds, and buffer the rest */
+            to_write = (char *) iov[i].iov_base + iov_pos;
+            to_write_len = remaining;
+            if (i + 1 < iovcnt) {
+               to_write_len -= remaining % buf_size;
             }
          } else {
-            /* Didn't buffer, so just write it through */
+            bytes = BSON_MIN (remaining, buf_size - buf_len);
+            memcpy (buf + buf_len, (char *) iov[i].iov_base + iov_pos, bytes);
+            buf_len += bytes;
+            iov_pos += bytes;
 
-            to_write = (char *) iov[i].iov_base + iov_pos;
-            to_write_len = iov[i].iov_len - iov_pos;
+            if (buf_len < buf_size) {
+               continue;
+            }
 
-            iov_pos += to_write_len;
+            /* a full record */
+            to_write = buf;
+            to_write_len = buf_len;
+            buf_len = 0;
          }
 
-         if (to_write) {
-            /* We get here if we buffered some bytes and filled the buffer, or
-             * if we didn't buffer and have to send out of the iovec */
-
-            child_ret =
-               _mongoc_stream_tls_openssl_write (tls, to_write, to_write_len);
-            if (child_ret != to_write_len) {
-               TRACE ("Got child_ret: %ld while to_write_len is: %ld",
-                      child_ret,
-                      to_write_len);
-            }
-
-            if (child_ret < 0) {
-               TRACE ("Returning what I had (%ld) as apposed to the error "
-                      "(%ld, errno:%d)",
-                      ret,
-                      child_ret,
-                      errno);
-               RETURN (ret);
-            }
+         child_ret =
+            _mongoc_stream_tls_openssl_write (tls, to_write, to_write_len);
+         if (child_ret != to_write_len) {
+            TRACE ("Got child_ret: %ld while to_write_len is: %ld",
+                   child_ret,
+                   to_write_len);
+         }
 
-            ret += child_ret;
+         if (child_ret < 0) {
+            TRACE ("Returning what I had (%ld) as apposed to the error "
+                   "(%ld, errno:%d)",
+                   ret,
+                   child_ret,
+                   errno);
+            RETURN (ret);
+         }
 
-            if (child_ret < to_write_len) {
-               /* we timed out, so send back what we could send */
+         ret += child_ret;
 
-               RETURN (ret);
-            }
+         if (child_ret < to_write_len) {
+            /* we timed out, so send back what we could send */
+            RETURN (ret);
+         }
 
-            to_write = NULL;
+         if (to_write != buf) {
+            iov_pos += to_write_len;
          }
       }
    }
 
-   if (buf_head != buf_tail) {
+   if (buf_len) {
       /* If we have any bytes buffered, send */
 
-      child_ret =
-         _mongoc_stream_tls_openssl_write (tls, buf_head, buf_tail - buf_head);
+      child_ret = _mongoc_stream_tls_openssl_write (tls, buf, buf_len);
 
       if (child_ret < 0) {
          RETURN (child_ret);
@@ -568,6 +597,17 @@ mongoc_stream_tls_openssl_handshake (mongoc_stream_t *stream,
    if (BIO_do_handshake (openssl->bio) == 1) {
       if (_mongoc_openssl_check_cert (
              ssl, host, tls->ssl_opts.allow_invalid_hostname)) {
+         if (SSL_session_reused (ssl)) {
+            mongoc_counter_tls_handshakes_resumed_inc ();
+         } else {
+            mongoc_counter_tls_handshakes_full_inc ();
+         }
+
+         if (openssl->shared) {
+            _mongoc_openssl_shared_save (
+               openssl->shared, openssl->host_and_port, ssl);
+         }
+
          RETURN (true);
       }
 
@@ -633,6 +673,22 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t *base_stream,
                                const char *host,
                                mongoc_ssl_opt_t *opt,
                                int client)
+{
+   return _mongoc_stream_tls_openssl_new_shared (
+      base_stream, host, NULL, opt, client, NULL);
+}
+
+
+/* like mongoc_stream_tls_openssl_new; a client stream to @host uses the
+ * SSL_CTX in @shared, its topology's, if it is not NULL, and resumes the
+ * session of the server at @host_and_port */
+mongoc_stream_t *
+_mongoc_stream_tls_openssl_new_shared (mongoc_stream_t *base_stream,
+                                       const char *host,
+                                       const char *host_and_port,
+                                       mongoc_ssl_opt_t *opt,
+                                       int client,
+                                       mongoc_openssl_shared_t *shared)
 {
    mongoc_stream_tls_t *tls;
    mongoc_stream_tls_openssl_t *openssl;
@@ -640,21 +696,45 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t *base_stream,
    BIO *bio_ssl = NULL;
    BIO *bio_mongoc_shim = NULL;
    BIO_METHOD *meth;
+   SSL *ssl;
 
    BSON_ASSERT (base_stream);
    BSON_ASSERT (opt);
    ENTRY;
 
-   ssl_ctx = _mongoc_openssl_ctx_new (opt);
+   /* a client's or pool's streams share its topology's OpenSSL state, so
+    * its certificates and CA files are loaded once */
+   if (!client || !host || !host_and_port) {
+      shared = NULL;
+   }
+
+   if (shared) {
+      ssl_ctx = _mongoc_openssl_shared_get_ctx (shared, opt);
+   } else {
+      ssl_ctx = _mongoc_openssl_ctx_new (opt);
+   }
 
    if (!ssl_ctx) {
       RETURN (NULL);
    }
 
+   bio_ssl = BIO_new_ssl (ssl_ctx, client);
+   if (!bio_ssl) {
+      SSL_CTX_free (ssl_ctx);
+      RETURN (NULL);
+   }
+
+   BIO_get_ssl (bio_ssl, &ssl);
+
+#ifdef SSL3_RT_HEADER
+   SSL_set_msg_callback (ssl, _mongoc_stream_tls_openssl_msg_callback);
+#endif
+
 #if OPENSSL_VERSION_NUMBER >= 0x10002000L
+   /* the SSL_CTX may be shared, so the host to verify is set per SSL */
    if (!opt->allow_invalid_hostname) {
       struct in_addr addr;
-      X509_VERIFY_PARAM *param = X509_VERIFY_PARAM_new ();
+      X509_VERIFY_PARAM *param = SSL_get0_param (ssl);
 
       X509_VERIFY_PARAM_set_hostflags (param,
                                        X509_CHECK_FLAG_NO_PARTIAL_WILDCARDS);
@@ -664,22 +744,8 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t *base_stream,
       } else {
          X509_VERIFY_PARAM_set1_host (param, host, 0);
       }
-      SSL_CTX_set1_param (ssl_ctx, param);
-      X509_VERIFY_PARAM_free (param);
    }
 #endif
-
-   if (opt->weak_cert_validation) {
-      SSL_CTX_set_verify (ssl_ctx, SSL_VERIFY_NONE, NULL);
-   } else {
-      SSL_CTX_set_verify (ssl_ctx, SSL_VERIFY_PEER, NULL);
-   }
-
-   bio_ssl = BIO_new_ssl (ssl_ctx, client);
-   if (!bio_ssl) {
-      SSL_CTX_free (ssl_ctx);
-      RETURN (NULL);
-   }
    meth = mongoc_stream_tls_openssl_bio_meth_new ();
    bio_mongoc_shim = BIO_new (meth);
    if (!bio_mongoc_shim) {
@@ -696,6 +762,12 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t *base_stream,
    openssl->meth = meth;
    openssl->ctx = ssl_ctx;
 
+   if (shared) {
+      openssl->shared = shared;
+      openssl->host_and_port = bson_strdup (host_and_port);
+      _mongoc_openssl_shared_resume (shared, host_and_port, ssl);
+   }
+
    tls = (mongoc_stream_tls_t *) bson_malloc0 (sizeof *tls);
    tls->parent.type = MONGOC_STREAM_TLS;
    tls->parent.destroy = _mongoc_stream_tls_openssl_destroy;
@@ -28,6 +28,8 @@
 
 BSON_BEGIN_DECLS
 
+struct _mongoc_openssl_shared_t;
+
 /**
  * mongoc_stream_tls_t:
  *
@@ -48,6 +50,16 @@ struct _mongoc_stream_tls_t {
 };
 
 
+mongoc_stream_t *
+_mongoc_stream_tls_new_with_hostname_shared (
+   mongoc_stream_t *base_stream,
+   const char *host,
+   const char *host_and_port,
+   mongoc_ssl_opt_t *opt,
+   int client,
+   struct _mongoc_openssl_shared_t *openssl_shared);
+
+
 BSON_END_DECLS
 
 #endif /* MONGOC_STREAM_TLS_PRIVATE_H */
@@ -30,6 +30,7 @@
 #include "mongoc-stream-private.h"
 #if defined(MONGOC_ENABLE_SSL_OPENSSL)
 #include "mongoc-stream-tls-openssl.h"
+#include "mongoc-stream-tls-openssl-private.h"
 #include "mongoc-openssl-private.h"
 #elif defined(MONGOC_ENABLE_SSL_LIBRESSL)
 #include "mongoc-libressl-private.h"
@@ -200,6 +201,33 @@ mongoc_stream_tls_new_with_hostname (mongoc_stream_t *base_stream,
                                      const char *host,
                                      mongoc_ssl_opt_t *opt,
                                      int client)
+{
+   return _mongoc_stream_tls_new_with_hostname_shared (
+      base_stream, host, NULL, opt, client, NULL);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_tls_new_with_hostname_shared --
+ *
+ *       Like mongoc_stream_tls_new_with_hostname. With OpenSSL, a client
+ *       stream to @host uses the SSL_CTX and cached sessions in
+ *       @openssl_shared, which belongs to the caller's topology, if it is
+ *       not NULL. Other TLS libraries ignore @openssl_shared.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_stream_t *
+_mongoc_stream_tls_new_with_hostname_shared (
+   mongoc_stream_t *base_stream,
+   const char *host,
+   const char *host_and_port,
+   mongoc_ssl_opt_t *opt,
+   int client,
+   struct _mongoc_openssl_shared_t *openssl_shared)
 {
    BSON_ASSERT (base_stream);
 
@@ -217,7 +245,8 @@ mongoc_stream_tls_new_with_hostname (mongoc_stream_t *base_stream,
 #endif
 
 #if defined(MONGOC_ENABLE_SSL_OPENSSL)
-   return mongoc_stream_tls_openssl_new (base_stream, host, opt, client);
+   return _mongoc_stream_tls_openssl_new_shared (
+      base_stream, host, host_and_port, opt, client, openssl_shared);
 #elif defined(MONGOC_ENABLE_SSL_LIBRESSL)
    return mongoc_stream_tls_libressl_new (base_stream, host, opt, client);
 #elif defined(MONGOC_ENABLE_SSL_SECURE_TRANSPORT)
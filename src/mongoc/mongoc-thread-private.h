@@ -61,6 +61,7 @@ mongoc_cond_timedwait (pthread_cond_t *cond,
 #define mongoc_thread_t pthread_t
 #define mongoc_thread_create(_t, _f, _d) pthread_create ((_t), NULL, (_f), (_d))
 #define mongoc_thread_join(_n) pthread_join ((_n), NULL)
+#define mongoc_thread_detach(_n) pthread_detach (_n)
 #define mongoc_once_t pthread_once_t
 #define mongoc_once pthread_once
 #define MONGOC_ONCE_FUN(n) void n (void)
@@ -82,6 +83,7 @@ mongoc_thread_create (mongoc_thread_t *thread, void *(*cb) (void *), void *arg)
    return 0;
 }
 #define mongoc_thread_join(_n) WaitForSingleObject ((_n), INFINITE)
+#define mongoc_thread_detach(_n) CloseHandle (_n)
 #define mongoc_mutex_t CRITICAL_SECTION
 #define mongoc_mutex_init InitializeCriticalSection
 #define mongoc_mutex_lock EnterCriticalSection
@@ -17,7 +17,12 @@
 #ifndef MONGOC_TOPOLOGY_PRIVATE_H
 #define MONGOC_TOPOLOGY_PRIVATE_H
 
+#include "mongoc-config.h"
+#ifdef MONGOC_ENABLE_SSL_OPENSSL
+#include "mongoc-openssl-private.h"
+#endif
 #include "mongoc-read-prefs-private.h"
+#include "mongoc-scram-private.h"
 #include "mongoc-topology-scanner-private.h"
 #include "mongoc-server-description-private.h"
 #include "mongoc-topology-description-private.h"
@@ -60,6 +65,22 @@ typedef struct _mongoc_topology_t {
    bool shutdown_requested;
    bool single_threaded;
    bool stale;
+
+   /* called with the mutex held when a server's type changes, so a client
+    * pool's warmer connects its idle clients to a server that became
+    * selectable */
+   void (*server_changed_cb) (void *context);
+   void *server_changed_context;
+
+#ifdef MONGOC_ENABLE_CRYPTO
+   /* shared by the clients' SCRAM authentications */
+   mongoc_scram_cache_t scram_cache;
+#endif
+
+#ifdef MONGOC_ENABLE_SSL_OPENSSL
+   /* SSL_CTX and TLS sessions shared by the clients' and scanner's streams */
+   mongoc_openssl_shared_t openssl_shared;
+#endif
 } mongoc_topology_t;
 
 mongoc_topology_t *
@@ -26,6 +26,7 @@
 #include <bson.h>
 #include "mongoc-async-private.h"
 #include "mongoc-async-cmd-private.h"
+#include "mongoc-counters-private.h"
 #include "mongoc-host-list.h"
 #include "mongoc-apm-private.h"
 
@@ -49,15 +50,15 @@ struct mongoc_topology_scanner;
 
 typedef struct mongoc_topology_scanner_node {
    uint32_t id;
-   mongoc_async_cmd_t *cmd;
    mongoc_stream_t *stream;
    int64_t timestamp;
    int64_t last_used;
    int64_t last_failed;
    bool has_auth;
    mongoc_host_list_t host;
-   struct addrinfo *dns_results;
-   struct addrinfo *current_dns_result;
+   mongoc_counter_slots_t *counters; /* this server's, in the shm segment */
+   struct addrinfo *dns_results; /* from _mongoc_resolver_start */
+   bool dns_pending; /* waiting for the resolver to begin connecting */
    struct mongoc_topology_scanner *ts;
 
    struct mongoc_topology_scanner_node *next;
@@ -88,6 +89,7 @@ typedef struct mongoc_topology_scanner {
 
 #ifdef MONGOC_ENABLE_SSL
    mongoc_ssl_opt_t *ssl_opts;
+   struct _mongoc_openssl_shared_t *openssl_shared; /* topology's, or NULL */
 #endif
 
    mongoc_apm_callbacks_t apm_callbacks;
@@ -149,6 +151,12 @@ bool
 mongoc_topology_scanner_node_setup (mongoc_topology_scanner_node_t *node,
                                     bson_error_t *error);
 
+bool
+mongoc_topology_scanner_node_setup_blocking (
+   mongoc_topology_scanner_node_t *node,
+   int64_t expire_at,
+   bson_error_t *error);
+
 mongoc_topology_scanner_node_t *
 mongoc_topology_scanner_get_node (mongoc_topology_scanner_t *ts, uint32_t id);
 
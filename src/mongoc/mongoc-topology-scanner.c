@@ -28,9 +28,13 @@
 
 #ifdef MONGOC_ENABLE_SSL
 #include "mongoc-stream-tls.h"
+#include "mongoc-stream-tls-private.h"
 #endif
 
 #include "mongoc-counters-private.h"
+#include "mongoc-compression-private.h"
+#include "mongoc-resolver-private.h"
+#include "mongoc-socket-private.h"
 #include "utlist.h"
 #include "mongoc-topology-private.h"
 #include "mongoc-host-list-private.h"
@@ -41,12 +45,16 @@
 /* forward declarations */
 static void
 mongoc_topology_scanner_ismaster_handler (
+   mongoc_async_cmd_t *acmd,
    mongoc_async_cmd_result_t async_status,
    const bson_t *ismaster_response,
    int64_t rtt_msec,
    void *data,
    bson_error_t *error);
 
+static mongoc_stream_t *
+_mongoc_topology_scanner_node_initiate (mongoc_async_cmd_t *acmd);
+
 static void
 _mongoc_topology_scanner_monitor_heartbeat_started (
    const mongoc_topology_scanner_t *ts, const mongoc_host_list_t *host);
@@ -64,9 +72,14 @@ _mongoc_topology_scanner_monitor_heartbeat_failed (
    const bson_error_t *error);
 
 static void
-_add_ismaster (bson_t *cmd)
+_add_ismaster (mongoc_topology_scanner_t *ts, bson_t *cmd)
 {
    BSON_APPEND_INT32 (cmd, "isMaster", 1);
+
+   if (ts->uri) {
+      _mongoc_compressor_append_to_ismaster (
+         cmd, mongoc_uri_get_compressors (ts->uri));
+   }
 }
 
 static bool
@@ -76,7 +89,7 @@ _build_ismaster_with_handshake (mongoc_topology_scanner_t *ts)
    bson_t handshake_doc;
    bool res;
 
-   _add_ismaster (doc);
+   _add_ismaster (ts, doc);
 
    BSON_APPEND_DOCUMENT_BEGIN (doc, HANDSHAKE_FIELD, &handshake_doc);
    res = _mongoc_handshake_build_doc_with_application (&handshake_doc,
@@ -113,22 +126,109 @@ _get_ismaster_doc (mongoc_topology_scanner_t *ts,
    return &ts->ismaster_cmd_with_handshake;
 }
 
+/* call isMaster on the node's stream. if it has none, race connections to
+ * each of its host's addresses, staggered by MONGOC_HAPPY_EYEBALLS_DELAY_MS,
+ * and call isMaster on each. the first to reply wins, see
+ * mongoc_topology_scanner_ismaster_handler. */
 static void
 _begin_ismaster_cmd (mongoc_topology_scanner_t *ts,
                      mongoc_topology_scanner_node_t *node,
                      int64_t timeout_msec)
 {
    const bson_t *ismaster_cmd_to_send = _get_ismaster_doc (ts, node);
+   struct addrinfo **sorted;
+   size_t n_addrs;
+   size_t i;
+
+   if (node->stream) {
+      mongoc_async_cmd (ts->async,
+                        node->stream,
+                        ts->setup,
+                        node->host.host,
+                        "admin",
+                        ismaster_cmd_to_send,
+                        &mongoc_topology_scanner_ismaster_handler,
+                        node,
+                        timeout_msec);
+      return;
+   }
+
+   BSON_ASSERT (node->dns_results);
+   n_addrs = _mongoc_socket_sort_addrinfo (node->dns_results, &sorted);
+
+   for (i = 0; i < n_addrs; i++) {
+      mongoc_async_cmd_delayed (ts->async,
+                                &_mongoc_topology_scanner_node_initiate,
+                                sorted[i],
+                                (int64_t) i * MONGOC_HAPPY_EYEBALLS_DELAY_MS,
+                                ts->setup,
+                                node->host.host,
+                                "admin",
+                                ismaster_cmd_to_send,
+                                &mongoc_topology_scanner_ismaster_handler,
+                                node,
+                                timeout_msec);
+   }
 
-   node->cmd = mongoc_async_cmd (ts->async,
-                                 node->stream,
-                                 ts->setup,
-                                 node->host.host,
-                                 "admin",
-                                 ismaster_cmd_to_send,
-                                 &mongoc_topology_scanner_ismaster_handler,
-                                 node,
-                                 timeout_msec);
+   bson_free (sorted);
+}
+
+
+/* whether the node has commands in progress besides @except */
+static bool
+_mongoc_topology_scanner_node_has_cmds (mongoc_topology_scanner_node_t *node,
+                                        mongoc_async_cmd_t *except)
+{
+   mongoc_async_cmd_t *acmd;
+
+   DL_FOREACH (node->ts->async->cmds, acmd)
+   {
+      if (acmd != except && acmd->data == node &&
+          acmd->state != MONGOC_ASYNC_CMD_CANCELED_STATE) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+
+/* cancel the node's commands besides @except. the async loop finishes them
+ * without waiting for their streams. */
+static void
+_mongoc_topology_scanner_node_cancel_cmds (
+   mongoc_topology_scanner_node_t *node, mongoc_async_cmd_t *except)
+{
+   mongoc_async_cmd_t *acmd;
+
+   DL_FOREACH (node->ts->async->cmds, acmd)
+   {
+      if (acmd != except && acmd->data == node) {
+         acmd->state = MONGOC_ASYNC_CMD_CANCELED_STATE;
+      }
+   }
+}
+
+
+/* a connection attempt failed: start the next one now, rather than after
+ * the rest of its delay */
+static void
+_mongoc_topology_scanner_node_jumpstart (mongoc_topology_scanner_node_t *node)
+{
+   mongoc_async_cmd_t *acmd;
+   mongoc_async_cmd_t *next = NULL;
+
+   DL_FOREACH (node->ts->async->cmds, acmd)
+   {
+      if (acmd->data == node && acmd->state == MONGOC_ASYNC_CMD_INITIATE &&
+          (!next || acmd->initiate_at < next->initiate_at)) {
+         next = acmd;
+      }
+   }
+
+   if (next) {
+      next->initiate_at = bson_get_monotonic_time ();
+   }
 }
 
 
@@ -144,14 +244,15 @@ mongoc_topology_scanner_new (
 
    ts->async = mongoc_async_new ();
 
-   bson_init (&ts->ismaster_cmd);
-   _add_ismaster (&ts->ismaster_cmd);
-   bson_init (&ts->ismaster_cmd_with_handshake);
-
    ts->setup_err_cb = setup_err_cb;
    ts->cb = cb;
    ts->cb_data = data;
    ts->uri = uri;
+
+   bson_init (&ts->ismaster_cmd);
+   _add_ismaster (ts, &ts->ismaster_cmd);
+   bson_init (&ts->ismaster_cmd_with_handshake);
+
    ts->appname = NULL;
    ts->handshake_ok_to_send = false;
 
@@ -209,6 +310,7 @@ mongoc_topology_scanner_add (mongoc_topology_scanner_t *ts,
 
    memcpy (&node->host, host, sizeof (*host));
 
+   node->counters = _mongoc_node_counters_get (host->host_and_port);
    node->id = id;
    node->ts = ts;
    node->last_failed = -1;
@@ -243,9 +345,7 @@ mongoc_topology_scanner_add_and_scan (mongoc_topology_scanner_t *ts,
 void
 mongoc_topology_scanner_node_retire (mongoc_topology_scanner_node_t *node)
 {
-   if (node->cmd) {
-      node->cmd->state = MONGOC_ASYNC_CMD_CANCELED_STATE;
-   }
+   _mongoc_topology_scanner_node_cancel_cmds (node, NULL);
 
    node->retired = true;
 }
@@ -254,15 +354,25 @@ void
 mongoc_topology_scanner_node_disconnect (mongoc_topology_scanner_node_t *node,
                                          bool failed)
 {
-   if (node->dns_results) {
-      freeaddrinfo (node->dns_results);
-      node->dns_results = NULL;
-      node->current_dns_result = NULL;
+   mongoc_async_cmd_t *acmd, *tmp;
+
+   DL_FOREACH_SAFE (node->ts->async->cmds, acmd, tmp)
+   {
+      if (acmd->data != node) {
+         continue;
+      }
+
+      /* a connection attempt's stream isn't the node's yet */
+      if (acmd->initiator && acmd->stream && acmd->stream != node->stream) {
+         mongoc_stream_destroy (acmd->stream);
+      }
+
+      mongoc_async_cmd_destroy (acmd);
    }
 
-   if (node->cmd) {
-      mongoc_async_cmd_destroy (node->cmd);
-      node->cmd = NULL;
+   if (node->dns_results) {
+      _mongoc_resolver_free_results (node->dns_results);
+      node->dns_results = NULL;
    }
 
    if (node->stream) {
@@ -273,6 +383,8 @@ mongoc_topology_scanner_node_disconnect (mongoc_topology_scanner_node_t *node,
       }
 
       node->stream = NULL;
+      _mongoc_node_counter_add (
+         node->counters, MONGOC_NODE_COUNTER_STREAMS, -1);
    }
 }
 
@@ -349,6 +461,7 @@ mongoc_topology_scanner_has_node_for_host (mongoc_topology_scanner_t *ts,
 
 static void
 mongoc_topology_scanner_ismaster_handler (
+   mongoc_async_cmd_t *acmd,
    mongoc_async_cmd_result_t async_status,
    const bson_t *ismaster_response,
    int64_t rtt_msec,
@@ -364,19 +477,52 @@ mongoc_topology_scanner_ismaster_handler (
 
    node = (mongoc_topology_scanner_node_t *) data;
    ts = node->ts;
-   node->cmd = NULL;
+   now = bson_get_monotonic_time ();
+
+   if (acmd->initiator) {
+      /* one of the connection attempts begun by _begin_ismaster_cmd */
+      if (ismaster_response && async_status == MONGOC_ASYNC_CMD_SUCCESS &&
+          !node->stream && !node->retired) {
+         /* the first to succeed is the node's stream, cancel the others */
+         node->stream = acmd->stream;
+         _mongoc_node_counter_add (
+            node->counters, MONGOC_NODE_COUNTER_STREAMS, 1);
+         node->has_auth = false;
+         node->timestamp = now;
+         _mongoc_topology_scanner_node_cancel_cmds (node, acmd);
+      } else {
+         if (acmd->stream) {
+            mongoc_stream_destroy (acmd->stream);
+         }
+
+         if (node->stream || node->retired) {
+            return;
+         }
+
+         if (_mongoc_topology_scanner_node_has_cmds (node, acmd)) {
+            _mongoc_topology_scanner_node_jumpstart (node);
+            return;
+         }
+
+         /* all attempts failed */
+      }
+   }
 
    if (node->retired) {
       return;
    }
 
-   now = bson_get_monotonic_time ();
-
    /* if no ismaster response, async cmd had an error or timed out */
    if (!ismaster_response || async_status == MONGOC_ASYNC_CMD_ERROR ||
        async_status == MONGOC_ASYNC_CMD_TIMEOUT) {
-      mongoc_stream_failed (node->stream);
-      node->stream = NULL;
+      if (node->stream) {
+         mongoc_stream_failed (node->stream);
+         node->stream = NULL;
+         _mongoc_node_counter_add (
+            node->counters, MONGOC_NODE_COUNTER_STREAMS, -1);
+      }
+
+      _mongoc_node_counter_add (node->counters, MONGOC_NODE_COUNTER_ERRORS, 1);
       node->last_failed = now;
       if (error->code) {
          message = error->message;
@@ -411,88 +557,106 @@ mongoc_topology_scanner_ismaster_handler (
 /*
  *--------------------------------------------------------------------------
  *
- * mongoc_topology_scanner_node_connect_tcp --
+ * mongoc_topology_scanner_node_resolve --
  *
- *      Create a socket stream for this node, begin a non-blocking
- *      connect and return.
+ *      Resolve the node's host into node->dns_results, replacing those of
+ *      its last connection. Connections are begun later, one to each
+ *      address, see _begin_ismaster_cmd.
  *
  * Returns:
- *      A stream. On failure, return NULL and fill out the error.
+ *      true on success. On failure, return false and fill out the error.
+ *      If the host is still being resolved, return false and set
+ *      dns_pending.
  *
  *--------------------------------------------------------------------------
  */
 
-static mongoc_stream_t *
-mongoc_topology_scanner_node_connect_tcp (mongoc_topology_scanner_node_t *node,
-                                          bson_error_t *error)
+static bool
+mongoc_topology_scanner_node_resolve (mongoc_topology_scanner_node_t *node,
+                                      bson_error_t *error)
 {
-   mongoc_socket_t *sock = NULL;
-   struct addrinfo hints;
-   struct addrinfo *rp;
-   char portstr[8];
-   mongoc_host_list_t *host;
-   int s;
+   mongoc_resolver_status_t status;
 
    ENTRY;
 
-   host = &node->host;
+   if (node->dns_results) {
+      _mongoc_resolver_free_results (node->dns_results);
+      node->dns_results = NULL;
+   }
 
-   if (!node->dns_results) {
-      bson_snprintf (portstr, sizeof portstr, "%hu", host->port);
-
-      memset (&hints, 0, sizeof hints);
-      hints.ai_family = host->family;
-      hints.ai_socktype = SOCK_STREAM;
-      hints.ai_flags = 0;
-      hints.ai_protocol = 0;
-
-      s = getaddrinfo (host->host, portstr, &hints, &node->dns_results);
-
-      if (s != 0) {
-         mongoc_counter_dns_failure_inc ();
-         bson_set_error (error,
-                         MONGOC_ERROR_STREAM,
-                         MONGOC_ERROR_STREAM_NAME_RESOLUTION,
-                         "Failed to resolve '%s'",
-                         host->host);
-         RETURN (NULL);
-      }
+   /* if dns_pending, this node started the lookup and waited for it */
+   status = _mongoc_resolver_start (
+      &node->host, node->dns_pending, &node->dns_results, error);
+   node->dns_pending = (status == MONGOC_RESOLVER_PENDING);
+
+   RETURN (status == MONGOC_RESOLVER_DONE);
+}
 
-      node->current_dns_result = node->dns_results;
 
-      mongoc_counter_dns_success_inc ();
+/* wrap a socket stream with TLS if the scanner uses it. on failure, destroy
+ * @sock_stream and return NULL. */
+static mongoc_stream_t *
+_mongoc_topology_scanner_node_stream_new (mongoc_topology_scanner_node_t *node,
+                                          mongoc_stream_t *sock_stream)
+{
+#ifdef MONGOC_ENABLE_SSL
+   mongoc_stream_t *tls_stream;
+
+   if (sock_stream && node->ts->ssl_opts) {
+      tls_stream = _mongoc_stream_tls_new_with_hostname_shared (
+         sock_stream,
+         node->host.host,
+         node->host.host_and_port,
+         node->ts->ssl_opts,
+         1,
+         node->ts->openssl_shared);
+      if (!tls_stream) {
+         mongoc_stream_destroy (sock_stream);
+      }
+
+      return tls_stream;
    }
+#endif
 
-   for (; node->current_dns_result;
-        node->current_dns_result = node->current_dns_result->ai_next) {
-      rp = node->current_dns_result;
+   return sock_stream;
+}
 
-      /*
-       * Create a new non-blocking socket.
-       */
-      if (!(sock = mongoc_socket_new (
-               rp->ai_family, rp->ai_socktype, rp->ai_protocol))) {
-         continue;
-      }
 
-      mongoc_socket_connect (sock, rp->ai_addr, (socklen_t) rp->ai_addrlen, 0);
+/* the initiator of a connection attempt, begin a non-blocking connect to
+ * one of the node's addresses */
+static mongoc_stream_t *
+_mongoc_topology_scanner_node_initiate (mongoc_async_cmd_t *acmd)
+{
+   mongoc_topology_scanner_node_t *node;
+   mongoc_socket_t *sock;
+   struct addrinfo *rp;
+   mongoc_stream_t *stream;
 
-      break;
-   }
+   node = (mongoc_topology_scanner_node_t *) acmd->data;
+   rp = (struct addrinfo *) acmd->initiator_ctx;
 
+   sock = mongoc_socket_new (rp->ai_family, rp->ai_socktype, rp->ai_protocol);
    if (!sock) {
-      bson_set_error (error,
+      bson_set_error (&acmd->error,
+                      MONGOC_ERROR_STREAM,
+                      MONGOC_ERROR_STREAM_SOCKET,
+                      "Failed to create socket.");
+      return NULL;
+   }
+
+   mongoc_socket_connect (sock, rp->ai_addr, (socklen_t) rp->ai_addrlen, 0);
+
+   stream = _mongoc_topology_scanner_node_stream_new (
+      node, mongoc_stream_socket_new (sock));
+   if (!stream) {
+      bson_set_error (&acmd->error,
                       MONGOC_ERROR_STREAM,
                       MONGOC_ERROR_STREAM_CONNECT,
                       "Failed to connect to target host: '%s'",
-                      host->host_and_port);
-      freeaddrinfo (node->dns_results);
-      node->dns_results = NULL;
-      node->current_dns_result = NULL;
-      RETURN (NULL);
+                      node->host.host_and_port);
    }
 
-   return mongoc_stream_socket_new (sock);
+   return stream;
 }
 
 static mongoc_stream_t *
@@ -553,15 +717,46 @@ mongoc_topology_scanner_node_connect_unix (mongoc_topology_scanner_node_t *node,
 }
 
 
+static void
+_mongoc_topology_scanner_node_setup_failed (
+   mongoc_topology_scanner_node_t *node, bson_error_t *error)
+{
+   _mongoc_topology_scanner_monitor_heartbeat_failed (
+      node->ts, &node->host, error);
+
+   node->ts->setup_err_cb (node->id, node->ts->cb_data, error);
+}
+
+
+/* give up on a node whose host was not resolved in time */
+static void
+_mongoc_topology_scanner_node_dns_timeout (
+   mongoc_topology_scanner_node_t *node, bson_error_t *error)
+{
+   node->dns_pending = false;
+   bson_set_error (error,
+                   MONGOC_ERROR_STREAM,
+                   MONGOC_ERROR_STREAM_NAME_RESOLUTION,
+                   "Timed out resolving '%s'",
+                   node->host.host);
+
+   _mongoc_topology_scanner_node_setup_failed (node, error);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
  * mongoc_topology_scanner_node_setup --
  *
- *      Create a stream and begin a non-blocking connect.
+ *      Create a stream and begin a non-blocking connect. For a TCP host,
+ *      only resolve it: _begin_ismaster_cmd races connections to its
+ *      addresses, and node->stream is set when one succeeds.
  *
  * Returns:
- *      true on success, or false and error is set.
+ *      true on success, or false and error is set. If the node's host
+ *      is still being resolved, return false and set dns_pending; call
+ *      this function again once the resolver is done.
  *
  *--------------------------------------------------------------------------
  */
@@ -572,7 +767,11 @@ mongoc_topology_scanner_node_setup (mongoc_topology_scanner_node_t *node,
 {
    mongoc_stream_t *sock_stream;
 
-   _mongoc_topology_scanner_monitor_heartbeat_started (node->ts, &node->host);
+   /* the heartbeat began before the node's host was resolved */
+   if (!node->dns_pending) {
+      _mongoc_topology_scanner_monitor_heartbeat_started (node->ts,
+                                                          &node->host);
+   }
 
    if (node->stream) {
       return true;
@@ -583,41 +782,110 @@ mongoc_topology_scanner_node_setup (mongoc_topology_scanner_node_t *node,
    if (node->ts->initiator) {
       sock_stream = node->ts->initiator (
          node->ts->uri, &node->host, node->ts->initiator_context, error);
+   } else if (node->host.family == AF_UNIX) {
+      sock_stream = _mongoc_topology_scanner_node_stream_new (
+         node, mongoc_topology_scanner_node_connect_unix (node, error));
    } else {
-      if (node->host.family == AF_UNIX) {
-         sock_stream = mongoc_topology_scanner_node_connect_unix (node, error);
-      } else {
-         sock_stream = mongoc_topology_scanner_node_connect_tcp (node, error);
+      if (mongoc_topology_scanner_node_resolve (node, error)) {
+         return true;
       }
 
-#ifdef MONGOC_ENABLE_SSL
-      if (sock_stream && node->ts->ssl_opts) {
-         mongoc_stream_t *original = sock_stream;
-
-         sock_stream = mongoc_stream_tls_new_with_hostname (
-            sock_stream, node->host.host, node->ts->ssl_opts, 1);
-         if (!sock_stream) {
-            mongoc_stream_destroy (original);
-         }
-      }
-#endif
+      sock_stream = NULL;
    }
 
    if (!sock_stream) {
-      _mongoc_topology_scanner_monitor_heartbeat_failed (
-         node->ts, &node->host, error);
+      if (!node->dns_pending) {
+         _mongoc_topology_scanner_node_setup_failed (node, error);
+      }
 
-      node->ts->setup_err_cb (node->id, node->ts->cb_data, error);
       return false;
    }
 
    node->stream = sock_stream;
+   _mongoc_node_counter_add (node->counters, MONGOC_NODE_COUNTER_STREAMS, 1);
+   node->has_auth = false;
+   node->timestamp = bson_get_monotonic_time ();
+
+   return true;
+}
+
+
+/* race connections to the node's addresses until @expire_at, like
+ * _begin_ismaster_cmd but blocking */
+static bool
+_mongoc_topology_scanner_node_connect_blocking (
+   mongoc_topology_scanner_node_t *node, int64_t expire_at, bson_error_t *error)
+{
+   mongoc_socket_t *sock;
+   mongoc_stream_t *stream = NULL;
+
+   sock = _mongoc_socket_connect_race (node->dns_results, expire_at);
+   if (sock) {
+      stream = _mongoc_topology_scanner_node_stream_new (
+         node, mongoc_stream_socket_new (sock));
+   }
+
+   if (!stream) {
+      bson_set_error (error,
+                      MONGOC_ERROR_STREAM,
+                      MONGOC_ERROR_STREAM_CONNECT,
+                      "Failed to connect to target host: '%s'",
+                      node->host.host_and_port);
+      return false;
+   }
+
+   node->stream = stream;
+   _mongoc_node_counter_add (node->counters, MONGOC_NODE_COUNTER_STREAMS, 1);
    node->has_auth = false;
    node->timestamp = bson_get_monotonic_time ();
 
    return true;
 }
 
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_topology_scanner_node_setup_blocking --
+ *
+ *      Like mongoc_topology_scanner_node_setup, but wait until @expire_at
+ *      for the node's host to be resolved, and for a TCP host, for a
+ *      connection to one of its addresses.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_topology_scanner_node_setup_blocking (
+   mongoc_topology_scanner_node_t *node,
+   int64_t expire_at,
+   bson_error_t *error)
+{
+   uint32_t generation;
+   int64_t timeout_msec;
+
+   for (;;) {
+      generation = _mongoc_resolver_generation ();
+
+      if (mongoc_topology_scanner_node_setup (node, error)) {
+         return node->stream || _mongoc_topology_scanner_node_connect_blocking (
+                                   node, expire_at, error);
+      }
+
+      if (!node->dns_pending) {
+         return false;
+      }
+
+      timeout_msec = (expire_at - bson_get_monotonic_time ()) / 1000;
+      if (timeout_msec <= 0) {
+         _mongoc_topology_scanner_node_dns_timeout (node, error);
+         return false;
+      }
+
+      _mongoc_resolver_wait (generation, timeout_msec);
+   }
+}
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -667,7 +935,7 @@ mongoc_topology_scanner_start (mongoc_topology_scanner_t *ts,
       /* check node if it last failed before current cooldown period began */
       if (node->last_failed < cooldown) {
          if (mongoc_topology_scanner_node_setup (node, &node->last_error)) {
-            BSON_ASSERT (!node->cmd);
+            BSON_ASSERT (!_mongoc_topology_scanner_node_has_cmds (node, NULL));
             _begin_ismaster_cmd (ts, node, timeout_msec);
          }
       }
@@ -714,6 +982,37 @@ _mongoc_topology_scanner_finish (mongoc_topology_scanner_t *ts)
    bson_string_free (msg, true);
 }
 
+/* begin checking nodes whose hosts have been resolved, and give up on
+ * those still waiting if @remaining_msec is 0. returns true if any are
+ * still waiting. */
+static bool
+_mongoc_topology_scanner_resume (mongoc_topology_scanner_t *ts,
+                                 int64_t remaining_msec)
+{
+   mongoc_topology_scanner_node_t *node, *tmp;
+   bool pending = false;
+
+   DL_FOREACH_SAFE (ts->nodes, node, tmp)
+   {
+      if (!node->dns_pending) {
+         continue;
+      }
+
+      if (node->retired) {
+         node->dns_pending = false;
+      } else if (mongoc_topology_scanner_node_setup (node, &node->last_error)) {
+         BSON_ASSERT (!_mongoc_topology_scanner_node_has_cmds (node, NULL));
+         _begin_ismaster_cmd (ts, node, BSON_MAX (remaining_msec, 1));
+      } else if (node->dns_pending && remaining_msec <= 0) {
+         _mongoc_topology_scanner_node_dns_timeout (node, &node->last_error);
+      } else if (node->dns_pending) {
+         pending = true;
+      }
+   }
+
+   return pending;
+}
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -733,7 +1032,41 @@ void
 mongoc_topology_scanner_work (mongoc_topology_scanner_t *ts,
                               int64_t timeout_msec)
 {
-   mongoc_async_run (ts->async, timeout_msec);
+   uint32_t generation;
+   int64_t expire_at;
+   int64_t remaining_msec;
+   bool pending;
+
+   expire_at = bson_get_monotonic_time () + timeout_msec * 1000;
+
+   for (;;) {
+      generation = _mongoc_resolver_generation ();
+      remaining_msec = (expire_at - bson_get_monotonic_time ()) / 1000;
+
+      /* nodes discovered during the scan may be waiting too */
+      pending = _mongoc_topology_scanner_resume (ts, remaining_msec);
+
+      if (remaining_msec <= 0 || (!pending && !ts->async->ncmds)) {
+         break;
+      }
+
+      if (!ts->async->ncmds) {
+         _mongoc_resolver_wait (generation, remaining_msec);
+      } else if (pending) {
+         /* the resolver can't wake the poller, check again soon */
+         mongoc_async_run_once (
+            ts->async,
+            (int32_t) BSON_MIN (remaining_msec, MONGOC_RESOLVER_POLL_MS));
+      } else {
+         mongoc_async_run_once (ts->async,
+                                (int32_t) BSON_MIN (remaining_msec, INT32_MAX));
+      }
+   }
+
+   /* time out the commands still in progress */
+   if (ts->async->ncmds) {
+      mongoc_async_run (ts->async, 1);
+   }
 }
 
 /*
@@ -15,6 +15,7 @@
  */
 
 #include "mongoc-config.h"
+#include "mongoc-counters-private.h"
 
 #include "mongoc-handshake.h"
 #include "mongoc-handshake-private.h"
@@ -85,6 +86,13 @@ _mongoc_topology_update_no_lock (uint32_t id,
                                  mongoc_topology_t *topology,
                                  const bson_error_t *error /* IN */)
 {
+   mongoc_server_description_t *sd;
+   mongoc_server_description_type_t old_type;
+
+   sd = mongoc_topology_description_server_by_id (
+      &topology->description, id, NULL);
+   old_type = sd ? sd->type : MONGOC_SERVER_UNKNOWN;
+
    mongoc_topology_description_handle_ismaster (
       &topology->description, id, ismaster_response, rtt_msec, error);
 
@@ -93,9 +101,15 @@ _mongoc_topology_update_no_lock (uint32_t id,
     */
    mongoc_topology_reconcile (topology);
 
+   sd = mongoc_topology_description_server_by_id (
+      &topology->description, id, NULL);
+
+   if (sd && sd->type != old_type && topology->server_changed_cb) {
+      topology->server_changed_cb (topology->server_changed_context);
+   }
+
    /* return false if server removed from topology */
-   return mongoc_topology_description_server_by_id (
-             &topology->description, id, NULL) != NULL;
+   return sd != NULL;
 }
 
 
@@ -269,6 +283,13 @@ mongoc_topology_new (const mongoc_uri_t *uri, bool single_threaded)
    mongoc_mutex_init (&topology->mutex);
    mongoc_cond_init (&topology->cond_client);
    mongoc_cond_init (&topology->cond_server);
+#ifdef MONGOC_ENABLE_CRYPTO
+   _mongoc_scram_cache_init (&topology->scram_cache);
+#endif
+#ifdef MONGOC_ENABLE_SSL_OPENSSL
+   _mongoc_openssl_shared_init (&topology->openssl_shared);
+   topology->scanner->openssl_shared = &topology->openssl_shared;
+#endif
 
    for (hl = mongoc_uri_get_hosts (uri); hl; hl = hl->next) {
       mongoc_topology_description_add_server (
@@ -336,6 +357,12 @@ mongoc_topology_destroy (mongoc_topology_t *topology)
    mongoc_cond_destroy (&topology->cond_client);
    mongoc_cond_destroy (&topology->cond_server);
    mongoc_mutex_destroy (&topology->mutex);
+#ifdef MONGOC_ENABLE_CRYPTO
+   _mongoc_scram_cache_destroy (&topology->scram_cache);
+#endif
+#ifdef MONGOC_ENABLE_SSL_OPENSSL
+   _mongoc_openssl_shared_destroy (&topology->openssl_shared);
+#endif
 
    bson_free (topology);
 }
@@ -493,23 +520,13 @@ mongoc_topology_select (mongoc_topology_t *topology,
    }
 }
 
-/*
- *-------------------------------------------------------------------------
- *
- * mongoc_topology_select_server_id --
- *
- *       Alternative to mongoc_topology_select when you only need the id.
- *
- * Returns:
- *       A server id, or 0 on failure, in which case @error will be set.
- *
- *-------------------------------------------------------------------------
- */
-uint32_t
-mongoc_topology_select_server_id (mongoc_topology_t *topology,
-                                  mongoc_ss_optype_t optype,
-                                  const mongoc_read_prefs_t *read_prefs,
-                                  bson_error_t *error)
+
+/* the implementation of mongoc_topology_select_server_id, below */
+static uint32_t
+_mongoc_topology_select_server_id (mongoc_topology_t *topology,
+                                   mongoc_ss_optype_t optype,
+                                   const mongoc_read_prefs_t *read_prefs,
+                                   bson_error_t *error)
 {
    static const char *timeout_msg =
       "No suitable servers found: `serverSelectionTimeoutMS` expired";
@@ -674,6 +691,38 @@ mongoc_topology_select_server_id (mongoc_topology_t *topology,
    }
 }
 
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * mongoc_topology_select_server_id --
+ *
+ *       Alternative to mongoc_topology_select when you only need the id.
+ *       The time spent is recorded in the server selection histogram.
+ *
+ * Returns:
+ *       A server id, or 0 on failure, in which case @error will be set.
+ *
+ *-------------------------------------------------------------------------
+ */
+uint32_t
+mongoc_topology_select_server_id (mongoc_topology_t *topology,
+                                  mongoc_ss_optype_t optype,
+                                  const mongoc_read_prefs_t *read_prefs,
+                                  bson_error_t *error)
+{
+   int64_t started;
+   uint32_t server_id;
+
+   started = bson_get_monotonic_time ();
+   server_id = _mongoc_topology_select_server_id (
+      topology, optype, read_prefs, error);
+   mongoc_histogram_server_selection_record (bson_get_monotonic_time () -
+                                             started);
+
+   return server_id;
+}
+
 /*
  *-------------------------------------------------------------------------
  *
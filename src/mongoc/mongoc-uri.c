@@ -33,6 +33,7 @@
 #include "mongoc-uri-private.h"
 #include "mongoc-read-concern-private.h"
 #include "mongoc-write-concern-private.h"
+#include "mongoc-compression-private.h"
 
 
 struct _mongoc_uri_t {
@@ -43,6 +44,7 @@ struct _mongoc_uri_t {
    char *database;
    bson_t options;
    bson_t credentials;
+   bson_t compressors;
    mongoc_read_prefs_t *read_prefs;
    mongoc_read_concern_t *read_concern;
    mongoc_write_concern_t *write_concern;
@@ -573,7 +575,8 @@ mongoc_uri_option_is_int32 (const char *key)
           !strcasecmp (key, "maxidletimems") ||
           !strcasecmp (key, "waitqueuemultiple") ||
           !strcasecmp (key, "waitqueuetimeoutms") ||
-          !strcasecmp (key, "wtimeoutms");
+          !strcasecmp (key, "wtimeoutms") ||
+          !strcasecmp (key, "zlibcompressionlevel");
 }
 
 bool
@@ -652,6 +655,12 @@ mongoc_uri_parse_option (mongoc_uri_t *uri, const char *str)
          goto CLEANUP;
       }
 
+      if (!strcasecmp (key, "zlibcompressionlevel") &&
+          (v_int < -1 || v_int > 9)) {
+         MONGOC_WARNING ("Invalid zlibCompressionLevel: %d", v_int);
+         goto CLEANUP;
+      }
+
       BSON_APPEND_INT32 (&uri->options, key, v_int);
    } else if (!strcasecmp (key, "w")) {
       if (*value == '-' || isdigit (*value)) {
@@ -687,6 +696,10 @@ mongoc_uri_parse_option (mongoc_uri_t *uri, const char *str)
          MONGOC_WARNING ("Cannot set appname: %s is invalid", value);
          goto CLEANUP;
       }
+   } else if (!strcasecmp (key, "compressors")) {
+      if (!mongoc_uri_set_compressors (uri, value)) {
+         goto CLEANUP;
+      }
    } else {
       bson_append_utf8 (&uri->options, key, -1, value, -1);
    }
@@ -1044,6 +1057,7 @@ mongoc_uri_new (const char *uri_string)
    uri = (mongoc_uri_t *) bson_malloc0 (sizeof *uri);
    bson_init (&uri->options);
    bson_init (&uri->credentials);
+   bson_init (&uri->compressors);
 
    /* Initialize read_prefs, since parsing may add to it */
    uri->read_prefs = mongoc_read_prefs_new (MONGOC_READ_PRIMARY);
@@ -1251,6 +1265,56 @@ mongoc_uri_set_appname (mongoc_uri_t *uri, const char *value)
    return true;
 }
 
+bool
+mongoc_uri_set_compressors (mongoc_uri_t *uri, const char *value)
+{
+   const char *end_compressor;
+   char *entry;
+
+   BSON_ASSERT (uri);
+
+   bson_destroy (&uri->compressors);
+   bson_init (&uri->compressors);
+
+   if (value && !bson_utf8_validate (value, strlen (value), false)) {
+      return false;
+   }
+
+   while (value && *value) {
+      if ((end_compressor = strchr (value, ','))) {
+         entry = bson_strndup (value, end_compressor - value);
+         value = end_compressor + 1;
+      } else {
+         entry = bson_strdup (value);
+         value = NULL;
+      }
+
+      if (*entry && _mongoc_compressor_supported (entry)) {
+         mongoc_uri_bson_append_or_replace_key (
+            &uri->compressors,
+            _mongoc_compressor_id_to_name (
+               _mongoc_compressor_name_to_id (entry)),
+            "yes");
+      } else if (*entry) {
+         MONGOC_WARNING ("Unsupported compressor: '%s'", entry);
+      }
+
+      bson_free (entry);
+   }
+
+   return true;
+}
+
+
+const bson_t *
+mongoc_uri_get_compressors (const mongoc_uri_t *uri)
+{
+   BSON_ASSERT (uri);
+
+   return &uri->compressors;
+}
+
+
 const bson_t *
 mongoc_uri_get_options (const mongoc_uri_t *uri)
 {
@@ -1269,6 +1333,7 @@ mongoc_uri_destroy (mongoc_uri_t *uri)
       bson_free (uri->username);
       bson_destroy (&uri->options);
       bson_destroy (&uri->credentials);
+      bson_destroy (&uri->compressors);
       mongoc_read_prefs_destroy (uri->read_prefs);
       mongoc_read_concern_destroy (uri->read_concern);
       mongoc_write_concern_destroy (uri->write_concern);
@@ -1310,6 +1375,7 @@ mongoc_uri_copy (const mongoc_uri_t *uri)
 
    bson_copy_to (&uri->options, &copy->options);
    bson_copy_to (&uri->credentials, &copy->credentials);
+   bson_copy_to (&uri->compressors, &copy->compressors);
 
    return copy;
 }
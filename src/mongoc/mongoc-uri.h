@@ -113,6 +113,10 @@ BSON_EXPORT (const char *)
 mongoc_uri_get_appname (const mongoc_uri_t *uri);
 BSON_EXPORT (bool)
 mongoc_uri_set_appname (mongoc_uri_t *uri, const char *value);
+BSON_EXPORT (bool)
+mongoc_uri_set_compressors (mongoc_uri_t *uri, const char *value);
+BSON_EXPORT (const bson_t *)
+mongoc_uri_get_compressors (const mongoc_uri_t *uri);
 BSON_EXPORT (const char *)
 mongoc_uri_get_auth_mechanism (const mongoc_uri_t *uri);
 BSON_EXPORT (bool)
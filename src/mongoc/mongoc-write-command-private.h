@@ -23,6 +23,7 @@
 
 #include <bson.h>
 
+#include "mongoc-array-private.h"
 #include "mongoc-client.h"
 #include "mongoc-error.h"
 #include "mongoc-write-concern.h"
@@ -86,6 +87,19 @@ typedef struct {
 } mongoc_write_result_t;
 
 
+/* a write command built ahead of time, to be sent on any connection to the
+ * server, then merged into the bulk operation's result in order */
+typedef struct {
+   mongoc_write_command_t *command;
+   uint32_t offset; /* index of the first operation in the bulk */
+   bson_t *cmd;
+   bson_t reply; /* initialized once sent */
+   bson_error_t error;
+   bool sent;
+   bool ok;
+} mongoc_write_batch_t;
+
+
 void
 _mongoc_write_command_destroy (mongoc_write_command_t *command);
 void
@@ -130,6 +144,15 @@ _mongoc_write_command_execute (mongoc_write_command_t *command,
                                const mongoc_write_concern_t *write_concern,
                                uint32_t offset,
                                mongoc_write_result_t *result);
+bool
+_mongoc_write_command_split (mongoc_write_command_t *command,
+                             mongoc_server_stream_t *server_stream,
+                             const char *collection,
+                             const mongoc_write_concern_t *write_concern,
+                             uint32_t offset,
+                             mongoc_array_t *batches);
+void
+_mongoc_write_batch_destroy (mongoc_write_batch_t *batch);
 void
 _mongoc_write_result_init (mongoc_write_result_t *result);
 void
@@ -144,6 +167,9 @@ _mongoc_write_result_merge_legacy (mongoc_write_result_t *result,
                                    int32_t error_api_version,
                                    mongoc_error_code_t default_code,
                                    uint32_t offset);
+void
+_mongoc_write_result_merge_batch (mongoc_write_result_t *result,
+                                  mongoc_write_batch_t *batch);
 bool
 _mongoc_write_result_complete (mongoc_write_result_t *result,
                                int32_t error_api_version,
@@ -297,8 +297,9 @@ _mongoc_monitor_legacy_write (mongoc_client_t *client,
                               mongoc_server_stream_t *stream,
                               int64_t request_id)
 {
-   bson_t doc;
+   bson_t *doc;
    mongoc_apm_command_started_t event;
+   mongoc_arena_mark_t mark;
 
    ENTRY;
 
@@ -306,14 +307,15 @@ _mongoc_monitor_legacy_write (mongoc_client_t *client,
       EXIT;
    }
 
-   bson_init (&doc);
-   _mongoc_write_command_init (&doc, command, collection, write_concern);
+   _mongoc_arena_mark (&client->cluster.arena, &mark);
+   doc = _mongoc_arena_bson_new (&client->cluster.arena);
+   _mongoc_write_command_init (doc, command, collection, write_concern);
 
    /* copy the whole documents buffer as e.g. "updates": [...] */
-   BSON_APPEND_ARRAY (&doc, gCommandFields[command->type], command->documents);
+   BSON_APPEND_ARRAY (doc, gCommandFields[command->type], command->documents);
 
    mongoc_apm_command_started_init (&event,
-                                    &doc,
+                                    doc,
                                     db,
                                     gCommandNames[command->type],
                                     request_id,
@@ -325,7 +327,7 @@ _mongoc_monitor_legacy_write (mongoc_client_t *client,
    client->apm_callbacks.started (&event);
 
    mongoc_apm_command_started_cleanup (&event);
-   bson_destroy (&doc);
+   _mongoc_arena_release (&client->cluster.arena, &mark);
 }
 
 
@@ -1233,8 +1235,9 @@ _mongoc_write_command (mongoc_write_command_t *command,
    uint32_t len = 0;
    bson_t tmp;
    bson_t ar;
-   bson_t cmd;
+   bson_t *cmd;
    bson_t reply;
+   mongoc_arena_mark_t mark;
    char str[16];
    bool has_more;
    bool ret = false;
@@ -1253,8 +1256,6 @@ _mongoc_write_command (mongoc_write_command_t *command,
    BSON_ASSERT (server_stream);
    BSON_ASSERT (collection);
 
-   bson_init (&cmd);
-
    max_bson_obj_size = mongoc_server_stream_max_bson_obj_size (server_stream);
    max_write_batch_size =
       mongoc_server_stream_max_write_batch_size (server_stream);
@@ -1311,14 +1312,18 @@ _mongoc_write_command (mongoc_write_command_t *command,
       EXIT;
    }
 
+   /* the command is released with the mark */
+   _mongoc_arena_mark (&client->cluster.arena, &mark);
+   cmd = _mongoc_arena_bson_new (&client->cluster.arena);
+
 again:
    has_more = false;
    i = 0;
 
-   _mongoc_write_command_init (&cmd, command, collection, write_concern);
+   _mongoc_write_command_init (cmd, command, collection, write_concern);
 
    /* 1 byte to specify array type, 1 byte for field name's null terminator */
-   overhead = cmd.len + 2 + gCommandFieldLens[command->type];
+   overhead = cmd->len + 2 + gCommandFieldLens[command->type];
 
    if (!_mongoc_write_command_will_overflow (overhead,
                                              command->documents->len,
@@ -1326,13 +1331,13 @@ again:
                                              max_bson_obj_size,
                                              max_write_batch_size)) {
       /* copy the whole documents buffer as e.g. "updates": [...] */
-      bson_append_array (&cmd,
+      bson_append_array (cmd,
                          gCommandFields[command->type],
                          gCommandFieldLens[command->type],
                          command->documents);
       i = command->n_documents;
    } else {
-      bson_append_array_begin (&cmd,
+      bson_append_array_begin (cmd,
                                gCommandFields[command->type],
                                gCommandFieldLens[command->type],
                                &ar);
@@ -1368,7 +1373,7 @@ again:
          i++;
       } while (bson_iter_next (&iter));
 
-      bson_append_array_end (&cmd, &ar);
+      bson_append_array_end (cmd, &ar);
    }
 
    if (!i) {
@@ -1380,7 +1385,7 @@ again:
                                                   server_stream,
                                                   MONGOC_QUERY_NONE,
                                                   database,
-                                                  &cmd,
+                                                  cmd,
                                                   &reply,
                                                   error);
 
@@ -1400,11 +1405,11 @@ again:
    }
 
    if (has_more && (ret || !command->flags.ordered) && !result->must_stop) {
-      bson_reinit (&cmd);
+      bson_reinit (cmd);
       GOTO (again);
    }
 
-   bson_destroy (&cmd);
+   _mongoc_arena_release (&client->cluster.arena, &mark);
    EXIT;
 }
 
@@ -1487,6 +1492,187 @@ _mongoc_write_command_execute (
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_write_command_split --
+ *
+ *       Build the write commands that send @command's documents in
+ *       batches within @server_stream's limits, without sending them,
+ *       and append a mongoc_write_batch_t for each to @batches. @offset
+ *       is the index of @command's first document in its bulk operation.
+ *
+ * Returns:
+ *       false, and appends nothing, if @command is empty or one of its
+ *       documents is too large to send. Execute it with
+ *       _mongoc_write_command_execute to report the error.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_write_command_split (mongoc_write_command_t *command,
+                             mongoc_server_stream_t *server_stream,
+                             const char *collection,
+                             const mongoc_write_concern_t *write_concern,
+                             uint32_t offset,
+                             mongoc_array_t *batches)
+{
+   mongoc_write_batch_t batch;
+   const uint8_t *data;
+   bson_iter_t iter;
+   const char *key;
+   uint32_t len = 0;
+   bson_t tmp;
+   bson_t ar;
+   char str[16];
+   bool has_more;
+   uint32_t i;
+   int32_t max_bson_obj_size;
+   int32_t max_write_batch_size;
+   uint32_t overhead;
+   uint32_t key_len;
+   size_t n_batches;
+
+   ENTRY;
+
+   BSON_ASSERT (command);
+   BSON_ASSERT (server_stream);
+   BSON_ASSERT (collection);
+   BSON_ASSERT (batches);
+
+   max_bson_obj_size = mongoc_server_stream_max_bson_obj_size (server_stream);
+   max_write_batch_size =
+      mongoc_server_stream_max_write_batch_size (server_stream);
+
+   n_batches = batches->len;
+
+   if (!command->n_documents || !bson_iter_init (&iter, command->documents)) {
+      RETURN (false);
+   }
+
+   has_more = bson_iter_next (&iter);
+
+   while (has_more) {
+      memset (&batch, 0, sizeof batch);
+      batch.command = command;
+      batch.offset = offset;
+      batch.cmd = bson_new ();
+
+      _mongoc_write_command_init (
+         batch.cmd, command, collection, write_concern);
+
+      /* as in _mongoc_write_command */
+      overhead = batch.cmd->len + 2 + gCommandFieldLens[command->type];
+
+      bson_append_array_begin (batch.cmd,
+                               gCommandFields[command->type],
+                               gCommandFieldLens[command->type],
+                               &ar);
+
+      i = 0;
+
+      do {
+         if (!BSON_ITER_HOLDS_DOCUMENT (&iter)) {
+            BSON_ASSERT (false);
+         }
+
+         bson_iter_document (&iter, &len, &data);
+         key_len = (uint32_t) bson_uint32_to_string (i, &key, str, sizeof str);
+
+         if (_mongoc_write_command_will_overflow (overhead,
+                                                  key_len + len + 2 + ar.len,
+                                                  i,
+                                                  max_bson_obj_size,
+                                                  max_write_batch_size)) {
+            break;
+         }
+
+         if (!bson_init_static (&tmp, data, len)) {
+            BSON_ASSERT (false);
+         }
+
+         BSON_APPEND_DOCUMENT (&ar, key, &tmp);
+         bson_destroy (&tmp);
+
+         i++;
+      } while ((has_more = bson_iter_next (&iter)));
+
+      bson_append_array_end (batch.cmd, &ar);
+
+      if (!i) {
+         /* a document is too large */
+         bson_destroy (batch.cmd);
+
+         while (batches->len > n_batches) {
+            _mongoc_write_batch_destroy (&_mongoc_array_index (
+               batches, mongoc_write_batch_t, batches->len - 1));
+            batches->len--;
+         }
+
+         RETURN (false);
+      }
+
+      _mongoc_array_append_val (batches, batch);
+      offset += i;
+   }
+
+   RETURN (true);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_write_result_merge_batch --
+ *
+ *       Merge the outcome of a batch built by _mongoc_write_command_split
+ *       into @result, like _mongoc_write_command does after sending each
+ *       of its own batches.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_write_result_merge_batch (mongoc_write_result_t *result,
+                                  mongoc_write_batch_t *batch)
+{
+   ENTRY;
+
+   BSON_ASSERT (result);
+   BSON_ASSERT (batch);
+   BSON_ASSERT (batch->sent);
+
+   if (!batch->ok) {
+      result->failed = true;
+      memcpy (&result->error, &batch->error, sizeof (bson_error_t));
+
+      if (bson_empty (&batch->reply)) {
+         /* the roundtrip to the server failed */
+         result->must_stop = true;
+      }
+   }
+
+   _mongoc_write_result_merge (
+      result, batch->command, &batch->reply, batch->offset);
+
+   EXIT;
+}
+
+
+void
+_mongoc_write_batch_destroy (mongoc_write_batch_t *batch)
+{
+   if (batch) {
+      bson_destroy (batch->cmd);
+
+      if (batch->sent) {
+         bson_destroy (&batch->reply);
+      }
+   }
+}
+
+
 void
 _mongoc_write_command_destroy (mongoc_write_command_t *command)
 {
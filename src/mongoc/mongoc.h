@@ -25,6 +25,7 @@
 #include "mongoc-apm.h"
 #include "mongoc-bulk-operation.h"
 #include "mongoc-client.h"
+#include "mongoc-client-async.h"
 #include "mongoc-client-pool.h"
 #include "mongoc-collection.h"
 #include "mongoc-config.h"
@@ -42,6 +43,7 @@
 #include "mongoc-matcher.h"
 #include "mongoc-handshake.h"
 #include "mongoc-opcode.h"
+#include "mongoc-pipeline.h"
 #include "mongoc-log.h"
 #include "mongoc-socket.h"
 #include "mongoc-stream.h"
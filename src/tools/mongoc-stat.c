@@ -24,6 +24,7 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -50,7 +51,14 @@ typedef struct {
    uint32_t n_counters;
    uint32_t infos_offset;
    uint32_t values_offset;
-   uint8_t padding[44];
+   uint32_t n_histograms;
+   uint32_t histogram_infos_offset;
+   uint32_t histograms_offset;
+   uint32_t n_nodes;
+   uint32_t max_nodes;
+   uint32_t node_infos_offset;
+   uint32_t node_values_offset;
+   uint8_t padding[16];
 } mongoc_counters_t;
 #pragma pack()
 
@@ -58,6 +66,30 @@ typedef struct {
 BSON_STATIC_ASSERT (sizeof (mongoc_counters_t) == 64);
 
 
+#pragma pack(1)
+typedef struct {
+   uint32_t offset;
+   uint32_t padding;
+   int64_t rtt_msec;
+   char host[112];
+} mongoc_node_counter_info_t;
+#pragma pack()
+
+
+BSON_STATIC_ASSERT (sizeof (mongoc_node_counter_info_t) == 128);
+
+
+/* the order of a server's counters in each CPU's slots */
+enum {
+   NODE_STREAMS,
+   NODE_BYTES_IN,
+   NODE_BYTES_OUT,
+   NODE_OPS,
+   NODE_ERRORS,
+   NODE_LAST
+};
+
+
 typedef struct {
    int64_t slots[8];
 } mongoc_counter_slots_t;
@@ -71,6 +103,11 @@ typedef struct {
 } mongoc_counter_t;
 
 
+/* a histogram's info has its number of buckets in "slot". each CPU's
+ * buckets follow the previous CPU's. */
+#define MONGOC_HISTOGRAM_MAX_BUCKETS 128
+
+
 static mongoc_counters_t *
 mongoc_counters_new_from_pid (unsigned pid)
 {
@@ -193,6 +230,173 @@ mongoc_counters_print_info (mongoc_counters_t *counters,
 }
 
 
+/* the smallest value counted in bucket @i, see _mongoc_histogram_bucket */
+static int64_t
+mongoc_histogram_bucket_min (uint32_t i)
+{
+   if (i < 4) {
+      return i;
+   }
+
+   return (int64_t) (4 + i % 4) << (i / 4 - 1);
+}
+
+
+/* the largest value counted in the bucket that holds the @p quantile */
+static int64_t
+mongoc_histogram_quantile (const int64_t *buckets,
+                           uint32_t n_buckets,
+                           int64_t count,
+                           double p)
+{
+   int64_t rank;
+   int64_t seen = 0;
+   uint32_t i;
+
+   rank = (int64_t) (p * (double) count + 0.999999);
+   if (rank < 1) {
+      rank = 1;
+   }
+
+   for (i = 0; i < n_buckets; i++) {
+      seen += buckets[i];
+      if (seen >= rank) {
+         break;
+      }
+   }
+
+   if (i + 1 >= n_buckets) {
+      /* the last bucket has no upper bound */
+      return mongoc_histogram_bucket_min (n_buckets - 1);
+   }
+
+   return mongoc_histogram_bucket_min (i + 1) - 1;
+}
+
+
+static void
+mongoc_counters_print_histogram (mongoc_counters_t *counters,
+                                 mongoc_counter_info_t *info,
+                                 FILE *file)
+{
+   int64_t buckets[MONGOC_HISTOGRAM_MAX_BUCKETS] = {0};
+   const int64_t *cpu_buckets;
+   int64_t count = 0;
+   uint32_t n_buckets;
+   unsigned i;
+   uint32_t j;
+
+   BSON_ASSERT (info);
+   BSON_ASSERT (file);
+   BSON_ASSERT ((info->offset & 0x7) == 0);
+
+   n_buckets = BSON_MIN (info->slot, MONGOC_HISTOGRAM_MAX_BUCKETS);
+   if (!n_buckets) {
+      return;
+   }
+
+   for (i = 0; i < counters->n_cpu; i++) {
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wcast-align"
+#endif
+      cpu_buckets = (const int64_t *) (((char *) counters) + info->offset) +
+                    (size_t) i * info->slot;
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+      for (j = 0; j < n_buckets; j++) {
+         buckets[j] += cpu_buckets[j];
+         count += cpu_buckets[j];
+      }
+   }
+
+   fprintf (file,
+            "%24s : %-24s : %-50s : n=%lld",
+            info->category,
+            info->name,
+            info->description,
+            (long long) count);
+
+   if (count) {
+      fprintf (
+         file,
+         " p50=%lld p99=%lld p999=%lld",
+         (long long) mongoc_histogram_quantile (buckets, n_buckets, count, 0.5),
+         (long long) mongoc_histogram_quantile (
+            buckets, n_buckets, count, 0.99),
+         (long long) mongoc_histogram_quantile (
+            buckets, n_buckets, count, 0.999));
+   }
+
+   fprintf (file, "\n");
+}
+
+
+/* one row per server with its counters summed over the CPUs */
+static void
+mongoc_counters_print_nodes (mongoc_counters_t *counters, FILE *file)
+{
+   mongoc_node_counter_info_t *infos;
+   const mongoc_counter_slots_t *cpus;
+   int64_t values[NODE_LAST];
+   uint32_t n_nodes;
+   unsigned i;
+   unsigned j;
+   int k;
+
+   /* zero in segments from older drivers, whose padding is zeroed */
+   n_nodes = counters->n_nodes;
+   if (!n_nodes) {
+      return;
+   }
+
+   infos = (mongoc_node_counter_info_t *) (((char *) counters) +
+                                           counters->node_infos_offset);
+
+   fprintf (file,
+            "%-40s %8s %14s %14s %12s %8s %8s\n",
+            "host",
+            "streams",
+            "bytes in",
+            "bytes out",
+            "ops",
+            "errors",
+            "rtt ms");
+
+   for (i = 0; i < n_nodes; i++) {
+      memset (values, 0, sizeof values);
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wcast-align"
+#endif
+      cpus = (const mongoc_counter_slots_t *) (((char *) counters) +
+                                               infos[i].offset);
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+      for (j = 0; j < counters->n_cpu; j++) {
+         for (k = 0; k < NODE_LAST; k++) {
+            values[k] += cpus[j].slots[k];
+         }
+      }
+
+      fprintf (file,
+               "%-40.40s %8lld %14lld %14lld %12lld %8lld %8lld\n",
+               infos[i].host,
+               (long long) values[NODE_STREAMS],
+               (long long) values[NODE_BYTES_IN],
+               (long long) values[NODE_BYTES_OUT],
+               (long long) values[NODE_OPS],
+               (long long) values[NODE_ERRORS],
+               (long long) infos[i].rtt_msec);
+   }
+}
+
+
 int
 main (int argc, char *argv[])
 {
@@ -200,10 +404,11 @@ main (int argc, char *argv[])
    mongoc_counters_t *counters;
    uint32_t n_counters = 0;
    unsigned i;
+   int interval = 0;
    int pid;
 
-   if (argc != 2) {
-      fprintf (stderr, "usage: %s PID\n", argv[0]);
+   if (argc != 2 && argc != 3) {
+      fprintf (stderr, "usage: %s PID [INTERVAL]\n", argv[0]);
       return 1;
    }
 
@@ -213,11 +418,40 @@ main (int argc, char *argv[])
       return EXIT_FAILURE;
    }
 
+   if (argc == 3) {
+      interval = (int) strtol (argv[2], NULL, 10);
+      if (interval < 1) {
+         fprintf (stderr, "usage: %s PID [INTERVAL]\n", argv[0]);
+         mongoc_counters_destroy (counters);
+         return 1;
+      }
+
+      /* show the servers every INTERVAL seconds until interrupted */
+      for (;;) {
+         printf ("\033[H\033[2J");
+         mongoc_counters_print_nodes (counters, stdout);
+         fflush (stdout);
+         sleep ((unsigned) interval);
+      }
+   }
+
    infos = mongoc_counters_get_infos (counters, &n_counters);
    for (i = 0; i < n_counters; i++) {
       mongoc_counters_print_info (counters, &infos[i], stdout);
    }
 
+   /* zero in segments from older drivers, whose padding is zeroed */
+   infos = (mongoc_counter_info_t *) (((char *) counters) +
+                                      counters->histogram_infos_offset);
+   for (i = 0; i < counters->n_histograms; i++) {
+      mongoc_counters_print_histogram (counters, &infos[i], stdout);
+   }
+
+   if (counters->n_nodes) {
+      printf ("\n");
+      mongoc_counters_print_nodes (counters, stdout);
+   }
+
    mongoc_counters_destroy (counters);
 
    return EXIT_SUCCESS;
@@ -348,6 +348,30 @@ background_mongoc_collection_stats (void *data)
    return NULL;
 }
 
+static void *
+background_mongoc_collection_parallel_scan (void *data)
+{
+   future_t *future = (future_t *) data;
+   future_value_t return_value;
+
+   return_value.type = future_value_size_t_type;
+
+   future_value_set_size_t (
+      &return_value,
+      mongoc_collection_parallel_scan (
+         future_value_get_mongoc_collection_ptr (future_get_param (future, 0)),
+         future_value_get_mongoc_client_ptr_ptr (future_get_param (future, 1)),
+         future_value_get_mongoc_cursor_ptr_ptr (future_get_param (future, 2)),
+         future_value_get_size_t (future_get_param (future, 3)),
+         future_value_get_const_mongoc_read_prefs_ptr (
+            future_get_param (future, 4)),
+         future_value_get_bson_error_ptr (future_get_param (future, 5))));
+
+   future_resolve (future, return_value);
+
+   return NULL;
+}
+
 static void *
 background_mongoc_collection_insert (void *data)
 {
@@ -552,6 +576,24 @@ background_mongoc_gridfs_file_remove (void *data)
    return NULL;
 }
 
+static void *
+background_mongoc_gridfs_file_save (void *data)
+{
+   future_t *future = (future_t *) data;
+   future_value_t return_value;
+
+   return_value.type = future_value_bool_type;
+
+   future_value_set_bool (
+      &return_value,
+      mongoc_gridfs_file_save (
+         future_value_get_mongoc_gridfs_file_ptr (future_get_param (future, 0))));
+
+   future_resolve (future, return_value);
+
+   return NULL;
+}
+
 static void *
 background_mongoc_gridfs_file_seek (void *data)
 {
@@ -1002,6 +1044,36 @@ future_collection_stats (mongoc_collection_ptr collection,
    return future;
 }
 
+future_t *
+future_collection_parallel_scan (mongoc_collection_ptr collection,
+                                 mongoc_client_ptr_ptr clients,
+                                 mongoc_cursor_ptr_ptr cursors,
+                                 size_t max_cursors,
+                                 const_mongoc_read_prefs_ptr read_prefs,
+                                 bson_error_ptr error)
+{
+   future_t *future = future_new (future_value_size_t_type, 6);
+
+   future_value_set_mongoc_collection_ptr (future_get_param (future, 0),
+                                           collection);
+
+   future_value_set_mongoc_client_ptr_ptr (future_get_param (future, 1),
+                                           clients);
+
+   future_value_set_mongoc_cursor_ptr_ptr (future_get_param (future, 2),
+                                           cursors);
+
+   future_value_set_size_t (future_get_param (future, 3), max_cursors);
+
+   future_value_set_const_mongoc_read_prefs_ptr (future_get_param (future, 4),
+                                                 read_prefs);
+
+   future_value_set_bson_error_ptr (future_get_param (future, 5), error);
+
+   future_start (future, background_mongoc_collection_parallel_scan);
+   return future;
+}
+
 future_t *
 future_collection_insert (mongoc_collection_ptr collection,
                           mongoc_insert_flags_t flags,
@@ -1187,6 +1259,17 @@ future_gridfs_file_remove (mongoc_gridfs_file_ptr file, bson_error_ptr error)
    return future;
 }
 
+future_t *
+future_gridfs_file_save (mongoc_gridfs_file_ptr file)
+{
+   future_t *future = future_new (future_value_bool_type, 1);
+
+   future_value_set_mongoc_gridfs_file_ptr (future_get_param (future, 0), file);
+
+   future_start (future, background_mongoc_gridfs_file_save);
+   return future;
+}
+
 future_t *
 future_gridfs_file_seek (mongoc_gridfs_file_ptr file, int64_t delta, int whence)
 {
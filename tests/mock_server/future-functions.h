@@ -158,6 +158,17 @@ future_collection_stats (
    bson_error_ptr error);
 
 
+future_t *
+future_collection_parallel_scan (
+
+   mongoc_collection_ptr collection,
+   mongoc_client_ptr_ptr clients,
+   mongoc_cursor_ptr_ptr cursors,
+   size_t max_cursors,
+   const_mongoc_read_prefs_ptr read_prefs,
+   bson_error_ptr error);
+
+
 future_t *
 future_collection_insert (
 
@@ -235,6 +246,12 @@ future_gridfs_file_remove (
    mongoc_gridfs_file_ptr file, bson_error_ptr error);
 
 
+future_t *
+future_gridfs_file_save (
+
+   mongoc_gridfs_file_ptr file);
+
+
 future_t *
 future_gridfs_file_seek (
 
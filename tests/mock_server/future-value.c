@@ -243,6 +243,21 @@ future_value_get_mongoc_client_ptr (future_value_t *future_value)
    return future_value->mongoc_client_ptr_value;
 }
 
+void
+future_value_set_mongoc_client_ptr_ptr (future_value_t *future_value,
+                                        mongoc_client_ptr_ptr value)
+{
+   future_value->type = future_value_mongoc_client_ptr_ptr_type;
+   future_value->mongoc_client_ptr_ptr_value = value;
+}
+
+mongoc_client_ptr_ptr
+future_value_get_mongoc_client_ptr_ptr (future_value_t *future_value)
+{
+   assert (future_value->type == future_value_mongoc_client_ptr_ptr_type);
+   return future_value->mongoc_client_ptr_ptr_value;
+}
+
 void
 future_value_set_mongoc_collection_ptr (future_value_t *future_value,
                                         mongoc_collection_ptr value)
@@ -273,6 +288,21 @@ future_value_get_mongoc_cursor_ptr (future_value_t *future_value)
    return future_value->mongoc_cursor_ptr_value;
 }
 
+void
+future_value_set_mongoc_cursor_ptr_ptr (future_value_t *future_value,
+                                        mongoc_cursor_ptr_ptr value)
+{
+   future_value->type = future_value_mongoc_cursor_ptr_ptr_type;
+   future_value->mongoc_cursor_ptr_ptr_value = value;
+}
+
+mongoc_cursor_ptr_ptr
+future_value_get_mongoc_cursor_ptr_ptr (future_value_t *future_value)
+{
+   assert (future_value->type == future_value_mongoc_cursor_ptr_ptr_type);
+   return future_value->mongoc_cursor_ptr_ptr_value;
+}
+
 void
 future_value_set_mongoc_database_ptr (future_value_t *future_value,
                                       mongoc_database_ptr value)
@@ -91,12 +91,18 @@ future_get_mongoc_bulk_operation_ptr (future_t *future);
 mongoc_client_ptr
 future_get_mongoc_client_ptr (future_t *future);
 
+mongoc_client_ptr_ptr
+future_get_mongoc_client_ptr_ptr (future_t *future);
+
 mongoc_collection_ptr
 future_get_mongoc_collection_ptr (future_t *future);
 
 mongoc_cursor_ptr
 future_get_mongoc_cursor_ptr (future_t *future);
 
+mongoc_cursor_ptr_ptr
+future_get_mongoc_cursor_ptr_ptr (future_t *future);
+
 mongoc_database_ptr
 future_get_mongoc_database_ptr (future_t *future);
 
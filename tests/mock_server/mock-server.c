@@ -79,6 +79,7 @@ typedef struct {
    mongoc_opcode_t request_opcode;
    mongoc_query_flags_t query_flags;
    int32_t response_to;
+   int32_t compressor_id;
 } reply_t;
 
 
@@ -1685,6 +1686,7 @@ mock_server_reply_multi (request_t *request,
    reply->request_opcode = (mongoc_opcode_t) request->request_rpc.header.opcode;
    reply->query_flags = (mongoc_query_flags_t) request->request_rpc.query.flags;
    reply->response_to = request->request_rpc.header.request_id;
+   reply->compressor_id = request->compressor_id;
 
    q_put (request->replies, reply);
 }
@@ -1706,6 +1708,9 @@ _mock_server_reply_with_stream (mock_server_t *server,
    int i;
    uint8_t *buf;
    uint8_t *ptr;
+   uint8_t *compressed = NULL;
+   mongoc_iovec_t compressed_iov;
+   size_t compressed_len;
    size_t len;
 
    mongoc_reply_flags_t flags = reply->flags;
@@ -1763,8 +1768,18 @@ _mock_server_reply_with_stream (mock_server_t *server,
    r.reply.documents = buf;
    r.reply.documents_len = (uint32_t) len;
 
-   _mongoc_rpc_gather (&r, &ar);
-   _mongoc_rpc_swab_to_le (&r);
+   /* reply the way the client spoke to us */
+   if (reply->compressor_id != -1) {
+      compressed = _mongoc_rpc_compress (
+         &r, reply->compressor_id, -1, &compressed_len);
+      BSON_ASSERT (compressed);
+      compressed_iov.iov_base = (void *) compressed;
+      compressed_iov.iov_len = compressed_len;
+      _mongoc_array_append_val (&ar, compressed_iov);
+   } else {
+      _mongoc_rpc_gather (&r, &ar);
+      _mongoc_rpc_swab_to_le (&r);
+   }
 
    iov = (mongoc_iovec_t *) ar.data;
    iovcnt = (int) ar.len;
@@ -1779,6 +1794,7 @@ _mock_server_reply_with_stream (mock_server_t *server,
 
    bson_string_free (docs_json, true);
    _mongoc_array_destroy (&ar);
+   bson_free (compressed);
    bson_free (buf);
 }
 
@@ -69,6 +69,7 @@ request_new (const mongoc_buffer_t *buffer,
    request->data = data;
    request->data_len = (size_t) msg_len;
    request->replies = replies;
+   request->compressor_id = -1;
 
    if (!_mongoc_rpc_scatter (&request->request_rpc, data, (size_t) msg_len)) {
       MONGOC_WARNING ("%s():%d: %s", BSON_FUNC, __LINE__, "Failed to scatter");
@@ -77,6 +78,30 @@ request_new (const mongoc_buffer_t *buffer,
       return NULL;
    }
 
+   if (BSON_UINT32_FROM_LE (request->request_rpc.header.opcode) ==
+       MONGOC_OPCODE_COMPRESSED) {
+      request->compressor_id = request->request_rpc.compressed.compressor_id;
+      request->compressed_len = (size_t) msg_len;
+      request->data_len =
+         16 + (size_t) BSON_UINT32_FROM_LE (
+                 request->request_rpc.compressed.uncompressed_size);
+      request->data = (uint8_t *) bson_malloc (request->data_len);
+
+      if (!_mongoc_rpc_decompress (
+             &request->request_rpc, request->data, request->data_len) ||
+          !_mongoc_rpc_scatter (
+             &request->request_rpc, request->data, request->data_len)) {
+         MONGOC_WARNING (
+            "%s():%d: %s", BSON_FUNC, __LINE__, "Failed to decompress");
+         bson_free (request->data);
+         bson_free (data);
+         bson_free (request);
+         return NULL;
+      }
+
+      bson_free (data);
+   }
+
    _mongoc_rpc_swab_from_le (&request->request_rpc);
 
    request->opcode = (mongoc_opcode_t) request->request_rpc.header.opcode;
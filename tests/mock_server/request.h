@@ -32,6 +32,8 @@ typedef struct _request_t {
    size_t data_len;
    mongoc_rpc_t request_rpc;
    mongoc_opcode_t opcode; /* copied from rpc for convenience */
+   int32_t compressor_id;  /* -1 unless sent as OP_COMPRESSED */
+   size_t compressed_len;  /* length of the OP_COMPRESSED message */
    struct _mock_server_t *server;
    mongoc_stream_t *client;
    uint16_t client_port;
@@ -8,6 +8,7 @@
 #endif
 
 #include "mongoc-stream-tls.h"
+#include "mongoc-stream-tls-private.h"
 
 #include "ssl-test.h"
 #include "TestSuite.h"
@@ -178,6 +179,7 @@ ssl_test_client (void *ptr)
    mongoc_iovec_t wiov;
    mongoc_iovec_t wiov_many[NUM_IOVECS];
    struct sockaddr_in server_addr = {0};
+   char host_and_port[BSON_HOST_NAME_MAX + 7];
    int len;
    bson_error_t error;
 
@@ -209,8 +211,18 @@ ssl_test_client (void *ptr)
 
    sock_stream = mongoc_stream_socket_new (conn_sock);
    assert (sock_stream);
-   ssl_stream = mongoc_stream_tls_new_with_hostname (
-      sock_stream, data->host, data->client, 1);
+   bson_snprintf (host_and_port,
+                  sizeof host_and_port,
+                  "%s:%hu",
+                  data->host ? data->host : "",
+                  data->server_port);
+   ssl_stream = _mongoc_stream_tls_new_with_hostname_shared (
+      sock_stream,
+      data->host,
+      host_and_port,
+      data->client,
+      1,
+      data->openssl_shared);
    if (!ssl_stream) {
 #ifdef MONGOC_ENABLE_SSL_OPENSSL
       unsigned long err = ERR_get_error ();
@@ -292,6 +304,20 @@ ssl_test (mongoc_ssl_opt_t *client,
           const char *host,
           ssl_test_result_t *client_result,
           ssl_test_result_t *server_result)
+{
+   ssl_test_shared (client, server, host, NULL, client_result, server_result);
+}
+
+
+/* like ssl_test, the client's stream uses @openssl_shared, as a client's
+ * streams use its topology's */
+void
+ssl_test_shared (mongoc_ssl_opt_t *client,
+                 mongoc_ssl_opt_t *server,
+                 const char *host,
+                 struct _mongoc_openssl_shared_t *openssl_shared,
+                 ssl_test_result_t *client_result,
+                 ssl_test_result_t *server_result)
 {
    ssl_test_data_t data = {0};
    mongoc_thread_t threads[2];
@@ -299,6 +325,7 @@ ssl_test (mongoc_ssl_opt_t *client,
 
    data.server = server;
    data.client = client;
+   data.openssl_shared = openssl_shared;
    data.client_result = client_result;
    data.server_result = server_result;
    data.host = host;
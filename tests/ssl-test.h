@@ -2,6 +2,8 @@
 
 #include <mongoc-thread-private.h>
 
+struct _mongoc_openssl_shared_t;
+
 typedef enum ssl_test_behavior {
    SSL_TEST_BEHAVIOR_NORMAL,
    SSL_TEST_BEHAVIOR_HANGUP_AFTER_HANDSHAKE,
@@ -25,6 +27,7 @@ typedef struct ssl_test_result {
 typedef struct ssl_test_data {
    mongoc_ssl_opt_t *client;
    mongoc_ssl_opt_t *server;
+   struct _mongoc_openssl_shared_t *openssl_shared;
    ssl_test_behavior_t behavior;
    int64_t handshake_stall_ms;
    const char *host;
@@ -41,3 +44,11 @@ ssl_test (mongoc_ssl_opt_t *client,
           const char *host,
           ssl_test_result_t *client_result,
           ssl_test_result_t *server_result);
+
+void
+ssl_test_shared (mongoc_ssl_opt_t *client,
+                 mongoc_ssl_opt_t *server,
+                 const char *host,
+                 struct _mongoc_openssl_shared_t *openssl_shared,
+                 ssl_test_result_t *client_result,
+                 ssl_test_result_t *server_result);
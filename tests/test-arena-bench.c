@@ -0,0 +1,202 @@
+/*
+ * Count the heap allocations the driver makes per operation, and the bytes
+ * they request: a find that returns one document, an insert, and a count
+ * with options.
+ *
+ * Usage: test-arena-bench [URI] [ITERATIONS]
+ *
+ * Only public API is used, so the program can be built against an older
+ * driver to compare. The collection test.arena_bench is dropped first.
+ */
+
+#include <mongoc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static int64_t n_allocs;
+static int64_t n_bytes;
+
+
+static void *
+counting_malloc (size_t num_bytes)
+{
+   n_allocs++;
+   n_bytes += (int64_t) num_bytes;
+   return malloc (num_bytes);
+}
+
+
+static void *
+counting_calloc (size_t n_members, size_t num_bytes)
+{
+   n_allocs++;
+   n_bytes += (int64_t) (n_members * num_bytes);
+   return calloc (n_members, num_bytes);
+}
+
+
+static void *
+counting_realloc (void *mem, size_t num_bytes)
+{
+   n_allocs++;
+   n_bytes += (int64_t) num_bytes;
+   return realloc (mem, num_bytes);
+}
+
+
+static void
+counting_free (void *mem)
+{
+   free (mem);
+}
+
+
+typedef void (*op_func_t) (mongoc_collection_t *collection, int i);
+
+
+static void
+op_find (mongoc_collection_t *collection, int i)
+{
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   bson_t filter;
+   bson_t opts;
+
+   bson_init (&filter);
+   BSON_APPEND_INT32 (&filter, "_id", i);
+   bson_init (&opts);
+   BSON_APPEND_INT32 (&opts, "limit", 1);
+   BCON_APPEND (&opts, "projection", "{", "payload", BCON_INT32 (1), "}");
+
+   cursor = mongoc_collection_find_with_opts (collection, &filter, &opts, NULL);
+   if (!mongoc_cursor_next (cursor, &doc)) {
+      fprintf (stderr, "find returned no document\n");
+      abort ();
+   }
+
+   mongoc_cursor_destroy (cursor);
+   bson_destroy (&opts);
+   bson_destroy (&filter);
+}
+
+
+static void
+op_insert (mongoc_collection_t *collection, int i)
+{
+   bson_error_t error;
+   bson_t doc;
+
+   bson_init (&doc);
+   BSON_APPEND_INT32 (&doc, "_id", i);
+   BSON_APPEND_UTF8 (&doc, "payload", "abcdefghijklmnopqrstuvwxyz");
+
+   if (!mongoc_collection_insert (
+          collection, MONGOC_INSERT_NONE, &doc, NULL, &error)) {
+      fprintf (stderr, "insert failed: %s\n", error.message);
+      abort ();
+   }
+
+   bson_destroy (&doc);
+}
+
+
+static void
+op_count (mongoc_collection_t *collection, int i)
+{
+   bson_error_t error;
+   bson_t opts;
+
+   bson_init (&opts);
+   BCON_APPEND (&opts, "readConcern", "{", "level", "local", "}");
+
+   if (mongoc_collection_count_with_opts (
+          collection, MONGOC_QUERY_NONE, NULL, 0, 1, &opts, NULL, &error) <
+       0) {
+      fprintf (stderr, "count failed: %s\n", error.message);
+      abort ();
+   }
+
+   bson_destroy (&opts);
+}
+
+
+/* print the mean allocations and bytes per call of @op, after a warm-up
+ * call */
+static void
+count_allocs (const char *name,
+              mongoc_collection_t *collection,
+              op_func_t op,
+              int first,
+              int iterations)
+{
+   int64_t start_allocs;
+   int64_t start_bytes;
+   int i;
+
+   op (collection, first);
+
+   start_allocs = n_allocs;
+   start_bytes = n_bytes;
+   for (i = 1; i < iterations; i++) {
+      op (collection, first + i);
+   }
+
+   printf ("%8s %16.1f %16.1f\n",
+           name,
+           (double) (n_allocs - start_allocs) / (iterations - 1),
+           (double) (n_bytes - start_bytes) / (iterations - 1));
+}
+
+
+int
+main (int argc, char *argv[])
+{
+   const char *uri_str = "mongodb://localhost/";
+   int iterations = 1000;
+   bson_mem_vtable_t vtable = {counting_malloc,
+                               counting_calloc,
+                               counting_realloc,
+                               counting_free};
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+
+   if (argc > 1) {
+      uri_str = argv[1];
+   }
+
+   if (argc > 2) {
+      iterations = atoi (argv[2]);
+   }
+
+   if (iterations < 2) {
+      fprintf (stderr, "Usage: %s [URI] [ITERATIONS]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   bson_mem_set_vtable (&vtable);
+   mongoc_init ();
+
+   client = mongoc_client_new (uri_str);
+   if (!client) {
+      fprintf (stderr, "Invalid URI: \"%s\"\n", uri_str);
+      return EXIT_FAILURE;
+   }
+
+   collection = mongoc_client_get_collection (client, "test", "arena_bench");
+
+   /* ignore "ns not found" */
+   mongoc_collection_drop (collection, NULL);
+
+   printf ("%8s %16s %16s\n", "op", "allocs/op", "bytes/op");
+   count_allocs ("insert", collection, op_insert, 0, iterations);
+   count_allocs ("find", collection, op_find, 0, iterations);
+   count_allocs ("count", collection, op_count, 0, iterations);
+
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mongoc_cleanup ();
+   bson_mem_restore_vtable ();
+
+   return EXIT_SUCCESS;
+}
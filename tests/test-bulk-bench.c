@@ -0,0 +1,116 @@
+/*
+ * Measure the insert throughput of an unordered bulk operation as the
+ * number of batches sent concurrently grows, with
+ * mongoc_bulk_operation_set_concurrency.
+ *
+ * Usage: test-bulk-bench [URI] [N_DOCS] [MAX_CONCURRENCY]
+ *
+ * Each run drops and refills the collection test.bulk_bench.
+ */
+
+#include <mongoc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static double
+bench_insert (mongoc_client_pool_t *pool, int n_docs, uint32_t concurrency)
+{
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   bson_error_t error;
+   bson_t doc;
+   int64_t start;
+   double elapsed;
+   int i;
+
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "test", "bulk_bench");
+
+   /* ignore "ns not found" */
+   mongoc_collection_drop (collection, NULL);
+
+   bulk = mongoc_collection_create_bulk_operation (collection, false, NULL);
+   mongoc_bulk_operation_set_concurrency (bulk, pool, concurrency);
+
+   for (i = 0; i < n_docs; i++) {
+      bson_init (&doc);
+      BSON_APPEND_INT32 (&doc, "_id", i);
+      BSON_APPEND_UTF8 (&doc, "payload", "abcdefghijklmnopqrstuvwxyz");
+      mongoc_bulk_operation_insert (bulk, &doc);
+      bson_destroy (&doc);
+   }
+
+   start = bson_get_monotonic_time ();
+
+   if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+      fprintf (stderr, "bulk failed: %s\n", error.message);
+      abort ();
+   }
+
+   elapsed = (double) (bson_get_monotonic_time () - start) / 1e6;
+
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+
+   return n_docs / elapsed;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+   const char *uri_str = "mongodb://localhost/";
+   int n_docs = 1000000;
+   int max_concurrency = 16;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool;
+   uint32_t concurrency;
+
+   if (argc > 1) {
+      uri_str = argv[1];
+   }
+
+   if (argc > 2) {
+      n_docs = atoi (argv[2]);
+   }
+
+   if (argc > 3) {
+      max_concurrency = atoi (argv[3]);
+   }
+
+   if (n_docs < 1 || max_concurrency < 1) {
+      fprintf (stderr,
+               "Usage: %s [URI] [N_DOCS] [MAX_CONCURRENCY]\n",
+               argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_init ();
+
+   uri = mongoc_uri_new (uri_str);
+   if (!uri) {
+      fprintf (stderr, "Invalid URI: \"%s\"\n", uri_str);
+      return EXIT_FAILURE;
+   }
+
+   pool = mongoc_client_pool_new (uri);
+
+   printf ("%12s %16s\n", "concurrency", "docs/sec");
+
+   for (concurrency = 1; concurrency <= (uint32_t) max_concurrency;
+        concurrency *= 2) {
+      printf ("%12u %16.0f\n",
+              concurrency,
+              bench_insert (pool, n_docs, concurrency));
+      fflush (stdout);
+   }
+
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+   mongoc_cleanup ();
+
+   return EXIT_SUCCESS;
+}
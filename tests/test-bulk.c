@@ -3347,6 +3347,148 @@ test_bulk_update_one_error_message (void)
 }
 
 
+/* an unordered bulk sends its batches on several pooled connections at once
+ * and merges the replies in order */
+static void
+test_bulk_concurrent (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   future_t *future;
+   request_t *requests[3];
+   bson_t reply;
+   bson_error_t error;
+   int32_t first_id;
+   int i;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1.0,"
+                              " 'ismaster': true,"
+                              " 'minWireVersion': 0,"
+                              " 'maxWireVersion': %d,"
+                              " 'maxWriteBatchSize': 2}",
+                              WIRE_VERSION_WRITE_CMD);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "test", "test");
+   bulk = mongoc_collection_create_bulk_operation (collection, false, NULL);
+   mongoc_bulk_operation_set_concurrency (bulk, pool, 3);
+
+   for (i = 0; i < 6; i++) {
+      mongoc_bulk_operation_insert (bulk, tmp_bson ("{'_id': %d}", i));
+   }
+
+   future = future_bulk_operation_execute (bulk, &reply, &error);
+
+   /* all three batches are in flight before any is answered */
+   for (i = 0; i < 3; i++) {
+      requests[i] = mock_server_receives_command (
+         server,
+         "test",
+         MONGOC_QUERY_NONE,
+         "{'insert': 'test', 'ordered': false, 'documents': [{}, {}]}");
+   }
+
+   for (i = 0; i < 3; i++) {
+      first_id = bson_lookup_int32 (request_get_doc (requests[i], 0),
+                                    "documents.0._id");
+
+      if (first_id == 2) {
+         /* the second document of the second batch is the bulk's 4th */
+         mock_server_replies_simple (
+            requests[i],
+            "{'ok': 1.0, 'n': 1,"
+            " 'writeErrors': [{'index': 1, 'code': 11000, 'errmsg': 'dup'}]}");
+      } else {
+         mock_server_replies_simple (requests[i], "{'ok': 1.0, 'n': 2}");
+      }
+
+      request_destroy (requests[i]);
+   }
+
+   ASSERT (!future_get_uint32_t (future));
+   ASSERT_MATCH (&reply,
+                 "{'nInserted': 5,"
+                 " 'writeErrors': [{'index': 3, 'code': 11000}]}");
+
+   future_destroy (future);
+   bson_destroy (&reply);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+/* with concurrency set, an ordered bulk still sends one batch at a time */
+static void
+test_bulk_concurrent_ordered (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   future_t *future;
+   request_t *request;
+   bson_t reply;
+   bson_error_t error;
+   int i;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1.0,"
+                              " 'ismaster': true,"
+                              " 'minWireVersion': 0,"
+                              " 'maxWireVersion': %d,"
+                              " 'maxWriteBatchSize': 2}",
+                              WIRE_VERSION_WRITE_CMD);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "test", "test");
+   bulk = mongoc_collection_create_bulk_operation (collection, true, NULL);
+   mongoc_bulk_operation_set_concurrency (bulk, pool, 3);
+
+   for (i = 0; i < 4; i++) {
+      mongoc_bulk_operation_insert (bulk, tmp_bson ("{'_id': %d}", i));
+   }
+
+   future = future_bulk_operation_execute (bulk, &reply, &error);
+
+   for (i = 0; i < 2; i++) {
+      request = mock_server_receives_command (
+         server,
+         "test",
+         MONGOC_QUERY_NONE,
+         "{'insert': 'test', 'ordered': true,"
+         " 'documents': [{'_id': %d}, {'_id': %d}]}",
+         2 * i,
+         2 * i + 1);
+
+      mock_server_replies_simple (request, "{'ok': 1.0, 'n': 2}");
+      request_destroy (request);
+   }
+
+   ASSERT_OR_PRINT (future_get_uint32_t (future), error);
+   ASSERT_MATCH (&reply, "{'nInserted': 4}");
+
+   future_destroy (future);
+   bson_destroy (&reply);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
 void
 test_bulk_install (TestSuite *suite)
 {
@@ -3585,4 +3727,8 @@ test_bulk_install (TestSuite *suite)
    TestSuite_Add (suite,
                   "/BulkOperation/update_one/error_message",
                   test_bulk_update_one_error_message);
+   TestSuite_Add (suite, "/BulkOperation/concurrent", test_bulk_concurrent);
+   TestSuite_Add (suite,
+                  "/BulkOperation/concurrent/ordered",
+                  test_bulk_concurrent_ordered);
 }
@@ -0,0 +1,437 @@
+/*
+ * Measure the bytes on the wire and the throughput of large insert and find
+ * batches against the mock server, without compression and with each
+ * compressor this build supports.
+ *
+ * Usage: test-compression-bench [N_DOCS] [ITERATIONS]
+ *
+ * Each iteration inserts N_DOCS documents with one bulk operation, and
+ * finds N_DOCS documents returned in one reply. Bytes are counted in both
+ * directions on the client's stream. The mock server's own work is part of
+ * the time, the same with each compressor.
+ */
+
+#include <mongoc.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mongoc-client-private.h"
+#include "mock_server/mock-server.h"
+
+
+#define PAYLOAD                                                              \
+   "It is a truth universally acknowledged, that a single man in possession " \
+   "of a good fortune, must be in want of a wife."
+
+
+/* the mock server reports to the test framework, which is not linked */
+int64_t
+get_future_timeout_ms (void)
+{
+   return 10 * 1000;
+}
+
+
+void
+test_error (const char *format, ...)
+{
+   va_list ap;
+
+   va_start (ap, format);
+   vfprintf (stderr, format, ap);
+   fprintf (stderr, "\n");
+   fflush (stderr);
+   va_end (ap);
+}
+
+
+void
+test_suite_mock_server_log (const char *msg, ...)
+{
+}
+
+
+typedef struct {
+   mongoc_client_t *client;
+   int64_t bytes_out;
+   int64_t bytes_in;
+} wire_t;
+
+
+typedef struct {
+   mongoc_stream_t vtable;
+   mongoc_stream_t *wrapped;
+   wire_t *wire;
+} counting_stream_t;
+
+
+static void
+counting_stream_destroy (mongoc_stream_t *stream)
+{
+   mongoc_stream_destroy (((counting_stream_t *) stream)->wrapped);
+   bson_free (stream);
+}
+
+
+static int
+counting_stream_close (mongoc_stream_t *stream)
+{
+   return mongoc_stream_close (((counting_stream_t *) stream)->wrapped);
+}
+
+
+static int
+counting_stream_flush (mongoc_stream_t *stream)
+{
+   return mongoc_stream_flush (((counting_stream_t *) stream)->wrapped);
+}
+
+
+static ssize_t
+counting_stream_writev (mongoc_stream_t *stream,
+                        mongoc_iovec_t *iov,
+                        size_t iovcnt,
+                        int32_t timeout_msec)
+{
+   counting_stream_t *counting = (counting_stream_t *) stream;
+   ssize_t r;
+
+   r = mongoc_stream_writev (counting->wrapped, iov, iovcnt, timeout_msec);
+   if (r > 0) {
+      counting->wire->bytes_out += r;
+   }
+
+   return r;
+}
+
+
+static ssize_t
+counting_stream_readv (mongoc_stream_t *stream,
+                       mongoc_iovec_t *iov,
+                       size_t iovcnt,
+                       size_t min_bytes,
+                       int32_t timeout_msec)
+{
+   counting_stream_t *counting = (counting_stream_t *) stream;
+   ssize_t r;
+
+   r = mongoc_stream_readv (
+      counting->wrapped, iov, iovcnt, min_bytes, timeout_msec);
+   if (r > 0) {
+      counting->wire->bytes_in += r;
+   }
+
+   return r;
+}
+
+
+static int
+counting_stream_setsockopt (mongoc_stream_t *stream,
+                            int level,
+                            int optname,
+                            void *optval,
+                            socklen_t optlen)
+{
+   return mongoc_stream_setsockopt (
+      ((counting_stream_t *) stream)->wrapped, level, optname, optval, optlen);
+}
+
+
+static bool
+counting_stream_check_closed (mongoc_stream_t *stream)
+{
+   return mongoc_stream_check_closed (((counting_stream_t *) stream)->wrapped);
+}
+
+
+static mongoc_stream_t *
+counting_stream_get_base_stream (mongoc_stream_t *stream)
+{
+   mongoc_stream_t *wrapped = ((counting_stream_t *) stream)->wrapped;
+
+   if (wrapped->get_base_stream) {
+      return wrapped->get_base_stream (wrapped);
+   }
+
+   return wrapped;
+}
+
+
+static mongoc_stream_t *
+counting_initiator (const mongoc_uri_t *uri,
+                    const mongoc_host_list_t *host,
+                    void *user_data,
+                    bson_error_t *error)
+{
+   wire_t *wire = (wire_t *) user_data;
+   counting_stream_t *counting;
+   mongoc_stream_t *stream;
+
+   stream =
+      mongoc_client_default_stream_initiator (uri, host, wire->client, error);
+   if (!stream) {
+      return NULL;
+   }
+
+   counting = (counting_stream_t *) bson_malloc0 (sizeof *counting);
+   counting->vtable.destroy = counting_stream_destroy;
+   counting->vtable.close = counting_stream_close;
+   counting->vtable.flush = counting_stream_flush;
+   counting->vtable.writev = counting_stream_writev;
+   counting->vtable.readv = counting_stream_readv;
+   counting->vtable.setsockopt = counting_stream_setsockopt;
+   counting->vtable.check_closed = counting_stream_check_closed;
+   counting->vtable.get_base_stream = counting_stream_get_base_stream;
+   counting->wrapped = stream;
+   counting->wire = wire;
+
+   return (mongoc_stream_t *) counting;
+}
+
+
+typedef struct {
+   bson_t *docs;
+   int n_docs;
+} responder_data_t;
+
+
+/* acknowledge inserts, and answer every query with all the documents */
+static bool
+responder (request_t *request, void *data)
+{
+   responder_data_t *responder_data = (responder_data_t *) data;
+   const bson_t *cmd;
+   bson_iter_t iter;
+   bson_iter_t documents;
+   bson_t reply;
+   int32_t n = 0;
+
+   if (request->is_command && !strcmp (request->command_name, "insert")) {
+      cmd = request_get_doc (request, 0);
+      if (bson_iter_init_find (&iter, cmd, "documents") &&
+          bson_iter_recurse (&iter, &documents)) {
+         while (bson_iter_next (&documents)) {
+            n++;
+         }
+      }
+
+      bson_init (&reply);
+      BSON_APPEND_INT32 (&reply, "ok", 1);
+      BSON_APPEND_INT32 (&reply, "n", n);
+      mock_server_reply_multi (request, MONGOC_REPLY_NONE, &reply, 1, 0);
+      bson_destroy (&reply);
+   } else if (request->opcode == MONGOC_OPCODE_QUERY && !request->is_command) {
+      mock_server_reply_multi (request,
+                               MONGOC_REPLY_NONE,
+                               responder_data->docs,
+                               responder_data->n_docs,
+                               0);
+   } else {
+      return false;
+   }
+
+   request_destroy (request);
+   return true;
+}
+
+
+static void
+insert (mongoc_collection_t *collection, const bson_t *docs, int n_docs)
+{
+   mongoc_bulk_operation_t *bulk;
+   bson_error_t error;
+   int i;
+
+   bulk = mongoc_collection_create_bulk_operation (collection, false, NULL);
+
+   for (i = 0; i < n_docs; i++) {
+      mongoc_bulk_operation_insert (bulk, &docs[i]);
+   }
+
+   if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+      fprintf (stderr, "insert failed: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_bulk_operation_destroy (bulk);
+}
+
+
+static void
+find (mongoc_collection_t *collection, int n_docs)
+{
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   bson_error_t error;
+   bson_t filter = BSON_INITIALIZER;
+   int n = 0;
+
+   cursor = mongoc_collection_find_with_opts (collection, &filter, NULL, NULL);
+
+   while (mongoc_cursor_next (cursor, &doc)) {
+      n++;
+   }
+
+   if (mongoc_cursor_error (cursor, &error)) {
+      fprintf (stderr, "find failed: %s\n", error.message);
+      abort ();
+   }
+
+   if (n != n_docs) {
+      fprintf (stderr, "find returned %d of %d documents\n", n, n_docs);
+      abort ();
+   }
+
+   mongoc_cursor_destroy (cursor);
+}
+
+
+static void
+print_result (const char *compressor,
+              const char *op,
+              const wire_t *wire,
+              int iterations,
+              int64_t elapsed_usec)
+{
+   printf ("%-12s %-8s %16.0f %16.0f %12.1f\n",
+           compressor,
+           op,
+           (double) wire->bytes_out / iterations,
+           (double) wire->bytes_in / iterations,
+           iterations / ((double) elapsed_usec / 1e6));
+   fflush (stdout);
+}
+
+
+/* @compressor is a value of the "compressors" URI option, or NULL */
+static void
+bench (const char *compressor, bson_t *docs, int n_docs, int iterations)
+{
+   mock_server_t *server;
+   responder_data_t responder_data;
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   wire_t wire = {0};
+   int64_t start;
+   int i;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1.0,"
+                              " 'ismaster': true,"
+                              " 'minWireVersion': 0,"
+                              " 'maxWireVersion': 3,"
+                              " 'compression': [%s%s%s]}",
+                              compressor ? "'" : "",
+                              compressor ? compressor : "",
+                              compressor ? "'" : "");
+   responder_data.docs = docs;
+   responder_data.n_docs = n_docs;
+   mock_server_autoresponds (server, responder, &responder_data, NULL);
+   mock_server_run (server);
+
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   if (compressor && !mongoc_uri_set_compressors (uri, compressor)) {
+      fprintf (stderr, "Unsupported compressor: \"%s\"\n", compressor);
+      abort ();
+   }
+
+   client = mongoc_client_new_from_uri (uri);
+   wire.client = client;
+   mongoc_client_set_stream_initiator (client, counting_initiator, &wire);
+   collection =
+      mongoc_client_get_collection (client, "test", "compression_bench");
+
+   /* connect and handshake before counting */
+   insert (collection, docs, 1);
+   wire.bytes_out = wire.bytes_in = 0;
+
+   start = bson_get_monotonic_time ();
+   for (i = 0; i < iterations; i++) {
+      insert (collection, docs, n_docs);
+   }
+
+   print_result (compressor ? compressor : "none",
+                 "insert",
+                 &wire,
+                 iterations,
+                 bson_get_monotonic_time () - start);
+
+   wire.bytes_out = wire.bytes_in = 0;
+
+   start = bson_get_monotonic_time ();
+   for (i = 0; i < iterations; i++) {
+      find (collection, n_docs);
+   }
+
+   print_result (compressor ? compressor : "none",
+                 "find",
+                 &wire,
+                 iterations,
+                 bson_get_monotonic_time () - start);
+
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+   int n_docs = 1000;
+   int iterations = 100;
+   bson_t *docs;
+   int i;
+
+   if (argc > 1) {
+      n_docs = atoi (argv[1]);
+   }
+
+   if (argc > 2) {
+      iterations = atoi (argv[2]);
+   }
+
+   if (n_docs < 1 || iterations < 1) {
+      fprintf (stderr, "Usage: %s [N_DOCS] [ITERATIONS]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_init ();
+
+   docs = (bson_t *) bson_malloc0 (n_docs * sizeof (bson_t));
+   for (i = 0; i < n_docs; i++) {
+      bson_init (&docs[i]);
+      BSON_APPEND_INT32 (&docs[i], "_id", i);
+      BSON_APPEND_INT64 (&docs[i], "n", (int64_t) i * 7919);
+      BSON_APPEND_UTF8 (&docs[i], "name", "compression benchmark");
+      BSON_APPEND_UTF8 (&docs[i], "payload", PAYLOAD);
+   }
+
+   printf ("%-12s %-8s %16s %16s %12s\n",
+           "compressor",
+           "op",
+           "bytes out/op",
+           "bytes in/op",
+           "ops/sec");
+
+   bench (NULL, docs, n_docs, iterations);
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+   bench ("snappy", docs, n_docs, iterations);
+#endif
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   bench ("zlib", docs, n_docs, iterations);
+#endif
+
+   for (i = 0; i < n_docs; i++) {
+      bson_destroy (&docs[i]);
+   }
+
+   bson_free (docs);
+   mongoc_cleanup ();
+
+   return EXIT_SUCCESS;
+}
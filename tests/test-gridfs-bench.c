@@ -0,0 +1,192 @@
+/*
+ * Measure GridFS upload throughput: write a new file the default way, which
+ * upserts each chunk and rewrites the files document after each one. Then
+ * write it again with mongoc_gridfs_file_set_batch_size, which inserts the
+ * chunks in batches and writes the files document when the file is saved.
+ *
+ * Then measure download throughput as mongoc_gridfs_file_set_concurrency
+ * lets the file be read ahead on more pooled connections. To simulate a
+ * remote server, add latency to the loopback interface, e.g. on Linux:
+ *
+ *   tc qdisc add dev lo root netem delay 5ms
+ *
+ * and compare e.g. "test-gridfs-bench mongodb://localhost/ 100 0 4", which
+ * downloads 100 MB at concurrency 1, 2 and 4, with and without the delay.
+ *
+ * Usage: test-gridfs-bench [URI] [N_MB] [CHUNK_SIZE] [MAX_CONCURRENCY]
+ *
+ * Each run drops and refills the GridFS bucket "test.gridfs_bench".
+ */
+
+#include <mongoc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static double
+bench_write (mongoc_gridfs_file_t *file, int n_mb)
+{
+   char buf[64 * 1024];
+   mongoc_iovec_t iov;
+   ssize_t r;
+   bson_error_t error;
+   int64_t start;
+   int i;
+
+   memset (buf, 'a', sizeof buf);
+   iov.iov_base = buf;
+   iov.iov_len = sizeof buf;
+
+   start = bson_get_monotonic_time ();
+
+   for (i = 0; i < n_mb * 16; i++) {
+      r = mongoc_gridfs_file_writev (file, &iov, 1, 0);
+      if (r != (ssize_t) sizeof buf) {
+         mongoc_gridfs_file_error (file, &error);
+         fprintf (stderr, "write failed: %s\n", error.message);
+         abort ();
+      }
+   }
+
+   if (!mongoc_gridfs_file_save (file)) {
+      mongoc_gridfs_file_error (file, &error);
+      fprintf (stderr, "save failed: %s\n", error.message);
+      abort ();
+   }
+
+   return n_mb / ((double) (bson_get_monotonic_time () - start) / 1e6);
+}
+
+
+static double
+bench_read (mongoc_gridfs_file_t *file,
+            mongoc_client_pool_t *pool,
+            uint32_t concurrency)
+{
+   char buf[64 * 1024];
+   mongoc_iovec_t iov;
+   ssize_t r;
+   bson_error_t error;
+   int64_t start;
+   int64_t total = 0;
+
+   iov.iov_base = buf;
+   iov.iov_len = sizeof buf;
+
+   mongoc_gridfs_file_seek (file, 0, SEEK_SET);
+   mongoc_gridfs_file_set_concurrency (file, pool, concurrency);
+
+   start = bson_get_monotonic_time ();
+
+   while ((r = mongoc_gridfs_file_readv (file, &iov, 1, sizeof buf, 0)) > 0) {
+      total += r;
+   }
+
+   if (r < 0) {
+      mongoc_gridfs_file_error (file, &error);
+      fprintf (stderr, "read failed: %s\n", error.message);
+      abort ();
+   }
+
+   return (total / (1024.0 * 1024.0)) /
+          ((double) (bson_get_monotonic_time () - start) / 1e6);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+   const char *uri_str = "mongodb://localhost/";
+   int n_mb = 256;
+   int chunk_size = 0;
+   int max_concurrency = 16;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_gridfs_t *gridfs;
+   mongoc_gridfs_file_t *file;
+   mongoc_gridfs_file_opt_t opt = {0};
+   bson_error_t error;
+   uint32_t concurrency;
+
+   if (argc > 1) {
+      uri_str = argv[1];
+   }
+
+   if (argc > 2) {
+      n_mb = atoi (argv[2]);
+   }
+
+   if (argc > 3) {
+      chunk_size = atoi (argv[3]);
+   }
+
+   if (argc > 4) {
+      max_concurrency = atoi (argv[4]);
+   }
+
+   if (n_mb < 1 || chunk_size < 0 || max_concurrency < 1) {
+      fprintf (stderr,
+               "Usage: %s [URI] [N_MB] [CHUNK_SIZE] [MAX_CONCURRENCY]\n",
+               argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_init ();
+
+   uri = mongoc_uri_new (uri_str);
+   if (!uri) {
+      fprintf (stderr, "Invalid URI: \"%s\"\n", uri_str);
+      return EXIT_FAILURE;
+   }
+
+   pool = mongoc_client_pool_new (uri);
+   client = mongoc_client_pool_pop (pool);
+
+   gridfs = mongoc_client_get_gridfs (client, "test", "gridfs_bench", &error);
+   if (!gridfs) {
+      fprintf (stderr, "gridfs failed: %s\n", error.message);
+      return EXIT_FAILURE;
+   }
+
+   /* ignore "ns not found" */
+   mongoc_gridfs_drop (gridfs, NULL);
+
+   opt.filename = "bench";
+   opt.chunk_size = (uint32_t) chunk_size;
+   file = mongoc_gridfs_create_file (gridfs, &opt);
+
+   printf ("%-12s %10.1f MB/s\n", "unbatched", bench_write (file, n_mb));
+   fflush (stdout);
+
+   if (!mongoc_gridfs_file_remove (file, &error)) {
+      fprintf (stderr, "remove failed: %s\n", error.message);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_gridfs_file_destroy (file);
+   file = mongoc_gridfs_create_file (gridfs, &opt);
+   mongoc_gridfs_file_set_batch_size (file, 16 * 1024 * 1024);
+
+   printf ("%-12s %10.1f MB/s\n", "batched", bench_write (file, n_mb));
+   fflush (stdout);
+
+   for (concurrency = 1; concurrency <= (uint32_t) max_concurrency;
+        concurrency *= 2) {
+      printf ("read %-7u %10.1f MB/s\n",
+              concurrency,
+              bench_read (file, pool, concurrency));
+      fflush (stdout);
+   }
+
+   mongoc_gridfs_file_destroy (file);
+   mongoc_gridfs_drop (gridfs, NULL);
+   mongoc_gridfs_destroy (gridfs);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+   mongoc_cleanup ();
+
+   return EXIT_SUCCESS;
+}
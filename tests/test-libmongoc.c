@@ -34,6 +34,8 @@
 #include <strings.h>
 #endif
 
+extern void
+test_arena_install (TestSuite *suite);
 extern void
 test_array_install (TestSuite *suite);
 extern void
@@ -43,6 +45,8 @@ test_buffer_install (TestSuite *suite);
 extern void
 test_bulk_install (TestSuite *suite);
 extern void
+test_client_async_install (TestSuite *suite);
+extern void
 test_client_install (TestSuite *suite);
 extern void
 test_client_max_staleness_install (TestSuite *suite);
@@ -51,8 +55,12 @@ test_client_pool_install (TestSuite *suite);
 extern void
 test_cluster_install (TestSuite *suite);
 extern void
+test_compression_install (TestSuite *suite);
+extern void
 test_collection_install (TestSuite *suite);
 extern void
+test_counters_install (TestSuite *suite);
+extern void
 test_collection_find_install (TestSuite *suite);
 extern void
 test_collection_find_with_opts_install (TestSuite *suite);
@@ -83,12 +91,20 @@ test_matcher_install (TestSuite *suite);
 extern void
 test_handshake_install (TestSuite *suite);
 extern void
+test_pipeline_install (TestSuite *suite);
+extern void
+test_poller_install (TestSuite *suite);
+extern void
 test_queue_install (TestSuite *suite);
 extern void
 test_read_prefs_install (TestSuite *suite);
 extern void
+test_resolver_install (TestSuite *suite);
+extern void
 test_rpc_install (TestSuite *suite);
 extern void
+test_scram_install (TestSuite *suite);
+extern void
 test_sdam_install (TestSuite *suite);
 extern void
 test_sdam_monitoring_install (TestSuite *suite);
@@ -1861,16 +1877,20 @@ main (int argc, char *argv[])
    TestSuite_Init (&suite, "", argc, argv);
    TestSuite_Add (&suite, "/TestSuite/version_cmp", test_version_cmp);
 
+   test_arena_install (&suite);
    test_array_install (&suite);
    test_async_install (&suite);
    test_buffer_install (&suite);
+   test_client_async_install (&suite);
    test_client_install (&suite);
    test_client_max_staleness_install (&suite);
    test_client_pool_install (&suite);
    test_write_command_install (&suite);
    test_bulk_install (&suite);
    test_cluster_install (&suite);
+   test_compression_install (&suite);
    test_collection_install (&suite);
+   test_counters_install (&suite);
    test_collection_find_install (&suite);
    test_collection_find_with_opts_install (&suite);
    test_command_monitoring_install (&suite);
@@ -1886,9 +1906,13 @@ main (int argc, char *argv[])
    test_list_install (&suite);
    test_log_install (&suite);
    test_matcher_install (&suite);
+   test_pipeline_install (&suite);
+   test_poller_install (&suite);
    test_queue_install (&suite);
    test_read_prefs_install (&suite);
+   test_resolver_install (&suite);
    test_rpc_install (&suite);
+   test_scram_install (&suite);
    test_socket_install (&suite);
    test_topology_scanner_install (&suite);
    test_topology_reconcile_install (&suite);
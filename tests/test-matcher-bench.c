@@ -0,0 +1,236 @@
+/*
+ * Time mongoc_matcher_match, which runs the compiled program, against
+ * walking the matcher's op tree as mongoc_matcher_match used to, for
+ * queries like those in example-matcher.c, a change stream filter with
+ * dotted paths and a large $in, and one with $elemMatch, $regex, and $mod.
+ *
+ * Usage: test-matcher-bench [N_DOCS]
+ *
+ * No server is needed.
+ */
+
+#include <bcon.h>
+#include <mongoc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mongoc-matcher-private.h"
+
+
+#define N_QUERIES 4
+
+
+static bson_t *
+make_doc (int i)
+{
+   char ns[32];
+
+   bson_snprintf (ns, sizeof ns, "coll%d", i % 200);
+
+   return BCON_NEW ("_id",
+                    BCON_INT32 (i),
+                    "operationType",
+                    i % 3 ? "update" : "insert",
+                    "ns",
+                    "{",
+                    "db",
+                    "test",
+                    "coll",
+                    BCON_UTF8 (ns),
+                    "}",
+                    "hello",
+                    "[",
+                    "{",
+                    "foo",
+                    i % 2 ? "bar" : "baz",
+                    "}",
+                    "]",
+                    "i",
+                    BCON_INT32 (i % 5 - 2),
+                    "fullDocument",
+                    "{",
+                    "x",
+                    BCON_DOUBLE (i * 0.5),
+                    "tag",
+                    "blue",
+                    "}");
+}
+
+
+static bson_t *
+make_query (int n)
+{
+   bson_t *query;
+   bson_t child;
+   bson_t in;
+   char key[16];
+   char ns[32];
+   int i;
+
+   switch (n) {
+   case 0:
+      return BCON_NEW ("hello.0.foo", BCON_UTF8 ("bar"));
+   case 1:
+      return BCON_NEW ("$or",
+                       "[",
+                       "{",
+                       "i",
+                       "{",
+                       "$gt",
+                       BCON_INT32 (1),
+                       "}",
+                       "}",
+                       "{",
+                       "i",
+                       "{",
+                       "$lt",
+                       BCON_INT32 (-1),
+                       "}",
+                       "}",
+                       "]");
+   case 2:
+      return BCON_NEW ("hello",
+                       "{",
+                       "$elemMatch",
+                       "{",
+                       "foo",
+                       "bar",
+                       "}",
+                       "}",
+                       "ns.coll",
+                       "{",
+                       "$regex",
+                       "^coll1[0-9]$",
+                       "}",
+                       "i",
+                       "{",
+                       "$mod",
+                       "[",
+                       BCON_INT32 (2),
+                       BCON_INT32 (0),
+                       "]",
+                       "}");
+   default:
+      query = BCON_NEW ("operationType",
+                        "update",
+                        "ns.db",
+                        "test",
+                        "fullDocument.tag",
+                        "blue",
+                        "fullDocument.x",
+                        "{",
+                        "$gte",
+                        BCON_INT32 (10),
+                        "}");
+
+      bson_append_document_begin (query, "ns.coll", -1, &child);
+      bson_append_array_begin (&child, "$in", -1, &in);
+      for (i = 0; i < 100; i++) {
+         bson_snprintf (key, sizeof key, "%d", i);
+         bson_snprintf (ns, sizeof ns, "coll%d", i * 2);
+         bson_append_utf8 (&in, key, -1, ns, -1);
+      }
+
+      bson_append_array_end (&child, &in);
+      bson_append_document_end (query, &child);
+
+      return query;
+   }
+}
+
+
+int
+main (int argc, char *argv[])
+{
+   int n_docs = 1000 * 1000;
+   bson_t **docs;
+   bson_t *query;
+   mongoc_matcher_t *matcher;
+   bson_error_t error;
+   int64_t start;
+   double tree_secs;
+   double program_secs;
+   int tree_matches;
+   int program_matches;
+   int i;
+   int q;
+
+   if (argc > 1) {
+      n_docs = atoi (argv[1]);
+   }
+
+   if (n_docs < 1) {
+      fprintf (stderr, "Usage: %s [N_DOCS]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_init ();
+
+   docs = (bson_t **) bson_malloc (n_docs * sizeof (bson_t *));
+   for (i = 0; i < n_docs; i++) {
+      docs[i] = make_doc (i);
+   }
+
+   printf ("%-8s %14s %14s %8s\n",
+           "query",
+           "tree docs/s",
+           "program docs/s",
+           "matches");
+
+   for (q = 0; q < N_QUERIES; q++) {
+      query = make_query (q);
+      matcher = mongoc_matcher_new (query, &error);
+      if (!matcher) {
+         fprintf (stderr, "matcher failed: %s\n", error.message);
+         return EXIT_FAILURE;
+      }
+
+      if (!matcher->program) {
+         fprintf (stderr, "query %d was not compiled\n", q);
+         return EXIT_FAILURE;
+      }
+
+      tree_matches = 0;
+      start = bson_get_monotonic_time ();
+      for (i = 0; i < n_docs; i++) {
+         tree_matches += _mongoc_matcher_op_match (matcher->optree, docs[i]);
+      }
+
+      tree_secs = (double) (bson_get_monotonic_time () - start) / 1e6;
+
+      program_matches = 0;
+      start = bson_get_monotonic_time ();
+      for (i = 0; i < n_docs; i++) {
+         program_matches += mongoc_matcher_match (matcher, docs[i]);
+      }
+
+      program_secs = (double) (bson_get_monotonic_time () - start) / 1e6;
+
+      if (tree_matches != program_matches) {
+         fprintf (stderr,
+                  "query %d: op tree matched %d, program matched %d\n",
+                  q,
+                  tree_matches,
+                  program_matches);
+         return EXIT_FAILURE;
+      }
+
+      printf ("%-8d %14.0f %14.0f %8d\n",
+              q,
+              n_docs / tree_secs,
+              n_docs / program_secs,
+              program_matches);
+
+      mongoc_matcher_destroy (matcher);
+      bson_destroy (query);
+   }
+
+   for (i = 0; i < n_docs; i++) {
+      bson_destroy (docs[i]);
+   }
+
+   bson_free (docs);
+   mongoc_cleanup ();
+
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+#include <mongoc.h>
+
+#include "mongoc-arena-private.h"
+#include "mongoc-client-private.h"
+#include "TestSuite.h"
+
+#include "test-libmongoc.h"
+#include "test-conveniences.h"
+#include "mock_server/future-functions.h"
+#include "mock_server/mock-server.h"
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "arena-test"
+
+
+static void
+test_arena_alloc (void)
+{
+   mongoc_arena_t arena;
+   mongoc_arena_mark_t mark;
+   uint8_t *a;
+   uint8_t *b;
+   uint8_t *c;
+
+   _mongoc_arena_init (&arena);
+   _mongoc_arena_mark (&arena, &mark);
+
+   a = (uint8_t *) _mongoc_arena_alloc (&arena, 1);
+   b = (uint8_t *) _mongoc_arena_alloc (&arena, 100);
+   ASSERT (a && b);
+   ASSERT (a != b);
+   ASSERT_CMPSIZE_T ((size_t) a % 16, ==, (size_t) 0);
+   ASSERT_CMPSIZE_T ((size_t) b % 16, ==, (size_t) 0);
+   memset (a, 'a', 1);
+   memset (b, 'b', 100);
+
+   /* more than a chunk */
+   c = (uint8_t *) _mongoc_arena_alloc (&arena, MONGOC_ARENA_CHUNK_SIZE * 2);
+   memset (c, 'c', MONGOC_ARENA_CHUNK_SIZE * 2);
+   ASSERT_CMPINT (a[0], ==, 'a');
+   ASSERT_CMPINT (b[99], ==, 'b');
+
+   /* space is reused after release */
+   _mongoc_arena_release (&arena, &mark);
+   ASSERT (_mongoc_arena_alloc (&arena, 1) == a);
+   ASSERT (_mongoc_arena_alloc (&arena, 100) == b);
+
+   _mongoc_arena_destroy (&arena);
+}
+
+
+static void
+test_arena_realloc (void)
+{
+   mongoc_arena_t arena;
+   uint8_t *a;
+   uint8_t *b;
+   uint8_t *a2;
+
+   _mongoc_arena_init (&arena);
+
+   a = (uint8_t *) _mongoc_arena_realloc (NULL, 10, &arena);
+   memset (a, 'a', 10);
+
+   /* the latest allocation grows in place */
+   ASSERT (_mongoc_arena_realloc (a, 100, &arena) == a);
+   memset (a, 'a', 100);
+
+   b = (uint8_t *) _mongoc_arena_alloc (&arena, 10);
+
+   /* now "a" is copied */
+   a2 = (uint8_t *) _mongoc_arena_realloc (a, 200, &arena);
+   ASSERT (a2 != a);
+   ASSERT (a2 != b);
+   ASSERT_CMPINT (a2[0], ==, 'a');
+   ASSERT_CMPINT (a2[99], ==, 'a');
+
+   /* shrinking is a no-op */
+   ASSERT (_mongoc_arena_realloc (a2, 1, &arena) == a2);
+
+   _mongoc_arena_destroy (&arena);
+}
+
+
+static void
+test_arena_bson (void)
+{
+   mongoc_arena_t arena;
+   mongoc_arena_mark_t outer;
+   mongoc_arena_mark_t inner;
+   bson_t *cmd;
+   bson_t *cmd2;
+   bson_t *nested;
+   char str[16];
+   const char *key;
+   bson_t ar;
+   bson_t child;
+   uint32_t i;
+
+   _mongoc_arena_init (&arena);
+
+   _mongoc_arena_mark (&arena, &outer);
+   cmd = _mongoc_arena_bson_new (&arena);
+   ASSERT (bson_empty (cmd));
+
+   /* grow past the first chunk */
+   BSON_APPEND_UTF8 (cmd, "insert", "collection");
+   bson_append_array_begin (cmd, "documents", 9, &ar);
+   for (i = 0; i < 1000; i++) {
+      bson_uint32_to_string (i, &key, str, sizeof str);
+      bson_append_document_begin (&ar, key, -1, &child);
+      BSON_APPEND_INT32 (&child, "_id", (int32_t) i);
+      bson_append_document_end (&ar, &child);
+   }
+
+   bson_append_array_end (cmd, &ar);
+   ASSERT_CMPUINT32 (cmd->len, >, (uint32_t) MONGOC_ARENA_CHUNK_SIZE);
+   ASSERT_CMPINT32 (bson_lookup_int32 (cmd, "documents.999._id"), ==, 999);
+
+   /* a nested operation */
+   _mongoc_arena_mark (&arena, &inner);
+   nested = _mongoc_arena_bson_new (&arena);
+   BSON_APPEND_INT32 (nested, "ping", 1);
+   ASSERT_MATCH (nested, "{'ping': 1}");
+   _mongoc_arena_release (&arena, &inner);
+
+   ASSERT_CMPINT32 (bson_lookup_int32 (cmd, "documents.0._id"), ==, 0);
+   ASSERT_CMPINT32 (bson_lookup_int32 (cmd, "documents.999._id"), ==, 999);
+
+   _mongoc_arena_release (&arena, &outer);
+
+   /* the document struct is reused, and starts empty */
+   cmd2 = _mongoc_arena_bson_new (&arena);
+   ASSERT (cmd2 == cmd);
+   ASSERT (bson_empty (cmd2));
+   BSON_APPEND_INT32 (cmd2, "ping", 1);
+   ASSERT_MATCH (cmd2, "{'ping': 1}");
+
+   _mongoc_arena_destroy (&arena);
+}
+
+
+/* a command with opts is copied into the client's arena, and released */
+static void
+test_arena_client_command (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_arena_t *arena;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+   int i;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_READ_CONCERN);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   arena = &client->cluster.arena;
+
+   for (i = 0; i < 2; i++) {
+      future = future_client_read_command_with_opts (
+         client,
+         "db",
+         tmp_bson ("{'count': 'collection'}"),
+         NULL /* prefs */,
+         tmp_bson ("{'readConcern': {'level': 'local'}}"),
+         NULL /* reply */,
+         &error);
+
+      request = mock_server_receives_command (
+         server,
+         "db",
+         MONGOC_QUERY_SLAVE_OK,
+         "{'count': 'collection', 'readConcern': {'level': 'local'}}");
+
+      mock_server_replies_simple (request, "{'ok': 1, 'n': 1}");
+      ASSERT_OR_PRINT (future_get_bool (future), error);
+
+      /* one document, released and then reused */
+      ASSERT_CMPSIZE_T (arena->n_docs, ==, (size_t) 0);
+      ASSERT_CMPSIZE_T (arena->docs.len, ==, (size_t) 1);
+
+      future_destroy (future);
+      request_destroy (request);
+   }
+
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+void
+test_arena_install (TestSuite *suite)
+{
+   TestSuite_Add (suite, "/Arena/alloc", test_arena_alloc);
+   TestSuite_Add (suite, "/Arena/realloc", test_arena_realloc);
+   TestSuite_Add (suite, "/Arena/bson", test_arena_bson);
+   TestSuite_Add (suite, "/Arena/client_command", test_arena_client_command);
+}
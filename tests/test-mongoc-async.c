@@ -5,6 +5,8 @@
 #include "TestSuite.h"
 #include "mock_server/mock-server.h"
 #include "mongoc-errno-private.h"
+#include "mongoc-util-private.h"
+#include "utlist.h"
 
 #undef MONGOC_LOG_DOMAIN
 #define MONGOC_LOG_DOMAIN "async-test"
@@ -19,7 +21,8 @@ struct result {
 
 
 static void
-test_ismaster_helper (mongoc_async_cmd_result_t result,
+test_ismaster_helper (mongoc_async_cmd_t *acmd,
+                      mongoc_async_cmd_result_t result,
                       const bson_t *bson,
                       int64_t rtt_msec,
                       void *data,
@@ -171,10 +174,180 @@ test_ismaster_ssl (void)
 #endif
 
 
+typedef struct {
+   uint16_t port;
+   int64_t initiated_at;
+   mongoc_stream_t *stream;
+} delayed_data_t;
+
+
+static mongoc_stream_t *
+delayed_initiator (mongoc_async_cmd_t *acmd)
+{
+   delayed_data_t *data = (delayed_data_t *) acmd->initiator_ctx;
+   struct sockaddr_in server_addr = {0};
+   mongoc_socket_t *conn_sock;
+
+   conn_sock = mongoc_socket_new (AF_INET, SOCK_STREAM, 0);
+   assert (conn_sock);
+
+   server_addr.sin_family = AF_INET;
+   server_addr.sin_port = htons (data->port);
+   server_addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+   mongoc_socket_connect (
+      conn_sock, (struct sockaddr *) &server_addr, sizeof (server_addr), 0);
+
+   data->initiated_at = bson_get_monotonic_time ();
+   data->stream = mongoc_stream_socket_new (conn_sock);
+
+   return data->stream;
+}
+
+
+/* a delayed command's stream is created when its delay has passed */
+static void
+test_delayed (void)
+{
+   mock_server_t *server;
+   mongoc_async_t *async;
+   delayed_data_t data = {0};
+   struct result result = {0};
+   bson_t q = BSON_INITIALIZER;
+   int64_t start;
+
+   assert (bson_append_int32 (&q, "isMaster", 8, 1));
+
+   server = mock_server_with_autoismaster (3);
+   data.port = mock_server_run (server);
+   async = mongoc_async_new ();
+
+   start = bson_get_monotonic_time ();
+   mongoc_async_cmd_delayed (async,
+                             &delayed_initiator,
+                             &data,
+                             100 /* delay_msec */,
+                             NULL,
+                             NULL,
+                             "admin",
+                             &q,
+                             &test_ismaster_helper,
+                             (void *) &result,
+                             TIMEOUT);
+
+   ASSERT (!data.stream);
+   mongoc_async_run (async, TIMEOUT);
+
+   ASSERT (result.finished);
+   ASSERT_CMPINT (result.max_wire_version, ==, 3);
+   ASSERT_CMPINT64 (data.initiated_at - start, >=, (int64_t) 100 * 1000);
+
+   mongoc_async_destroy (async);
+   mongoc_stream_destroy (data.stream);
+   bson_destroy (&q);
+   mock_server_destroy (server);
+}
+
+
+typedef struct {
+   mongoc_async_t *async;
+   int n_finished;
+} destroy_others_data_t;
+
+
+/* like the scanner disconnecting a node: the first command to finish
+ * destroys the others, which may have events in the same poll */
+static void
+destroy_others_cb (mongoc_async_cmd_t *acmd,
+                   mongoc_async_cmd_result_t result,
+                   const bson_t *bson,
+                   int64_t rtt_msec,
+                   void *data,
+                   bson_error_t *error)
+{
+   destroy_others_data_t *d = (destroy_others_data_t *) data;
+   mongoc_async_cmd_t *other, *tmp;
+
+   ASSERT_CMPINT (result, ==, MONGOC_ASYNC_CMD_SUCCESS);
+   d->n_finished++;
+
+   DL_FOREACH_SAFE (d->async->cmds, other, tmp)
+   {
+      if (other != acmd) {
+         mongoc_async_cmd_destroy (other);
+      }
+   }
+}
+
+
+static void
+test_destroy_others (void)
+{
+   mock_server_t *servers[NSERVERS];
+   mongoc_stream_t *sock_streams[NSERVERS];
+   mongoc_socket_t *conn_sock;
+   struct sockaddr_in server_addr = {0};
+   destroy_others_data_t data;
+   bson_t q = BSON_INITIALIZER;
+   uint16_t port;
+   int i;
+
+   assert (bson_append_int32 (&q, "isMaster", 8, 1));
+
+   data.async = mongoc_async_new ();
+   data.n_finished = 0;
+
+   for (i = 0; i < NSERVERS; i++) {
+      servers[i] = mock_server_with_autoismaster (0);
+      port = mock_server_run (servers[i]);
+
+      conn_sock = mongoc_socket_new (AF_INET, SOCK_STREAM, 0);
+      assert (conn_sock);
+      server_addr.sin_family = AF_INET;
+      server_addr.sin_port = htons (port);
+      server_addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+      ASSERT_CMPINT (mongoc_socket_connect (conn_sock,
+                                            (struct sockaddr *) &server_addr,
+                                            sizeof (server_addr),
+                                            TIMEOUT),
+                     ==,
+                     0);
+
+      sock_streams[i] = mongoc_stream_socket_new (conn_sock);
+      mongoc_async_cmd (data.async,
+                        sock_streams[i],
+                        NULL,
+                        NULL,
+                        "admin",
+                        &q,
+                        &destroy_others_cb,
+                        (void *) &data,
+                        TIMEOUT);
+   }
+
+   /* let every server reply, so their events come in one poll */
+   mongoc_async_run_once (data.async, 0);
+   _mongoc_usleep (100 * 1000);
+   mongoc_async_run (data.async, TIMEOUT);
+
+   ASSERT_CMPINT (data.n_finished, ==, 1);
+   ASSERT_CMPSIZE_T (data.async->ncmds, ==, (size_t) 0);
+
+   mongoc_async_destroy (data.async);
+   bson_destroy (&q);
+
+   for (i = 0; i < NSERVERS; i++) {
+      mock_server_destroy (servers[i]);
+      mongoc_stream_destroy (sock_streams[i]);
+   }
+}
+
+
 void
 test_async_install (TestSuite *suite)
 {
    TestSuite_Add (suite, "/Async/ismaster", test_ismaster);
+   TestSuite_Add (suite, "/Async/delayed", test_delayed);
+   TestSuite_Add (suite, "/Async/destroy_others", test_destroy_others);
 #if defined(MONGOC_ENABLE_SSL_OPENSSL) && !defined(_WIN32)
    TestSuite_Add (suite, "/Async/ismaster_ssl", test_ismaster_ssl);
 #endif
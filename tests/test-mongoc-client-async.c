@@ -0,0 +1,656 @@
+#include <mongoc.h>
+
+#include "mongoc-client-private.h"
+
+#include "mock_server/future-functions.h"
+#include "mock_server/mock-server.h"
+#include "TestSuite.h"
+#include "test-conveniences.h"
+#include "test-libmongoc.h"
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "client-async-test"
+
+
+#define N_RESULTS 3
+
+
+typedef struct {
+   int n_done;
+   bool succeeded[N_RESULTS];
+   bson_t replies[N_RESULTS];
+   bson_error_t errors[N_RESULTS];
+} async_results_t;
+
+
+static void
+async_results_init (async_results_t *results)
+{
+   int i;
+
+   results->n_done = 0;
+   for (i = 0; i < N_RESULTS; i++) {
+      bson_init (&results->replies[i]);
+   }
+}
+
+
+static void
+async_results_cleanup (async_results_t *results)
+{
+   int i;
+
+   for (i = 0; i < N_RESULTS; i++) {
+      bson_destroy (&results->replies[i]);
+   }
+}
+
+
+static void
+_async_cb (bool succeeded,
+           const bson_t *reply,
+           const bson_error_t *error,
+           void *data)
+{
+   async_results_t *results;
+   int i;
+
+   results = (async_results_t *) data;
+   i = results->n_done++;
+   ASSERT_CMPINT (i, <, N_RESULTS);
+
+   results->succeeded[i] = succeeded;
+   bson_concat (&results->replies[i], reply);
+
+   if (succeeded) {
+      ASSERT (!error);
+   } else {
+      ASSERT (error);
+      memcpy (&results->errors[i], error, sizeof (bson_error_t));
+   }
+}
+
+
+/* drive "async" until "n" operations have completed */
+static void
+_run_until (mongoc_client_async_t *async, async_results_t *results, int n)
+{
+   int64_t expire_at;
+
+   expire_at = bson_get_monotonic_time () + 10 * 1000 * 1000;
+
+   while (results->n_done < n) {
+      mongoc_client_async_run (async, 10);
+      ASSERT_CMPINT64 (bson_get_monotonic_time (), <, expire_at);
+   }
+}
+
+
+/* the outcome of one operation, to check which reply each one got */
+typedef struct {
+   bool done;
+   bool succeeded;
+   bson_t reply;
+} async_slot_t;
+
+
+static void
+_async_slot_cb (bool succeeded,
+                const bson_t *reply,
+                const bson_error_t *error,
+                void *data)
+{
+   async_slot_t *slot;
+
+   slot = (async_slot_t *) data;
+   ASSERT (!slot->done);
+
+   slot->done = true;
+   slot->succeeded = succeeded;
+   bson_copy_to (reply, &slot->reply);
+}
+
+
+/* commands on one server are all sent before any is answered, and each
+ * gets its own reply, whatever order the replies come in */
+static void
+test_client_async_pipelined (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_client_async_t *async;
+   async_slot_t slots[N_RESULTS];
+   request_t *requests[N_RESULTS];
+   char reply_json[64];
+   bson_error_t error;
+   int64_t expire_at;
+   int i;
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   async = mongoc_client_async_new (client);
+
+   for (i = 0; i < N_RESULTS; i++) {
+      slots[i].done = false;
+      ASSERT_OR_PRINT (
+         mongoc_client_async_command (async,
+                                      "db",
+                                      tmp_bson ("{'ping': 1, 'i': %d}", i),
+                                      NULL,
+                                      _async_slot_cb,
+                                      &slots[i],
+                                      &error),
+         error);
+   }
+
+   ASSERT_CMPUINT32 (mongoc_client_async_get_pending (async), ==, N_RESULTS);
+   mongoc_client_async_run (async, 0);
+
+   for (i = 0; i < N_RESULTS; i++) {
+      requests[i] = mock_server_receives_command (
+         server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 1, 'i': %d}", i);
+      ASSERT_CMPINT (request_get_client_port (requests[i]),
+                     ==,
+                     request_get_client_port (requests[0]));
+   }
+
+   for (i = N_RESULTS - 1; i >= 0; i--) {
+      bson_snprintf (reply_json, sizeof reply_json, "{'ok': 1, 'n': %d}", i);
+      mock_server_replies_simple (requests[i], reply_json);
+      request_destroy (requests[i]);
+   }
+
+   expire_at = bson_get_monotonic_time () + 10 * 1000 * 1000;
+
+   while (mongoc_client_async_run (async, 10) > 0) {
+      ASSERT_CMPINT64 (bson_get_monotonic_time (), <, expire_at);
+   }
+
+   for (i = 0; i < N_RESULTS; i++) {
+      ASSERT (slots[i].done);
+      ASSERT (slots[i].succeeded);
+      ASSERT_MATCH (&slots[i].reply, "{'ok': 1, 'n': %d}", i);
+      bson_destroy (&slots[i].reply);
+   }
+
+   mongoc_client_async_destroy (async);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_client_async_command_error (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_client_async_t *async;
+   async_results_t results;
+   request_t *request;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   async = mongoc_client_async_new (client);
+   async_results_init (&results);
+
+   ASSERT_OR_PRINT (mongoc_client_async_command (async,
+                                                 "db",
+                                                 tmp_bson ("{'foo': 1}"),
+                                                 NULL,
+                                                 _async_cb,
+                                                 &results,
+                                                 &error),
+                    error);
+
+   mongoc_client_async_run (async, 0);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'foo': 1}");
+   mock_server_replies_simple (request,
+                               "{'ok': 0, 'code': 59, 'errmsg': 'no foo'}");
+   request_destroy (request);
+
+   _run_until (async, &results, 1);
+   ASSERT (!results.succeeded[0]);
+   ASSERT_ERROR_CONTAINS (results.errors[0], MONGOC_ERROR_QUERY, 59, "no foo");
+   ASSERT_MATCH (&results.replies[0], "{'ok': 0, 'errmsg': 'no foo'}");
+
+   async_results_cleanup (&results);
+   mongoc_client_async_destroy (async);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_client_async_find (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_client_async_t *async;
+   async_results_t results;
+   request_t *request;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_FIND_CMD);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   async = mongoc_client_async_new (client);
+   async_results_init (&results);
+
+   ASSERT_OR_PRINT (mongoc_client_async_find (async,
+                                              "db",
+                                              "collection",
+                                              tmp_bson ("{'a': 1}"),
+                                              tmp_bson ("{'limit': 2}"),
+                                              NULL,
+                                              _async_cb,
+                                              &results,
+                                              &error),
+                    error);
+
+   mongoc_client_async_run (async, 0);
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_SLAVE_OK,
+      "{'find': 'collection', 'filter': {'a': 1}, 'limit': 2}");
+   mock_server_replies_simple (request,
+                               "{'ok': 1, 'cursor': {"
+                               "    'id': 0,"
+                               "    'ns': 'db.collection',"
+                               "    'firstBatch': [{'a': 1}]}}");
+   request_destroy (request);
+
+   _run_until (async, &results, 1);
+   ASSERT (results.succeeded[0]);
+   ASSERT_MATCH (&results.replies[0], "{'cursor': {'firstBatch': [{'a': 1}]}}");
+
+   async_results_cleanup (&results);
+   mongoc_client_async_destroy (async);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_client_async_insert (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_client_async_t *async;
+   async_results_t results;
+   request_t *request;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_WRITE_CMD);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   async = mongoc_client_async_new (client);
+   async_results_init (&results);
+
+   ASSERT_OR_PRINT (mongoc_client_async_insert (async,
+                                                "db",
+                                                "collection",
+                                                tmp_bson ("{'a': 1}"),
+                                                NULL,
+                                                _async_cb,
+                                                &results,
+                                                &error),
+                    error);
+
+   mongoc_client_async_run (async, 0);
+
+   /* an _id is generated */
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_NONE,
+      "{'insert': 'collection',"
+      " 'documents': [{'_id': {'$exists': true}, 'a': 1}],"
+      " 'ordered': true}");
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 1}");
+   request_destroy (request);
+
+   _run_until (async, &results, 1);
+   ASSERT (results.succeeded[0]);
+   ASSERT_MATCH (&results.replies[0], "{'nInserted': 1, 'writeErrors': []}");
+
+   async_results_cleanup (&results);
+   mongoc_client_async_destroy (async);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+/* a network error fails every operation in flight on the connection; the
+ * next operation reconnects */
+static void
+test_client_async_hangup (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_client_async_t *async;
+   async_results_t results;
+   request_t *requests[2];
+   request_t *request;
+   bson_error_t error;
+   int i;
+
+   capture_logs (true);
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   async = mongoc_client_async_new (client);
+   async_results_init (&results);
+
+   for (i = 0; i < 2; i++) {
+      ASSERT_OR_PRINT (
+         mongoc_client_async_command (async,
+                                      "db",
+                                      tmp_bson ("{'ping': 1, 'i': %d}", i),
+                                      NULL,
+                                      _async_cb,
+                                      &results,
+                                      &error),
+         error);
+   }
+
+   mongoc_client_async_run (async, 0);
+
+   for (i = 0; i < 2; i++) {
+      requests[i] = mock_server_receives_command (
+         server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 1, 'i': %d}", i);
+   }
+
+   mock_server_hangs_up (requests[0]);
+   request_destroy (requests[0]);
+   request_destroy (requests[1]);
+
+   _run_until (async, &results, 2);
+
+   for (i = 0; i < 2; i++) {
+      ASSERT (!results.succeeded[i]);
+      ASSERT_CMPINT (results.errors[i].domain, ==, MONGOC_ERROR_STREAM);
+   }
+
+   ASSERT_OR_PRINT (mongoc_client_async_command (async,
+                                                 "db",
+                                                 tmp_bson ("{'ping': 2}"),
+                                                 NULL,
+                                                 _async_cb,
+                                                 &results,
+                                                 &error),
+                    error);
+
+   mongoc_client_async_run (async, 0);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 2}");
+   mock_server_replies_ok_and_destroys (request);
+
+   _run_until (async, &results, 3);
+   ASSERT (results.succeeded[2]);
+
+   async_results_cleanup (&results);
+   mongoc_client_async_destroy (async);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+/* the client's own operations don't use the async object's connection */
+static void
+test_client_async_own_connection (void)
+{
+   mock_server_t *server;
+   future_t *future;
+   mongoc_client_t *client;
+   mongoc_client_async_t *async;
+   async_results_t results;
+   request_t *async_request;
+   request_t *request;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   async = mongoc_client_async_new (client);
+   async_results_init (&results);
+
+   ASSERT_OR_PRINT (mongoc_client_async_command (async,
+                                                 "db",
+                                                 tmp_bson ("{'ping': 1}"),
+                                                 NULL,
+                                                 _async_cb,
+                                                 &results,
+                                                 &error),
+                    error);
+
+   mongoc_client_async_run (async, 0);
+   async_request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+
+   /* a synchronous command while the async one awaits its reply */
+   future = future_client_command_simple (
+      client, "db", tmp_bson ("{'ping': 2}"), NULL, NULL, &error);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 2}");
+   ASSERT_CMPINT (request_get_client_port (request),
+                  !=,
+                  request_get_client_port (async_request));
+   mock_server_replies_ok_and_destroys (request);
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+   future_destroy (future);
+
+   mock_server_replies_simple (async_request, "{'ok': 1, 'n': 1}");
+   request_destroy (async_request);
+
+   _run_until (async, &results, 1);
+   ASSERT (results.succeeded[0]);
+   ASSERT_MATCH (&results.replies[0], "{'ok': 1, 'n': 1}");
+
+   async_results_cleanup (&results);
+   mongoc_client_async_destroy (async);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+/* socketTimeoutMS=0 means operations never time out */
+static void
+test_client_async_no_timeout (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_client_async_t *async;
+   async_results_t results;
+   request_t *request;
+   bson_error_t error;
+   int i;
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   client->cluster.sockettimeoutms = 0;
+   async = mongoc_client_async_new (client);
+   async_results_init (&results);
+
+   ASSERT_OR_PRINT (mongoc_client_async_command (async,
+                                                 "db",
+                                                 tmp_bson ("{'ping': 1}"),
+                                                 NULL,
+                                                 _async_cb,
+                                                 &results,
+                                                 &error),
+                    error);
+
+   mongoc_client_async_run (async, 0);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+
+   for (i = 0; i < 3; i++) {
+      ASSERT_CMPUINT32 (mongoc_client_async_run (async, 10), ==, 1);
+   }
+
+   ASSERT_CMPINT (results.n_done, ==, 0);
+   mock_server_replies_ok_and_destroys (request);
+
+   _run_until (async, &results, 1);
+   ASSERT (results.succeeded[0]);
+
+   async_results_cleanup (&results);
+   mongoc_client_async_destroy (async);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+/* an operation that times out fails alone: its late reply is discarded and
+ * the connection goes on working */
+static void
+test_client_async_timeout (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_client_async_t *async;
+   async_results_t results;
+   request_t *request;
+   uint16_t port;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   client->cluster.sockettimeoutms = 100;
+   async = mongoc_client_async_new (client);
+   async_results_init (&results);
+
+   ASSERT_OR_PRINT (mongoc_client_async_command (async,
+                                                 "db",
+                                                 tmp_bson ("{'ping': 1}"),
+                                                 NULL,
+                                                 _async_cb,
+                                                 &results,
+                                                 &error),
+                    error);
+
+   mongoc_client_async_run (async, 0);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+
+   _run_until (async, &results, 1);
+   ASSERT (!results.succeeded[0]);
+   ASSERT_ERROR_CONTAINS (results.errors[0],
+                          MONGOC_ERROR_STREAM,
+                          MONGOC_ERROR_STREAM_SOCKET,
+                          "socket timeout");
+
+   port = request_get_client_port (request);
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 1}");
+   request_destroy (request);
+
+   ASSERT_OR_PRINT (mongoc_client_async_command (async,
+                                                 "db",
+                                                 tmp_bson ("{'ping': 2}"),
+                                                 NULL,
+                                                 _async_cb,
+                                                 &results,
+                                                 &error),
+                    error);
+
+   mongoc_client_async_run (async, 0);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 2}");
+   ASSERT_CMPINT (request_get_client_port (request), ==, port);
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 2}");
+   request_destroy (request);
+
+   _run_until (async, &results, 2);
+   ASSERT (results.succeeded[1]);
+   ASSERT_MATCH (&results.replies[1], "{'ok': 1, 'n': 2}");
+
+   async_results_cleanup (&results);
+   mongoc_client_async_destroy (async);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+/* destroying the async object cancels pending operations silently */
+static void
+test_client_async_destroy_pending (void)
+{
+   mock_server_t *server;
+   future_t *future;
+   mongoc_client_t *client;
+   mongoc_client_async_t *async;
+   async_results_t results;
+   request_t *request;
+   bson_error_t error;
+   int i;
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   async = mongoc_client_async_new (client);
+   async_results_init (&results);
+
+   for (i = 0; i < 2; i++) {
+      ASSERT_OR_PRINT (
+         mongoc_client_async_command (async,
+                                      "db",
+                                      tmp_bson ("{'ping': 1, 'i': %d}", i),
+                                      NULL,
+                                      _async_cb,
+                                      &results,
+                                      &error),
+         error);
+   }
+
+   mongoc_client_async_run (async, 0);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 1, 'i': 0}");
+
+   mongoc_client_async_destroy (async);
+   ASSERT_CMPINT (results.n_done, ==, 0);
+   request_destroy (request);
+
+   /* the client still works, on a new connection */
+   future = future_client_command_simple (
+      client, "db", tmp_bson ("{'ping': 2}"), NULL, NULL, &error);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 2}");
+   mock_server_replies_ok_and_destroys (request);
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+   future_destroy (future);
+
+   async_results_cleanup (&results);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+void
+test_client_async_install (TestSuite *suite)
+{
+   TestSuite_Add (
+      suite, "/ClientAsync/pipelined", test_client_async_pipelined);
+   TestSuite_Add (
+      suite, "/ClientAsync/command_error", test_client_async_command_error);
+   TestSuite_Add (suite, "/ClientAsync/find", test_client_async_find);
+   TestSuite_Add (suite, "/ClientAsync/insert", test_client_async_insert);
+   TestSuite_Add (suite, "/ClientAsync/hangup", test_client_async_hangup);
+   TestSuite_Add (suite,
+                  "/ClientAsync/own_connection",
+                  test_client_async_own_connection);
+   TestSuite_Add (
+      suite, "/ClientAsync/no_timeout", test_client_async_no_timeout);
+   TestSuite_Add (suite, "/ClientAsync/timeout", test_client_async_timeout);
+   TestSuite_Add (suite,
+                  "/ClientAsync/destroy_pending",
+                  test_client_async_destroy_pending);
+}
@@ -1,10 +1,35 @@
 #include <mongoc.h>
 #include "mongoc-client-pool-private.h"
+#include "mongoc-client-private.h"
 #include "mongoc-array-private.h"
+#include "mongoc-counters-private.h"
+#include "mongoc-thread-private.h"
+#include "mongoc-util-private.h"
 
 
 #include "TestSuite.h"
 #include "test-libmongoc.h"
+#include "test-conveniences.h"
+#include "mock_server/future-functions.h"
+#include "mock_server/mock-server.h"
+
+
+#define COUNTER_VALUE(ident) \
+   counter_value (&__mongoc_counter_##ident, COUNTER_##ident)
+
+
+static int64_t
+counter_value (mongoc_counter_t *counter, int num)
+{
+   int64_t value = 0;
+   unsigned i;
+
+   for (i = 0; i < _mongoc_get_cpu_count (); i++) {
+      value += counter->cpus[i].slots[num % SLOTS_PER_CACHELINE];
+   }
+
+   return value;
+}
 
 
 static void
@@ -134,6 +159,57 @@ test_mongoc_client_pool_min_size_dispose (void)
    mongoc_uri_destroy (uri);
 }
 
+static void *
+push_client_thread (void *data)
+{
+   void **args = (void **) data;
+
+   mongoc_client_pool_push ((mongoc_client_pool_t *) args[0],
+                            (mongoc_client_t *) args[1]);
+
+   return NULL;
+}
+
+/* past minPoolSize, a push destroys the least recently used client of its
+ * own shard. clients idle alone in other shards are destroyed once they pass
+ * minPoolSize by more than the number of shards, at most 64 */
+static void
+test_mongoc_client_pool_min_size_dispose_shards (void)
+{
+   mongoc_client_pool_t *pool;
+   mongoc_uri_t *uri;
+   mongoc_client_t *clients[100];
+   mongoc_thread_t thread;
+   void *args[2];
+   int i;
+
+   uri = mongoc_uri_new ("mongodb://127.0.0.1?minpoolsize=1&maxpoolsize=100");
+   pool = mongoc_client_pool_new (uri);
+
+   for (i = 0; i < 100; i++) {
+      clients[i] = mongoc_client_pool_pop (pool);
+      assert (clients[i]);
+   }
+
+   /* each client goes idle from another thread, maybe in another shard */
+   for (i = 0; i < 100; i++) {
+      args[0] = pool;
+      args[1] = clients[i];
+      ASSERT_CMPINT (mongoc_thread_create (&thread, push_client_thread, args),
+                     ==,
+                     0);
+      ASSERT_CMPINT (mongoc_thread_join (thread), ==, 0);
+   }
+
+   ASSERT_CMPSIZE_T (mongoc_client_pool_num_pushed (pool), <=, (size_t) 65);
+   ASSERT_CMPSIZE_T (mongoc_client_pool_get_size (pool),
+                     ==,
+                     mongoc_client_pool_num_pushed (pool));
+
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+}
+
 static void
 test_mongoc_client_pool_set_max_size (void)
 {
@@ -272,6 +348,313 @@ test_mongoc_client_pool_handshake (void)
    mongoc_client_pool_destroy (pool);
 }
 
+
+static void
+wait_for_warm_clients (mongoc_client_pool_t *pool, size_t n)
+{
+   int64_t expire_at;
+
+   expire_at = bson_get_monotonic_time () + 10 * 1000 * 1000;
+
+   while (_mongoc_client_pool_num_warm (pool) < n) {
+      if (bson_get_monotonic_time () > expire_at) {
+         test_error ("timed out waiting for %d warm clients", (int) n);
+      }
+
+      _mongoc_usleep (10 * 1000);
+   }
+}
+
+
+/* the warmer connects minPoolSize clients, and reconnects a client that
+ * was pushed after losing its connection */
+static void
+test_mongoc_client_pool_warm (void)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+   int64_t warm;
+   int64_t cold;
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   ASSERT (mongoc_uri_set_option_as_int32 (uri, "minPoolSize", 2));
+   pool = mongoc_client_pool_new (uri);
+
+   mongoc_client_pool_warm (pool);
+   wait_for_warm_clients (pool, 2);
+   ASSERT_CMPSIZE_T (mongoc_client_pool_get_size (pool), ==, (size_t) 2);
+
+   warm = COUNTER_VALUE (client_pools_warm_checkouts);
+   cold = COUNTER_VALUE (client_pools_cold_checkouts);
+
+   client = mongoc_client_pool_pop (pool);
+   future = future_client_command_simple (
+      client, "admin", tmp_bson ("{'ping': 1}"), NULL, NULL, &error);
+   request = mock_server_receives_command (
+      server, "admin", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+   mock_server_replies_simple (request, "{'ok': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+
+   /* no need to connect or authenticate */
+   ASSERT_CMPINT64 (COUNTER_VALUE (client_pools_warm_checkouts), ==, warm + 1);
+   ASSERT_CMPINT64 (COUNTER_VALUE (client_pools_cold_checkouts), ==, cold);
+
+   future_destroy (future);
+   request_destroy (request);
+
+   /* counted once per checkout, not per operation */
+   future = future_client_command_simple (
+      client, "admin", tmp_bson ("{'ping': 1}"), NULL, NULL, &error);
+   request = mock_server_receives_command (
+      server, "admin", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+   mock_server_replies_simple (request, "{'ok': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+   ASSERT_CMPINT64 (COUNTER_VALUE (client_pools_warm_checkouts), ==, warm + 1);
+
+   future_destroy (future);
+   request_destroy (request);
+
+   /* as if a network error happened */
+   mongoc_cluster_disconnect_node (&client->cluster, 1);
+   mongoc_client_pool_push (pool, client);
+   wait_for_warm_clients (pool, 2);
+   ASSERT_CMPSIZE_T (mongoc_client_pool_get_size (pool), ==, (size_t) 2);
+
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
+typedef struct {
+   mongoc_client_t *client;
+   mongoc_mutex_t mutex;
+   mongoc_cond_t cond;
+   bool block;
+   int n_blocked;
+} blocking_initiator_t;
+
+
+static mongoc_stream_t *
+blocking_initiator (const mongoc_uri_t *uri,
+                    const mongoc_host_list_t *host,
+                    void *user_data,
+                    bson_error_t *err)
+{
+   blocking_initiator_t *data = (blocking_initiator_t *) user_data;
+
+   mongoc_mutex_lock (&data->mutex);
+   if (data->block) {
+      data->n_blocked++;
+      while (data->block) {
+         mongoc_cond_wait (&data->cond, &data->mutex);
+      }
+   }
+   mongoc_mutex_unlock (&data->mutex);
+
+   return mongoc_client_default_stream_initiator (uri, host, data->client, err);
+}
+
+
+/* destroy does not wait for the warmer's connection attempt, the warmer
+ * frees the pool once the attempt ends */
+static void
+test_mongoc_client_pool_warm_destroy (void)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   blocking_initiator_t data = {0};
+   future_t *future;
+   request_t *request;
+   bson_error_t error;
+   int64_t disposed;
+   int64_t expire_at;
+   int n_blocked;
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   ASSERT (mongoc_uri_set_option_as_int32 (uri, "minPoolSize", 1));
+   pool = mongoc_client_pool_new (uri);
+
+   data.client = mongoc_client_new_from_uri (uri);
+   mongoc_mutex_init (&data.mutex);
+   mongoc_cond_init (&data.cond);
+   _mongoc_client_pool_set_stream_initiator (pool, blocking_initiator, &data);
+
+   /* discover the server, then return a client that is not connected */
+   client = mongoc_client_pool_pop (pool);
+   future = future_client_command_simple (
+      client, "admin", tmp_bson ("{'ping': 1}"), NULL, NULL, &error);
+   request = mock_server_receives_command (
+      server, "admin", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+   mock_server_replies_simple (request, "{'ok': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+   future_destroy (future);
+   request_destroy (request);
+
+   mongoc_cluster_disconnect_node (&client->cluster, 1);
+   mongoc_client_pool_push (pool, client);
+
+   mongoc_mutex_lock (&data.mutex);
+   data.block = true;
+   mongoc_mutex_unlock (&data.mutex);
+
+   mongoc_client_pool_warm (pool);
+
+   expire_at = bson_get_monotonic_time () + 10 * 1000 * 1000;
+   do {
+      if (bson_get_monotonic_time () > expire_at) {
+         test_error ("timed out waiting for the warmer to connect");
+      }
+
+      _mongoc_usleep (10 * 1000);
+      mongoc_mutex_lock (&data.mutex);
+      n_blocked = data.n_blocked;
+      mongoc_mutex_unlock (&data.mutex);
+   } while (!n_blocked);
+
+   disposed = COUNTER_VALUE (client_pools_disposed);
+   mongoc_client_pool_destroy (pool);
+   ASSERT_CMPINT64 (COUNTER_VALUE (client_pools_disposed), ==, disposed);
+
+   mongoc_mutex_lock (&data.mutex);
+   data.block = false;
+   mongoc_cond_broadcast (&data.cond);
+   mongoc_mutex_unlock (&data.mutex);
+
+   expire_at = bson_get_monotonic_time () + 10 * 1000 * 1000;
+   while (COUNTER_VALUE (client_pools_disposed) == disposed) {
+      if (bson_get_monotonic_time () > expire_at) {
+         test_error ("timed out waiting for the warmer to free the pool");
+      }
+
+      _mongoc_usleep (10 * 1000);
+   }
+
+   mongoc_client_destroy (data.client);
+   mongoc_mutex_destroy (&data.mutex);
+   mongoc_cond_destroy (&data.cond);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
+#define POOL_BENCH_THREADS 16
+
+typedef struct {
+   mongoc_client_pool_t *pool;
+   int iterations;
+   volatile int32_t checked_out;
+   volatile int32_t max_checked_out;
+} pool_bench_t;
+
+
+static void *
+pool_bench_thread (void *data)
+{
+   pool_bench_t *bench = (pool_bench_t *) data;
+   mongoc_client_t *client;
+   int32_t n;
+   int i;
+
+   for (i = 0; i < bench->iterations; i++) {
+      client = mongoc_client_pool_pop (bench->pool);
+      ASSERT (client);
+
+      n = bson_atomic_int_add (&bench->checked_out, 1);
+      /* racy, but only ever raises the recorded maximum */
+      if (n > bench->max_checked_out) {
+         bench->max_checked_out = n;
+      }
+
+      bson_atomic_int_add (&bench->checked_out, -1);
+      mongoc_client_pool_push (bench->pool, client);
+   }
+
+   return NULL;
+}
+
+
+/* many threads check clients out and in. set MONGOC_TEST_POOL_BENCH_ITERS
+ * to run longer and print the throughput. */
+static void
+_test_mongoc_client_pool_checkout_checkin (int32_t max_pool_size)
+{
+   mongoc_thread_t threads[POOL_BENCH_THREADS];
+   pool_bench_t bench = {0};
+   mongoc_uri_t *uri;
+   int64_t iterations;
+   int64_t start;
+   int64_t usec;
+   int i;
+   int r;
+
+   iterations = test_framework_getenv_int64 ("MONGOC_TEST_POOL_BENCH_ITERS", 0);
+
+   uri = mongoc_uri_new ("mongodb://127.0.0.1");
+   ASSERT (mongoc_uri_set_option_as_int32 (uri, "maxPoolSize", max_pool_size));
+   bench.pool = mongoc_client_pool_new (uri);
+   bench.iterations = iterations ? (int) iterations : 1000;
+
+   start = bson_get_monotonic_time ();
+
+   for (i = 0; i < POOL_BENCH_THREADS; i++) {
+      r = mongoc_thread_create (&threads[i], pool_bench_thread, &bench);
+      ASSERT_CMPINT (r, ==, 0);
+   }
+
+   for (i = 0; i < POOL_BENCH_THREADS; i++) {
+      mongoc_thread_join (threads[i]);
+   }
+
+   usec = bson_get_monotonic_time () - start;
+
+   ASSERT_CMPINT (bench.checked_out, ==, 0);
+   ASSERT_CMPINT (bench.max_checked_out, <=, max_pool_size);
+   ASSERT_CMPSIZE_T (
+      mongoc_client_pool_get_size (bench.pool), <=, (size_t) max_pool_size);
+   ASSERT_CMPSIZE_T (mongoc_client_pool_num_pushed (bench.pool),
+                     ==,
+                     mongoc_client_pool_get_size (bench.pool));
+
+   if (iterations) {
+      printf ("maxPoolSize %d, %d threads: %.0f checkouts/sec\n",
+              max_pool_size,
+              POOL_BENCH_THREADS,
+              (double) POOL_BENCH_THREADS * bench.iterations * 1e6 /
+                 (double) BSON_MAX (usec, 1));
+   }
+
+   mongoc_client_pool_destroy (bench.pool);
+   mongoc_uri_destroy (uri);
+}
+
+
+static void
+test_mongoc_client_pool_checkout_checkin_contended (void)
+{
+   /* fewer clients than threads: exercises the blocking slow path */
+   _test_mongoc_client_pool_checkout_checkin (4);
+}
+
+
+static void
+test_mongoc_client_pool_checkout_checkin (void)
+{
+   _test_mongoc_client_pool_checkout_checkin (100);
+}
+
+
 void
 test_client_pool_install (TestSuite *suite)
 {
@@ -284,6 +667,9 @@ test_client_pool_install (TestSuite *suite)
    TestSuite_Add (suite,
                   "/ClientPool/min_size_dispose",
                   test_mongoc_client_pool_min_size_dispose);
+   TestSuite_Add (suite,
+                  "/ClientPool/min_size_dispose/shards",
+                  test_mongoc_client_pool_min_size_dispose_shards);
    TestSuite_Add (
       suite, "/ClientPool/set_max_size", test_mongoc_client_pool_set_max_size);
    TestSuite_Add (
@@ -291,6 +677,15 @@ test_client_pool_install (TestSuite *suite)
 
    TestSuite_Add (
       suite, "/ClientPool/handshake", test_mongoc_client_pool_handshake);
+   TestSuite_Add (suite, "/ClientPool/warm", test_mongoc_client_pool_warm);
+   TestSuite_Add (
+      suite, "/ClientPool/warm/destroy", test_mongoc_client_pool_warm_destroy);
+   TestSuite_Add (suite,
+                  "/ClientPool/checkout_checkin",
+                  test_mongoc_client_pool_checkout_checkin);
+   TestSuite_Add (suite,
+                  "/ClientPool/checkout_checkin/contended",
+                  test_mongoc_client_pool_checkout_checkin_contended);
 
 #ifndef MONGOC_ENABLE_SSL
    TestSuite_Add (
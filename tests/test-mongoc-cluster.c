@@ -2,6 +2,8 @@
 #include <mongoc.h>
 
 #include "mongoc-client-private.h"
+#include "mongoc-config.h"
+#include "mongoc-counters-private.h"
 #include "mongoc-uri-private.h"
 
 #include "mock_server/mock-server.h"
@@ -476,6 +478,165 @@ test_legacy_write_socket_check (void)
 }
 
 
+#ifdef MONGOC_ENABLE_CRYPTO
+#define COUNTER_VALUE(ident) \
+   counter_value (&__mongoc_counter_##ident, COUNTER_##ident)
+
+
+static int64_t
+counter_value (mongoc_counter_t *counter, int num)
+{
+   int64_t value = 0;
+   unsigned i;
+
+   for (i = 0; i < _mongoc_get_cpu_count (); i++) {
+      value += counter->cpus[i].slots[num % SLOTS_PER_CACHELINE];
+   }
+
+   return value;
+}
+
+
+/* reply to the first SCRAM step in an ismaster, as MongoDB 4.4 does */
+static bool
+auto_speculative_auth (request_t *request, void *data)
+{
+   bson_iter_t iter;
+   bson_subtype_t subtype;
+   const uint8_t *payload;
+   uint32_t len;
+   char *client_first;
+   char *server_first;
+   bson_t ismaster = BSON_INITIALIZER;
+   bson_t speculative;
+
+   if (!request->is_command || strcasecmp (request->command_name, "ismaster")) {
+      return false;
+   }
+
+   if (!bson_iter_init (&iter, request_get_doc (request, 0)) ||
+       !bson_iter_find_descendant (
+          &iter, "speculativeAuthenticate.payload", &iter)) {
+      return false;
+   }
+
+   ASSERT (BSON_ITER_HOLDS_BINARY (&iter));
+   bson_iter_binary (&iter, &subtype, &len, &payload);
+
+   /* client-first-message is "n,,n=user,r=nonce" */
+   client_first = bson_strndup ((const char *) payload, len);
+   ASSERT (strstr (client_first, "r="));
+   server_first =
+      bson_strdup_printf ("%sservernonce,s=AAAAAAAAAAAAAAAAAAAAAA==,i=4096",
+                          strstr (client_first, "r="));
+
+   BSON_APPEND_DOUBLE (&ismaster, "ok", 1.0);
+   BSON_APPEND_BOOL (&ismaster, "ismaster", true);
+   BSON_APPEND_INT32 (&ismaster, "minWireVersion", 0);
+   BSON_APPEND_INT32 (&ismaster, "maxWireVersion", 3);
+   BSON_APPEND_DOCUMENT_BEGIN (
+      &ismaster, "speculativeAuthenticate", &speculative);
+   BSON_APPEND_INT32 (&speculative, "conversationId", 1);
+   BSON_APPEND_BOOL (&speculative, "done", false);
+   bson_append_binary (&speculative,
+                       "payload",
+                       7,
+                       BSON_SUBTYPE_BINARY,
+                       (const uint8_t *) server_first,
+                       (uint32_t) strlen (server_first));
+   bson_append_document_end (&ismaster, &speculative);
+
+   mock_server_reply_multi (request, MONGOC_REPLY_NONE, &ismaster, 1, 0);
+
+   bson_destroy (&ismaster);
+   bson_free (server_first);
+   bson_free (client_first);
+   request_destroy (request);
+   return true;
+}
+
+
+/* a new pooled connection sends the first SCRAM step in its ismaster. if the
+ * server replies to it, authentication takes one round trip fewer. */
+static void
+_test_cluster_speculative_auth (bool supported)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+   int64_t speculative;
+
+   server = mock_server_with_autoismaster (3);
+   if (supported) {
+      mock_server_autoresponds (server, auto_speculative_auth, NULL, NULL);
+   }
+
+   mock_server_run (server);
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_username (uri, "user");
+   mongoc_uri_set_password (uri, "password");
+   pool = mongoc_client_pool_new (uri);
+   client = mongoc_client_pool_pop (pool);
+   speculative = COUNTER_VALUE (auth_speculative);
+
+   future = future_client_command_simple (
+      client, "admin", tmp_bson ("{'ping': 1}"), NULL, NULL, &error);
+
+   if (supported) {
+      /* the next message after ismaster continues the conversation */
+      request = mock_server_receives_command (
+         server,
+         "admin",
+         MONGOC_QUERY_SLAVE_OK,
+         "{'saslContinue': 1, 'conversationId': 1}");
+   } else {
+      request = mock_server_receives_command (
+         server,
+         "admin",
+         MONGOC_QUERY_SLAVE_OK,
+         "{'saslStart': 1, 'mechanism': 'SCRAM-SHA-1'}");
+   }
+
+   ASSERT (request);
+   mock_server_replies_simple (request, "{'ok': 0, 'errmsg': 'auth failed'}");
+
+   ASSERT (!future_get_bool (future));
+   ASSERT_ERROR_CONTAINS (error,
+                          MONGOC_ERROR_CLIENT,
+                          MONGOC_ERROR_CLIENT_AUTHENTICATE,
+                          "auth failed");
+   ASSERT_CMPINT64 (COUNTER_VALUE (auth_speculative),
+                    ==,
+                    speculative + (supported ? 1 : 0));
+
+   future_destroy (future);
+   request_destroy (request);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_cluster_speculative_auth (void)
+{
+   _test_cluster_speculative_auth (true);
+}
+
+
+static void
+test_cluster_speculative_auth_unsupported (void)
+{
+   _test_cluster_speculative_auth (false);
+}
+#endif /* MONGOC_ENABLE_CRYPTO */
+
+
 void
 test_cluster_install (TestSuite *suite)
 {
@@ -519,4 +680,11 @@ test_cluster_install (TestSuite *suite)
    TestSuite_Add (suite,
                   "/Cluster/legacy_write/socket_check",
                   test_legacy_write_socket_check);
+#ifdef MONGOC_ENABLE_CRYPTO
+   TestSuite_Add (
+      suite, "/Cluster/speculative_auth", test_cluster_speculative_auth);
+   TestSuite_Add (suite,
+                  "/Cluster/speculative_auth/unsupported",
+                  test_cluster_speculative_auth_unsupported);
+#endif
 }
@@ -5,6 +5,7 @@
 #include <mongoc-collection-private.h>
 #include <mongoc-write-concern-private.h>
 #include <mongoc-read-concern-private.h>
+#include <mongoc-thread-private.h>
 
 #include "TestSuite.h"
 
@@ -4113,6 +4114,373 @@ test_find_indexes_err (void)
 }
 
 
+static void
+test_parallel_scan (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_client_t *clients[2];
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursors[2];
+   const bson_t *doc;
+   future_t *future;
+   request_t *request;
+   bson_error_t error;
+   int i;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_FIND_CMD);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+
+   /* each cursor belongs to a different client from the pool */
+   for (i = 0; i < 2; i++) {
+      clients[i] = mongoc_client_pool_pop (pool);
+   }
+
+   future = future_collection_parallel_scan (
+      collection, clients, cursors, 2, NULL, &error);
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_SLAVE_OK,
+      "{'parallelCollectionScan': 'collection', 'numCursors': 2}");
+
+   mock_server_replies_simple (
+      request,
+      "{'ok': 1, 'cursors': ["
+      "   {'ok': 1, 'cursor': {'id': 0, 'ns': 'db.collection',"
+      "                        'firstBatch': [{'_id': 0}]}},"
+      "   {'ok': 1, 'cursor': {'id': 0, 'ns': 'db.collection',"
+      "                        'firstBatch': [{'_id': 1}]}}]}");
+
+   ASSERT_CMPSIZE_T (future_get_size_t (future), ==, (size_t) 2);
+
+   for (i = 0; i < 2; i++) {
+      ASSERT (cursors[i]->client == clients[i]);
+      ASSERT (mongoc_cursor_next (cursors[i], &doc));
+      ASSERT_MATCH (doc, "{'_id': %d}", i);
+      ASSERT (!mongoc_cursor_next (cursors[i], &doc));
+      ASSERT_OR_PRINT (!mongoc_cursor_error (cursors[i], &error), error);
+      mongoc_cursor_destroy (cursors[i]);
+      mongoc_client_pool_push (pool, clients[i]);
+   }
+
+   request_destroy (request);
+   future_destroy (future);
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+/* parallelCollectionScan returns one cursor, as with WiredTiger, so the
+ * collection is split into _id ranges instead */
+static void
+test_parallel_scan_split (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursors[3];
+   const bson_t *doc;
+   future_t *future;
+   request_t *request;
+   bson_error_t error;
+   int i;
+
+   /* the index bounds of each range */
+   const char *ranges[] = {
+      "'min': {'$exists': false}, 'max': {'_id': 1}",
+      "'min': {'_id': 1}, 'max': {'_id': 3}",
+      "'min': {'_id': 3}, 'max': {'$exists': false}",
+   };
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_FIND_CMD);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+
+   future = future_collection_parallel_scan (
+      collection, NULL, cursors, 3, NULL, &error);
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_SLAVE_OK,
+      "{'parallelCollectionScan': 'collection', 'numCursors': 3}");
+
+   mock_server_replies_simple (
+      request,
+      "{'ok': 1, 'cursors': [{'ok': 1, 'cursor': {"
+      "   'id': 0, 'ns': 'db.collection', 'firstBatch': []}}]}");
+
+   request_destroy (request);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'collStats': 'collection'}");
+
+   mock_server_replies_simple (request, "{'ok': 1, 'size': 3000}");
+   request_destroy (request);
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_SLAVE_OK,
+      "{'splitVector': 'db.collection', 'keyPattern': {'_id': 1},"
+      " 'maxChunkSizeBytes': 1000}");
+
+   /* more keys than needed: every other one is used */
+   mock_server_replies_simple (
+      request,
+      "{'ok': 1, 'splitKeys': [{'_id': 0}, {'_id': 1}, {'_id': 2},"
+      "                        {'_id': 3}, {'_id': 4}]}");
+
+   ASSERT_CMPSIZE_T (future_get_size_t (future), ==, (size_t) 3);
+   request_destroy (request);
+   future_destroy (future);
+
+   for (i = 0; i < 3; i++) {
+      future = future_cursor_next (cursors[i], &doc);
+      request = mock_server_receives_command (
+         server,
+         "db",
+         MONGOC_QUERY_SLAVE_OK,
+         "{'find': 'collection', 'filter': {}, 'hint': {'_id': 1}, %s}",
+         ranges[i]);
+
+      mock_server_replies_simple (
+         request,
+         "{'ok': 1, 'cursor': {"
+         "   'id': 0, 'ns': 'db.collection', 'firstBatch': [{'_id': 1}]}}");
+
+      ASSERT (future_get_bool (future));
+      request_destroy (request);
+      future_destroy (future);
+      mongoc_cursor_destroy (cursors[i]);
+   }
+
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+/* neither parallelCollectionScan nor splitVector works, as on mongos: one
+ * cursor reads the whole collection */
+static void
+test_parallel_scan_unsupported (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursors[2];
+   const bson_t *doc;
+   future_t *future;
+   request_t *request;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_FIND_CMD);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+
+   future = future_collection_parallel_scan (
+      collection, NULL, cursors, 2, NULL, &error);
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_SLAVE_OK,
+      "{'parallelCollectionScan': 'collection', 'numCursors': 2}");
+
+   mock_server_replies_simple (
+      request, "{'ok': 0, 'code': 59, 'errmsg': 'no such command'}");
+
+   request_destroy (request);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'collStats': 'collection'}");
+
+   mock_server_replies_simple (request, "{'ok': 1, 'size': 3000}");
+   request_destroy (request);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'splitVector': 'db.collection'}");
+
+   mock_server_replies_simple (request, "{'ok': 0, 'errmsg': 'unauthorized'}");
+
+   ASSERT_CMPSIZE_T (future_get_size_t (future), ==, (size_t) 1);
+   request_destroy (request);
+   future_destroy (future);
+
+   future = future_cursor_next (cursors[0], &doc);
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_SLAVE_OK,
+      "{'find': 'collection', 'filter': {}, 'hint': {'$exists': false},"
+      " 'min': {'$exists': false}, 'max': {'$exists': false}}");
+
+   mock_server_replies_simple (
+      request,
+      "{'ok': 1, 'cursor': {"
+      "   'id': 0, 'ns': 'db.collection', 'firstBatch': [{'_id': 1}]}}");
+
+   ASSERT (future_get_bool (future));
+
+   request_destroy (request);
+   future_destroy (future);
+   mongoc_cursor_destroy (cursors[0]);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_parallel_scan_err (void)
+{
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *pooled;
+   mongoc_client_t *client;
+   mongoc_client_t *clients[1];
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursors[1];
+   bson_error_t error;
+
+   client = mongoc_client_new ("mongodb://localhost");
+   collection = mongoc_client_get_collection (client, "db", "collection");
+
+   ASSERT_CMPSIZE_T (mongoc_collection_parallel_scan (
+                        collection, NULL, cursors, 0, NULL, &error),
+                     ==,
+                     (size_t) 0);
+   ASSERT_ERROR_CONTAINS (error,
+                          MONGOC_ERROR_COMMAND,
+                          MONGOC_ERROR_COMMAND_INVALID_ARG,
+                          "max_cursors must be from 1 to 10000");
+
+   /* a client from another pool has its own server ids */
+   pool = mongoc_client_pool_new (client->uri);
+   pooled = mongoc_client_pool_pop (pool);
+   clients[0] = pooled;
+
+   ASSERT_CMPSIZE_T (mongoc_collection_parallel_scan (
+                        collection, clients, cursors, 1, NULL, &error),
+                     ==,
+                     (size_t) 0);
+   ASSERT_ERROR_CONTAINS (error,
+                          MONGOC_ERROR_COMMAND,
+                          MONGOC_ERROR_COMMAND_INVALID_ARG,
+                          "same client pool");
+
+   mongoc_client_pool_push (pool, pooled);
+   mongoc_client_pool_destroy (pool);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+}
+
+
+typedef struct {
+   mongoc_cursor_t *cursor;
+   int64_t n_docs;
+   int64_t id_sum;
+} parallel_scan_thread_t;
+
+
+static void *
+parallel_scan_thread (void *data)
+{
+   parallel_scan_thread_t *ctx = (parallel_scan_thread_t *) data;
+   const bson_t *doc;
+   bson_iter_t iter;
+   bson_error_t error;
+
+   while (mongoc_cursor_next (ctx->cursor, &doc)) {
+      BSON_ASSERT (bson_iter_init_find (&iter, doc, "_id"));
+      ctx->id_sum += bson_iter_as_int64 (&iter);
+      ctx->n_docs++;
+   }
+
+   ASSERT_OR_PRINT (!mongoc_cursor_error (ctx->cursor, &error), error);
+
+   return NULL;
+}
+
+
+/* export a collection from several threads, each with its own client */
+static void
+test_parallel_scan_live (void)
+{
+   enum { N_CURSORS = 4, N_DOCS = 1000 };
+
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_client_t *clients[N_CURSORS];
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   mongoc_cursor_t *cursors[N_CURSORS];
+   mongoc_thread_t threads[N_CURSORS];
+   parallel_scan_thread_t ctx[N_CURSORS];
+   int64_t n_docs = 0;
+   int64_t id_sum = 0;
+   size_t n_cursors;
+   bson_error_t error;
+   bson_t *doc;
+   bool r;
+   size_t i;
+
+   pool = test_framework_client_pool_new ();
+   client = mongoc_client_pool_pop (pool);
+   collection = get_test_collection (client, "test_parallel_scan");
+
+   bulk = mongoc_collection_create_bulk_operation (collection, false, NULL);
+   for (i = 0; i < N_DOCS; i++) {
+      doc = BCON_NEW ("_id", BCON_INT64 ((int64_t) i));
+      mongoc_bulk_operation_insert (bulk, doc);
+      bson_destroy (doc);
+   }
+
+   ASSERT_OR_PRINT (mongoc_bulk_operation_execute (bulk, NULL, &error), error);
+   mongoc_bulk_operation_destroy (bulk);
+
+   for (i = 0; i < N_CURSORS; i++) {
+      clients[i] = mongoc_client_pool_pop (pool);
+   }
+
+   n_cursors = mongoc_collection_parallel_scan (
+      collection, clients, cursors, N_CURSORS, NULL, &error);
+   ASSERT_OR_PRINT (n_cursors > 0, error);
+   ASSERT_CMPSIZE_T (n_cursors, <=, (size_t) N_CURSORS);
+
+   for (i = 0; i < n_cursors; i++) {
+      ctx[i].cursor = cursors[i];
+      ctx[i].n_docs = 0;
+      ctx[i].id_sum = 0;
+      r = mongoc_thread_create (&threads[i], parallel_scan_thread, &ctx[i]);
+      BSON_ASSERT (r == 0);
+   }
+
+   for (i = 0; i < n_cursors; i++) {
+      mongoc_thread_join (threads[i]);
+      n_docs += ctx[i].n_docs;
+      id_sum += ctx[i].id_sum;
+      mongoc_cursor_destroy (cursors[i]);
+   }
+
+   /* each document was read exactly once */
+   ASSERT_CMPINT64 (n_docs, ==, (int64_t) N_DOCS);
+   ASSERT_CMPINT64 (id_sum, ==, (int64_t) N_DOCS * (N_DOCS - 1) / 2);
+
+   for (i = 0; i < N_CURSORS; i++) {
+      mongoc_client_pool_push (pool, clients[i]);
+   }
+
+   ASSERT_OR_PRINT (mongoc_collection_drop (collection, &error), error);
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+}
+
+
 static void
 test_aggregate_install (TestSuite *suite)
 {
@@ -4794,6 +5162,16 @@ test_collection_install (TestSuite *suite)
    TestSuite_AddLive (suite, "/Collection/get_index_info", test_get_index_info);
    TestSuite_Add (
       suite, "/Collection/find_indexes/error", test_find_indexes_err);
+   TestSuite_Add (suite, "/Collection/parallel_scan", test_parallel_scan);
+   TestSuite_Add (
+      suite, "/Collection/parallel_scan/split", test_parallel_scan_split);
+   TestSuite_Add (suite,
+                  "/Collection/parallel_scan/unsupported",
+                  test_parallel_scan_unsupported);
+   TestSuite_Add (
+      suite, "/Collection/parallel_scan/error", test_parallel_scan_err);
+   TestSuite_AddLive (
+      suite, "/Collection/parallel_scan/live", test_parallel_scan_live);
    TestSuite_AddLive (
       suite, "/Collection/insert/duplicate_key", test_insert_duplicate_key);
 }
@@ -0,0 +1,280 @@
+#include <mongoc.h>
+#include <mongoc-array-private.h>
+#include <mongoc-compression-private.h>
+#include <mongoc-rpc-private.h>
+
+#include "mock_server/mock-server.h"
+#include "mock_server/future.h"
+#include "mock_server/future-functions.h"
+#include "TestSuite.h"
+#include "test-conveniences.h"
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "compression-test"
+
+
+/* a command that compresses well */
+static bson_t *
+compressible_command (void)
+{
+   bson_t *cmd;
+   char *payload;
+
+   payload = bson_malloc (4096 + 1);
+   memset (payload, 'a', 4096);
+   payload[4096] = '\0';
+
+   cmd = bson_new ();
+   BSON_APPEND_INT32 (cmd, "ping", 1);
+   BSON_APPEND_UTF8 (cmd, "payload", payload);
+
+   bson_free (payload);
+
+   return cmd;
+}
+
+
+static void
+_test_rpc_compress_round_trip (int32_t compressor_id)
+{
+   bson_t *cmd;
+   bson_t query;
+   mongoc_rpc_t rpc;
+   mongoc_rpc_t compressed_rpc;
+   uint8_t *compressed;
+   uint8_t *buf;
+   size_t len;
+   size_t buflen;
+
+   cmd = compressible_command ();
+
+   _mongoc_rpc_prep_command (&rpc, "db.$cmd", cmd, MONGOC_QUERY_SLAVE_OK);
+   rpc.query.request_id = 1234;
+
+   compressed = _mongoc_rpc_compress (&rpc, compressor_id, -1, &len);
+   ASSERT (compressed);
+
+   /* rpc is still usable in host byte order */
+   ASSERT_CMPINT (rpc.header.opcode, ==, MONGOC_OPCODE_QUERY);
+
+   if (compressor_id != MONGOC_COMPRESSOR_NOOP_ID) {
+      ASSERT_CMPSIZE_T (len, <, (size_t) rpc.header.msg_len);
+   }
+
+   ASSERT (_mongoc_rpc_scatter (&compressed_rpc, compressed, len));
+   ASSERT_CMPINT (BSON_UINT32_FROM_LE (compressed_rpc.header.opcode),
+                  ==,
+                  MONGOC_OPCODE_COMPRESSED);
+   ASSERT_CMPINT (compressed_rpc.compressed.compressor_id, ==, compressor_id);
+
+   buflen = 16 + (size_t) BSON_UINT32_FROM_LE (
+                    compressed_rpc.compressed.uncompressed_size);
+   ASSERT_CMPSIZE_T (buflen, ==, (size_t) rpc.header.msg_len);
+   buf = bson_malloc (buflen);
+
+   ASSERT (_mongoc_rpc_decompress (&compressed_rpc, buf, buflen));
+   ASSERT (_mongoc_rpc_scatter (&rpc, buf, buflen));
+   _mongoc_rpc_swab_from_le (&rpc);
+
+   ASSERT_CMPINT (rpc.header.opcode, ==, MONGOC_OPCODE_QUERY);
+   ASSERT_CMPINT (rpc.header.request_id, ==, 1234);
+   ASSERT_CMPSTR (rpc.query.collection, "db.$cmd");
+   ASSERT (bson_init_static (&query, rpc.query.query, cmd->len));
+   ASSERT (bson_equal (&query, cmd));
+
+   bson_free (buf);
+   bson_free (compressed);
+   bson_destroy (cmd);
+}
+
+
+static void
+test_rpc_compress_noop (void)
+{
+   _test_rpc_compress_round_trip (MONGOC_COMPRESSOR_NOOP_ID);
+}
+
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+static void
+test_rpc_compress_zlib (void)
+{
+   _test_rpc_compress_round_trip (MONGOC_COMPRESSOR_ZLIB_ID);
+}
+#endif
+
+
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+static void
+test_rpc_compress_snappy (void)
+{
+   _test_rpc_compress_round_trip (MONGOC_COMPRESSOR_SNAPPY_ID);
+}
+#endif
+
+
+static void
+test_compressible_commands (void)
+{
+   ASSERT (!_mongoc_compressor_command_is_compressible ("isMaster"));
+   ASSERT (!_mongoc_compressor_command_is_compressible ("ismaster"));
+   ASSERT (!_mongoc_compressor_command_is_compressible ("saslStart"));
+   ASSERT (!_mongoc_compressor_command_is_compressible ("saslContinue"));
+   ASSERT (!_mongoc_compressor_command_is_compressible ("getnonce"));
+   ASSERT (!_mongoc_compressor_command_is_compressible ("authenticate"));
+   ASSERT (!_mongoc_compressor_command_is_compressible ("createUser"));
+   ASSERT (!_mongoc_compressor_command_is_compressible ("updateUser"));
+   ASSERT (_mongoc_compressor_command_is_compressible ("ping"));
+   ASSERT (_mongoc_compressor_command_is_compressible ("find"));
+}
+
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+/* the client offers zlib and compresses commands and queries, and reads
+ * compressed replies, only if the server agrees to it in ismaster */
+static void
+_test_compression_mock_server (bool pooled, bool server_agrees)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool = NULL;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   bson_t *cmd;
+   bson_t reply;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1.0,"
+                              " 'ismaster': true,"
+                              " 'minWireVersion': 0,"
+                              " 'maxWireVersion': 3,"
+                              " 'compression': [%s]}",
+                              server_agrees ? "'zlib'" : "");
+   mock_server_run (server);
+
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   ASSERT (mongoc_uri_set_compressors (uri, "zlib"));
+
+   if (pooled) {
+      pool = mongoc_client_pool_new (uri);
+      client = mongoc_client_pool_pop (pool);
+   } else {
+      client = mongoc_client_new_from_uri (uri);
+   }
+
+   /* command */
+   cmd = compressible_command ();
+   future = future_client_command_simple (
+      client, "db", cmd, NULL, &reply, &error);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+
+   if (server_agrees) {
+      ASSERT_CMPINT (request->compressor_id, ==, MONGOC_COMPRESSOR_ZLIB_ID);
+      /* fewer bytes on the wire */
+      ASSERT_CMPSIZE_T (request->compressed_len, <, request->data_len);
+   } else {
+      ASSERT_CMPINT (request->compressor_id, ==, -1);
+   }
+
+   mock_server_replies_simple (request, "{'ok': 1, 'pong': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+   ASSERT_HAS_FIELD (&reply, "pong");
+
+   bson_destroy (&reply);
+   request_destroy (request);
+   future_destroy (future);
+
+   /* legacy query and reply */
+   collection = mongoc_client_get_collection (client, "test", "test");
+   cursor = mongoc_collection_find_with_opts (
+      collection, tmp_bson ("{}"), NULL, NULL);
+   future = future_cursor_next (cursor, &doc);
+   request = mock_server_receives_query (
+      server, "test.test", MONGOC_QUERY_SLAVE_OK, 0, 0, "{}", NULL);
+
+   ASSERT_CMPINT (
+      request->compressor_id, ==, server_agrees ? MONGOC_COMPRESSOR_ZLIB_ID : -1);
+
+   mock_server_replies_simple (request, "{'a': 1}");
+   ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'a': 1}");
+
+   request_destroy (request);
+   future_destroy (future);
+   mongoc_cursor_destroy (cursor);
+   mongoc_collection_destroy (collection);
+
+   if (pooled) {
+      mongoc_client_pool_push (pool, client);
+      mongoc_client_pool_destroy (pool);
+   } else {
+      mongoc_client_destroy (client);
+   }
+
+   bson_destroy (cmd);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_compression_single (void)
+{
+   _test_compression_mock_server (false, true);
+}
+
+
+static void
+test_compression_pooled (void)
+{
+   _test_compression_mock_server (true, true);
+}
+
+
+static void
+test_compression_not_negotiated_single (void)
+{
+   _test_compression_mock_server (false, false);
+}
+
+
+static void
+test_compression_not_negotiated_pooled (void)
+{
+   _test_compression_mock_server (true, false);
+}
+#endif
+
+
+void
+test_compression_install (TestSuite *suite)
+{
+   TestSuite_Add (
+      suite, "/Compression/rpc/noop", test_rpc_compress_noop);
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   TestSuite_Add (suite, "/Compression/rpc/zlib", test_rpc_compress_zlib);
+#endif
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+   TestSuite_Add (suite, "/Compression/rpc/snappy", test_rpc_compress_snappy);
+#endif
+   TestSuite_Add (
+      suite, "/Compression/compressible", test_compressible_commands);
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   TestSuite_Add (suite, "/Compression/single", test_compression_single);
+   TestSuite_Add (suite, "/Compression/pooled", test_compression_pooled);
+   TestSuite_Add (suite,
+                  "/Compression/not_negotiated/single",
+                  test_compression_not_negotiated_single);
+   TestSuite_Add (suite,
+                  "/Compression/not_negotiated/pooled",
+                  test_compression_not_negotiated_pooled);
+#endif
+}
@@ -0,0 +1,176 @@
+#include <mongoc.h>
+
+#include "mongoc-counters-private.h"
+#include "mongoc-server-description-private.h"
+#include "TestSuite.h"
+
+#include "test-libmongoc.h"
+#include "test-conveniences.h"
+#include "mock_server/future-functions.h"
+#include "mock_server/mock-server.h"
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "counters-test"
+
+
+static int64_t
+histogram_count (mongoc_histogram_t *histogram, uint32_t bucket)
+{
+   int64_t count = 0;
+   unsigned i;
+
+   for (i = 0; i < _mongoc_get_cpu_count (); i++) {
+      count += histogram->cpus[i].buckets[bucket];
+   }
+
+   return count;
+}
+
+
+static void
+test_histogram_bucket (void)
+{
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (-1), ==, (uint32_t) 0);
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (0), ==, (uint32_t) 0);
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (3), ==, (uint32_t) 3);
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (4), ==, (uint32_t) 4);
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (7), ==, (uint32_t) 7);
+
+   /* 8 to 15 are split in quarters */
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (8), ==, (uint32_t) 8);
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (9), ==, (uint32_t) 8);
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (10), ==, (uint32_t) 9);
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (15), ==, (uint32_t) 11);
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (16), ==, (uint32_t) 12);
+
+   /* 1000 is 0b1111101000 */
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (1000), ==, (uint32_t) 39);
+
+   ASSERT_CMPUINT32 (_mongoc_histogram_bucket (INT64_MAX),
+                     ==,
+                     (uint32_t) MONGOC_HISTOGRAM_N_BUCKETS - 1);
+}
+
+
+static void
+test_histogram_record (void)
+{
+   int64_t before;
+
+   before = histogram_count (&__mongoc_histogram_cmd_other, 39);
+   mongoc_histogram_cmd_other_record (1000);
+   mongoc_histogram_cmd_other_record (1001);
+   ASSERT_CMPINT64 (
+      histogram_count (&__mongoc_histogram_cmd_other, 39), ==, before + 2);
+}
+
+
+static int64_t
+node_count (mongoc_counter_slots_t *node, mongoc_node_counter_t which)
+{
+   int64_t count = 0;
+   unsigned i;
+
+   for (i = 0; i < _mongoc_get_cpu_count (); i++) {
+      count += node[i].slots[which];
+   }
+
+   return count;
+}
+
+
+static void
+test_node_counters (void)
+{
+   mongoc_counter_slots_t *a;
+   mongoc_counter_slots_t *b;
+   mongoc_server_description_t sd;
+   int64_t before;
+
+   a = _mongoc_node_counters_get ("counters-test-a.example.com:27017");
+   b = _mongoc_node_counters_get ("counters-test-b.example.com:27017");
+   ASSERT (a);
+   ASSERT (b);
+   ASSERT (a != b);
+   ASSERT (_mongoc_node_counters_get ("counters-test-a.example.com:27017") ==
+           a);
+
+   before = node_count (a, MONGOC_NODE_COUNTER_BYTES_IN);
+   _mongoc_node_counter_add (a, MONGOC_NODE_COUNTER_BYTES_IN, 10);
+   _mongoc_node_counter_add (a, MONGOC_NODE_COUNTER_BYTES_IN, 5);
+   ASSERT_CMPINT64 (
+      node_count (a, MONGOC_NODE_COUNTER_BYTES_IN), ==, before + 15);
+
+   /* a server description finds its row once */
+   mongoc_server_description_init (&sd, "counters-test-b.example.com:27017", 1);
+   ASSERT (sd.counters == b);
+   mongoc_server_description_update_rtt (&sd, 10);
+   mongoc_server_description_cleanup (&sd);
+
+   /* a full table */
+   _mongoc_node_counter_add (NULL, MONGOC_NODE_COUNTER_OPS, 1);
+   _mongoc_node_counters_set_rtt (NULL, 10);
+}
+
+
+static void
+test_node_counters_command (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_counter_slots_t *node;
+   int64_t streams;
+   int64_t ops;
+   int64_t bytes_in;
+   int64_t bytes_out;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+   node = _mongoc_node_counters_get (mock_server_get_host_and_port (server));
+   ASSERT (node);
+
+   streams = node_count (node, MONGOC_NODE_COUNTER_STREAMS);
+   ops = node_count (node, MONGOC_NODE_COUNTER_OPS);
+   bytes_in = node_count (node, MONGOC_NODE_COUNTER_BYTES_IN);
+   bytes_out = node_count (node, MONGOC_NODE_COUNTER_BYTES_OUT);
+
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   future = future_client_command_simple (
+      client, "admin", tmp_bson ("{'ping': 1}"), NULL, NULL, &error);
+
+   request = mock_server_receives_command (
+      server, "admin", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+
+   mock_server_replies_simple (request, "{'ok': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+
+   ASSERT_CMPINT64 (
+      node_count (node, MONGOC_NODE_COUNTER_STREAMS), ==, streams + 1);
+   ASSERT_CMPINT64 (node_count (node, MONGOC_NODE_COUNTER_OPS), ==, ops + 1);
+   ASSERT_CMPINT64 (
+      node_count (node, MONGOC_NODE_COUNTER_BYTES_IN), >, bytes_in);
+   ASSERT_CMPINT64 (
+      node_count (node, MONGOC_NODE_COUNTER_BYTES_OUT), >, bytes_out);
+
+   future_destroy (future);
+   request_destroy (request);
+   mongoc_client_destroy (client);
+
+   ASSERT_CMPINT64 (
+      node_count (node, MONGOC_NODE_COUNTER_STREAMS), ==, streams);
+
+   mock_server_destroy (server);
+}
+
+
+void
+test_counters_install (TestSuite *suite)
+{
+   TestSuite_Add (suite, "/Counters/histogram/bucket", test_histogram_bucket);
+   TestSuite_Add (suite, "/Counters/histogram/record", test_histogram_record);
+   TestSuite_Add (suite, "/Counters/nodes", test_node_counters);
+   TestSuite_Add (suite, "/Counters/nodes/command", test_node_counters_command);
+}
@@ -1531,6 +1531,335 @@ test_n_return_find_cmd_with_opts (void)
 }
 
 
+static void
+_test_cursor_next_batch_mock (bool find_cmd)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursor;
+   bson_t reply_docs[3];
+   const bson_t *doc;
+   const bson_t *docs;
+   size_t n_docs;
+   request_t *request;
+   future_t *future;
+   bson_error_t error;
+   int i;
+
+   server =
+      mock_server_with_autoismaster (find_cmd ? WIRE_VERSION_FIND_CMD : 0);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "coll");
+   cursor = mongoc_collection_find_with_opts (
+      collection, tmp_bson (NULL), NULL, NULL);
+
+   future = future_cursor_next (cursor, &doc);
+
+   if (find_cmd) {
+      request = mock_server_receives_command (
+         server, "db", MONGOC_QUERY_SLAVE_OK, "{'find': 'coll'}");
+      mock_server_replies_simple (request,
+                                  "{'ok': 1, 'cursor': {"
+                                  "    'id': 0,"
+                                  "    'ns': 'db.coll',"
+                                  "    'firstBatch': ["
+                                  "       {'_id': 0}, {'_id': 1}, {'_id': 2}"
+                                  "]}}");
+   } else {
+      request = mock_server_receives_query (
+         server, "db.coll", MONGOC_QUERY_SLAVE_OK, 0, 0, NULL, NULL);
+      for (i = 0; i < 3; i++) {
+         bson_init (&reply_docs[i]);
+         BSON_APPEND_INT32 (&reply_docs[i], "_id", i);
+      }
+
+      mock_server_reply_multi (request, MONGOC_REPLY_NONE, reply_docs, 3, 0);
+      for (i = 0; i < 3; i++) {
+         bson_destroy (&reply_docs[i]);
+      }
+   }
+
+   ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'_id': 0}");
+
+   /* the rest of the batch is already in the reply buffer */
+   ASSERT (mongoc_cursor_next_batch (cursor, &docs, &n_docs));
+   ASSERT_CMPSIZE_T (n_docs, ==, (size_t) 2);
+   ASSERT_MATCH (&docs[0], "{'_id': 1}");
+   ASSERT_MATCH (&docs[1], "{'_id': 2}");
+
+   /* views, not copies: the documents are consecutive in the reply */
+   ASSERT (bson_get_data (&docs[0]) + docs[0].len == bson_get_data (&docs[1]));
+   ASSERT (mongoc_cursor_current (cursor)->len == docs[1].len);
+
+   ASSERT (!mongoc_cursor_next_batch (cursor, &docs, &n_docs));
+   ASSERT_CMPSIZE_T (n_docs, ==, (size_t) 0);
+   ASSERT_OR_PRINT (!mongoc_cursor_error (cursor, &error), error);
+
+   future_destroy (future);
+   request_destroy (request);
+   mongoc_cursor_destroy (cursor);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_cursor_next_batch_op_query (void)
+{
+   _test_cursor_next_batch_mock (false);
+}
+
+
+static void
+test_cursor_next_batch_find_cmd (void)
+{
+   _test_cursor_next_batch_mock (true);
+}
+
+
+static mongoc_cursor_t *
+_find_all_in_batches (mongoc_collection_t *collection, int batch_size)
+{
+   return mongoc_collection_find_with_opts (
+      collection,
+      tmp_bson (NULL),
+      tmp_bson ("{'sort': {'_id': 1}, 'batchSize': %d}", batch_size),
+      NULL);
+}
+
+
+/* compare mongoc_cursor_next_batch with mongoc_cursor_next on a live server.
+ * set MONGOC_TEST_CURSOR_BENCH_DOCS to insert more documents and print the
+ * throughput of each. */
+static void
+test_cursor_next_batch_live (void)
+{
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   const bson_t *docs;
+   size_t n_docs;
+   size_t i;
+   int64_t bench_docs;
+   int64_t n_inserted;
+   int64_t n_read;
+   int64_t start;
+   int64_t next_usec;
+   int64_t next_batch_usec;
+   bson_iter_t iter;
+   bson_error_t error;
+   const int batch_size = 100;
+   bool r;
+
+   bench_docs =
+      test_framework_getenv_int64 ("MONGOC_TEST_CURSOR_BENCH_DOCS", 0);
+   n_inserted = bench_docs ? bench_docs : 250;
+
+   client = test_framework_client_new ();
+   collection = get_test_collection (client, "test_cursor_next_batch");
+   bulk = mongoc_collection_create_bulk_operation (collection, true, NULL);
+   for (i = 0; i < (size_t) n_inserted; i++) {
+      mongoc_bulk_operation_insert (
+         bulk, tmp_bson ("{'_id': %d, 'x': 'abcdefghijklmnop'}", (int) i));
+   }
+
+   r = (0 != mongoc_bulk_operation_execute (bulk, NULL, &error));
+   ASSERT_OR_PRINT (r, error);
+
+   cursor = _find_all_in_batches (collection, batch_size);
+   start = bson_get_monotonic_time ();
+   n_read = 0;
+   while (mongoc_cursor_next (cursor, &doc)) {
+      n_read++;
+   }
+
+   next_usec = bson_get_monotonic_time () - start;
+   ASSERT_OR_PRINT (!mongoc_cursor_error (cursor, &error), error);
+   ASSERT_CMPINT64 (n_read, ==, n_inserted);
+   mongoc_cursor_destroy (cursor);
+
+   cursor = _find_all_in_batches (collection, batch_size);
+   start = bson_get_monotonic_time ();
+   n_read = 0;
+   while (mongoc_cursor_next_batch (cursor, &docs, &n_docs)) {
+      ASSERT_CMPSIZE_T (n_docs, <=, (size_t) batch_size);
+      for (i = 0; i < n_docs; i++) {
+         /* every view in the batch is still valid */
+         ASSERT (bson_iter_init_find (&iter, &docs[i], "_id"));
+         ASSERT_CMPINT64 (bson_iter_as_int64 (&iter), ==, n_read);
+         n_read++;
+      }
+   }
+
+   next_batch_usec = bson_get_monotonic_time () - start;
+   ASSERT_OR_PRINT (!mongoc_cursor_error (cursor, &error), error);
+   ASSERT_CMPINT64 (n_read, ==, n_inserted);
+   mongoc_cursor_destroy (cursor);
+
+   if (bench_docs) {
+      printf ("mongoc_cursor_next:       %.0f docs/sec\n"
+              "mongoc_cursor_next_batch: %.0f docs/sec\n",
+              (double) n_read * 1e6 / (double) BSON_MAX (next_usec, 1),
+              (double) n_read * 1e6 / (double) BSON_MAX (next_batch_usec, 1));
+   }
+
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_drop (collection, NULL);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+}
+
+
+typedef enum {
+   PREFETCH_CONSUME,
+   PREFETCH_INTERLEAVE,
+   PREFETCH_DESTROY,
+} prefetch_test_type_t;
+
+
+static void
+_test_cursor_prefetch (prefetch_test_type_t test_type)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   request_t *request;
+   request_t *getmore;
+   future_t *future;
+   bson_error_t error;
+   int i;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_FIND_CMD);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "coll");
+   cursor = mongoc_collection_find_with_opts (
+      collection,
+      tmp_bson (NULL),
+      tmp_bson ("{'prefetch': true, 'prefetchFraction': 0.5, 'batchSize': 4}"),
+      NULL);
+
+   future = future_cursor_next (cursor, &doc);
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_SLAVE_OK,
+      "{'find': 'coll',"
+      " 'prefetch': {'$exists': false},"
+      " 'prefetchFraction': {'$exists': false}}");
+
+   mock_server_replies_simple (request,
+                               "{'ok': 1, 'cursor': {"
+                               "    'id': {'$numberLong': '123'},"
+                               "    'ns': 'db.coll',"
+                               "    'firstBatch': ["
+                               "       {'_id': 0}, {'_id': 1},"
+                               "       {'_id': 2}, {'_id': 3}"
+                               "]}}");
+
+   ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'_id': 0}");
+   future_destroy (future);
+   request_destroy (request);
+
+   /* reading half the batch sends the getMore */
+   ASSERT (mongoc_cursor_next (cursor, &doc));
+   ASSERT_MATCH (doc, "{'_id': 1}");
+
+   getmore = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_SLAVE_OK,
+      "{'getMore': {'$numberLong': '123'}, 'collection': 'coll',"
+      " 'batchSize': {'$numberLong': '4'}}");
+
+   if (test_type == PREFETCH_DESTROY) {
+      future = future_cursor_destroy (cursor);
+      mock_server_replies_simple (getmore,
+                                  "{'ok': 1, 'cursor': {"
+                                  "    'id': {'$numberLong': '123'},"
+                                  "    'ns': 'db.coll',"
+                                  "    'nextBatch': [{'_id': 4}]}}");
+
+      /* the cursor learned from the prefetched reply that it is open */
+      request = mock_server_receives_command (
+         server, "db", MONGOC_QUERY_SLAVE_OK, "{'killCursors': 'coll'}");
+      mock_server_replies_simple (request, "{'ok': 1}");
+      future_wait (future);
+      future_destroy (future);
+      request_destroy (request);
+      request_destroy (getmore);
+      goto done;
+   }
+
+   if (test_type == PREFETCH_INTERLEAVE) {
+      /* the client reads the getMore reply before sending "ping" */
+      future = future_client_command_simple (
+         client, "admin", tmp_bson ("{'ping': 1}"), NULL, NULL, &error);
+   }
+
+   mock_server_replies_simple (getmore,
+                               "{'ok': 1, 'cursor': {"
+                               "    'id': 0,"
+                               "    'ns': 'db.coll',"
+                               "    'nextBatch': [{'_id': 4}]}}");
+
+   if (test_type == PREFETCH_INTERLEAVE) {
+      request = mock_server_receives_command (
+         server, "admin", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+      mock_server_replies_ok_and_destroys (request);
+      ASSERT_OR_PRINT (future_get_bool (future), error);
+      future_destroy (future);
+   }
+
+   /* the rest of the first batch, then the prefetched batch */
+   for (i = 2; i < 5; i++) {
+      ASSERT (mongoc_cursor_next (cursor, &doc));
+      ASSERT_MATCH (doc, "{'_id': %d}", i);
+   }
+
+   ASSERT (!mongoc_cursor_next (cursor, &doc));
+   ASSERT_OR_PRINT (!mongoc_cursor_error (cursor, &error), error);
+
+   request_destroy (getmore);
+   mongoc_cursor_destroy (cursor);
+
+done:
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_cursor_prefetch (void)
+{
+   _test_cursor_prefetch (PREFETCH_CONSUME);
+}
+
+
+static void
+test_cursor_prefetch_interleave (void)
+{
+   _test_cursor_prefetch (PREFETCH_INTERLEAVE);
+}
+
+
+static void
+test_cursor_prefetch_destroy (void)
+{
+   _test_cursor_prefetch (PREFETCH_DESTROY);
+}
+
+
 void
 test_cursor_install (TestSuite *suite)
 {
@@ -1623,4 +1952,15 @@ test_cursor_install (TestSuite *suite)
    TestSuite_Add (suite,
                   "/Cursor/n_return/find_cmd/with_opts",
                   test_n_return_find_cmd_with_opts);
+   TestSuite_Add (
+      suite, "/Cursor/next_batch/op_query", test_cursor_next_batch_op_query);
+   TestSuite_Add (
+      suite, "/Cursor/next_batch/find_cmd", test_cursor_next_batch_find_cmd);
+   TestSuite_AddLive (
+      suite, "/Cursor/next_batch/live", test_cursor_next_batch_live);
+   TestSuite_Add (suite, "/Cursor/prefetch", test_cursor_prefetch);
+   TestSuite_Add (
+      suite, "/Cursor/prefetch/interleave", test_cursor_prefetch_interleave);
+   TestSuite_Add (
+      suite, "/Cursor/prefetch/destroy", test_cursor_prefetch_destroy);
 }
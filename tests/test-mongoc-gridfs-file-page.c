@@ -116,6 +116,48 @@ test_read (void)
 }
 
 
+static void
+test_read_span (void)
+{
+   uint8_t fox[] = "the quick brown fox jumped over the laxy dog";
+   uint32_t len = sizeof fox;
+   const uint8_t *data;
+   uint32_t r;
+
+   mongoc_gridfs_file_page_t *page;
+
+   page = _mongoc_gridfs_file_page_new (fox, len, 4096);
+
+   ASSERT (page);
+
+   /* spans point into the chunk's data, not a copy */
+   r = _mongoc_gridfs_file_page_read_span (page, &data, 3);
+   ASSERT (r == 3);
+   ASSERT (data == fox);
+   ASSERT (page->offset == 3);
+
+   r = _mongoc_gridfs_file_page_read_span (page, &data, 50);
+   ASSERT (r == len - 3);
+   ASSERT (data == fox + 3);
+
+   r = _mongoc_gridfs_file_page_read_span (page, &data, 50);
+   ASSERT (r == 0);
+
+   /* after a write, spans point into the page's own buffer */
+   ASSERT (_mongoc_gridfs_file_page_seek (page, 0));
+   r = _mongoc_gridfs_file_page_write (page, "THE", 3);
+   ASSERT (r == 3);
+   ASSERT (_mongoc_gridfs_file_page_seek (page, 0));
+
+   r = _mongoc_gridfs_file_page_read_span (page, &data, 50);
+   ASSERT (r == len);
+   ASSERT (data != fox);
+   ASSERT (memcmp ("THE quick", data, 9) == 0);
+
+   _mongoc_gridfs_file_page_destroy (page);
+}
+
+
 static void
 test_seek (void)
 {
@@ -219,6 +261,7 @@ test_gridfs_file_page_install (TestSuite *suite)
    TestSuite_Add (suite, "/GridFS/File/Page/get_len", test_get_len);
    TestSuite_Add (suite, "/GridFS/File/Page/is_dirty", test_is_dirty);
    TestSuite_Add (suite, "/GridFS/File/Page/read", test_read);
+   TestSuite_Add (suite, "/GridFS/File/Page/read_span", test_read_span);
    TestSuite_Add (suite, "/GridFS/File/Page/seek", test_seek);
    TestSuite_Add (suite, "/GridFS/File/Page/write", test_write);
    TestSuite_Add (suite, "/GridFS/File/Page/memset0", test_memset0);
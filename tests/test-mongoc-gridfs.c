@@ -833,6 +833,204 @@ test_stream (void)
    ASSERT_CMPUINT64 (mongoc_gridfs_file_tell (file_), ==, position_)
 
 
+/* a stream that appends all it is written to a string */
+typedef struct {
+   mongoc_stream_t vtable;
+   bson_string_t *str;
+} string_stream_t;
+
+
+static ssize_t
+string_stream_writev (mongoc_stream_t *stream,
+                      mongoc_iovec_t *iov,
+                      size_t iovcnt,
+                      int32_t timeout_msec)
+{
+   string_stream_t *sstream = (string_stream_t *) stream;
+   ssize_t r = 0;
+   size_t i;
+
+   for (i = 0; i < iovcnt; i++) {
+      bson_string_append_printf (sstream->str,
+                                 "%.*s",
+                                 (int) iov[i].iov_len,
+                                 (const char *) iov[i].iov_base);
+      r += (ssize_t) iov[i].iov_len;
+   }
+
+   return r;
+}
+
+
+static void
+string_stream_destroy (mongoc_stream_t *stream)
+{
+   bson_string_free (((string_stream_t *) stream)->str, true);
+   bson_free (stream);
+}
+
+
+static mongoc_stream_t *
+string_stream_new (void)
+{
+   string_stream_t *stream;
+
+   stream = (string_stream_t *) bson_malloc0 (sizeof *stream);
+   stream->vtable.type = 999;
+   stream->vtable.writev = string_stream_writev;
+   stream->vtable.destroy = string_stream_destroy;
+   stream->str = bson_string_new (NULL);
+
+   return (mongoc_stream_t *) stream;
+}
+
+
+static void
+test_read_span (void)
+{
+   const char *data = "abcdefghijklmnopqrstuvwxy";
+   mongoc_gridfs_t *gridfs;
+   mongoc_gridfs_file_t *file;
+   mongoc_gridfs_file_opt_t opt = {0};
+   mongoc_client_t *client;
+   mongoc_stream_t *stream;
+   mongoc_iovec_t iov;
+   const uint8_t *span;
+   bson_error_t error;
+   ssize_t r;
+
+   client = test_framework_client_new ();
+   ASSERT_OR_PRINT (gridfs = get_test_gridfs (client, "span", &error), error);
+
+   mongoc_gridfs_drop (gridfs, &error);
+
+   opt.filename = "span";
+   opt.chunk_size = 10;
+   file = mongoc_gridfs_create_file (gridfs, &opt);
+   ASSERT (file);
+
+   iov.iov_base = (void *) data;
+   iov.iov_len = 25;
+   ASSERT_CMPSSIZE_T (
+      mongoc_gridfs_file_writev (file, &iov, 1, 0), ==, (ssize_t) 25);
+   ASSERT (mongoc_gridfs_file_save (file));
+   mongoc_gridfs_file_destroy (file);
+
+   file = mongoc_gridfs_find_one_by_filename (gridfs, "span", &error);
+   ASSERT_OR_PRINT (file, error);
+
+   /* spans end at chunk boundaries */
+   r = mongoc_gridfs_file_read_span (file, &span, 4);
+   ASSERT_CMPSSIZE_T (r, ==, (ssize_t) 4);
+   ASSERT_MEMCMP (span, "abcd", 4);
+
+   r = mongoc_gridfs_file_read_span (file, &span, 100);
+   ASSERT_CMPSSIZE_T (r, ==, (ssize_t) 6);
+   ASSERT_MEMCMP (span, "efghij", 6);
+
+   r = mongoc_gridfs_file_read_span (file, &span, 100);
+   ASSERT_CMPSSIZE_T (r, ==, (ssize_t) 10);
+   ASSERT_MEMCMP (span, "klmnopqrst", 10);
+
+   r = mongoc_gridfs_file_read_span (file, &span, 100);
+   ASSERT_CMPSSIZE_T (r, ==, (ssize_t) 5);
+   ASSERT_MEMCMP (span, "uvwxy", 5);
+
+   r = mongoc_gridfs_file_read_span (file, &span, 100);
+   ASSERT_CMPSSIZE_T (r, ==, (ssize_t) 0);
+   ASSERT_TELL (file, (uint64_t) 25);
+
+   /* write the rest of the file from the position on */
+   ASSERT_CMPINT (mongoc_gridfs_file_seek (file, 3, SEEK_SET), ==, 0);
+   stream = string_stream_new ();
+   ASSERT_OR_PRINT (
+      mongoc_gridfs_file_write_to_stream (file, stream, 0, &error) == 22,
+      error);
+   ASSERT_CMPSTR (((string_stream_t *) stream)->str->str, data + 3);
+   ASSERT_TELL (file, (uint64_t) 25);
+
+   mongoc_stream_destroy (stream);
+   mongoc_gridfs_file_destroy (file);
+
+   drop_collections (gridfs, &error);
+   mongoc_gridfs_destroy (gridfs);
+   mongoc_client_destroy (client);
+}
+
+
+/* a chunk shorter than chunkSize before the end of the file is an error, not
+ * the end of the file */
+static void
+test_read_span_short_chunk (void)
+{
+   const char *data = "abcdefghijklmnopqrstuvwxy";
+   mongoc_gridfs_t *gridfs;
+   mongoc_gridfs_file_t *file;
+   mongoc_gridfs_file_opt_t opt = {0};
+   mongoc_client_t *client;
+   mongoc_collection_t *chunks;
+   mongoc_stream_t *stream;
+   mongoc_iovec_t iov;
+   bson_t update = BSON_INITIALIZER;
+   bson_t set;
+   bson_error_t error;
+
+   client = test_framework_client_new ();
+   ASSERT_OR_PRINT (gridfs = get_test_gridfs (client, "span", &error), error);
+
+   mongoc_gridfs_drop (gridfs, &error);
+
+   opt.filename = "span";
+   opt.chunk_size = 10;
+   file = mongoc_gridfs_create_file (gridfs, &opt);
+   ASSERT (file);
+
+   iov.iov_base = (void *) data;
+   iov.iov_len = 25;
+   ASSERT_CMPSSIZE_T (
+      mongoc_gridfs_file_writev (file, &iov, 1, 0), ==, (ssize_t) 25);
+   ASSERT (mongoc_gridfs_file_save (file));
+   mongoc_gridfs_file_destroy (file);
+
+   /* cut the middle chunk to 3 bytes */
+   BSON_APPEND_DOCUMENT_BEGIN (&update, "$set", &set);
+   BSON_APPEND_BINARY (
+      &set, "data", BSON_SUBTYPE_BINARY, (const uint8_t *) "klm", 3);
+   bson_append_document_end (&update, &set);
+
+   chunks = mongoc_gridfs_get_chunks (gridfs);
+   ASSERT_OR_PRINT (mongoc_collection_update (chunks,
+                                              MONGOC_UPDATE_NONE,
+                                              tmp_bson ("{'n': 1}"),
+                                              &update,
+                                              NULL,
+                                              &error),
+                    error);
+
+   file = mongoc_gridfs_find_one_by_filename (gridfs, "span", &error);
+   ASSERT_OR_PRINT (file, error);
+
+   stream = string_stream_new ();
+   ASSERT_CMPINT64 (
+      mongoc_gridfs_file_write_to_stream (file, stream, 0, &error),
+      ==,
+      (int64_t) -1);
+   ASSERT_ERROR_CONTAINS (error,
+                          MONGOC_ERROR_GRIDFS,
+                          MONGOC_ERROR_GRIDFS_CHUNK_MISSING,
+                          "corrupt chunk number 1");
+   ASSERT_CMPSTR (((string_stream_t *) stream)->str->str, "abcdefghijklm");
+
+   bson_destroy (&update);
+   mongoc_stream_destroy (stream);
+   mongoc_gridfs_file_destroy (file);
+
+   drop_collections (gridfs, &error);
+   mongoc_gridfs_destroy (gridfs);
+   mongoc_client_destroy (client);
+}
+
+
 static void
 test_long_seek (void *ctx)
 {
@@ -1184,6 +1382,309 @@ test_inherit_client_config (void)
    mock_server_destroy (server);
 }
 
+static void
+receives_chunk_upsert (mock_server_t *server, int32_t n, int64_t length)
+{
+   request_t *request;
+   char *length_str;
+
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_NONE,
+      "{'update': 'fs.chunks',"
+      " 'updates': [{'q': {'n': %d}, 'u': {'n': %d}, 'upsert': true}]}",
+      n,
+      n);
+
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 1}");
+   request_destroy (request);
+
+   length_str = bson_strdup_printf ("%" PRId64, length);
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_NONE,
+      "{'update': 'fs.files',"
+      " 'updates': [{'u': {'$set': {'length': {'$numberLong': '%s'}}},"
+      "              'upsert': true}]}",
+      length_str);
+
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 1}");
+   request_destroy (request);
+   bson_free (length_str);
+}
+
+/* by default each full chunk is upserted, and the file saved, as it is
+ * written */
+static void
+test_write_through (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_gridfs_t *gridfs;
+   mongoc_gridfs_file_t *file;
+   mongoc_gridfs_file_opt_t opt = {0};
+   char buf[25];
+   mongoc_iovec_t iov;
+   future_t *future;
+
+   server = mock_server_with_autoismaster (3);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   gridfs = _get_gridfs (server, client);
+
+   opt.chunk_size = 10;
+   file = mongoc_gridfs_create_file (gridfs, &opt);
+   ASSERT (file);
+
+   memset (buf, 'a', sizeof buf);
+   iov.iov_base = buf;
+   iov.iov_len = sizeof buf;
+
+   future = future_gridfs_file_writev (file, &iov, 1, 0);
+   receives_chunk_upsert (server, 0, 10);
+   receives_chunk_upsert (server, 1, 20);
+   ASSERT_CMPSSIZE_T (future_get_ssize_t (future), ==, (ssize_t) sizeof buf);
+   ASSERT (!file->bulk);
+   future_destroy (future);
+
+   /* the last, partial chunk */
+   future = future_gridfs_file_save (file);
+   receives_chunk_upsert (server, 2, 25);
+   ASSERT (future_get_bool (future));
+   future_destroy (future);
+
+   mongoc_gridfs_file_destroy (file);
+   mongoc_gridfs_destroy (gridfs);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+/* with a batch size, new chunks are inserted in one batch, and the files
+ * document written once, when the file is saved */
+static void
+test_batched_chunks (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_gridfs_t *gridfs;
+   mongoc_gridfs_file_t *file;
+   mongoc_gridfs_file_opt_t opt = {0};
+   char buf[25];
+   mongoc_iovec_t iov;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_with_autoismaster (3);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   gridfs = _get_gridfs (server, client);
+
+   opt.chunk_size = 10;
+   file = mongoc_gridfs_create_file (gridfs, &opt);
+   ASSERT (file);
+   mongoc_gridfs_file_set_batch_size (file, 1024);
+
+   memset (buf, 'a', sizeof buf);
+   iov.iov_base = buf;
+   iov.iov_len = sizeof buf;
+
+   /* two full chunks are batched, without a round trip */
+   ASSERT_CMPSSIZE_T (
+      mongoc_gridfs_file_writev (file, &iov, 1, 0), ==, (ssize_t) sizeof buf);
+   ASSERT (file->bulk);
+   ASSERT_CMPUINT32 (file->bulk_len, ==, (uint32_t) 20);
+
+   future = future_gridfs_file_save (file);
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_NONE,
+      "{'insert': 'fs.chunks',"
+      " 'ordered': true,"
+      " 'documents': [{'n': 0}, {'n': 1}, {'n': 2}]}");
+
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 3}");
+   request_destroy (request);
+
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_NONE,
+      "{'update': 'fs.files',"
+      " 'updates': [{'u': {'$set': {'length': {'$numberLong': '25'},"
+      "                             'chunkSize': 10}},"
+      "              'upsert': true}]}");
+
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 1}");
+   request_destroy (request);
+
+   ASSERT (future_get_bool (future));
+   ASSERT (!file->bulk);
+
+   future_destroy (future);
+   mongoc_gridfs_file_destroy (file);
+   mongoc_gridfs_destroy (gridfs);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+/* if a batch of chunks can't be inserted, writev and later saves fail */
+static void
+test_batched_chunks_error (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_gridfs_t *gridfs;
+   mongoc_gridfs_file_t *file;
+   mongoc_gridfs_file_opt_t opt = {0};
+   char buf[25];
+   mongoc_iovec_t iov;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_with_autoismaster (3);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   gridfs = _get_gridfs (server, client);
+
+   opt.chunk_size = 10;
+   file = mongoc_gridfs_create_file (gridfs, &opt);
+   ASSERT (file);
+   mongoc_gridfs_file_set_batch_size (file, 10);
+
+   memset (buf, 'a', sizeof buf);
+   iov.iov_base = buf;
+   iov.iov_len = sizeof buf;
+
+   /* the first full chunk fills a batch */
+   future = future_gridfs_file_writev (file, &iov, 1, 0);
+   request = mock_server_receives_command (
+      server,
+      "db",
+      MONGOC_QUERY_NONE,
+      "{'insert': 'fs.chunks', 'documents': [{'n': 0}]}");
+
+   mock_server_replies_simple (request,
+                               "{'ok': 0, 'code': 1, 'errmsg': 'foo'}");
+   request_destroy (request);
+
+   ASSERT_CMPSSIZE_T (future_get_ssize_t (future), ==, (ssize_t) -1);
+   ASSERT (!file->bulk);
+   future_destroy (future);
+
+   ASSERT (mongoc_gridfs_file_error (file, &error));
+   ASSERT_CONTAINS (error.message, "foo");
+
+   /* no more round trips */
+   ASSERT_CMPSSIZE_T (
+      mongoc_gridfs_file_writev (file, &iov, 1, 0), ==, (ssize_t) -1);
+   ASSERT (!mongoc_gridfs_file_save (file));
+
+   mongoc_gridfs_file_destroy (file);
+   mongoc_gridfs_destroy (gridfs);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+static void
+reply_with_chunk (request_t *request, int32_t n, char c)
+{
+   uint8_t data[10];
+   bson_t reply = BSON_INITIALIZER;
+   bson_t cursor;
+   bson_t batch;
+   bson_t chunk;
+
+   memset (data, c, sizeof data);
+
+   BSON_APPEND_INT32 (&reply, "ok", 1);
+   BSON_APPEND_DOCUMENT_BEGIN (&reply, "cursor", &cursor);
+   BSON_APPEND_INT64 (&cursor, "id", 0);
+   BSON_APPEND_UTF8 (&cursor, "ns", "db.fs.chunks");
+   BSON_APPEND_ARRAY_BEGIN (&cursor, "firstBatch", &batch);
+   BSON_APPEND_DOCUMENT_BEGIN (&batch, "0", &chunk);
+   BSON_APPEND_INT32 (&chunk, "n", n);
+   BSON_APPEND_BINARY (&chunk, "data", BSON_SUBTYPE_BINARY, data, sizeof data);
+   bson_append_document_end (&batch, &chunk);
+   bson_append_array_end (&cursor, &batch);
+   bson_append_document_end (&reply, &cursor);
+
+   mock_server_reply_multi (request, MONGOC_REPLY_NONE, &reply, 1, 0);
+
+   bson_destroy (&reply);
+}
+
+
+/* chunks are read ahead concurrently, on several pooled connections */
+static void
+test_read_ahead (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_gridfs_t *gridfs;
+   mongoc_gridfs_file_t *file;
+   char buf[31] = {0};
+   mongoc_iovec_t iov;
+   future_t *future;
+   request_t *requests[3];
+   bson_iter_t iter;
+   bson_iter_t n;
+   int i;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   client = mongoc_client_pool_pop (pool);
+   gridfs = _get_gridfs (server, client);
+
+   file = _mongoc_gridfs_file_new_from_bson (
+      gridfs, tmp_bson ("{'_id': 1, 'length': 30, 'chunkSize': 10}"));
+   ASSERT (file);
+
+   /* one chunk per range, three ranges at once */
+   mongoc_gridfs_file_set_concurrency (file, pool, 3);
+   ASSERT (file->read_ahead);
+   file->read_ahead->chunks_per_range = 1;
+
+   iov.iov_base = buf;
+   iov.iov_len = 30;
+   future = future_gridfs_file_readv (file, &iov, 1, 30, 0);
+
+   /* all three queries are sent before any is answered */
+   for (i = 0; i < 3; i++) {
+      requests[i] =
+         mock_server_receives_command (server,
+                                       "db",
+                                       MONGOC_QUERY_SLAVE_OK,
+                                       "{'find': 'fs.chunks',"
+                                       " 'filter': {'files_id': 1}}");
+   }
+
+   /* answer in reverse order, the file is read in order regardless */
+   for (i = 2; i >= 0; i--) {
+      ASSERT (bson_iter_init (&iter, request_get_doc (requests[i], 0)));
+      ASSERT (bson_iter_find_descendant (&iter, "filter.n.$gte", &n));
+      reply_with_chunk (
+         requests[i], bson_iter_int32 (&n), 'a' + bson_iter_int32 (&n));
+      request_destroy (requests[i]);
+   }
+
+   ASSERT_CMPSSIZE_T (future_get_ssize_t (future), ==, (ssize_t) 30);
+   ASSERT_CMPSTR (buf, "aaaaaaaaaabbbbbbbbbbcccccccccc");
+
+   future_destroy (future);
+   mongoc_gridfs_file_destroy (file);
+   mongoc_gridfs_destroy (gridfs);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
 void
 test_gridfs_install (TestSuite *suite)
 {
@@ -1197,6 +1698,9 @@ test_gridfs_install (TestSuite *suite)
    TestSuite_AddLive (suite, "/GridFS/read", test_read);
    TestSuite_AddLive (suite, "/GridFS/seek", test_seek);
    TestSuite_AddLive (suite, "/GridFS/stream", test_stream);
+   TestSuite_AddLive (suite, "/GridFS/read_span", test_read_span);
+   TestSuite_AddLive (
+      suite, "/GridFS/read_span/short_chunk", test_read_span_short_chunk);
    TestSuite_AddLive (suite, "/GridFS/remove", test_remove);
    TestSuite_AddLive (suite, "/GridFS/write", test_write);
    TestSuite_AddLive (
@@ -1219,4 +1723,9 @@ test_gridfs_install (TestSuite *suite)
    TestSuite_AddLive (suite, "/GridFS/file_set_id", test_set_id);
    TestSuite_Add (
       suite, "/GridFS/inherit_client_config", test_inherit_client_config);
+   TestSuite_Add (suite, "/GridFS/write_through", test_write_through);
+   TestSuite_Add (suite, "/GridFS/batched_chunks", test_batched_chunks);
+   TestSuite_Add (
+      suite, "/GridFS/batched_chunks_error", test_batched_chunks_error);
+   TestSuite_Add (suite, "/GridFS/read_ahead", test_read_ahead);
 }
@@ -2,8 +2,10 @@
 #include <bcon.h>
 #include <mongoc.h>
 #include <mongoc-matcher-private.h>
+#include <mongoc-matcher-regex-private.h>
 
 #include "TestSuite.h"
+#include "test-conveniences.h"
 
 BEGIN_IGNORE_DEPRECATIONS;
 
@@ -320,6 +322,58 @@ test_mongoc_matcher_bad_spec (void)
 }
 
 
+static void
+test_mongoc_matcher_bad_array_ops (void)
+{
+   const char *specs[] = {
+      "{'a': {'$size': -1}}",
+      "{'a': {'$size': 1.5}}",
+      "{'a': {'$size': '1'}}",
+      "{'a': {'$mod': [0, 1]}}",
+      "{'a': {'$mod': [2]}}",
+      "{'a': {'$mod': [2, 1, 0]}}",
+      "{'a': {'$mod': 2}}",
+      "{'a': {'$all': 1}}",
+      "{'a': {'$elemMatch': 1}}",
+      "{'a': {'$elemMatch': {}}}",
+      "{'a': {'$elemMatch': {'$abc': 1}}}",
+      "{'a': {'$gt': 1, '$abc': 1}}",
+   };
+
+   bson_t *regex_specs[] = {
+      /* JSON would parse these as BSON regular expressions */
+      BCON_NEW ("a", "{", "$options", "i", "}"),
+      BCON_NEW ("a", "{", "$regex", BCON_INT32 (1), "}"),
+      BCON_NEW ("a", "{", "$regex", "a", "$options", BCON_INT32 (1), "}"),
+#ifndef _WIN32
+      BCON_NEW ("a", "{", "$regex", "a(", "}"),
+      BCON_NEW ("a", "{", "$regex", "a", "$options", "q", "}"),
+      /* PCRE syntax POSIX would read differently */
+      BCON_NEW ("a", "{", "$regex", "^\\d+$", "}"),
+      BCON_NEW ("a", "{", "$regex", "[\\.]", "}"),
+      BCON_NEW ("a", "{", "$regex", "[[:alpha:]\\s]", "}"),
+      BCON_NEW ("a", "{", "$regex", "(?:a)", "}"),
+#endif
+   };
+
+   bson_error_t error;
+   size_t i;
+
+   for (i = 0; i < sizeof specs / sizeof specs[0]; i++) {
+      BSON_ASSERT (!mongoc_matcher_new (tmp_bson (specs[i]), &error));
+      ASSERT_CMPINT (error.domain, ==, MONGOC_ERROR_MATCHER);
+      ASSERT_CMPINT (error.code, ==, MONGOC_ERROR_MATCHER_INVALID);
+   }
+
+   for (i = 0; i < sizeof regex_specs / sizeof regex_specs[0]; i++) {
+      BSON_ASSERT (!mongoc_matcher_new (regex_specs[i], &error));
+      ASSERT_CMPINT (error.domain, ==, MONGOC_ERROR_MATCHER);
+      ASSERT_CMPINT (error.code, ==, MONGOC_ERROR_MATCHER_INVALID);
+      bson_destroy (regex_specs[i]);
+   }
+}
+
+
 static void
 test_mongoc_matcher_eq_utf8 (void)
 {
@@ -547,6 +601,328 @@ test_mongoc_matcher_in_basic (void)
    mongoc_matcher_destroy (matcher);
 }
 
+
+/* the compiled program and the op tree both give the expected result */
+static void
+assert_matcher_match (mongoc_matcher_t *matcher,
+                      const char *spec,
+                      const char *json,
+                      bool match)
+{
+   bson_t *doc = tmp_bson (json);
+
+   if (mongoc_matcher_match (matcher, doc) != match ||
+       _mongoc_matcher_op_match (matcher->optree, doc) != match) {
+      fprintf (stderr,
+               "query:\n\n%s\n\nshould %shave matched:\n\n%s\n",
+               spec,
+               match ? "" : "not ",
+               json);
+      abort ();
+   }
+}
+
+
+static void
+run_matcher_tests (logic_op_test_t *tests, int n_tests)
+{
+   bson_error_t error;
+   mongoc_matcher_t *matcher;
+   int i;
+
+   for (i = 0; i < n_tests; i++) {
+      matcher = mongoc_matcher_new (tmp_bson (tests[i].spec), &error);
+      ASSERT_OR_PRINT (matcher, error);
+      BSON_ASSERT (matcher->program);
+
+      assert_matcher_match (
+         matcher, tests[i].spec, tests[i].doc, tests[i].match);
+
+      mongoc_matcher_destroy (matcher);
+   }
+}
+
+
+/* the compiled program gives the same results as the op tree */
+static void
+test_mongoc_matcher_program (void)
+{
+   logic_op_test_t tests[] = {
+      {"{'a.b': 1, 'a.c': 2}", "{'a': {'b': 1, 'c': 2}}", true},
+      {"{'a.b': 1, 'a.c': 2}", "{'a': {'c': 2, 'b': 1}}", true},
+      {"{'a.b': 1, 'a.c': 2}", "{'a': {'b': 1}}", false},
+      {"{'a.b': 1, 'a': {'$exists': true}}", "{'a': {'b': 1}}", true},
+      {"{'a.1': 6}", "{'a': [5, 6]}", true},
+      {"{'a.1': 6}", "{'a': [6, 5]}", false},
+      {"{'a.b.c': 'x'}", "{'a': {'b': {'c': 'x'}}}", true},
+      {"{'a.b.c': 'x'}", "{'a': {'b': 'x'}}", false},
+      /* only the first field with a key is used */
+      {"{'a': 1}", "{'a': 2, 'a': 1}", false},
+      {"{'a.b': 1}", "{'a': 1, 'a': {'b': 1}}", false},
+      {"{'a.b': 1}", "{'a': {'b': 1}, 'a': 1}", true},
+      /* numbers */
+      {"{'a': {'$gt': 1.5}}", "{'a': 2}", true},
+      {"{'a': {'$gt': 1.5}}", "{'a': true}", false},
+      {"{'a': {'$gte': 2}}", "{'a': {'$numberLong': '2'}}", true},
+      {"{'a': {'$lt': {'$numberLong': '2'}}}", "{'a': 1.5}", true},
+      {"{'a': 1}", "{'a': true}", true},
+      {"{'a': {'$ne': 1}}", "{'a': 'x'}", true},
+      {"{'a': {'$ne': 1}}", "{}", false},
+      /* strings */
+      {"{'a': 'x'}", "{'a': 'x'}", true},
+      {"{'a': 'x'}", "{'a': 'xy'}", false},
+      {"{'a': {'$ne': 'x'}}", "{'a': 1}", true},
+      {"{'a': {'$ne': 'x'}}", "{'a': 'x'}", false},
+      /* $in and $nin */
+      {"{'a': {'$in': [1, 'x', null, [1, 2], {'b': 1}, true]}}",
+       "{'a': 1.0}",
+       true},
+      {"{'a': {'$in': [1, 'x', null, [1, 2], {'b': 1}, true]}}",
+       "{'a': true}",
+       true},
+      {"{'a': {'$in': [1, 'x', null, [1, 2], {'b': 1}, true]}}",
+       "{'a': 'x'}",
+       true},
+      {"{'a': {'$in': [1, 'x', null, [1, 2], {'b': 1}, true]}}",
+       "{'a': null}",
+       true},
+      {"{'a': {'$in': [1, 'x', null, [1, 2], {'b': 1}, true]}}",
+       "{'a': [1, 2]}",
+       true},
+      {"{'a': {'$in': [1, 'x', null, [1, 2], {'b': 1}, true]}}",
+       "{'a': {'b': 1}}",
+       true},
+      {"{'a': {'$in': [1, 'x', null, [1, 2], {'b': 1}, true]}}",
+       "{'a': 'y'}",
+       false},
+      {"{'a': {'$in': [1, 'x', null, [1, 2], {'b': 1}, true]}}",
+       "{'a': 2}",
+       false},
+      {"{'a': {'$in': [1, 'x', null, [1, 2], {'b': 1}, true]}}",
+       "{}",
+       false},
+      {"{'a': {'$in': [false]}}", "{'a': false}", false},
+      {"{'a': {'$in': [0]}}", "{'a': -0.0}", true},
+      {"{'a': {'$in': [{'$numberLong': '5'}]}}", "{'a': 5}", true},
+      {"{'a': {'$in': 1}}", "{'a': 1}", false},
+      {"{'a': {'$nin': [1, 'x']}}", "{'a': 2}", true},
+      {"{'a': {'$nin': [1, 'x']}}", "{'a': 'x'}", false},
+      {"{'a': {'$nin': [1, 'x']}}", "{}", false},
+      /* $exists, $type, and logical ops */
+      {"{'a.b': {'$exists': false}}", "{'a': {'c': 1}}", true},
+      {"{'a.b': {'$exists': false}}", "{'a': {'b': null}}", false},
+      {"{'a.b': {'$type': 'string'}}", "{'a': {'b': 'x'}}", true},
+      {"{'a.b': {'$type': 'string'}}", "{'a': {'b': 1}}", false},
+      {"{'a': {'$not': {'$gt': 2}}}", "{'a': 1}", true},
+      {"{'a': {'$not': {'$gt': 2}}}", "{'a': 3}", false},
+      {"{'$nor': [{'a': 1}, {'b': 2}]}", "{'a': 3}", true},
+      {"{'$nor': [{'a': 1}, {'b': 2}]}", "{'b': 2}", false},
+      {"{'$or': [{'a': 1}, {'$or': [{'b': 2}, {'c': 3}]}]}", "{'c': 3}", true},
+      {"{'$and': [{'a': 1}, {'$and': [{'b': 2}, {'c': 3}]}], 'd': 4}",
+       "{'a': 1, 'b': 2, 'c': 3, 'd': 4}",
+       true},
+      {"{'$and': [{'a': 1}, {'$and': [{'b': 2}, {'c': 3}]}], 'd': 4}",
+       "{'a': 1, 'b': 2, 'c': 4, 'd': 4}",
+       false},
+      /* all of a field's operators must match */
+      {"{'a': {'$gt': 1, '$lt': 5}}", "{'a': 3}", true},
+      {"{'a': {'$gt': 1, '$lt': 5}}", "{'a': 6}", false},
+      {"{'a': {'$gt': 1, '$lt': 5}}", "{'a': 0}", false},
+   };
+
+   run_matcher_tests (tests, sizeof tests / sizeof (logic_op_test_t));
+}
+
+
+static void
+test_mongoc_matcher_array_ops (void)
+{
+   logic_op_test_t tests[] = {
+      /* $elemMatch with a query */
+      {"{'a': {'$elemMatch': {'b': 1, 'c': {'$gt': 2}}}}",
+       "{'a': [{'b': 1, 'c': 1}, {'b': 2, 'c': 3}]}",
+       false},
+      {"{'a': {'$elemMatch': {'b': 1, 'c': {'$gt': 2}}}}",
+       "{'a': [5, {'b': 2}, {'b': 1, 'c': 3}]}",
+       true},
+      {"{'a': {'$elemMatch': {'b': 1, 'c': {'$gt': 2}}}}",
+       "{'a': {'b': 1, 'c': 3}}",
+       false},
+      {"{'a': {'$elemMatch': {'b': 1, 'c': {'$gt': 2}}}}", "{}", false},
+      {"{'a': {'$elemMatch': {'$or': [{'b': 1}, {'c': 2}]}}}",
+       "{'a': [{'b': 2}, {'c': 2}]}",
+       true},
+      {"{'x.a': {'$elemMatch': {'b.c': 'y'}}}",
+       "{'x': {'a': [{'b': {'c': 'y'}}]}}",
+       true},
+      /* $elemMatch with operators */
+      {"{'a': {'$elemMatch': {'$gte': 80, '$lt': 85}}}",
+       "{'a': [79, 90, 82]}",
+       true},
+      {"{'a': {'$elemMatch': {'$gte': 80, '$lt': 85}}}",
+       "{'a': [79, 90]}",
+       false},
+      {"{'a': {'$elemMatch': {'$gte': 80, '$lt': 85}}}", "{'a': []}", false},
+      {"{'a': {'$elemMatch': {'$gte': 80, '$lt': 85}}}", "{'a': 82}", false},
+      {"{'a': {'$elemMatch': {'$elemMatch': {'$gt': 5}}}}",
+       "{'a': [[1], [2, 6]]}",
+       true},
+      {"{'a': {'$elemMatch': {'$not': {'$type': 'string'}}}}",
+       "{'a': ['x', 'y']}",
+       false},
+      /* $size */
+      {"{'a': {'$size': 2}}", "{'a': [1, [2, 3]]}", true},
+      {"{'a': {'$size': 2}}", "{'a': [1]}", false},
+      {"{'a': {'$size': 2}}", "{'a': [1, 2, 3]}", false},
+      {"{'a': {'$size': 2}}", "{'a': 'ab'}", false},
+      {"{'a': {'$size': 2}}", "{}", false},
+      {"{'a': {'$size': 0}}", "{'a': []}", true},
+      {"{'a': {'$size': 2.0}}", "{'a': [1, 2]}", true},
+      /* $all */
+      {"{'a': {'$all': [1, 'x']}}", "{'a': ['x', 3, 1.0]}", true},
+      {"{'a': {'$all': [1, 'x']}}", "{'a': [1, 3]}", false},
+      {"{'a': {'$all': [1]}}", "{'a': 1}", true},
+      {"{'a': {'$all': [1, 2]}}", "{'a': 1}", false},
+      {"{'a': {'$all': []}}", "{'a': []}", false},
+      {"{'a': {'$all': [[1, 2]]}}", "{'a': [[1, 2], 3]}", true},
+      {"{'a': {'$all': [[1, 2]]}}", "{'a': [1, 2]}", true},
+      /* $mod */
+      {"{'a': {'$mod': [4, 1]}}", "{'a': 5}", true},
+      {"{'a': {'$mod': [4, 1]}}", "{'a': 4}", false},
+      {"{'a': {'$mod': [4, 1]}}", "{'a': 9.9}", true},
+      {"{'a': {'$mod': [4, 1]}}", "{'a': {'$numberLong': '13'}}", true},
+      {"{'a': {'$mod': [4, 1]}}", "{'a': -3}", false},
+      {"{'a': {'$mod': [4, 1]}}", "{'a': '5'}", false},
+      {"{'a': {'$mod': [-1, 0]}}",
+       "{'a': {'$numberLong': '-9223372036854775808'}}",
+       true},
+      /* together */
+      {"{'a': {'$size': 3, '$all': [2, 3]}}", "{'a': [1, 2, 3]}", true},
+      {"{'a': {'$size': 3, '$all': [2, 3]}}", "{'a': [2, 3]}", false},
+      {"{'a': {'$not': {'$size': 1}}, 'b': {'$mod': [2, 0]}}",
+       "{'a': [1, 2], 'b': 8}",
+       true},
+   };
+
+   run_matcher_tests (tests, sizeof tests / sizeof (logic_op_test_t));
+}
+
+
+static void
+test_mongoc_matcher_regex (void)
+{
+   const char *spec = "{'name': {'$regex': '^jo+hn$', '$options': 'i'}}";
+   bson_error_t error;
+   mongoc_matcher_t *matcher;
+   mongoc_matcher_t *matcher2;
+   bson_t *query;
+
+   query = BCON_NEW (
+      "name", "{", "$regex", BCON_UTF8 ("^jo+hn$"), "$options", "i", "}");
+   matcher = mongoc_matcher_new (query, &error);
+   ASSERT_OR_PRINT (matcher, error);
+   BSON_ASSERT (matcher->program);
+   assert_matcher_match (matcher, spec, "{'name': 'JOOhn'}", true);
+   assert_matcher_match (matcher, spec, "{'name': 'johnny'}", false);
+   assert_matcher_match (matcher, spec, "{'name': 1}", false);
+   assert_matcher_match (matcher, spec, "{}", false);
+
+   /* the compiled pattern is shared */
+   matcher2 = mongoc_matcher_new (query, &error);
+   ASSERT_OR_PRINT (matcher2, error);
+   BSON_ASSERT (matcher->optree->regex.regex ==
+                matcher2->optree->regex.regex);
+   mongoc_matcher_destroy (matcher2);
+
+   /* cleanup, as from mongoc_cleanup, keeps patterns in use */
+   _mongoc_matcher_regex_cleanup ();
+   assert_matcher_match (matcher, spec, "{'name': 'JOOhn'}", true);
+   matcher2 = mongoc_matcher_new (query, &error);
+   ASSERT_OR_PRINT (matcher2, error);
+   BSON_ASSERT (matcher->optree->regex.regex ==
+                matcher2->optree->regex.regex);
+   mongoc_matcher_destroy (matcher2);
+   mongoc_matcher_destroy (matcher);
+   bson_destroy (query);
+
+   /* a BSON regular expression, alone or with $not */
+   spec = "{'name': /^j/, 'city': {'$not': /^n/i}}";
+   query = BCON_NEW ("name",
+                     BCON_REGEX ("^j", ""),
+                     "city",
+                     "{",
+                     "$not",
+                     BCON_REGEX ("^n", "i"),
+                     "}");
+   matcher = mongoc_matcher_new (query, &error);
+   ASSERT_OR_PRINT (matcher, error);
+   assert_matcher_match (matcher, spec, "{'name': 'joe'}", true);
+   assert_matcher_match (
+      matcher, spec, "{'name': 'joe', 'city': 'Boston'}", true);
+   assert_matcher_match (
+      matcher, spec, "{'name': 'joe', 'city': 'NYC'}", false);
+   assert_matcher_match (matcher, spec, "{'name': 'Joe'}", false);
+   mongoc_matcher_destroy (matcher);
+   bson_destroy (query);
+
+   /* with other operators */
+   spec = "{'name': {'$regex': 'o', '$ne': 'bob'}}";
+   query = BCON_NEW ("name", "{", "$regex", "o", "$ne", "bob", "}");
+   matcher = mongoc_matcher_new (query, &error);
+   ASSERT_OR_PRINT (matcher, error);
+   assert_matcher_match (matcher, spec, "{'name': 'john'}", true);
+   assert_matcher_match (matcher, spec, "{'name': 'bob'}", false);
+   mongoc_matcher_destroy (matcher);
+   bson_destroy (query);
+
+   /* POSIX bracket expressions, and escaped punctuation */
+   spec = "{'s': {'$regex': '^[]a[:digit:]]+\\\\.$'}}";
+   query = BCON_NEW ("s", "{", "$regex", "^[]a[:digit:]]+\\.$", "}");
+   matcher = mongoc_matcher_new (query, &error);
+   ASSERT_OR_PRINT (matcher, error);
+   assert_matcher_match (matcher, spec, "{'s': ']a1.'}", true);
+   assert_matcher_match (matcher, spec, "{'s': ']a1x'}", false);
+   mongoc_matcher_destroy (matcher);
+   bson_destroy (query);
+
+   /* in $elemMatch */
+   spec = "{'tags': {'$elemMatch': {'$regex': '^a.c$'}}}";
+   query = BCON_NEW (
+      "tags", "{", "$elemMatch", "{", "$regex", "^a.c$", "}", "}");
+   matcher = mongoc_matcher_new (query, &error);
+   ASSERT_OR_PRINT (matcher, error);
+   assert_matcher_match (matcher, spec, "{'tags': ['x', 'abc']}", true);
+   assert_matcher_match (matcher, spec, "{'tags': ['x', 'abcd']}", false);
+   mongoc_matcher_destroy (matcher);
+   bson_destroy (query);
+}
+
+
+/* a query with too many paths to compile is matched with the op tree */
+static void
+test_mongoc_matcher_program_too_large (void)
+{
+   bson_t spec = BSON_INITIALIZER;
+   bson_error_t error;
+   mongoc_matcher_t *matcher;
+   char key[16];
+   int i;
+
+   for (i = 0; i < MONGOC_MATCHER_PROGRAM_MAX_NODES + 1; i++) {
+      bson_snprintf (key, sizeof key, "k%d", i);
+      BSON_APPEND_INT32 (&spec, key, i);
+   }
+
+   matcher = mongoc_matcher_new (&spec, &error);
+   ASSERT_OR_PRINT (matcher, error);
+   BSON_ASSERT (!matcher->program);
+   BSON_ASSERT (mongoc_matcher_match (matcher, &spec));
+   BSON_ASSERT (!mongoc_matcher_match (matcher, tmp_bson ("{'k0': 0}")));
+
+   mongoc_matcher_destroy (matcher);
+   bson_destroy (&spec);
+}
+
 END_IGNORE_DEPRECATIONS;
 
 void
@@ -557,9 +933,19 @@ test_matcher_install (TestSuite *suite)
    TestSuite_Add (suite, "/Matcher/compare", test_mongoc_matcher_compare);
    TestSuite_Add (suite, "/Matcher/logic", test_mongoc_matcher_logic_ops);
    TestSuite_Add (suite, "/Matcher/bad_spec", test_mongoc_matcher_bad_spec);
+   TestSuite_Add (
+      suite, "/Matcher/bad_spec/array_ops", test_mongoc_matcher_bad_array_ops);
    TestSuite_Add (suite, "/Matcher/eq/utf8", test_mongoc_matcher_eq_utf8);
    TestSuite_Add (suite, "/Matcher/eq/int32", test_mongoc_matcher_eq_int32);
    TestSuite_Add (suite, "/Matcher/eq/int64", test_mongoc_matcher_eq_int64);
    TestSuite_Add (suite, "/Matcher/eq/doc", test_mongoc_matcher_eq_doc);
    TestSuite_Add (suite, "/Matcher/in/basic", test_mongoc_matcher_in_basic);
+   TestSuite_Add (suite, "/Matcher/program", test_mongoc_matcher_program);
+   TestSuite_Add (suite,
+                  "/Matcher/program/too_large",
+                  test_mongoc_matcher_program_too_large);
+   TestSuite_Add (suite, "/Matcher/array_ops", test_mongoc_matcher_array_ops);
+#ifndef _WIN32
+   TestSuite_Add (suite, "/Matcher/regex", test_mongoc_matcher_regex);
+#endif
 }
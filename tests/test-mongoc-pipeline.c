@@ -0,0 +1,259 @@
+#include <mongoc.h>
+
+#include "mock_server/mock-server.h"
+#include "TestSuite.h"
+#include "test-conveniences.h"
+#include "test-libmongoc.h"
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "pipeline-test"
+
+
+typedef struct {
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+} pipeline_test_t;
+
+
+static void
+pipeline_test_init (pipeline_test_t *test, bool pooled)
+{
+   test->server = mock_server_with_autoismaster (0);
+   mock_server_run (test->server);
+
+   if (pooled) {
+      test->pool = mongoc_client_pool_new (mock_server_get_uri (test->server));
+      test->client = mongoc_client_pool_pop (test->pool);
+   } else {
+      test->pool = NULL;
+      test->client =
+         mongoc_client_new_from_uri (mock_server_get_uri (test->server));
+   }
+}
+
+
+static void
+pipeline_test_cleanup (pipeline_test_t *test)
+{
+   if (test->pool) {
+      mongoc_client_pool_push (test->pool, test->client);
+      mongoc_client_pool_destroy (test->pool);
+   } else {
+      mongoc_client_destroy (test->client);
+   }
+
+   mock_server_destroy (test->server);
+}
+
+
+/* all commands are sent before any reply, on one connection, and replies
+ * are matched to requests by response_to even when they arrive out of order
+ */
+static void
+_test_pipeline_out_of_order (bool pooled)
+{
+   pipeline_test_t test;
+   mongoc_pipeline_t *pipeline;
+   mongoc_pipeline_request_t *requests[3];
+   request_t *server_requests[3];
+   bson_t reply;
+   bson_error_t error;
+   int i;
+
+   pipeline_test_init (&test, pooled);
+   pipeline = mongoc_client_create_pipeline (test.client, NULL);
+
+   for (i = 0; i < 3; i++) {
+      requests[i] = mongoc_pipeline_command (
+         pipeline, "db", tmp_bson ("{'ping': 1, 'i': %d}", i));
+      ASSERT (!mongoc_pipeline_request_is_done (requests[i]));
+   }
+
+   ASSERT_OR_PRINT (mongoc_pipeline_flush (pipeline, &error), error);
+   ASSERT_CMPUINT32 (mongoc_pipeline_get_hint (pipeline), ==, 1);
+
+   for (i = 0; i < 3; i++) {
+      server_requests[i] = mock_server_receives_command (
+         test.server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 1, 'i': %d}", i);
+
+      ASSERT_CMPINT (
+         server_requests[i]->client_port, ==, server_requests[0]->client_port);
+   }
+
+   mock_server_replies_simple (server_requests[2], "{'ok': 1, 'n': 2}");
+   mock_server_replies_simple (server_requests[0], "{'ok': 1, 'n': 0}");
+   mock_server_replies_simple (server_requests[1], "{'ok': 1, 'n': 1}");
+
+   /* reads the reply to the third request, then the first */
+   ASSERT_OR_PRINT (mongoc_pipeline_request_wait (requests[0], &reply, &error),
+                    error);
+   ASSERT_MATCH (&reply, "{'n': 0}");
+   bson_destroy (&reply);
+
+   ASSERT (mongoc_pipeline_request_is_done (requests[2]));
+   ASSERT (!mongoc_pipeline_request_is_done (requests[1]));
+
+   for (i = 1; i < 3; i++) {
+      ASSERT_OR_PRINT (
+         mongoc_pipeline_request_wait (requests[i], &reply, &error), error);
+      ASSERT_MATCH (&reply, "{'n': %d}", i);
+      bson_destroy (&reply);
+   }
+
+   for (i = 0; i < 3; i++) {
+      request_destroy (server_requests[i]);
+   }
+
+   mongoc_pipeline_destroy (pipeline);
+   pipeline_test_cleanup (&test);
+}
+
+
+static void
+test_pipeline_out_of_order_single (void)
+{
+   _test_pipeline_out_of_order (false);
+}
+
+
+static void
+test_pipeline_out_of_order_pooled (void)
+{
+   _test_pipeline_out_of_order (true);
+}
+
+
+/* a command error fails only its own request */
+static void
+test_pipeline_command_error (void)
+{
+   pipeline_test_t test;
+   mongoc_pipeline_t *pipeline;
+   mongoc_pipeline_request_t *bad;
+   mongoc_pipeline_request_t *good;
+   request_t *request;
+   bson_t reply;
+   bson_error_t error;
+
+   pipeline_test_init (&test, false);
+   pipeline = mongoc_client_create_pipeline (test.client, NULL);
+
+   bad = mongoc_pipeline_command (pipeline, "db", tmp_bson ("{'foo': 1}"));
+   good = mongoc_pipeline_command (pipeline, "db", tmp_bson ("{'ping': 1}"));
+   ASSERT_OR_PRINT (mongoc_pipeline_flush (pipeline, &error), error);
+
+   request = mock_server_receives_command (
+      test.server, "db", MONGOC_QUERY_SLAVE_OK, "{'foo': 1}");
+   mock_server_replies_simple (request,
+                               "{'ok': 0, 'code': 59, 'errmsg': 'no foo'}");
+   request_destroy (request);
+
+   request = mock_server_receives_command (
+      test.server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+   mock_server_replies_ok_and_destroys (request);
+
+   ASSERT (!mongoc_pipeline_request_wait (bad, &reply, &error));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_QUERY, 59, "no foo");
+   ASSERT_MATCH (&reply, "{'ok': 0, 'errmsg': 'no foo'}");
+   bson_destroy (&reply);
+
+   ASSERT_OR_PRINT (mongoc_pipeline_request_wait (good, &reply, &error), error);
+   bson_destroy (&reply);
+
+   mongoc_pipeline_destroy (pipeline);
+   pipeline_test_cleanup (&test);
+}
+
+
+/* a network error fails every request in flight */
+static void
+test_pipeline_hangup (void)
+{
+   pipeline_test_t test;
+   mongoc_pipeline_t *pipeline;
+   mongoc_pipeline_request_t *requests[2];
+   request_t *request;
+   bson_t reply;
+   bson_error_t error;
+   int i;
+
+   capture_logs (true);
+
+   pipeline_test_init (&test, false);
+   pipeline = mongoc_client_create_pipeline (test.client, NULL);
+
+   for (i = 0; i < 2; i++) {
+      requests[i] = mongoc_pipeline_command (
+         pipeline, "db", tmp_bson ("{'ping': 1, 'i': %d}", i));
+   }
+
+   ASSERT_OR_PRINT (mongoc_pipeline_flush (pipeline, &error), error);
+
+   request = mock_server_receives_command (
+      test.server, "db", MONGOC_QUERY_SLAVE_OK, "{'ping': 1, 'i': 0}");
+   mock_server_hangs_up (request);
+   request_destroy (request);
+
+   ASSERT (!mongoc_pipeline_request_wait (requests[0], &reply, &error));
+   ASSERT_CMPINT (error.domain, ==, MONGOC_ERROR_STREAM);
+   bson_destroy (&reply);
+
+   ASSERT (mongoc_pipeline_request_is_done (requests[1]));
+   ASSERT (!mongoc_pipeline_request_wait (requests[1], &reply, &error));
+   ASSERT_CMPINT (error.domain, ==, MONGOC_ERROR_STREAM);
+   bson_destroy (&reply);
+
+   mongoc_pipeline_destroy (pipeline);
+   pipeline_test_cleanup (&test);
+}
+
+
+static void
+test_pipeline_empty_command (void)
+{
+   pipeline_test_t test;
+   mongoc_pipeline_t *pipeline;
+   mongoc_pipeline_request_t *request;
+   bson_t reply;
+   bson_error_t error;
+
+   pipeline_test_init (&test, false);
+   pipeline = mongoc_client_create_pipeline (test.client, NULL);
+
+   request = mongoc_pipeline_command (pipeline, "db", tmp_bson ("{}"));
+   ASSERT (mongoc_pipeline_request_is_done (request));
+
+   /* nothing to send */
+   ASSERT_OR_PRINT (mongoc_pipeline_flush (pipeline, &error), error);
+   ASSERT_CMPUINT32 (mongoc_pipeline_get_hint (pipeline), ==, 0);
+
+   ASSERT (!mongoc_pipeline_request_wait (request, &reply, &error));
+   ASSERT_ERROR_CONTAINS (error,
+                          MONGOC_ERROR_COMMAND,
+                          MONGOC_ERROR_COMMAND_INVALID_ARG,
+                          "Empty command document");
+   ASSERT_CMPINT (bson_count_keys (&reply), ==, 0);
+   bson_destroy (&reply);
+
+   mongoc_pipeline_destroy (pipeline);
+   pipeline_test_cleanup (&test);
+}
+
+
+void
+test_pipeline_install (TestSuite *suite)
+{
+   TestSuite_Add (suite,
+                  "/Pipeline/out_of_order/single",
+                  test_pipeline_out_of_order_single);
+   TestSuite_Add (suite,
+                  "/Pipeline/out_of_order/pooled",
+                  test_pipeline_out_of_order_pooled);
+   TestSuite_Add (
+      suite, "/Pipeline/command_error", test_pipeline_command_error);
+   TestSuite_Add (suite, "/Pipeline/hangup", test_pipeline_hangup);
+   TestSuite_Add (
+      suite, "/Pipeline/empty_command", test_pipeline_empty_command);
+}
@@ -0,0 +1,190 @@
+#include <mongoc.h>
+
+#include "mongoc-poller-private.h"
+#include "mongoc-socket-private.h"
+#include "TestSuite.h"
+
+#include "test-libmongoc.h"
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "poller-test"
+
+
+#define N_PAIRS 3
+
+
+typedef struct {
+   mongoc_stream_t *client;
+   mongoc_stream_t *server;
+} stream_pair_t;
+
+
+/* connect a client socket to a listener on localhost and accept it */
+static void
+stream_pair_init (stream_pair_t *pair)
+{
+   struct sockaddr_in server_addr = {0};
+   mongoc_socket_t *listen_sock;
+   mongoc_socket_t *client_sock;
+   mongoc_socket_t *server_sock;
+   socklen_t sock_len;
+   int r;
+
+   listen_sock = mongoc_socket_new (AF_INET, SOCK_STREAM, 0);
+   BSON_ASSERT (listen_sock);
+
+   server_addr.sin_family = AF_INET;
+   server_addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+   server_addr.sin_port = htons (0);
+
+   r = mongoc_socket_bind (
+      listen_sock, (struct sockaddr *) &server_addr, sizeof server_addr);
+   BSON_ASSERT (r == 0);
+
+   sock_len = sizeof (server_addr);
+   r = mongoc_socket_getsockname (
+      listen_sock, (struct sockaddr *) &server_addr, &sock_len);
+   BSON_ASSERT (r == 0);
+
+   r = mongoc_socket_listen (listen_sock, 1);
+   BSON_ASSERT (r == 0);
+
+   client_sock = mongoc_socket_new (AF_INET, SOCK_STREAM, 0);
+   BSON_ASSERT (client_sock);
+
+   r = mongoc_socket_connect (
+      client_sock, (struct sockaddr *) &server_addr, sizeof server_addr, -1);
+   BSON_ASSERT (r == 0);
+
+   server_sock = mongoc_socket_accept (listen_sock, -1);
+   BSON_ASSERT (server_sock);
+
+   mongoc_socket_destroy (listen_sock);
+
+   pair->client = mongoc_stream_socket_new (client_sock);
+   pair->server = mongoc_stream_socket_new (server_sock);
+}
+
+
+static void
+stream_pair_cleanup (stream_pair_t *pair)
+{
+   mongoc_stream_destroy (pair->client);
+   mongoc_stream_destroy (pair->server);
+}
+
+
+static void
+stream_pair_send_byte (stream_pair_t *pair)
+{
+   mongoc_iovec_t iov;
+   char c = 'x';
+
+   iov.iov_base = &c;
+   iov.iov_len = 1;
+
+   ASSERT_CMPINT ((int) mongoc_stream_writev (pair->server, &iov, 1, 1000),
+                  ==,
+                  1);
+}
+
+
+static void
+test_poller_events (void)
+{
+   stream_pair_t pairs[N_PAIRS];
+   mongoc_poller_entry_t *entries[N_PAIRS];
+   mongoc_poller_t *poller;
+   const mongoc_poller_event_t *events;
+   ssize_t n;
+   int i;
+
+   poller = _mongoc_poller_new ();
+
+   for (i = 0; i < N_PAIRS; i++) {
+      stream_pair_init (&pairs[i]);
+      entries[i] =
+         _mongoc_poller_add (poller, pairs[i].client, POLLIN, &pairs[i]);
+   }
+
+   ASSERT_CMPSIZE_T (_mongoc_poller_size (poller), ==, (size_t) N_PAIRS);
+#ifdef __linux__
+   ASSERT (_mongoc_poller_uses_epoll (poller));
+#endif
+
+   /* nothing to read */
+   ASSERT_CMPINT ((int) _mongoc_poller_wait (poller, 0, &events), ==, 0);
+
+   stream_pair_send_byte (&pairs[1]);
+   n = _mongoc_poller_wait (poller, 1000, &events);
+   ASSERT_CMPINT ((int) n, ==, 1);
+   ASSERT (events[0].data == &pairs[1]);
+   ASSERT (events[0].revents & POLLIN);
+
+   /* the unread byte is reported again */
+   ASSERT_CMPINT ((int) _mongoc_poller_wait (poller, 0, &events), ==, 1);
+
+   /* a connected socket is writable */
+   _mongoc_poller_modify (poller, entries[0], POLLOUT);
+   n = _mongoc_poller_wait (poller, 1000, &events);
+   ASSERT_CMPINT ((int) n, ==, 2);
+   for (i = 0; i < n; i++) {
+      if (events[i].data == &pairs[0]) {
+         ASSERT (events[i].revents & POLLOUT);
+      } else {
+         ASSERT (events[i].data == &pairs[1]);
+      }
+   }
+
+   _mongoc_poller_remove (poller, entries[1]);
+   ASSERT_CMPSIZE_T (_mongoc_poller_size (poller), ==, (size_t) N_PAIRS - 1);
+   n = _mongoc_poller_wait (poller, 0, &events);
+   ASSERT_CMPINT ((int) n, ==, 1);
+   ASSERT (events[0].data == &pairs[0]);
+
+   _mongoc_poller_remove (poller, entries[0]);
+   _mongoc_poller_remove (poller, entries[2]);
+   ASSERT_CMPSIZE_T (_mongoc_poller_size (poller), ==, (size_t) 0);
+   ASSERT_CMPINT ((int) _mongoc_poller_wait (poller, 0, &events), ==, 0);
+
+   _mongoc_poller_destroy (poller);
+
+   for (i = 0; i < N_PAIRS; i++) {
+      stream_pair_cleanup (&pairs[i]);
+   }
+}
+
+
+static void
+test_poller_hangup (void)
+{
+   stream_pair_t pair;
+   mongoc_poller_t *poller;
+   mongoc_poller_entry_t *entry;
+   const mongoc_poller_event_t *events;
+
+   stream_pair_init (&pair);
+   poller = _mongoc_poller_new ();
+   entry = _mongoc_poller_add (poller, pair.client, POLLIN, &pair);
+
+   mongoc_stream_destroy (pair.server);
+   pair.server = NULL;
+
+   /* the peer's shutdown is readable, and may also be reported as HUP */
+   ASSERT_CMPINT (
+      (int) _mongoc_poller_wait (poller, 1000, &events), ==, 1);
+   ASSERT (events[0].data == &pair);
+   ASSERT (events[0].revents & (POLLIN | POLLHUP));
+
+   _mongoc_poller_remove (poller, entry);
+   _mongoc_poller_destroy (poller);
+   mongoc_stream_destroy (pair.client);
+}
+
+
+void
+test_poller_install (TestSuite *suite)
+{
+   TestSuite_Add (suite, "/Poller/events", test_poller_events);
+   TestSuite_Add (suite, "/Poller/hangup", test_poller_hangup);
+}
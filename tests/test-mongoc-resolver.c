@@ -0,0 +1,158 @@
+#include <mongoc.h>
+
+#include "mongoc-counters-private.h"
+#include "mongoc-host-list-private.h"
+#include "mongoc-resolver-private.h"
+#include "TestSuite.h"
+
+#include "test-libmongoc.h"
+#include "test-conveniences.h"
+#include "mock_server/future-functions.h"
+#include "mock_server/mock-server.h"
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "resolver-test"
+
+
+#define COUNTER_VALUE(ident) \
+   counter_value (&__mongoc_counter_##ident, COUNTER_##ident)
+
+
+static int64_t
+counter_value (mongoc_counter_t *counter, int num)
+{
+   int64_t value = 0;
+   unsigned i;
+
+   for (i = 0; i < _mongoc_get_cpu_count (); i++) {
+      value += counter->cpus[i].slots[num % SLOTS_PER_CACHELINE];
+   }
+
+   return value;
+}
+
+
+static void
+test_resolver_cache (void)
+{
+   mongoc_host_list_t host;
+   struct addrinfo *result;
+   bson_error_t error;
+   int64_t hits;
+   int64_t lookups;
+
+   _mongoc_resolver_clear ();
+   ASSERT (_mongoc_host_list_from_string (&host, "127.0.0.1:27017"));
+   hits = COUNTER_VALUE (dns_cache_hit);
+   lookups = COUNTER_VALUE (dns_success);
+
+   /* the first lookup is on another thread */
+   ASSERT_CMPINT (_mongoc_resolver_start (&host, false, &result, &error),
+                  ==,
+                  MONGOC_RESOLVER_PENDING);
+   ASSERT (!result);
+
+   ASSERT_OR_PRINT (_mongoc_resolver_resolve (
+                       &host, bson_get_monotonic_time () + 10 * 1000 * 1000,
+                       &result,
+                       &error),
+                    error);
+   ASSERT (result);
+   ASSERT (result->ai_addr);
+   ASSERT_CMPINT (result->ai_family, ==, AF_INET);
+   _mongoc_resolver_free_results (result);
+
+   /* waiting for the lookup isn't a cache hit */
+   ASSERT_CMPINT64 (COUNTER_VALUE (dns_success), ==, lookups + 1);
+   ASSERT_CMPINT64 (COUNTER_VALUE (dns_cache_hit), ==, hits);
+
+   /* the second is answered from the cache */
+   lookups = COUNTER_VALUE (dns_success);
+   ASSERT_CMPINT (_mongoc_resolver_start (&host, false, &result, &error),
+                  ==,
+                  MONGOC_RESOLVER_DONE);
+   ASSERT (result);
+   _mongoc_resolver_free_results (result);
+   ASSERT_CMPINT64 (COUNTER_VALUE (dns_cache_hit), ==, hits + 1);
+   ASSERT_CMPINT64 (COUNTER_VALUE (dns_success), ==, lookups);
+
+   _mongoc_resolver_clear ();
+}
+
+
+static void
+test_resolver_failure (void)
+{
+   mongoc_host_list_t host;
+   struct addrinfo *result;
+   bson_error_t error;
+   int64_t failures;
+   int64_t hits;
+
+   _mongoc_resolver_clear ();
+   ASSERT (_mongoc_host_list_from_string (&host, "doesntexist.invalid:1"));
+
+   ASSERT (!_mongoc_resolver_resolve (
+      &host, bson_get_monotonic_time () + 10 * 1000 * 1000, &result, &error));
+   ASSERT (!result);
+   ASSERT_ERROR_CONTAINS (error,
+                          MONGOC_ERROR_STREAM,
+                          MONGOC_ERROR_STREAM_NAME_RESOLUTION,
+                          "Failed to resolve 'doesntexist.invalid'");
+
+   /* the failure is remembered, but it isn't a cache hit */
+   failures = COUNTER_VALUE (dns_failure);
+   hits = COUNTER_VALUE (dns_cache_hit);
+   memset (&error, 0, sizeof error);
+   ASSERT_CMPINT (_mongoc_resolver_start (&host, false, &result, &error),
+                  ==,
+                  MONGOC_RESOLVER_FAILED);
+   ASSERT_ERROR_CONTAINS (error,
+                          MONGOC_ERROR_STREAM,
+                          MONGOC_ERROR_STREAM_NAME_RESOLUTION,
+                          "Failed to resolve 'doesntexist.invalid'");
+   ASSERT_CMPINT64 (COUNTER_VALUE (dns_failure), ==, failures);
+   ASSERT_CMPINT64 (COUNTER_VALUE (dns_cache_hit), ==, hits);
+
+   _mongoc_resolver_clear ();
+}
+
+
+/* the topology scanner waits for a lookup without blocking */
+static void
+test_resolver_scanner (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+
+   _mongoc_resolver_clear ();
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   future = future_client_command_simple (
+      client, "admin", tmp_bson ("{'ping': 1}"), NULL, NULL, &error);
+
+   request = mock_server_receives_command (
+      server, "admin", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+
+   mock_server_replies_simple (request, "{'ok': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+
+   future_destroy (future);
+   request_destroy (request);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+void
+test_resolver_install (TestSuite *suite)
+{
+   TestSuite_Add (suite, "/Resolver/cache", test_resolver_cache);
+   TestSuite_Add (suite, "/Resolver/failure", test_resolver_failure);
+   TestSuite_Add (suite, "/Resolver/scanner", test_resolver_scanner);
+}
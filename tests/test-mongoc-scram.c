@@ -0,0 +1,137 @@
+#include <mongoc.h>
+
+#include "mongoc-config.h"
+#include "mongoc-counters-private.h"
+#include "mongoc-scram-private.h"
+#include "TestSuite.h"
+
+#include "test-libmongoc.h"
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "scram-test"
+
+
+#ifdef MONGOC_ENABLE_CRYPTO
+
+#define COUNTER_VALUE(ident) \
+   counter_value (&__mongoc_counter_##ident, COUNTER_##ident)
+
+
+static int64_t
+counter_value (mongoc_counter_t *counter, int num)
+{
+   int64_t value = 0;
+   unsigned i;
+
+   for (i = 0; i < _mongoc_get_cpu_count (); i++) {
+      value += counter->cpus[i].slots[num % SLOTS_PER_CACHELINE];
+   }
+
+   return value;
+}
+
+
+/* 16 bytes each, base64-encoded */
+#define SALT_A "AAAAAAAAAAAAAAAAAAAAAA=="
+#define SALT_B "AQEBAQEBAQEBAQEBAQEBAQ=="
+
+
+/* run the client side of a conversation up to the client-final-message,
+ * and return the SaltedPassword it computed */
+static void
+scram_salted_password (mongoc_scram_cache_t *cache,
+                       const char *pass,
+                       const char *salt,
+                       int iterations,
+                       uint8_t *salted_password)
+{
+   mongoc_scram_t scram;
+   uint8_t buf[4096];
+   uint32_t buflen = 0;
+   char *client_nonce;
+   char *server_first;
+   bson_error_t error;
+
+   _mongoc_scram_init (&scram);
+   _mongoc_scram_set_user (&scram, "user");
+   _mongoc_scram_set_pass (&scram, pass);
+   _mongoc_scram_set_cache (&scram, cache);
+
+   /* client-first-message is "n,,n=user,r=nonce" */
+   ASSERT_OR_PRINT (
+      _mongoc_scram_step (
+         &scram, NULL, 0, buf, sizeof buf - 1, &buflen, &error),
+      error);
+   buf[buflen] = '\0';
+   client_nonce = strstr ((char *) buf, "r=");
+   ASSERT (client_nonce);
+
+   server_first = bson_strdup_printf (
+      "%sservernonce,s=%s,i=%d", client_nonce, salt, iterations);
+
+   ASSERT_OR_PRINT (_mongoc_scram_step (&scram,
+                                        (uint8_t *) server_first,
+                                        (uint32_t) strlen (server_first),
+                                        buf,
+                                        sizeof buf,
+                                        &buflen,
+                                        &error),
+                    error);
+
+   memcpy (salted_password, scram.salted_password, MONGOC_SCRAM_HASH_SIZE);
+
+   bson_free (server_first);
+   _mongoc_scram_destroy (&scram);
+}
+
+
+static void
+test_scram_cache (void)
+{
+   mongoc_scram_cache_t cache;
+   uint8_t expected[MONGOC_SCRAM_HASH_SIZE];
+   uint8_t salted_password[MONGOC_SCRAM_HASH_SIZE];
+   uint8_t zeros[sizeof cache] = {0};
+   int64_t hits;
+
+   /* no cache */
+   scram_salted_password (NULL, "pencil", SALT_A, 4096, expected);
+
+   _mongoc_scram_cache_init (&cache);
+   hits = COUNTER_VALUE (auth_scram_cache_hit);
+
+   /* a miss fills the cache */
+   scram_salted_password (&cache, "pencil", SALT_A, 4096, salted_password);
+   ASSERT (cache.set);
+   ASSERT (!memcmp (salted_password, expected, MONGOC_SCRAM_HASH_SIZE));
+   ASSERT_CMPINT64 (COUNTER_VALUE (auth_scram_cache_hit), ==, hits);
+
+   /* a hit */
+   scram_salted_password (&cache, "pencil", SALT_A, 4096, salted_password);
+   ASSERT (!memcmp (salted_password, expected, MONGOC_SCRAM_HASH_SIZE));
+   ASSERT_CMPINT64 (COUNTER_VALUE (auth_scram_cache_hit), ==, hits + 1);
+
+   /* the password, salt, and iteration count are each part of the key */
+   scram_salted_password (&cache, "pen", SALT_A, 4096, salted_password);
+   ASSERT (memcmp (salted_password, expected, MONGOC_SCRAM_HASH_SIZE));
+   scram_salted_password (&cache, "pencil", SALT_B, 4096, salted_password);
+   ASSERT (memcmp (salted_password, expected, MONGOC_SCRAM_HASH_SIZE));
+   scram_salted_password (&cache, "pencil", SALT_A, 4097, salted_password);
+   ASSERT (memcmp (salted_password, expected, MONGOC_SCRAM_HASH_SIZE));
+   ASSERT_CMPINT64 (COUNTER_VALUE (auth_scram_cache_hit), ==, hits + 1);
+
+   /* the keys are zeroed */
+   _mongoc_scram_cache_destroy (&cache);
+   ASSERT (!memcmp (&cache, zeros, sizeof cache));
+}
+
+#endif /* MONGOC_ENABLE_CRYPTO */
+
+
+void
+test_scram_install (TestSuite *suite)
+{
+#ifdef MONGOC_ENABLE_CRYPTO
+   TestSuite_Add (suite, "/Scram/cache", test_scram_cache);
+#endif
+}
@@ -385,6 +385,119 @@ test_mongoc_socket_sendv (void *ctx)
    mongoc_cond_destroy (&data.cond);
 }
 
+static void
+test_mongoc_socket_sort_addrinfo (void)
+{
+   struct addrinfo ai[5];
+   struct addrinfo **sorted;
+   int families[] = {AF_INET6, AF_INET6, AF_INET6, AF_INET, AF_INET};
+   int i;
+
+   memset (ai, 0, sizeof ai);
+   for (i = 0; i < 5; i++) {
+      ai[i].ai_family = families[i];
+      ai[i].ai_next = i < 4 ? &ai[i + 1] : NULL;
+   }
+
+   /* families alternate, beginning with the first address's */
+   ASSERT_CMPSIZE_T (
+      _mongoc_socket_sort_addrinfo (ai, &sorted), ==, (size_t) 5);
+   ASSERT (sorted[0] == &ai[0]);
+   ASSERT (sorted[1] == &ai[3]);
+   ASSERT (sorted[2] == &ai[1]);
+   ASSERT (sorted[3] == &ai[4]);
+   ASSERT (sorted[4] == &ai[2]);
+   bson_free (sorted);
+
+   /* one family */
+   ASSERT_CMPSIZE_T (
+      _mongoc_socket_sort_addrinfo (&ai[3], &sorted), ==, (size_t) 2);
+   ASSERT (sorted[0] == &ai[3]);
+   ASSERT (sorted[1] == &ai[4]);
+   bson_free (sorted);
+}
+
+
+/* a socket bound to a loopback port, with its address in @ai */
+static mongoc_socket_t *
+bind_loopback (struct sockaddr_in *addr, struct addrinfo *ai)
+{
+   mongoc_socket_t *sock;
+   socklen_t sock_len;
+   int r;
+
+   sock = mongoc_socket_new (AF_INET, SOCK_STREAM, 0);
+   assert (sock);
+
+   memset (addr, 0, sizeof *addr);
+   addr->sin_family = AF_INET;
+   addr->sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+   addr->sin_port = htons (0);
+
+   r = mongoc_socket_bind (sock, (struct sockaddr *) addr, sizeof *addr);
+   assert (r == 0);
+
+   sock_len = sizeof *addr;
+   r = mongoc_socket_getsockname (sock, (struct sockaddr *) addr, &sock_len);
+   assert (r == 0);
+
+   memset (ai, 0, sizeof *ai);
+   ai->ai_family = AF_INET;
+   ai->ai_socktype = SOCK_STREAM;
+   ai->ai_addr = (struct sockaddr *) addr;
+   ai->ai_addrlen = sizeof *addr;
+
+   return sock;
+}
+
+
+static void
+test_mongoc_socket_connect_race (void *ctx)
+{
+   struct sockaddr_in refused_addr;
+   struct sockaddr_in listen_addr;
+   struct addrinfo ai[2];
+   mongoc_socket_t *refused_sock;
+   mongoc_socket_t *listen_sock;
+   mongoc_socket_t *conn_sock;
+   mongoc_socket_t *server_sock;
+   int64_t start;
+
+   /* bound but not listening, connections are refused */
+   refused_sock = bind_loopback (&refused_addr, &ai[0]);
+   listen_sock = bind_loopback (&listen_addr, &ai[1]);
+   ASSERT_CMPINT (mongoc_socket_listen (listen_sock, 10), ==, 0);
+
+   capture_logs (true);
+
+   /* the refused address doesn't delay the next */
+   ai[0].ai_next = &ai[1];
+   start = bson_get_monotonic_time ();
+   conn_sock = _mongoc_socket_connect_race (ai, start + TIMEOUT * 1000);
+   ASSERT (conn_sock);
+   ASSERT_CMPINT64 (bson_get_monotonic_time () - start,
+                    <,
+                    (int64_t) MONGOC_HAPPY_EYEBALLS_DELAY_MS * 1000);
+
+   server_sock = mongoc_socket_accept (
+      listen_sock, bson_get_monotonic_time () + TIMEOUT * 1000);
+   ASSERT (server_sock);
+
+   /* all addresses fail */
+   ai[0].ai_next = NULL;
+   ASSERT (!_mongoc_socket_connect_race (
+      ai, bson_get_monotonic_time () + TIMEOUT * 1000));
+   ASSERT_CAPTURED_LOG ("_mongoc_socket_connect_race",
+                        MONGOC_LOG_LEVEL_WARNING,
+                        "Failed to connect to: ipv4 127.0.0.1");
+
+   mongoc_socket_destroy (server_sock);
+   mongoc_socket_destroy (conn_sock);
+   mongoc_socket_destroy (listen_sock);
+   mongoc_socket_destroy (refused_sock);
+}
+
+
 void
 test_socket_install (TestSuite *suite)
 {
@@ -396,4 +509,12 @@ test_socket_install (TestSuite *suite)
                       NULL,
                       NULL,
                       test_framework_skip_if_slow);
+   TestSuite_Add (
+      suite, "/Socket/sort_addrinfo", test_mongoc_socket_sort_addrinfo);
+   TestSuite_AddFull (suite,
+                      "/Socket/connect_race",
+                      test_mongoc_socket_connect_race,
+                      NULL,
+                      NULL,
+                      test_framework_skip_if_slow);
 }
@@ -3,6 +3,9 @@
 
 #ifdef MONGOC_ENABLE_SSL_OPENSSL
 #include <openssl/err.h>
+
+#include "mongoc-counters-private.h"
+#include "mongoc-openssl-private.h"
 #endif
 
 #include "ssl-test.h"
@@ -383,6 +386,110 @@ test_mongoc_tls_trust_dir (void)
 #endif
 
 
+#ifdef MONGOC_ENABLE_SSL_OPENSSL
+#define COUNTER_VALUE(ident) \
+   counter_value (&__mongoc_counter_##ident, COUNTER_##ident)
+
+
+static int64_t
+counter_value (mongoc_counter_t *counter, int num)
+{
+   int64_t value = 0;
+   unsigned i;
+
+   for (i = 0; i < _mongoc_get_cpu_count (); i++) {
+      value += counter->cpus[i].slots[num % SLOTS_PER_CACHELINE];
+   }
+
+   return value;
+}
+
+
+/* a client's streams share one SSL_CTX and cache their sessions */
+static void
+test_mongoc_tls_shared (void)
+{
+   mongoc_openssl_shared_t shared;
+   SSL_CTX *ctx;
+   mongoc_ssl_opt_t sopt = {0};
+   mongoc_ssl_opt_t copt = {0};
+   ssl_test_result_t sr;
+   ssl_test_result_t cr;
+   int64_t full;
+   int64_t resumed;
+
+   _mongoc_openssl_shared_init (&shared);
+
+   sopt.ca_file = CERT_CA;
+   sopt.pem_file = CERT_SERVER;
+
+   copt.ca_file = CERT_CA;
+   copt.pem_file = CERT_CLIENT;
+
+   full = COUNTER_VALUE (tls_handshakes_full);
+   resumed = COUNTER_VALUE (tls_handshakes_resumed);
+
+   /* the client's SSL_CTX is kept, and its session is cached */
+   ssl_test_shared (&copt, &sopt, "localhost", &shared, &cr, &sr);
+   ASSERT_CMPINT (cr.result, ==, SSL_TEST_SUCCESS);
+   ASSERT_CMPINT (sr.result, ==, SSL_TEST_SUCCESS);
+   ASSERT (shared.ctx);
+   ASSERT_CMPSIZE_T (shared.sessions.len, ==, (size_t) 1);
+   ctx = shared.ctx;
+
+   /* each ssl_test server listens on a new port of the same host. it is
+    * another server, so it gets its own session and isn't offered the
+    * first server's */
+   ssl_test_shared (&copt, &sopt, "localhost", &shared, &cr, &sr);
+   ASSERT_CMPINT (cr.result, ==, SSL_TEST_SUCCESS);
+   ASSERT_CMPINT (sr.result, ==, SSL_TEST_SUCCESS);
+   ASSERT (shared.ctx == ctx);
+   ASSERT_CMPSIZE_T (shared.sessions.len, ==, (size_t) 2);
+
+   /* client and server handshakes, twice */
+   ASSERT_CMPINT64 (COUNTER_VALUE (tls_handshakes_full), ==, full + 4);
+   ASSERT_CMPINT64 (COUNTER_VALUE (tls_handshakes_resumed), ==, resumed);
+
+   /* new options rebuild the SSL_CTX */
+   _mongoc_openssl_shared_reset (&shared);
+   ASSERT (!shared.ctx);
+   ASSERT_CMPSIZE_T (shared.sessions.len, ==, (size_t) 0);
+
+   _mongoc_openssl_shared_destroy (&shared);
+}
+
+
+/* small iovecs are packed into full TLS records */
+static void
+test_mongoc_tls_coalesce (void)
+{
+   mongoc_ssl_opt_t sopt = {0};
+   mongoc_ssl_opt_t copt = {0};
+   ssl_test_result_t sr;
+   ssl_test_result_t cr;
+   int64_t records;
+
+   sopt.ca_file = CERT_CA;
+   sopt.pem_file = CERT_SERVER;
+
+   copt.ca_file = CERT_CA;
+   copt.pem_file = CERT_CLIENT;
+
+   records = COUNTER_VALUE (tls_records_out);
+
+   ssl_test (&copt, &sopt, "localhost", &cr, &sr);
+   ASSERT_CMPINT (cr.result, ==, SSL_TEST_SUCCESS);
+   ASSERT_CMPINT (sr.result, ==, SSL_TEST_SUCCESS);
+
+#ifdef SSL3_RT_HEADER
+   /* the client sends a 4-byte length and then 2000 4-byte iovecs in one
+    * writev, and the server echoes the 8000 bytes: one record each */
+   ASSERT_CMPINT64 (COUNTER_VALUE (tls_records_out), ==, records + 3);
+#endif
+}
+#endif
+
+
 void
 test_stream_tls_install (TestSuite *suite)
 {
@@ -408,6 +515,8 @@ test_stream_tls_install (TestSuite *suite)
    TestSuite_Add (
       suite, "/TLS/weak_cert_validation", test_mongoc_tls_weak_cert_validation);
    TestSuite_Add (suite, "/TLS/crl", test_mongoc_tls_crl);
+   TestSuite_Add (suite, "/TLS/shared", test_mongoc_tls_shared);
+   TestSuite_Add (suite, "/TLS/coalesce", test_mongoc_tls_coalesce);
 #endif
 
 #if !defined(__APPLE__) && !defined(_WIN32) && \
@@ -588,6 +588,51 @@ test_mongoc_uri_functions (void)
 #undef ASSERT_SUPPRESS
 
 
+static void
+test_mongoc_uri_compressors (void)
+{
+   mongoc_uri_t *uri;
+
+   capture_logs (true);
+
+   uri = mongoc_uri_new ("mongodb://localhost/?compressors=foo,,bar");
+   ASSERT (uri);
+   ASSERT (bson_empty (mongoc_uri_get_compressors (uri)));
+   ASSERT_CAPTURED_LOG ("mongoc_uri_new",
+                        MONGOC_LOG_LEVEL_WARNING,
+                        "Unsupported compressor: 'foo'");
+   mongoc_uri_destroy (uri);
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   clear_captured_logs ();
+   uri = mongoc_uri_new (
+      "mongodb://localhost/?compressors=snappy,ZLIB&zlibCompressionLevel=5");
+   ASSERT (uri);
+   ASSERT (bson_has_field (mongoc_uri_get_compressors (uri), "zlib"));
+   ASSERT_CMPINT (
+      mongoc_uri_get_option_as_int32 (uri, "zlibcompressionlevel", -1), ==, 5);
+
+   /* setter replaces the list, NULL clears it */
+   ASSERT (mongoc_uri_set_compressors (uri, "zlib"));
+   ASSERT_CMPINT (bson_count_keys (mongoc_uri_get_compressors (uri)), ==, 1);
+   ASSERT (mongoc_uri_set_compressors (uri, NULL));
+   ASSERT (bson_empty (mongoc_uri_get_compressors (uri)));
+   mongoc_uri_destroy (uri);
+#endif
+
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+   uri = mongoc_uri_new ("mongodb://localhost/?compressors=snappy");
+   ASSERT (uri);
+   ASSERT (bson_has_field (mongoc_uri_get_compressors (uri), "snappy"));
+   mongoc_uri_destroy (uri);
+#endif
+
+   /* out of range */
+   ASSERT (!mongoc_uri_new ("mongodb://localhost/?zlibCompressionLevel=10"));
+   ASSERT (!mongoc_uri_new ("mongodb://localhost/?zlibCompressionLevel=-2"));
+}
+
+
 static void
 test_mongoc_uri_compound_setters (void)
 {
@@ -1088,5 +1133,6 @@ test_uri_install (TestSuite *suite)
    TestSuite_Add (suite, "/Uri/functions", test_mongoc_uri_functions);
    TestSuite_Add (
       suite, "/Uri/compound_setters", test_mongoc_uri_compound_setters);
+   TestSuite_Add (suite, "/Uri/compressors", test_mongoc_uri_compressors);
    TestSuite_Add (suite, "/Uri/long_hostname", test_mongoc_uri_long_hostname);
 }
@@ -0,0 +1,253 @@
+/*
+ * Compare the cost of waiting for one ready stream among many, with
+ * mongoc_stream_poll and with the persistent poller used by
+ * mongoc_async_t, as the number of nodes grows.
+ *
+ * Usage: test-poller-bench [MAX_NODES] [ITERATIONS]
+ *
+ * Each node is a connected pair of localhost sockets, so MAX_NODES must be
+ * less than half the open file limit.
+ */
+
+#include <mongoc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mongoc-poller-private.h"
+
+
+typedef struct {
+   mongoc_stream_t *client;
+   mongoc_stream_t *server;
+} node_t;
+
+
+static mongoc_socket_t *
+listen_localhost (struct sockaddr_in *server_addr)
+{
+   mongoc_socket_t *listen_sock;
+   socklen_t sock_len;
+
+   listen_sock = mongoc_socket_new (AF_INET, SOCK_STREAM, 0);
+   BSON_ASSERT (listen_sock);
+
+   memset (server_addr, 0, sizeof *server_addr);
+   server_addr->sin_family = AF_INET;
+   server_addr->sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+   server_addr->sin_port = htons (0);
+
+   BSON_ASSERT (0 == mongoc_socket_bind (listen_sock,
+                                         (struct sockaddr *) server_addr,
+                                         sizeof *server_addr));
+
+   sock_len = sizeof *server_addr;
+   BSON_ASSERT (0 == mongoc_socket_getsockname (
+                        listen_sock, (struct sockaddr *) server_addr, &sock_len));
+
+   BSON_ASSERT (0 == mongoc_socket_listen (listen_sock, 10));
+
+   return listen_sock;
+}
+
+
+static void
+nodes_init (node_t *nodes, int n_nodes)
+{
+   struct sockaddr_in server_addr;
+   mongoc_socket_t *listen_sock;
+   mongoc_socket_t *client_sock;
+   mongoc_socket_t *server_sock;
+   int i;
+
+   listen_sock = listen_localhost (&server_addr);
+
+   for (i = 0; i < n_nodes; i++) {
+      client_sock = mongoc_socket_new (AF_INET, SOCK_STREAM, 0);
+      if (!client_sock) {
+         fprintf (stderr, "Out of sockets, lower MAX_NODES\n");
+         abort ();
+      }
+
+      BSON_ASSERT (0 == mongoc_socket_connect (client_sock,
+                                               (struct sockaddr *) &server_addr,
+                                               sizeof server_addr,
+                                               -1));
+
+      server_sock = mongoc_socket_accept (listen_sock, -1);
+      BSON_ASSERT (server_sock);
+
+      nodes[i].client = mongoc_stream_socket_new (client_sock);
+      nodes[i].server = mongoc_stream_socket_new (server_sock);
+   }
+
+   mongoc_socket_destroy (listen_sock);
+}
+
+
+static void
+nodes_cleanup (node_t *nodes, int n_nodes)
+{
+   int i;
+
+   for (i = 0; i < n_nodes; i++) {
+      mongoc_stream_destroy (nodes[i].client);
+      mongoc_stream_destroy (nodes[i].server);
+   }
+}
+
+
+static void
+send_byte (mongoc_stream_t *stream)
+{
+   mongoc_iovec_t iov;
+   char c = 'x';
+
+   iov.iov_base = &c;
+   iov.iov_len = 1;
+
+   BSON_ASSERT (1 == mongoc_stream_writev (stream, &iov, 1, 1000));
+}
+
+
+static void
+recv_byte (mongoc_stream_t *stream)
+{
+   mongoc_iovec_t iov;
+   char c;
+
+   iov.iov_base = &c;
+   iov.iov_len = 1;
+
+   BSON_ASSERT (1 == mongoc_stream_readv (stream, &iov, 1, 1, 1000));
+}
+
+
+/* like mongoc_async_run before the poller: rebuild the array and poll() all
+ * streams on each wakeup */
+static double
+bench_stream_poll (node_t *nodes, int n_nodes, int iterations)
+{
+   mongoc_stream_poll_t *streams = NULL;
+   int64_t start;
+   ssize_t nactive;
+   int ready;
+   int i;
+   int j;
+
+   start = bson_get_monotonic_time ();
+
+   for (i = 0; i < iterations; i++) {
+      ready = rand () % n_nodes;
+      send_byte (nodes[ready].server);
+
+      streams = (mongoc_stream_poll_t *) bson_realloc (
+         streams, n_nodes * sizeof (mongoc_stream_poll_t));
+
+      for (j = 0; j < n_nodes; j++) {
+         streams[j].stream = nodes[j].client;
+         streams[j].events = POLLIN;
+         streams[j].revents = 0;
+      }
+
+      nactive = mongoc_stream_poll (streams, (size_t) n_nodes, 1000);
+      BSON_ASSERT (nactive == 1);
+
+      for (j = 0; j < n_nodes; j++) {
+         if (streams[j].revents & POLLIN) {
+            recv_byte (streams[j].stream);
+         }
+      }
+   }
+
+   bson_free (streams);
+
+   return (double) (bson_get_monotonic_time () - start) / iterations;
+}
+
+
+static double
+bench_poller (node_t *nodes, int n_nodes, int iterations, bool *uses_epoll)
+{
+   mongoc_poller_t *poller;
+   const mongoc_poller_event_t *events;
+   int64_t start;
+   ssize_t nactive;
+   int ready;
+   int i;
+
+   poller = _mongoc_poller_new ();
+
+   for (i = 0; i < n_nodes; i++) {
+      _mongoc_poller_add (poller, nodes[i].client, POLLIN, &nodes[i]);
+   }
+
+   *uses_epoll = _mongoc_poller_uses_epoll (poller);
+
+   start = bson_get_monotonic_time ();
+
+   for (i = 0; i < iterations; i++) {
+      ready = rand () % n_nodes;
+      send_byte (nodes[ready].server);
+
+      nactive = _mongoc_poller_wait (poller, 1000, &events);
+      BSON_ASSERT (nactive == 1);
+      BSON_ASSERT (events[0].data == &nodes[ready]);
+
+      recv_byte (nodes[ready].client);
+   }
+
+   _mongoc_poller_destroy (poller);
+
+   return (double) (bson_get_monotonic_time () - start) / iterations;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+   int max_nodes = 256;
+   int iterations = 10000;
+   node_t *nodes;
+   int n_nodes;
+   double poll_usec;
+   double poller_usec;
+   bool uses_epoll = false;
+
+   if (argc > 1) {
+      max_nodes = atoi (argv[1]);
+   }
+
+   if (argc > 2) {
+      iterations = atoi (argv[2]);
+   }
+
+   if (max_nodes < 1 || iterations < 1) {
+      fprintf (stderr, "Usage: %s [MAX_NODES] [ITERATIONS]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_init ();
+   srand (0);
+
+   nodes = (node_t *) bson_malloc0 (max_nodes * sizeof (node_t));
+
+   printf ("%8s %16s %16s\n", "nodes", "poll usec/wait", "poller usec/wait");
+
+   for (n_nodes = 1; n_nodes <= max_nodes; n_nodes *= 2) {
+      nodes_init (nodes, n_nodes);
+
+      poll_usec = bench_stream_poll (nodes, n_nodes, iterations);
+      poller_usec = bench_poller (nodes, n_nodes, iterations, &uses_epoll);
+
+      printf ("%8d %16.2f %16.2f\n", n_nodes, poll_usec, poller_usec);
+
+      nodes_cleanup (nodes, n_nodes);
+   }
+
+   printf ("poller backend: %s\n", uses_epoll ? "epoll" : "poll");
+
+   bson_free (nodes);
+   mongoc_cleanup ();
+
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+/*
+ * Time how long a client pool takes to open and authenticate many
+ * connections, as it does when every pooled client reconnects after a
+ * failover.
+ *
+ * Usage: test-scram-bench URI [N_CLIENTS]
+ *
+ * The URI must include a username and password for SCRAM-SHA-1. Only
+ * public API is used, so the program can be built against an older driver
+ * to compare.
+ */
+
+#include <mongoc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int
+main (int argc, char *argv[])
+{
+   int n_clients = 500;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *first;
+   mongoc_client_t **clients;
+   bson_t ping = BSON_INITIALIZER;
+   bson_error_t error;
+   int64_t start;
+   double elapsed;
+   int i;
+
+   if (argc < 2) {
+      fprintf (stderr, "Usage: %s URI [N_CLIENTS]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   if (argc > 2) {
+      n_clients = atoi (argv[2]);
+   }
+
+   if (n_clients < 1) {
+      fprintf (stderr, "Usage: %s URI [N_CLIENTS]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_init ();
+
+   uri = mongoc_uri_new (argv[1]);
+   if (!uri || !mongoc_uri_get_username (uri)) {
+      fprintf (stderr, "Invalid URI, or no username: \"%s\"\n", argv[1]);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_uri_set_option_as_int32 (uri, "maxPoolSize", n_clients + 1);
+   pool = mongoc_client_pool_new (uri);
+   clients = (mongoc_client_t **) bson_malloc (n_clients * sizeof *clients);
+   BSON_APPEND_INT32 (&ping, "ping", 1);
+
+   /* wait for the scanner to find the server, and keep this client out of
+    * the pool so the others each authenticate */
+   first = mongoc_client_pool_pop (pool);
+   if (!mongoc_client_command_simple (
+          first, "admin", &ping, NULL, NULL, &error)) {
+      fprintf (stderr, "ping failed: %s\n", error.message);
+      return EXIT_FAILURE;
+   }
+
+   /* each client opens and authenticates its own connection */
+   start = bson_get_monotonic_time ();
+
+   for (i = 0; i < n_clients; i++) {
+      clients[i] = mongoc_client_pool_pop (pool);
+      if (!mongoc_client_command_simple (
+             clients[i], "admin", &ping, NULL, NULL, &error)) {
+         fprintf (stderr, "ping failed: %s\n", error.message);
+         return EXIT_FAILURE;
+      }
+   }
+
+   elapsed = (double) (bson_get_monotonic_time () - start) / 1e6;
+
+   printf ("%d connections in %.3f sec, %.3f ms each\n",
+           n_clients,
+           elapsed,
+           elapsed * 1e3 / n_clients);
+
+   for (i = 0; i < n_clients; i++) {
+      mongoc_client_pool_push (pool, clients[i]);
+   }
+
+   mongoc_client_pool_push (pool, first);
+
+   bson_free (clients);
+   bson_destroy (&ping);
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+   mongoc_cleanup ();
+
+   return EXIT_SUCCESS;
+}
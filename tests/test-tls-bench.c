@@ -0,0 +1,146 @@
+/*
+ * Count how many TLS connections per second a client pool opens, when each
+ * pooled client connects to the server for the first time. With a large CA
+ * file, such as a system bundle, most of each connection's cost used to be
+ * loading and parsing the CA file again.
+ *
+ * Then time bulk inserts of small documents into "test.tls_bench", whose
+ * messages are made of many small iovecs. Run mongoc-stat on the program to
+ * see the "TLS Records Sent" for the batches.
+ *
+ * Usage: test-tls-bench URI CA_FILE [N_CLIENTS]
+ *
+ * Only public API is used, so the program can be built against an older
+ * driver to compare.
+ */
+
+#include <mongoc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int
+main (int argc, char *argv[])
+{
+#ifdef MONGOC_ENABLE_SSL
+   int n_clients = 500;
+   mongoc_uri_t *uri;
+   mongoc_ssl_opt_t ssl_opts = {0};
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *first;
+   mongoc_client_t **clients;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   bson_t ping = BSON_INITIALIZER;
+   bson_t doc;
+   bson_error_t error;
+   int64_t start;
+   double elapsed;
+   int i;
+   int j;
+
+   if (argc < 3) {
+      fprintf (stderr, "Usage: %s URI CA_FILE [N_CLIENTS]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   if (argc > 3) {
+      n_clients = atoi (argv[3]);
+   }
+
+   if (n_clients < 1) {
+      fprintf (stderr, "Usage: %s URI CA_FILE [N_CLIENTS]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_init ();
+
+   uri = mongoc_uri_new (argv[1]);
+   if (!uri) {
+      fprintf (stderr, "Invalid URI: \"%s\"\n", argv[1]);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_uri_set_option_as_int32 (uri, "maxPoolSize", n_clients + 1);
+   pool = mongoc_client_pool_new (uri);
+   ssl_opts.ca_file = argv[2];
+   mongoc_client_pool_set_ssl_opts (pool, &ssl_opts);
+   clients = (mongoc_client_t **) bson_malloc (n_clients * sizeof *clients);
+   BSON_APPEND_INT32 (&ping, "ping", 1);
+
+   /* wait for the scanner to find the server, and keep this client out of
+    * the pool so the others each connect */
+   first = mongoc_client_pool_pop (pool);
+   if (!mongoc_client_command_simple (
+          first, "admin", &ping, NULL, NULL, &error)) {
+      fprintf (stderr, "ping failed: %s\n", error.message);
+      return EXIT_FAILURE;
+   }
+
+   /* each client opens its own connection */
+   start = bson_get_monotonic_time ();
+
+   for (i = 0; i < n_clients; i++) {
+      clients[i] = mongoc_client_pool_pop (pool);
+      if (!mongoc_client_command_simple (
+             clients[i], "admin", &ping, NULL, NULL, &error)) {
+         fprintf (stderr, "ping failed: %s\n", error.message);
+         return EXIT_FAILURE;
+      }
+   }
+
+   elapsed = (double) (bson_get_monotonic_time () - start) / 1e6;
+
+   printf ("%d connections in %.3f sec, %.1f per sec\n",
+           n_clients,
+           elapsed,
+           n_clients / elapsed);
+
+   for (i = 0; i < n_clients; i++) {
+      mongoc_client_pool_push (pool, clients[i]);
+   }
+
+   collection = mongoc_client_get_collection (first, "test", "tls_bench");
+   mongoc_collection_drop (collection, NULL);
+   start = bson_get_monotonic_time ();
+
+   for (i = 0; i < 100; i++) {
+      bulk = mongoc_collection_create_bulk_operation (collection, true, NULL);
+      for (j = 0; j < 1000; j++) {
+         bson_init (&doc);
+         BSON_APPEND_INT32 (&doc, "i", i * 1000 + j);
+         mongoc_bulk_operation_insert (bulk, &doc);
+         bson_destroy (&doc);
+      }
+
+      if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+         fprintf (stderr, "insert failed: %s\n", error.message);
+         return EXIT_FAILURE;
+      }
+
+      mongoc_bulk_operation_destroy (bulk);
+   }
+
+   elapsed = (double) (bson_get_monotonic_time () - start) / 1e6;
+
+   printf ("100 batches of 1000 inserts in %.3f sec, %.0f inserts per sec\n",
+           elapsed,
+           100 * 1000 / elapsed);
+
+   mongoc_collection_drop (collection, NULL);
+   mongoc_collection_destroy (collection);
+
+   mongoc_client_pool_push (pool, first);
+
+   bson_free (clients);
+   bson_destroy (&ping);
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+   mongoc_cleanup ();
+
+   return EXIT_SUCCESS;
+#else
+   fprintf (stderr, "%s requires libmongoc built with TLS\n", argv[0]);
+   return EXIT_FAILURE;
+#endif
+}